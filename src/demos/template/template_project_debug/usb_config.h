@@ -84,8 +84,8 @@
 #elif defined(USB_IS_HID)
     #if defined(__C30__)
         //#define USB_PING_PONG_MODE USB_PING_PONG__NO_PING_PONG
-        //#define USB_PING_PONG_MODE USB_PING_PONG__FULL_PING_PONG
-        #define USB_PING_PONG_MODE USB_PING_PONG__EP0_OUT_ONLY
+        #define USB_PING_PONG_MODE USB_PING_PONG__FULL_PING_PONG
+        //#define USB_PING_PONG_MODE USB_PING_PONG__EP0_OUT_ONLY
         //#define USB_PING_PONG_MODE USB_PING_PONG__ALL_BUT_EP0        //NOTE: This mode is not supported in PIC18F4550 family rev A3 devices
     #elif defined(__PIC32MX__)
         #define USB_PING_PONG_MODE USB_PING_PONG__FULL_PING_PONG
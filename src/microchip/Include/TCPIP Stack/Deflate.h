@@ -0,0 +1,119 @@
+/**
+ * @brief           Streaming deflate (gzip) compressor
+ * @file            Deflate.h
+ * @author          <a href="www.modtronix.com">Modtronix Engineering</a>
+ * @compiler        MPLAB XC16
+ *
+ * @section deflate_desc Description
+ *****************************************
+ * Lightweight streaming compressor that generates a gzip (RFC 1952) stream. All data of a stream
+ * is encoded as a single deflate block with fixed Huffman codes (RFC 1951). Data is given in chunks
+ * of up to DEFLATE_BUF_SIZE bytes, and the last DEFLATE_WIN_SIZE bytes of previous chunks are kept
+ * as history. Matches can refer back to earlier chunks, so data that is generated in many small
+ * pieces (like dynamic web pages) still compresses well. Using fixed Huffman codes and a small
+ * window keeps RAM usage low, and makes it possible to compress data as it is generated.
+ *
+ * Fixed Huffman codes can make data that does not compress up to 12.5% larger. The caller can use
+ * DEFLATE_CONTEXT.isize and osize to check the ratio, and not compress similar data in future.
+ *
+ * It is used by the HTTP server to compress dynamic responses, see HTTP_USE_DEFLATE.
+ *
+ * @subsection deflate_usage Usage
+ *****************************************
+ * - Call DeflateInit() to start a new gzip stream.
+ * - Call DeflateBlock() for each chunk of data. The first call also outputs the gzip header.
+ * - Call DeflateFinish() to end the stream, this ends the deflate block and outputs the gzip trailer.
+ *
+ **********************************************************************
+ * @section deflate_lic Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ *********************************************************************/
+#ifndef __DEFLATE_H
+#define __DEFLATE_H
+
+//Maximum number of bytes compressed with one call to DeflateBlock()
+#if !defined(DEFLATE_BUF_SIZE)
+    #define DEFLATE_BUF_SIZE        (128u)
+#endif
+
+//Number of bytes of previous chunks kept as history, matches can refer back to them
+#if !defined(DEFLATE_WIN_SIZE)
+    #define DEFLATE_WIN_SIZE        (256u)
+#endif
+
+#if ((DEFLATE_WIN_SIZE + DEFLATE_BUF_SIZE) > 1024u)
+#error "DEFLATE_WIN_SIZE + DEFLATE_BUF_SIZE must be 1024 or less!"
+#endif
+
+//Maximum number of bytes DeflateBlock() can output in addition to the length of given data, each
+//byte can use 9 bits. Is also the maximum number of bytes output by DeflateFinish().
+#define DEFLATE_MAX_OVERHEAD        ((DEFLATE_BUF_SIZE/8u) + 24u)
+
+//Size of hash table used to find matches, must be a power of 2
+#if !defined(DEFLATE_HASH_SIZE)
+    #define DEFLATE_HASH_SIZE       (64u)
+#endif
+
+
+// Context storage for a deflate stream
+typedef struct
+{
+    DWORD crc;          // CRC32 of uncompressed data
+    DWORD isize;        // Length of uncompressed data
+    DWORD osize;        // Length of compressed data output so far, including gzip header and trailer
+    DWORD bitBuf;       // Bits not written to output yet, LSB first
+    BYTE bitCnt;        // Number of bits in bitBuf
+    BYTE flags;         // DEFLATE_FLAG_XX flags
+    WORD histLen;       // Number of history bytes at start of win
+    WORD hashNext;      // Position in win of next byte to add to hashHead
+    WORD hashHead[DEFLATE_HASH_SIZE];               // (Position in win + 1) of last 3 bytes with each hash value, 0 if none
+    BYTE win[DEFLATE_WIN_SIZE + DEFLATE_BUF_SIZE];  // History, followed by chunk being compressed
+} DEFLATE_CONTEXT;
+
+
+/**
+ * Initializes the given context for a new gzip stream.
+ *
+ * @param ctx The context to initialize
+ */
+void DeflateInit(DEFLATE_CONTEXT* ctx);
+
+
+/**
+ * Compresses the given chunk of data, and writes it to the output buffer. On the first call for a
+ * stream, the gzip header and deflate block header are written first. Output bits that do not
+ * complete a byte are kept in the context, and written by the next call.
+ *
+ * @param ctx The context of the stream
+ * @param in Data to compress
+ * @param len Number of bytes in "in", maximum is DEFLATE_BUF_SIZE
+ * @param out Buffer to write compressed data to, must be at least (len + DEFLATE_MAX_OVERHEAD) bytes long
+ * @return Number of bytes written to out
+ */
+WORD DeflateBlock(DEFLATE_CONTEXT* ctx, BYTE* in, WORD len, BYTE* out);
+
+
+/**
+ * Ends the gzip stream. Writes the end of the deflate block, and the gzip trailer to the output buffer.
+ *
+ * @param ctx The context of the stream
+ * @param out Buffer to write data to, must be at least DEFLATE_MAX_OVERHEAD bytes long
+ * @return Number of bytes written to out
+ */
+WORD DeflateFinish(DEFLATE_CONTEXT* ctx, BYTE* out);
+
+#endif
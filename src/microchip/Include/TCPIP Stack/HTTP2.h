@@ -54,6 +54,7 @@
 #define __HTTP2_H
 
 #include "TCPIP Stack/TCPIP.h"
+#include "cmd.h"    //MODTRONIX added this line. Defines CMD_COMPILED_TAG
 
 #if defined(STACK_USE_HTTP2_SERVER)
 
@@ -73,6 +74,38 @@
     #endif
     #if !defined(HTTP_MIN_CALLBACK_FREE)
         #define HTTP_MIN_CALLBACK_FREE	(16u)
+    #endif
+    #if !defined(HTTP_TAG_CACHE_SIZE)
+        #define HTTP_TAG_CACHE_SIZE     (32u)   //MODTRONIX added. Number of entries in tag cache, entry is selected with callbackID % HTTP_TAG_CACHE_SIZE
+    #endif
+    //MODTRONIX added next 6 lines. If compressing a file's response saves less than 1/8 of its size, the next
+    //HTTP_DEFLATE_SKIP_CNT responses for that file are sent uncompressed. Up to HTTP_DEFLATE_STATS_SIZE files are remembered.
+    #if !defined(HTTP_DEFLATE_STATS_SIZE)
+        #define HTTP_DEFLATE_STATS_SIZE (4u)
+    #endif
+    #if !defined(HTTP_DEFLATE_SKIP_CNT)
+        #define HTTP_DEFLATE_SKIP_CNT   (16u)
+    #endif
+
+    //MODTRONIX added. Server-Sent Events push channel, enabled with HTTP_USE_SSE. A client requests
+    //"/events?t=i1,o2,x5" (comma separated list of tags), and is sent "data: i1=0&x5=12\n\n" events
+    //with the tags that changed since the previous event.
+    #if defined(HTTP_USE_SSE)
+    #if !defined(HTTP_SSE_PATH)
+        #define HTTP_SSE_PATH               "events"            // Path of the event stream, without leading '/'
+    #endif
+    #if !defined(HTTP_SSE_MAX_CONNECTIONS)
+        #define HTTP_SSE_MAX_CONNECTIONS    (1u)                // Maximum number of open event streams, must be less than MAX_HTTP_CONNECTIONS
+    #endif
+    #if !defined(HTTP_SSE_MAX_TAGS)
+        #define HTTP_SSE_MAX_TAGS           (16u)               // Maximum number of tags per event stream. Uses 2 bytes of curHTTP.data per tag
+    #endif
+    #if !defined(HTTP_SSE_INTERVAL)
+        #define HTTP_SSE_INTERVAL           (TICK_SECOND/10)    // Time between checking tags for changes
+    #endif
+    #if !defined(HTTP_SSE_KEEPALIVE)
+        #define HTTP_SSE_KEEPALIVE          (15ul*TICK_SECOND)  // Send a comment if nothing was sent for this time
+    #endif
     #endif
 	#define HTTP_CACHE_LEN			("600")	// Max lifetime (sec) of static responses as string
 	#define HTTP_TIMEOUT			(45u)	// Max time (sec) to await more data before timing out and disconnecting the socket
@@ -109,6 +142,10 @@
 		#endif
 		HTTP_REDIRECT,					// 302 Redirect will be returned
 		HTTP_SSL_REQUIRED				// 403 Forbidden is returned, indicating SSL is required
+		#if defined(HTTP_USE_SSE)
+		,HTTP_SSE,						// MODTRONIX added. An event stream is being served
+		HTTP_SSE_BUSY					// MODTRONIX added. 503 returned, maximum number of event streams are open
+		#endif
 	} HTTP_STATUS;
 
 /****************************************************************************
@@ -130,7 +167,8 @@
 		SM_HTTP_SERVE_COOKIES,			// Adds any cookies to the response
 		SM_HTTP_SERVE_BODY,				// Serves the actual content
 		SM_HTTP_SEND_FROM_CALLBACK,		// Invokes a dynamic variable callback
-		SM_HTTP_DISCONNECT				// Disconnects the server and closes all files
+		SM_HTTP_DISCONNECT,				// Disconnects the server and closes all files
+		SM_HTTP_SSE						// MODTRONIX added. Sends changed tags to an event stream
 	} SM_HTTP2;
 
 	// Result states for execution callbacks
@@ -196,12 +234,14 @@
                                             // - Is used to pass information to POST processing functions. From SM_HTTP_PARSE_REQUEST to SM_HTTP_PARSE_HEADERS (use in HTTPHeaderParseLookup())
 		DWORD callbackID;					// Callback ID to execute, also used as watchdog timer
 		DWORD callbackPos;					// Callback position indicator
+        CMD_COMPILED_TAG compiledTag;       // MODTRONIX added. Compiled tag for current callback, handler CMD_TAG_HANDLER_NONE = none
 		BYTE *ptrData;						// Points to first free byte in data
 		BYTE *ptrRead;						// Points to current read location
         BYTE *ptrCookies;                   // Points to start of cookies in data
 		MPFS_HANDLE file;					// File pointer for the file being served
 	    MPFS_HANDLE offsets;				// File pointer for any offset info being used
 		BYTE hasArgs;						// True if there were get or cookie arguments
+        BYTE acceptEncoding;                // MODTRONIX added. HTTP_ACCEPT_XX flags
 		BYTE isAuthorized;					// 0x00-0x79 on fail, 0x80-0xff on pass
 		HTTP_STATUS httpStatus;				// Request method/status
 	    HTTP_FILE_TYPE fileType;			// File type to return with Content-Type
@@ -213,6 +253,10 @@
 		#endif
 	} HTTP_CONN;
 
+    // MODTRONIX added. Flags for HTTP_CONN.acceptEncoding
+    #define HTTP_ACCEPT_GZIP    0x01        // Client accepts gzip content encoding
+    #define HTTP_ACCEPT_VARY    0x02        // Response depends on Accept-Encoding header, send "Vary" header
+
 #if defined(HTTP_SAVE_CONTEXT_IN_PIC_RAM)
 	#define RESERVED_HTTP_MEMORY 0ul        // Macro indicating how much RAM to allocate on an ethernet controller to store HTTP state data.
 #else
@@ -241,6 +285,7 @@ extern BYTE curHTTPID;
 
 void HTTPInit(void);
 void HTTPServer(void);
+void HTTPTagCacheInvalidate(void);  //MODTRONIX added this line
 BYTE* HTTPURLDecode(BYTE* cData);
 BYTE* HTTPGetArg(BYTE* cData, BYTE* cArg);
 void HTTPIncFile(ROM BYTE* cFile);
@@ -62,6 +62,26 @@
 	#endif
 */
 
+	//MODTRONIX added next 4 lines
+	// Size of RAM buffer used to move file data to the MAC when the MPFS image can not be written to the MAC directly
+	#if !defined(MPFS_COPY_BUF_SIZE)
+		#define MPFS_COPY_BUF_SIZE			(128u)
+	#endif
+
+	//MODTRONIX added next 12 lines
+	// Set associative read cache for MPFS images in SPI Flash. Define MPFS_CACHE_WAYS as 0 to disable it.
+	#if defined(MPFS_USE_SPI_FLASH)
+		#if !defined(MPFS_CACHE_WAYS)
+			#define MPFS_CACHE_WAYS				(4u)	// Number of lines in each set, maximum 255
+		#endif
+		#if !defined(MPFS_CACHE_SETS)
+			#define MPFS_CACHE_SETS				(1u)	// Number of sets, must be a power of 2
+		#endif
+		#if !defined(MPFS_CACHE_LINE_SIZE)
+			#define MPFS_CACHE_LINE_SIZE		(256u)	// Size of each line in bytes, must be a power of 2
+		#endif
+	#endif
+
 	#if defined(MPFS_USE_EEPROM)
 		#if defined(USE_EEPROM_25LC1024)
 			#define MPFS_WRITE_PAGE_SIZE		(256u)	// Defines the size of a page in EEPROM
@@ -133,6 +153,7 @@ BOOL MPFSGet(MPFS_HANDLE hMPFS, BYTE* c);
 WORD MPFSGetArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen);
 BOOL MPFSGetLong(MPFS_HANDLE hMPFS, DWORD* ul);
 BOOL MPFSSeek(MPFS_HANDLE hMPFS, DWORD dwOffset, MPFS_SEEK_MODE tMode);
+WORD MPFSGetArrayToMAC(MPFS_HANDLE hMPFS, WORD wLen);   //MODTRONIX added this line
 #if defined(__C30__)
 	// Assembly function to read all three bytes of program memory for 16-bit parts
 	extern DWORD ReadProgramMemory(DWORD address);
@@ -142,6 +163,12 @@ MPFS_HANDLE MPFSFormat(void);
 void MPFSPutEnd(BOOL final);
 WORD MPFSPutArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen);
 
+//MODTRONIX added next 4 lines
+#if defined(MPFS_USE_SPI_FLASH) && (MPFS_CACHE_WAYS > 0)
+void MPFSCacheInvalidate(void);
+void MPFSCacheGetStats(DWORD* pHits, DWORD* pMisses);
+#endif
+
 DWORD MPFSGetTimestamp(MPFS_HANDLE hMPFS);
 DWORD MPFSGetMicrotime(MPFS_HANDLE hMPFS);
 WORD MPFSGetFlags(MPFS_HANDLE hMPFS);
@@ -156,4 +183,9 @@ WORD MPFSGetID(MPFS_HANDLE hMPFS);
 // Alias of MPFSGetPosition
 #define MPFSTell(a)	MPFSGetPosition(a)
 
+//MODTRONIX added next 3 lines
+#if defined(STACK_USE_TCP)
+	WORD TCPPutMPFS(TCP_SOCKET hTCP, MPFS_HANDLE hMPFS, WORD len);
+#endif
+
 #endif
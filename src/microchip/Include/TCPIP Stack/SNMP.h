@@ -65,6 +65,13 @@
 
 #define SNMP_BIB_FILE_NAME		"snmp.bib"
 
+//MODTRONIX added. Number of snmp.bib nodes held in the in-RAM MIB index, each uses 10 bytes of RAM.
+//MIB lookups and walks read nodes from the index, and only nodes not in it from MPFS. Set to 0 to
+//disable the index.
+#if !defined(SNMP_MIB_INDEX_SIZE)
+    #define SNMP_MIB_INDEX_SIZE     (128u)
+#endif
+
 
 // Section:  SNMP Tx pdu offset settings
 #define _SNMPSetTxOffset(o)     (SNMPTxOffset = o)
@@ -141,6 +148,21 @@ and implementation  supports more than 484 whenever
 feasible.*/
 #define SNMP_MAX_MSG_SIZE  484
 
+//MODTRONIX added. Size of RAM buffer SNMP messages are built in before they are written to the UDP
+//socket with a single UDPPutArray(). SNMPv1/v2c responses are always truncated to SNMP_MAX_MSG_SIZE
+//before being sent. Larger SNMPv3 messages are written directly to the UDP socket. Messages that do
+//not fit are discarded, and counted in snmpTxDropCnt.
+#if !defined(SNMP_TX_BUF_SIZE)
+    #define SNMP_TX_BUF_SIZE        (SNMP_MAX_MSG_SIZE + 64u)
+#endif
+
+//MODTRONIX added. Number of GetBulk repeater varbinds whose OID and last MIB record are cached.
+//Repetitions of cached varbinds continue from the last record, instead of parsing the request
+//and searching the MIB again. Each entry uses about 50 bytes of RAM, set to 0 to disable.
+#if !defined(SNMP_BULK_CACHE_SIZE)
+    #define SNMP_BULK_CACHE_SIZE    (4u)
+#endif
+
 // Section:  SNMP agent version types
 #define SNMP_V1                 (0)
 #define SNMP_V2C				(1)
@@ -277,6 +299,19 @@ typedef struct
 } OID_INFO;
 
 
+// MODTRONIX added. Section:  Parsed snmp.bib node, as stored in the in-RAM MIB index
+typedef struct
+{
+	WORD			hNode;		//Node location in the mib
+	WORD			hSibling;	//Sibling, or distant sibling for leaf nodes. 0 if none
+	WORD			id;			//Snmp Id, 0 if none
+	BYTE			oid;		//Object Id
+	MIB_INFO		nodeInfo;	//Node info
+	BYTE			dataType;	//Data type, leaf nodes only
+	BYTE			hdrLen;		//Length of node header. Child node (parent) or data (leaf) follows header
+} SNMP_MIB_NODE;
+
+
 // Section:  SNMP pdu information database 
 typedef struct 
 {
@@ -470,6 +505,10 @@ BOOL GetOIDStringByID(SNMP_ID id, OID_INFO* info, BYTE* oidString, BYTE* len);
 extern BOOL IsValidInt(DWORD* val);
 extern BYTE _SNMPGet(void);
 extern void _SNMPPut(BYTE v);
+extern void _SNMPPutArray(BYTE* p, WORD len);
+extern void _SNMPPutLenAt(WORD offset, WORD len);
+extern void _SNMPFlush(void);
+extern WORD snmpTxDropCnt;
 
 
 extern 	void SetErrorStatus(WORD errorStatusOffset,WORD errorIndexOffset, SNMP_ERR_STATUS errorStatus,BYTE errorIndex);
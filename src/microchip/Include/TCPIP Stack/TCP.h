@@ -288,6 +288,12 @@ WORD TCPGetTxFIFOFull(TCP_SOCKET hTCP);
 #define TCP_ADJUST_PRESERVE_TX		0x08u	// Resize flag: attempt to preserve TX buffer
 BOOL TCPAdjustFIFOSize(TCP_SOCKET hTCP, WORD wMinRXSize, WORD wMinTXSize, BYTE vFlags);
 
+//MODTRONIX added. Capture TX data in RAM buffer
+#if defined(TCP_USE_TX_CAPTURE)
+void TCPStartTxCapture(TCP_SOCKET hTCP, BYTE* buffer, WORD size);
+WORD TCPEndTxCapture(void);
+#endif
+
 #if defined(STACK_USE_SSL)
 BOOL TCPStartSSLClient(TCP_SOCKET hTCP, BYTE* host);
 BOOL TCPStartSSLClientEx(TCP_SOCKET hTCP, BYTE* host, void * buffer, BYTE suppDataType);
@@ -151,6 +151,17 @@
 		#endif
 	#endif
 	
+	//MODTRONIX added. On-the-fly compression of HTTP responses requires the
+	//deflate module, and capturing of TCP TX data
+	#if defined(HTTP_USE_DEFLATE)
+		#if !defined(STACK_USE_HTTP2_SERVER)
+			#undef HTTP_USE_DEFLATE
+		#else
+			#define STACK_USE_DEFLATE
+			#define TCP_USE_TX_CAPTURE
+		#endif
+	#endif
+	
 	// Make sure that the DNS client is enabled if services require it
 	#if defined(STACK_USE_GENERIC_TCP_CLIENT_EXAMPLE) || \
 		defined(STACK_USE_SNTP_CLIENT) || \
@@ -320,6 +331,10 @@
 	#include "TCPIP Stack/Hashes.h"
 #endif
 
+#if defined(STACK_USE_DEFLATE)
+	#include "TCPIP Stack/Deflate.h"
+#endif
+
     //MODTRONIX commented next 3 lines
 	//#include "TCPIP Stack/XEEPROM.h"
 	//#include "TCPIP Stack/SPIFlash.h"
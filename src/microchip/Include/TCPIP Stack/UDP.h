@@ -138,6 +138,25 @@ typedef struct
 #define UDP_OPEN_NODE_INFO	4u
 
 
+// MODTRONIX added. Buffer of a scatter/gather list, used by UDPSendV() and UDPRecvV()
+typedef struct
+{
+    BYTE* data;         // Pointer to buffer
+    WORD len;           // Number of bytes in buffer
+} UDP_IOVEC;
+
+// MODTRONIX added. Bytes of RAM used to queue datagrams given to UDPSendV() while the MAC TX buffer
+// is busy. Queued datagrams are transmitted by UDPTask(). If 0, the TX queue is disabled.
+#if !defined(UDP_TX_QUEUE_SIZE)
+    #define UDP_TX_QUEUE_SIZE   (0u)
+#endif
+
+// MODTRONIX added. Maximum number of datagrams in TX queue
+#if !defined(UDP_TX_QUEUE_DESCS)
+    #define UDP_TX_QUEUE_DESCS  (4u)
+#endif
+
+
 /****************************************************************************
   Section:
 	Function Prototypes
@@ -157,6 +176,7 @@ BOOL UDPPut(BYTE v);
 WORD UDPPutArray(BYTE *cData, WORD wDataLen);
 BYTE* UDPPutString(BYTE *strData);
 void UDPFlush(void);
+void UDPDiscardTx(void);    //MODTRONIX added this line
 
 // ROM function variants for PIC18
 #if defined(__18CXX)
@@ -172,6 +192,8 @@ BOOL UDPGet(BYTE *v);
 WORD UDPGetArray(BYTE *cData, WORD wDataLen);
 void UDPDiscard(void);
 BOOL UDPIsOpened(UDP_SOCKET socket);
+WORD UDPSendV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt);
+WORD UDPRecvV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt);
 
 /*****************************************************************************
   Function:
@@ -53,7 +53,10 @@
     #if defined(SOFTWARE_SECURITY)
     
         //#define XTEA_128
-        #define XTEA_64
+        //#define AES_128         //MODTRONIX added. Table driven AES-128, 128bit block and key. Faster than XTEA on 16 and 32 bit MCUs
+        #if !defined(XTEA_128) && !defined(AES_128)
+            #define XTEA_64
+        #endif
         
         #define XTEA_ROUND  32
 
@@ -73,6 +76,10 @@
             #define BLOCK_SIZE 4
             #define BLOCK_UNIT WORD
             #define KEY_SIZE 8
+        #elif defined(AES_128)
+            #define BLOCK_SIZE 16
+            #define BLOCK_UNIT BYTE
+            #define KEY_SIZE 16
         #endif
         
         #if SECURITY_LEVEL == SEC_LEVEL_CTR
@@ -98,6 +105,14 @@
         void CBC_MAC(BYTE *text, BYTE len, BYTE *key, BYTE *MIC);
         void CCM_Enc(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key);
         BOOL CCM_Dec(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key);
+        //MODTRONIX added next 7 lines. With AES_128, CCM_Enc() and CCM_Dec() are IEEE 802.15.4 CCM*, with the nonce taken from the header
+        #if defined(AES_128)
+            #if SECURITY_LEVEL == SEC_LEVEL_CCM_16
+                #error "CCM* has no 16 bit MIC, use SEC_LEVEL_CCM_32 or SEC_LEVEL_CCM_64 with AES_128"
+            #endif
+            void CCMStar_Enc(BYTE *nonce, BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE micLen, BYTE *key);
+            BOOL CCMStar_Dec(BYTE *nonce, BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE micLen, BYTE *key);
+        #endif
     
     #endif
 
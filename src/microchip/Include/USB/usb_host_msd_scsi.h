@@ -84,6 +84,35 @@ Change History:
 // *****************************************************************************
 // *****************************************************************************
 
+//MODTRONIX added next 27 lines
+// Maximum number of sectors transferred by a single READ10 or WRITE10 command.
+// Larger requests are split into multiple commands.
+#if !defined(USB_MSD_SCSI_MAX_SECTORS_PER_TRANSFER)
+    #define USB_MSD_SCSI_MAX_SECTORS_PER_TRANSFER   64
+#endif
+
+// Number of sectors read with a single READ10 command when sequential reads are
+// detected. Requires USB_MSD_SCSI_READ_AHEAD_SECTORS * 512 bytes of RAM. Set to
+// 0 (default) to disable read-ahead.
+#if !defined(USB_MSD_SCSI_READ_AHEAD_SECTORS)
+    #define USB_MSD_SCSI_READ_AHEAD_SECTORS         0
+#endif
+
+// Number of consecutive sector writes collected before they are written with a
+// single WRITE10 command. Requires USB_MSD_SCSI_WRITE_BEHIND_SECTORS * 512 bytes
+// of RAM. Any other write (FAT and directory entry) first writes the collected
+// sectors. When enabled, USBHostMSDSCSIFlush() must be called after closing a
+// file (FileClose() does this). Set to 0 (default) to disable write-behind.
+#if !defined(USB_MSD_SCSI_WRITE_BEHIND_SECTORS)
+    #define USB_MSD_SCSI_WRITE_BEHIND_SECTORS       0
+#endif
+
+// Sector size used by the read-ahead and write-behind buffers. Media with a
+// different sector size bypass the buffers.
+#if !defined(USB_MSD_SCSI_CACHE_SECTOR_SIZE)
+    #define USB_MSD_SCSI_CACHE_SECTOR_SIZE          512
+#endif
+
 
 // *****************************************************************************
 // *****************************************************************************
@@ -297,6 +326,34 @@ BYTE    USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer );
 BYTE    USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero);
 
 
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSIFlush( void )
+
+  Summary:
+    This function writes all sectors waiting in the write-behind buffer.
+
+  Description:
+    This function writes all sectors waiting in the write-behind buffer to
+    the media.  Does nothing if USB_MSD_SCSI_WRITE_BEHIND_SECTORS is 0.
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Return Values:
+    TRUE    - write performed successfully, or nothing to write
+    FALSE   - write was not successful
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSIFlush( void );
+
+
 /****************************************************************************
   Function:
     BYTE USBHostMSDSCSIWriteProtectState( void )
@@ -219,6 +219,22 @@ typedef struct
 } INDIRECT_MESSAGE;
 
 
+/******************************************************************
+ * Overview: Lookup counters for the connection table hash indices. Only
+ * available if CONNECTION_HASH_SIZE is defined.
+ *****************************************************************/
+#if defined(CONNECTION_HASH_SIZE)
+typedef struct _CONNECTION_LOOKUP_STATS
+{
+    WORD        shortLookups;       // number of SearchForShortAddress calls
+    WORD        shortHits;          // short address lookups resolved by the hash index
+    WORD        longLookups;        // number of SearchForLongAddress calls
+    WORD        longHits;           // long address lookups resolved by the hash index
+    WORD        scans;              // lookups that fell back to a linear scan of the connection table
+} CONNECTION_LOOKUP_STATS;
+#endif
+
+
 /************************ EXTERNAL VARIABLES **********************/
 
 extern MIWI_STATE_MACHINE MiWiStateMachine;
@@ -230,6 +246,9 @@ extern BYTE myParent;
 extern BYTE tempLongAddress[MY_ADDRESS_LENGTH];
 extern WORD_VAL tempShortAddress;
 extern OPEN_SOCKET openSocketInfo;
+#if defined(CONNECTION_HASH_SIZE)
+    extern CONNECTION_LOOKUP_STATS connLookupStats;
+#endif
 
 /************************ MACROS **********************************/
 #define MAC_FlushTx() {TxData = 0;}
@@ -353,6 +353,20 @@
         /*********************************************************************/
         #define FA_COMM_INTERVAL            (ONE_SECOND)
         
+        
+        /*********************************************************************/
+        // CONNECTION_HASH_SIZE enables hash indices on the short and long
+        // addresses of the connection table, so SearchForShortAddress and
+        // SearchForLongAddress do not have to scan the whole table for every
+        // received frame. Each index holds the connection table index last
+        // found for a hash bucket, and is verified against the table before
+        // use, so a stale or colliding bucket falls back to a linear scan.
+        // Must be a power of 2, not more than 256. It is recommended to be
+        // equal or higher than CONNECTION_SIZE. Uses 2 * CONNECTION_HASH_SIZE
+        // bytes of RAM.
+        /*********************************************************************/
+        //#define CONNECTION_HASH_SIZE        32
+        
     #endif
 #endif
 
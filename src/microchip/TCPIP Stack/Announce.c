@@ -71,6 +71,42 @@
 
 extern NODE_INFO remoteNode;
 
+static BYTE AnnouncePutMAC(BYTE* buf);    //MODTRONIX added this line
+
+/*********************************************************************
+ * Function:        static BYTE AnnouncePutMAC(BYTE* buf)
+ *
+ * Summary:         MODTRONIX added. Writes "\r\n", followed by our MAC
+ *                  address in human readable form, to the given buffer.
+ *
+ * PreCondition:    None
+ *
+ * Input:           buf - Buffer to write to, at least 19 bytes long
+ *
+ * Output:          Number of bytes written
+ ********************************************************************/
+static BYTE AnnouncePutMAC(BYTE* buf)
+{
+	BYTE i;
+	BYTE n;
+
+	buf[0] = '\r';
+	buf[1] = '\n';
+	n = 2;
+
+	// Convert the MAC address bytes to hex (text)
+	i = 0;
+	while(1)
+	{
+		buf[n++] = btohexa_high(AppConfig.MyMACAddr.v[i]);
+		buf[n++] = btohexa_low(AppConfig.MyMACAddr.v[i]);
+		if(++i == 6u)
+			break;
+		buf[n++] = '-';
+	}
+	return n;
+}
+
 /****************************************************************************************************
   Function:
             void AnnounceIP(void)
@@ -98,7 +134,8 @@ extern NODE_INFO remoteNode;
 void AnnounceIP(void)
 {
 	UDP_SOCKET	MySocket;
-	BYTE 		i;
+	UDP_IOVEC	iov[2];     //MODTRONIX added this line
+	BYTE		buf[48];    //MODTRONIX added this line
 
 	if(!MACIsLinked())  // Check for link before blindly opening and transmitting (similar to DHCP case)
 		return;
@@ -113,9 +150,6 @@ void AnnounceIP(void)
 	if(MySocket == INVALID_UDP_SOCKET)
 		return;
 	
-	// Make certain the socket can be written to
-	while(!UDPIsPutReady(MySocket));
-	
 	// Begin sending our MAC address in human readable form.
 	// The MAC address theoretically could be obtained from the 
 	// packet header when the computer receives our UDP packet, 
@@ -124,26 +158,19 @@ void AnnounceIP(void)
 	// would be lost if this broadcast packet were forwarded by a
 	// router to a different portion of the network (note that 
 	// broadcasts are normally not forwarded by routers).
-	UDPPutArray((BYTE*)AppConfig.NetBIOSName, sizeof(AppConfig.NetBIOSName)-1);
-	UDPPut('\r');
-	UDPPut('\n');
-
-	// Convert the MAC address bytes to hex (text) and then send it
-	i = 0;
-	while(1)
-	{
-		UDPPut(btohexa_high(AppConfig.MyMACAddr.v[i]));
-	    UDPPut(btohexa_low(AppConfig.MyMACAddr.v[i]));
-	    if(++i == 6u)
-	    	break;
-	    UDPPut('-');
-	}
+	//MODTRONIX, was written with UDPPut() functions after waiting for UDPIsPutReady(). UDPSendV() queues the
+	//packet if the MAC TX buffer is busy (UDP_TX_QUEUE_SIZE), and only waits here if the TX queue is disabled or full.
+	iov[0].data = (BYTE*)AppConfig.NetBIOSName;
+	iov[0].len = sizeof(AppConfig.NetBIOSName)-1;
+	iov[1].data = buf;
+	iov[1].len = AnnouncePutMAC(buf);
 
 	// Send some other human readable information.
-	UDPPutROMString((ROM BYTE*)"\r\nDHCP/Power event occurred");
+	strcpypgm2ram((char*)&buf[iov[1].len], (ROM char*)"\r\nDHCP/Power event occurred");
+	iov[1].len += strlen((char*)&buf[iov[1].len]);
 
 	// Send the packet
-	UDPFlush();
+	while(UDPSendV(MySocket, iov, 2) == 0u);
 	
 	// Close the socket so it can be used by other modules
 	UDPClose(MySocket);
@@ -184,6 +211,8 @@ void DiscoveryTask(void)
 
 	static UDP_SOCKET	MySocket;
 	BYTE 				i;
+	UDP_IOVEC			iov[2];     //MODTRONIX added this line
+	BYTE				buf[24];    //MODTRONIX added this line
 	
 	switch(DiscoverySM)
 	{
@@ -221,9 +250,6 @@ void DiscoveryTask(void)
 			// No break needed.  If we get down here, we are now ready for the DISCOVERY_REQUEST_RECEIVED state
 
 		case DISCOVERY_REQUEST_RECEIVED:
-			if(!UDPIsPutReady(MySocket))
-				return;
-
 			// Begin sending our MAC address in human readable form.
 			// The MAC address theoretically could be obtained from the 
 			// packet header when the computer receives our UDP packet, 
@@ -232,25 +258,18 @@ void DiscoveryTask(void)
 			// would be lost if this broadcast packet were forwarded by a
 			// router to a different portion of the network (note that 
 			// broadcasts are normally not forwarded by routers).
-			UDPPutArray((BYTE*)AppConfig.NetBIOSName, sizeof(AppConfig.NetBIOSName)-1);
-			UDPPut('\r');
-			UDPPut('\n');
-		
-			// Convert the MAC address bytes to hex (text) and then send it
-			i = 0;
-			while(1)
-			{
-				UDPPut(btohexa_high(AppConfig.MyMACAddr.v[i]));
-			    UDPPut(btohexa_low(AppConfig.MyMACAddr.v[i]));
-			    if(++i == 6u)
-			    	break;
-			    UDPPut('-');
-			}
-			UDPPut('\r');
-			UDPPut('\n');
+			//MODTRONIX, was written with UDPPut() functions after checking UDPIsPutReady(). UDPSendV() queues the
+			//reply if the MAC TX buffer is busy, and returns 0 if it could not be sent or queued.
+			iov[0].data = (BYTE*)AppConfig.NetBIOSName;
+			iov[0].len = sizeof(AppConfig.NetBIOSName)-1;
+			iov[1].data = buf;
+			iov[1].len = AnnouncePutMAC(buf);
+			buf[iov[1].len++] = '\r';
+			buf[iov[1].len++] = '\n';
 
-			// Send the packet
-			UDPFlush();
+			// Send the packet, try again next time if it could not be sent or queued
+			if(UDPSendV(MySocket, iov, 2) == 0u)
+				return;
 
 			// Listen for other discovery requests
 			DiscoverySM = DISCOVERY_LISTEN;
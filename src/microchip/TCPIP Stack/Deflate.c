@@ -0,0 +1,297 @@
+/**
+ * @brief           Streaming deflate (gzip) compressor
+ * @file            Deflate.c
+ * @author          <a href="www.modtronix.com">Modtronix Engineering</a>
+ * @compiler        MPLAB XC16
+ *
+ **********************************************************************
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ *********************************************************************/
+#define __DEFLATE_C
+
+//The host test (host/nz_deflateTest.c) defines DEFLATE_HOST, the types and nz_crc.c functions
+#if !defined(DEFLATE_HOST)
+#include "TCPIP Stack/TCPIP.h"
+#include "nz_crc.h"
+#endif
+
+#if defined(STACK_USE_DEFLATE)
+
+#define DEFLATE_FLAG_HEADER_SENT    0x01    //gzip header and deflate block header have been written
+
+#define DEFLATE_MIN_MATCH           3       //Minimum length of a match
+#define DEFLATE_MAX_MATCH           255     //Maximum length of a match, code 285 (length 258) is never used
+
+//Hash of 3 bytes at given pointer, used to index hashHead[]
+#define DEFLATE_HASH(p)     ((BYTE)(((p)[0] << 4) ^ ((p)[1] << 2) ^ (p)[2]) & (DEFLATE_HASH_SIZE-1))
+
+//gzip header: ID1, ID2, CM=8 (deflate), FLG=0, MTIME=0, XFL=0, OS=255 (unknown)
+static ROM BYTE gzipHeader[10] = {0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff};
+
+//Base length and extra bits for length codes 257 to 284
+static ROM BYTE lenBase[28] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227};
+static ROM BYTE lenExtra[28] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5};
+
+//Base distance and extra bits for distance codes 0 to 19. Distances are always 1024 or less.
+static ROM WORD distBase[20] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769};
+static ROM BYTE distExtra[20] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8};
+
+//Output state, used by putBits()
+static DEFLATE_CONTEXT* pCtx;
+static BYTE* pOut;
+static WORD outLen;
+
+
+/**
+ * Writes given bits to output, LSB first.
+ *
+ * @param bits The bits to write
+ * @param n Number of bits to write, maximum 16
+ */
+static void putBits(WORD bits, BYTE n) {
+    pCtx->bitBuf |= ((DWORD)bits) << pCtx->bitCnt;
+    pCtx->bitCnt += n;
+    while (pCtx->bitCnt >= 8) {
+        pOut[outLen++] = (BYTE)pCtx->bitBuf;
+        pCtx->bitBuf >>= 8;
+        pCtx->bitCnt -= 8;
+    }
+}
+
+
+/**
+ * Writes given Huffman code to output. Huffman codes are written MSB first.
+ *
+ * @param code The Huffman code
+ * @param n Number of bits in code
+ */
+static void putHuff(WORD code, BYTE n) {
+    WORD rev = 0;
+    BYTE i;
+
+    for (i = 0; i < n; i++) {
+        rev = (rev << 1) | (code & 0x01);
+        code >>= 1;
+    }
+    putBits(rev, n);
+}
+
+
+/**
+ * Writes given literal/length symbol to output, using the fixed Huffman code.
+ *
+ * @param sym The symbol, 0 to 287
+ */
+static void putSymbol(WORD sym) {
+    if (sym < 144)
+        putHuff(0x30 + sym, 8);
+    else if (sym < 256)
+        putHuff(0x190 + (sym - 144), 9);
+    else if (sym < 280)
+        putHuff(sym - 256, 7);
+    else
+        putHuff(0xc0 + (sym - 280), 8);
+}
+
+
+/**
+ * Writes given match to output, using the fixed Huffman code.
+ *
+ * @param len Length of match, 3 to 255
+ * @param dist Distance of match, 1 to 1024
+ */
+static void putMatch(BYTE len, WORD dist) {
+    BYTE i;
+
+    for (i = sizeof(lenBase)-1; lenBase[i] > len; i--);
+    putSymbol(257 + i);
+    if (lenExtra[i] != 0)
+        putBits(len - lenBase[i], lenExtra[i]);
+
+    for (i = (sizeof(distBase)/sizeof(distBase[0]))-1; distBase[i] > dist; i--);
+    putHuff(i, 5);
+    if (distExtra[i] != 0)
+        putBits(dist - distBase[i], distExtra[i]);
+}
+
+
+/**
+ * Writes gzip header and deflate block header to output if not done yet. All data of the stream
+ * is written in a single block.
+ */
+static void putHeader(void) {
+    if ((pCtx->flags & DEFLATE_FLAG_HEADER_SENT) == 0) {
+        memcpypgm2ram((void*)&pOut[outLen], (ROM void*)gzipHeader, sizeof(gzipHeader));
+        outLen += sizeof(gzipHeader);
+        pCtx->flags |= DEFLATE_FLAG_HEADER_SENT;
+
+        //BFINAL=1, BTYPE=01 (fixed Huffman codes)
+        putBits(0x03, 3);
+    }
+}
+
+
+/**
+ * Initializes the given context for a new gzip stream.
+ *
+ * @param ctx The context to initialize
+ */
+void DeflateInit(DEFLATE_CONTEXT* ctx) {
+    ctx->crc = 0xfffffffful;
+    ctx->isize = 0;
+    ctx->osize = 0;
+    ctx->bitBuf = 0;
+    ctx->bitCnt = 0;
+    ctx->flags = 0;
+    ctx->histLen = 0;
+    ctx->hashNext = 0;
+    memset((void*)ctx->hashHead, 0, sizeof(ctx->hashHead));
+}
+
+
+/**
+ * Compresses the given chunk of data, and writes it to the output buffer. On the first call for a
+ * stream, the gzip header and deflate block header are written first. Output bits that do not
+ * complete a byte are kept in the context, and written by the next call.
+ *
+ * @param ctx The context of the stream
+ * @param in Data to compress
+ * @param len Number of bytes in "in", maximum is DEFLATE_BUF_SIZE
+ * @param out Buffer to write compressed data to, must be at least (len + DEFLATE_MAX_OVERHEAD) bytes long
+ * @return Number of bytes written to out
+ */
+WORD DeflateBlock(DEFLATE_CONTEXT* ctx, BYTE* in, WORD len, BYTE* out) {
+    WORD pos;
+    WORD end;
+    WORD cand;
+    WORD maxLen;
+    WORD shift;
+    BYTE matchLen;
+    BYTE h;
+
+    if (len == 0)
+        return 0;
+    if (len > DEFLATE_BUF_SIZE)
+        len = DEFLATE_BUF_SIZE;
+
+    pCtx = ctx;
+    pOut = out;
+    outLen = 0;
+
+    //Update CRC32 and length of uncompressed data
+    ctx->crc = crc32Update(ctx->crc, in, len);
+    ctx->isize += len;
+
+    putHeader();
+
+    //Add new data after history
+    memcpy((void*)&ctx->win[ctx->histLen], (void*)in, len);
+    end = ctx->histLen + len;
+
+    for (pos = ctx->histLen; pos < end; ) {
+        //Add positions not added yet (inside last match, or at end of previous chunk) to hash table
+        while ((ctx->hashNext < pos) && ((ctx->hashNext + DEFLATE_MIN_MATCH) <= end)) {
+            ctx->hashHead[DEFLATE_HASH(&ctx->win[ctx->hashNext])] = ctx->hashNext + 1;
+            ctx->hashNext++;
+        }
+
+        //Find longest match at last position with same hash, can start in history
+        matchLen = 0;
+        if ((pos + DEFLATE_MIN_MATCH) <= end) {
+            h = DEFLATE_HASH(&ctx->win[pos]);
+            cand = ctx->hashHead[h];
+            ctx->hashHead[h] = pos + 1;
+            ctx->hashNext = pos + 1;
+            if (cand != 0) {
+                cand--;
+                maxLen = end - pos;
+                if (maxLen > DEFLATE_MAX_MATCH)
+                    maxLen = DEFLATE_MAX_MATCH;
+                while ((matchLen < maxLen) && (ctx->win[cand + matchLen] == ctx->win[pos + matchLen]))
+                    matchLen++;
+            }
+        }
+
+        if (matchLen >= DEFLATE_MIN_MATCH) {
+            putMatch(matchLen, pos - cand);
+            pos += matchLen;
+        }
+        else {
+            putSymbol(ctx->win[pos++]);
+        }
+    }
+
+    //Keep last DEFLATE_WIN_SIZE bytes as history for next chunk, and rebase hash table
+    if (end > DEFLATE_WIN_SIZE) {
+        shift = end - DEFLATE_WIN_SIZE;
+        memmove((void*)ctx->win, (void*)&ctx->win[shift], DEFLATE_WIN_SIZE);
+        for (h = 0; h < DEFLATE_HASH_SIZE; h++) {
+            if (ctx->hashHead[h] > shift)
+                ctx->hashHead[h] -= shift;
+            else
+                ctx->hashHead[h] = 0;
+        }
+        ctx->hashNext -= shift;
+        end = DEFLATE_WIN_SIZE;
+    }
+    ctx->histLen = end;
+
+    ctx->osize += outLen;
+    return outLen;
+}
+
+
+/**
+ * Ends the gzip stream. Writes the end of the deflate block, and the gzip trailer to the output buffer.
+ *
+ * @param ctx The context of the stream
+ * @param out Buffer to write data to, must be at least DEFLATE_MAX_OVERHEAD bytes long
+ * @return Number of bytes written to out
+ */
+WORD DeflateFinish(DEFLATE_CONTEXT* ctx, BYTE* out) {
+    DWORD dw;
+    BYTE i;
+
+    pCtx = ctx;
+    pOut = out;
+    outLen = 0;
+
+    putHeader();
+
+    //End of block, and pad last byte
+    putHuff(0, 7);
+    if (ctx->bitCnt != 0)
+        putBits(0x00, 8 - ctx->bitCnt);
+
+    //gzip trailer, CRC32 and ISIZE (LSB first)
+    dw = ~ctx->crc;
+    for (i = 0; i < 4; i++) {
+        out[outLen++] = (BYTE)dw;
+        dw >>= 8;
+    }
+    dw = ctx->isize;
+    for (i = 0; i < 4; i++) {
+        out[outLen++] = (BYTE)dw;
+        dw >>= 8;
+    }
+
+    ctx->osize += outLen;
+    return outLen;
+}
+
+#endif  //#if defined(STACK_USE_DEFLATE)
@@ -87,7 +87,15 @@ int FileClose(FILE_HANDLE fh)
     #if defined STACK_USE_MPFS2
         MPFSClose(fh);
     #elif defined STACK_USE_MDD 
-        return FSfclose(fh);
+        //MODTRONIX added next 7 lines. Write sectors still waiting in the USB MSD write-behind buffer
+        int ret;
+        ret = FSfclose(fh);
+        #if defined(USE_USB_INTERFACE)
+        if (!USBHostMSDSCSIFlush())
+            ret = EOF;
+        #endif
+        return ret;
+        //return FSfclose(fh);  //MODTRONIX commented this line
     #endif
 
     return 0;
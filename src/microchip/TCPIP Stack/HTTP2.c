@@ -158,6 +158,10 @@
 		#endif
 		"HTTP/1.1 302 Found\r\nConnection: close\r\nLocation: ",
 		"HTTP/1.1 403 Forbidden\r\nConnection: close\r\n\r\n403 Forbidden: SSL Required - use HTTPS\r\n"
+		#if defined(HTTP_USE_SSE)
+		,"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n",
+		"HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nRetry-After: 10\r\n\r\n503 Service Unavailable: Too many event streams\r\n"
+		#endif
 	};
 	
 /****************************************************************************
@@ -171,11 +175,12 @@
 		"Cookie:",
 		"Authorization:",
 		"Content-Length:",
-        "Content-Type:"
+        "Content-Type:",
+        "Accept-Encoding:"                      //MODTRONIX added
 	};
 	
 	// Set to length of longest string above
-	#define HTTP_MAX_HEADER_LEN		(15u)
+	#define HTTP_MAX_HEADER_LEN		(16u)
 
 	// Content-Type in header of HTTP POST message. MUST correspond to POST_CONTENT_TYPE in HTTP2.h!!
 	static ROM char * HTTPPostContentTypeHeaders[] =
@@ -204,6 +209,38 @@
 	#endif
 	HTTP_STUB httpStubs[MAX_HTTP_CONNECTIONS];	// HTTP stubs with state machine and socket
 	BYTE curHTTPID;								// ID of the currently loaded HTTP_CONN
+
+    //MODTRONIX added. Cache of tags found in MPFS files, is indexed by callbackID % HTTP_TAG_CACHE_SIZE.
+    //Only tags that don't require their name string are cached - HTTPPrint() callbacks, and compiled '#' tags.
+    typedef struct
+    {
+        WORD callbackID;            // Callback ID of tag, 0xffff = entry not valid
+        BYTE nameLen;               // Length of tag name string in MPFS file, excluding '~' delimiters
+        CMD_COMPILED_TAG tag;       // Compiled tag, handler CMD_TAG_HANDLER_NONE for HTTPPrint() callbacks
+    } HTTP_TAG_CACHE_ENTRY;
+    static HTTP_TAG_CACHE_ENTRY httpTagCache[HTTP_TAG_CACHE_SIZE];
+
+    //MODTRONIX added. Compressor for dynamic responses. Only one connection can use it at a time, given by httpDeflateOwner.
+    #if defined(HTTP_USE_DEFLATE)
+    static BYTE httpDeflateOwner = 0xff;                                // ID of connection using compressor, 0xff if none
+    static DEFLATE_CONTEXT httpDeflate;                                 // Context of gzip stream
+    static BYTE httpDeflateIn[DEFLATE_BUF_SIZE];                        // Uncompressed data captured from TCP socket
+    static BYTE httpDeflateOut[DEFLATE_BUF_SIZE+DEFLATE_MAX_OVERHEAD];  // Compressed data
+
+    //Files for which compressing did not pay, their responses are sent uncompressed for the next "skip" requests
+    typedef struct
+    {
+        WORD fileID;                // MPFS ID of file
+        BYTE skip;                  // Number of responses still to send uncompressed, 0 = entry not used
+    } HTTP_DEFLATE_STAT;
+    static HTTP_DEFLATE_STAT httpDeflateStats[HTTP_DEFLATE_STATS_SIZE];
+    #endif
+
+    //MODTRONIX added. Buffer that tag values are written to when checking event streams for changes
+    #if defined(HTTP_USE_SSE)
+    static CIRBUF httpSSEBuf;
+    static BYTE httpSSEVal[128];        // Must be a power of 2, and larger than largest value returned by cmdGetTag()
+    #endif
 	#if defined(__18CXX) && !defined(HI_TECH_C)	
 		#pragma udata
 	#endif
@@ -227,6 +264,17 @@
 	
 	static void HTTPProcess(void);
 	static BOOL HTTPSendFile(void);
+	static void HTTPHeaderParseAcceptEncoding(WORD len);
+	#if defined(HTTP_USE_DEFLATE)
+	static void HTTPDeflateStart(WORD len);
+	static void HTTPDeflateEnd(void);
+	static BOOL HTTPDeflateSkip(WORD fileID);
+	static void HTTPDeflateStat(WORD fileID);
+	#endif
+	#if defined(HTTP_USE_SSE)
+	static void HTTPSSEStart(void);
+	static void HTTPSSESend(void);
+	#endif
 
 	#if defined(HTTP_MPFS_UPLOAD)
 	static HTTP_IO_RESULT HTTPMPFSUpload(void);
@@ -283,12 +331,370 @@ void HTTPInit(void)
 		#endif
     }
 
+    HTTPTagCacheInvalidate();   //MODTRONIX added this line
+
 	// Set curHTTPID to zero so that first call to HTTPLoadConn() doesn't write 
 	// dummy data outside reserved HTTP memory.
     curHTTPID = 0;	
 }
 
 
+/*****************************************************************************
+  Function:
+	void HTTPTagCacheInvalidate(void)
+
+  Description:
+	Invalidates all entries of the tag cache. Must be called when the MPFS
+	image changes, seeing that callback IDs are assigned by the MPFS2 generator.
+	Is called by MPFSFormat() and MPFSPutEnd(), so all paths that write a new
+	image clear it.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+void HTTPTagCacheInvalidate(void)
+{
+    BYTE i;
+
+    for(i = 0; i < HTTP_TAG_CACHE_SIZE; i++)
+    {
+        httpTagCache[i].callbackID = 0xffff;
+    }
+}
+
+#if defined(HTTP_USE_DEFLATE)
+/*****************************************************************************
+  Function:
+	static void HTTPDeflateStart(WORD len)
+
+  Description:
+	Starts capturing data written to the current HTTP socket, so it can be
+	compressed by HTTPDeflateEnd() before it is sent.
+
+  Precondition:
+	Current connection owns the compressor (httpDeflateOwner == curHTTPID).
+
+  Parameters:
+	len - Maximum number of bytes to capture, up to sizeof(httpDeflateIn)
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPDeflateStart(WORD len)
+{
+    TCPStartTxCapture(sktHTTP, httpDeflateIn, len);
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPDeflateEnd(void)
+
+  Description:
+	Stops capturing data written to the current HTTP socket, compresses
+	the captured data and writes it to the socket.
+
+  Precondition:
+	HTTPDeflateStart() has been called, and the socket has at least
+	sizeof(httpDeflateOut) bytes free.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPDeflateEnd(void)
+{
+    WORD len;
+
+    len = TCPEndTxCapture();
+    len = DeflateBlock(&httpDeflate, httpDeflateIn, len, httpDeflateOut);
+    TCPPutArray(sktHTTP, httpDeflateOut, len);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL HTTPDeflateSkip(WORD fileID)
+
+  Description:
+	Checks if the response for the given file should be sent uncompressed,
+	because compressing it did not pay the last time. Each call that
+	returns TRUE uses up one of the skipped responses.
+
+  Precondition:
+	None
+
+  Parameters:
+	fileID - MPFS ID of the file
+
+  Returns:
+	TRUE if the response should not be compressed, else FALSE
+  ***************************************************************************/
+static BOOL HTTPDeflateSkip(WORD fileID)
+{
+    BYTE i;
+
+    for(i = 0; i < HTTP_DEFLATE_STATS_SIZE; i++)
+    {
+        if((httpDeflateStats[i].skip != 0u) && (httpDeflateStats[i].fileID == fileID))
+        {
+            httpDeflateStats[i].skip--;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPDeflateStat(WORD fileID)
+
+  Description:
+	Checks the ratio of the gzip stream that has just been finished. If less
+	than 1/8 of the size was saved, the next HTTP_DEFLATE_SKIP_CNT responses
+	for the given file are sent uncompressed. The entry with the fewest
+	skipped responses left is replaced if the table is full.
+
+  Precondition:
+	DeflateFinish() has been called for httpDeflate.
+
+  Parameters:
+	fileID - MPFS ID of the file that was compressed
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPDeflateStat(WORD fileID)
+{
+    BYTE i;
+    BYTE iUse;
+
+    if((httpDeflate.osize << 3) <= (httpDeflate.isize * 7u))
+        return;
+
+    iUse = 0;
+    for(i = 0; i < HTTP_DEFLATE_STATS_SIZE; i++)
+    {
+        if((httpDeflateStats[i].skip != 0u) && (httpDeflateStats[i].fileID == fileID))
+        {
+            iUse = i;
+            break;
+        }
+        if(httpDeflateStats[i].skip < httpDeflateStats[iUse].skip)
+            iUse = i;
+    }
+    httpDeflateStats[iUse].fileID = fileID;
+    httpDeflateStats[iUse].skip = HTTP_DEFLATE_SKIP_CNT;
+}
+#endif
+
+#if defined(HTTP_USE_SSE)
+/*****************************************************************************
+  Function:
+	static void HTTPSSEStart(void)
+
+  Description:
+	Prepares the current connection for serving an event stream. The comma
+	separated tag list given with the "t" GET argument is moved to
+	curHTTP.data. While the event stream is served, curHTTP.data contains:
+	- HTTP_SSE_MAX_TAGS 16-bit hashes of the last values sent, 0 if not sent
+	- The tag names, each NULL terminated, followed by an additional NULL
+
+	If HTTP_SSE_MAX_CONNECTIONS event streams are already open,
+	curHTTP.httpStatus is set to HTTP_SSE_BUSY.
+
+  Precondition:
+	GET arguments have been decoded to curHTTP.data.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPSSEStart(void)
+{
+    BYTE *ptr;
+    BYTE *dst;
+    WORD len, i, j;
+    BYTE n;
+    BOOL truncated;
+
+    // Only allow HTTP_SSE_MAX_CONNECTIONS event streams
+    n = 0;
+    for(i = 0; i < MAX_HTTP_CONNECTIONS; i++)
+    {
+        if(httpStubs[i].sm == SM_HTTP_SSE)
+            n++;
+    }
+    if(n >= HTTP_SSE_MAX_CONNECTIONS)
+    {
+        curHTTP.httpStatus = HTTP_SSE_BUSY;
+        return;
+    }
+
+    // Move tag list to after the table of hashes, leaving space for the terminating NULLs
+    dst = &curHTTP.data[HTTP_SSE_MAX_TAGS*2];
+    len = 0;
+    truncated = FALSE;
+    ptr = HTTPGetROMArg(curHTTP.data, (ROM BYTE*)"t");
+    if(ptr != NULL)
+    {
+        len = strlen((char*)ptr);
+        if(len > HTTP_MAX_DATA_LEN - HTTP_SSE_MAX_TAGS*2 - 2)
+        {
+            len = HTTP_MAX_DATA_LEN - HTTP_SSE_MAX_TAGS*2 - 2;
+            truncated = TRUE;
+        }
+        memmove((void*)dst, (void*)ptr, len);
+    }
+
+    // Split list into NULL terminated tag names. Empty tags, tags above HTTP_SSE_MAX_TAGS, and a
+    // truncated last tag are removed.
+    j = 0;
+    n = 0;
+    for(i = 0; (i <= len) && (n < HTTP_SSE_MAX_TAGS); i++)
+    {
+        if((i == len) && truncated)
+        {
+            while((j != 0) && (dst[j-1] != '\0'))
+                j--;
+        }
+        else if((i == len) || (dst[i] == ','))
+        {
+            if((j != 0) && (dst[j-1] != '\0'))
+            {
+                dst[j++] = '\0';
+                n++;
+            }
+        }
+        else
+        {
+            dst[j++] = dst[i];
+        }
+    }
+    dst[j] = '\0';
+
+    // No values have been sent yet
+    memset((void*)curHTTP.data, 0, HTTP_SSE_MAX_TAGS*2);
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPSSESend(void)
+
+  Description:
+	Checks the tags of the current event stream for changes, and sends all
+	changed tags in a single "data: name=value&name=value" event. Tags are
+	read with cmdGetTag(), so "User Tags" are requested from the listeners
+	added with cmdAddTagListener(). A value is detected as changed when its
+	hash differs from the hash of the last value sent. If the TX FIFO does
+	not have space for a changed tag, it is sent with the next event.
+
+	If nothing was sent for HTTP_SSE_KEEPALIVE, a comment is sent to keep
+	the connection open.
+
+	While in the SM_HTTP_SSE state, curHTTP.callbackID contains the time
+	tags must be checked next, and curHTTP.byteCount the time something
+	was last sent.
+
+  Precondition:
+	HTTPSSEStart() has been called.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPSSESend(void)
+{
+    BYTE *tag;
+    BYTE *hash;
+    WORD len, ref, h, i;
+    BYTE tagLen;
+    BOOL isEvent;
+
+    // Check tags every HTTP_SSE_INTERVAL
+    if((LONG)(TickGet() - curHTTP.callbackID) < (LONG)0)
+        return;
+    curHTTP.callbackID = TickGet() + HTTP_SSE_INTERVAL;
+
+    isEvent = FALSE;
+    hash = curHTTP.data;
+    for(tag = &curHTTP.data[HTTP_SSE_MAX_TAGS*2]; *tag != '\0'; tag += tagLen + 1, hash += 2)
+    {
+        tagLen = strlen((char*)tag);
+
+        // General tags can write to the socket directly, so are not supported
+        if(tag[0] == TAG_GENERAL)
+            continue;
+
+        // Get current value of tag. It is written to start of httpSSEVal[]
+        cbufInit(&httpSSEBuf, httpSSEVal, sizeof(httpSSEVal), CIRBUF_FORMAT_NONE | CIRBUF_TYPE_STREAMING);
+        ref = 0;
+        i = 0;
+        do
+        {
+            ref = cmdGetTag(tag, ref, &httpSSEBuf, 0, 0);
+        } while((ref != 0) && (++i < 4u));
+        len = cbufGetCount(&httpSSEBuf);
+
+        // Hash value, 0 is reserved for "not sent"
+        h = 0x5555;
+        for(i = 0; i < len; i++)
+            h = ((h << 5) | (h >> 11)) ^ httpSSEVal[i];
+        if(h == 0u)
+            h = 1;
+        if((hash[0] == (BYTE)h) && (hash[1] == (BYTE)(h >> 8)))
+            continue;
+
+        // Leave changed tag for next event if there is no space for "data: " or '&', tag, '=', value and "\n\n"
+        if(TCPIsPutReady(sktHTTP) < (WORD)(len + tagLen + 10))
+            break;
+
+        TCPPutROMString(sktHTTP, isEvent ? (ROM BYTE*)"&" : (ROM BYTE*)"data: ");
+        TCPPutArray(sktHTTP, tag, tagLen);
+        TCPPut(sktHTTP, '=');
+
+        // New lines would end the event, replace them
+        for(i = 0; i < len; i++)
+        {
+            if((httpSSEVal[i] == '\r') || (httpSSEVal[i] == '\n'))
+                httpSSEVal[i] = ' ';
+        }
+        TCPPutArray(sktHTTP, httpSSEVal, len);
+
+        hash[0] = (BYTE)h;
+        hash[1] = (BYTE)(h >> 8);
+        isEvent = TRUE;
+    }
+
+    if(isEvent)
+    {
+        TCPPutROMString(sktHTTP, (ROM BYTE*)"\n\n");
+    }
+    else if((LONG)(TickGet() - curHTTP.byteCount) >= (LONG)HTTP_SSE_KEEPALIVE)
+    {// Nothing sent for a while, send a comment to keep connection open
+        if(TCPIsPutReady(sktHTTP) < 3u)
+            return;
+        TCPPutROMString(sktHTTP, (ROM BYTE*)":\n\n");
+    }
+    else
+        return;
+
+    TCPFlush(sktHTTP);
+    curHTTP.byteCount = TickGet();
+}
+#endif
+
+
 /*****************************************************************************
   Function:
 	void HTTPServer(void)
@@ -337,6 +743,12 @@ void HTTPServer(void)
 			HTTPLoadConn(conn);
 			smHTTP = SM_HTTP_IDLE;
 
+			//MODTRONIX added. Release compressor if this connection was using it
+			#if defined(HTTP_USE_DEFLATE)
+			if(httpDeflateOwner == curHTTPID)
+				httpDeflateOwner = 0xff;
+			#endif
+
 			// Make sure any opened files are closed
 			if(curHTTP.file != MPFS_INVALID_HANDLE)
 			{
@@ -453,6 +865,7 @@ static void HTTPProcess(void)
 				smHTTP = SM_HTTP_PARSE_REQUEST;
 				curHTTP.isAuthorized = 0xff;
 				curHTTP.hasArgs = FALSE;
+				curHTTP.acceptEncoding = 0;                                 //MODTRONIX added
 				curHTTP.callbackID = TickGet() + HTTP_TIMEOUT*TICK_SECOND;  //MODTRONIX added comment. callbackPos & callbackID seem to be used for watchdog and timeout detection
 				curHTTP.callbackPos = 0xffffffff;                           //MODTRONIX added comment. callbackPos & callbackID seem to be used for watchdog and timeout detection
 				curHTTP.byteCount = 0;
@@ -565,13 +978,20 @@ static void HTTPProcess(void)
 			}
 			#endif
 			
+			//MODTRONIX added. Check if this is an event stream request, it has no file
+			#if defined(HTTP_USE_SSE)
+			if((curHTTP.httpStatus == HTTP_GET) && (strcmppgm2ram((char*)&curHTTP.data[1], (ROM char*)HTTP_SSE_PATH) == 0))
+				curHTTP.httpStatus = HTTP_SSE;
+			else
+			#endif
+
 			// If the last character is a not a directory delimiter, then try to open the file
 			// String starts at 2nd character, because the first is always a '/'
 			if(curHTTP.data[lenB-1] != '/')
 				curHTTP.file = MPFSOpen(&curHTTP.data[1]);
 				
-			// If the open fails, then add our default name and try again
-			if(curHTTP.file == MPFS_INVALID_HANDLE)
+			// If the open fails, then add our default name and try again. MODTRONIX - not for event streams
+			if((curHTTP.file == MPFS_INVALID_HANDLE) && (curHTTP.httpStatus <= HTTP_POST))
 			{
 				// Add the directory delimiter if needed
 				if(curHTTP.data[lenB-1] != '/')
@@ -768,6 +1188,16 @@ static void HTTPProcess(void)
 				break;
 			}
 			#endif
+
+			//MODTRONIX added. Event stream requests have no file, so bypass GET and POST processing
+			#if defined(HTTP_USE_SSE)
+			if(curHTTP.httpStatus == HTTP_SSE)
+			{
+				smHTTP = SM_HTTP_PROCESS_REQUEST;
+				isDone = FALSE;
+				break;
+			}
+			#endif
 			
 			// Move on to GET args, unless there are none
 			smHTTP = SM_HTTP_PROCESS_GET;
@@ -893,6 +1323,17 @@ static void HTTPProcess(void)
 
 		case SM_HTTP_PROCESS_REQUEST:
 
+			//MODTRONIX added. Event stream request
+			#if defined(HTTP_USE_SSE)
+			if(curHTTP.httpStatus == HTTP_SSE)
+			{
+				HTTPSSEStart();
+				smHTTP = SM_HTTP_SERVE_HEADERS;
+				isDone = FALSE;
+				break;
+			}
+			#endif
+
 			// Check for 404
             if(curHTTP.file == MPFS_INVALID_HANDLE)
             {
@@ -935,6 +1376,18 @@ static void HTTPProcess(void)
 				TCPPutROMString(sktHTTP, (ROM BYTE*)HTTP_CRLF);
 			}
 
+			//MODTRONIX added. Headers of event stream are complete, start sending events
+			#if defined(HTTP_USE_SSE)
+			if(curHTTP.httpStatus == HTTP_SSE)
+			{
+				TCPFlush(sktHTTP);
+				curHTTP.callbackID = TickGet();
+				curHTTP.byteCount = TickGet();
+				smHTTP = SM_HTTP_SSE;
+				break;
+			}
+			#endif
+
 			// If not GET or POST, we're done - This will be the case for HTTP_MPFS_UPLOAD!
 			if(curHTTP.httpStatus != HTTP_GET && curHTTP.httpStatus != HTTP_POST)
 			{// Disconnect
@@ -955,6 +1408,24 @@ static void HTTPProcess(void)
 			{
 				TCPPutROMString(sktHTTP, (ROM BYTE*)"Content-Encoding: gzip\r\n");
 			}
+			//MODTRONIX added. Compress dynamic text responses if the client accepts gzip, compressor is free, and
+			//compressing this file's response paid the last time
+			#if defined(HTTP_USE_DEFLATE)
+			else if((curHTTP.httpStatus == HTTP_POST || curHTTP.nextCallback != 0xffffffff) && (curHTTP.fileType <= HTTP_CSS))
+			{
+				curHTTP.acceptEncoding |= HTTP_ACCEPT_VARY;
+				if((curHTTP.acceptEncoding & HTTP_ACCEPT_GZIP) && (httpDeflateOwner == 0xff) && !HTTPDeflateSkip(MPFSGetID(curHTTP.file)))
+				{
+					httpDeflateOwner = curHTTPID;
+					DeflateInit(&httpDeflate);
+					TCPPutROMString(sktHTTP, (ROM BYTE*)"Content-Encoding: gzip\r\n");
+				}
+			}
+			#endif
+			if(curHTTP.acceptEncoding & HTTP_ACCEPT_VARY)
+			{
+				TCPPutROMString(sktHTTP, (ROM BYTE*)"Vary: Accept-Encoding\r\n");
+			}
 						
 			// Output the cache-control
 			TCPPutROMString(sktHTTP, (ROM BYTE*)"Cache-Control: ");
@@ -1058,15 +1529,47 @@ static void HTTPProcess(void)
 
 			isDone = FALSE;
 
+			//MODTRONIX added. If compressing, capture data written to socket. Wait for enough space for a compressed block first.
+			//Capture DEFLATE_MAX_OVERHEAD less bytes, so the last block and DeflateFinish() output also fit in this space.
+			#if defined(HTTP_USE_DEFLATE)
+			if(httpDeflateOwner == curHTTPID)
+			{
+				if(TCPIsPutReady(sktHTTP) < sizeof(httpDeflateOut))
+				{
+					isDone = TRUE;
+					break;
+				}
+				HTTPDeflateStart(sizeof(httpDeflateIn) - DEFLATE_MAX_OVERHEAD);
+			}
+			#endif
+
 			// Try to send next packet
 			if(HTTPSendFile())
 			{// If EOF, then we're done so close and disconnect
+				//MODTRONIX added. Compress captured data, and end gzip stream
+				#if defined(HTTP_USE_DEFLATE)
+				if(httpDeflateOwner == curHTTPID)
+				{
+					HTTPDeflateEnd();
+					TCPPutArray(sktHTTP, httpDeflateOut, DeflateFinish(&httpDeflate, httpDeflateOut));
+					HTTPDeflateStat(MPFSGetID(curHTTP.file));
+					httpDeflateOwner = 0xff;
+				}
+				#endif
+
 				MPFSClose(curHTTP.file);
 				curHTTP.file = MPFS_INVALID_HANDLE;
 				smHTTP = SM_HTTP_DISCONNECT;
 				isDone = TRUE;
                 DelayMs(2);     //MODTRONIX added. Browsers seem to miss packets if they are sent too fast. Ensure at least 1ms
 			}
+			//MODTRONIX added. Compress captured data
+			#if defined(HTTP_USE_DEFLATE)
+			else if(httpDeflateOwner == curHTTPID)
+			{
+				HTTPDeflateEnd();
+			}
+			#endif
 			
 			// If the TX FIFO is full, then return to main app loop
 			if(TCPIsPutReady(sktHTTP) == 0u) {
@@ -1086,10 +1589,24 @@ static void HTTPProcess(void)
 			if(TCPIsPutReady(sktHTTP) < HTTP_MIN_CALLBACK_FREE)
 				break;
 
+			//MODTRONIX added. If compressing, capture data written by callback. Wait for enough space for a compressed block first.
+			#if defined(HTTP_USE_DEFLATE)
+			if(httpDeflateOwner == curHTTPID)
+			{
+				if(TCPIsPutReady(sktHTTP) < sizeof(httpDeflateOut))
+					break;
+				HTTPDeflateStart(sizeof(httpDeflateIn));
+			}
+			#endif
+
             //MODTRONIX added code below from here
             DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nTag=");                          //MODTRONIX added this line
             DEBUG_PUT_STR(DEBUG_LEVEL_INFO, (const char*)&curHTTP.ptrData[1]);  //MODTRONIX added this line
-            if (curHTTP.ptrData[1]=='#') {
+            if (curHTTP.compiledTag.handler != CMD_TAG_HANDLER_NONE) {
+                //This is a compiled Modtronix tag
+                curHTTP.callbackPos = cmdGetCompiledTag(&curHTTP.compiledTag, curHTTP.callbackPos, NULL);
+            }
+            else if (curHTTP.ptrData[1]=='#') {
                 //This is a Modtronix tag
                 curHTTP.callbackPos = cmdGetTag(&curHTTP.ptrData[1], curHTTP.callbackPos, NULL, 0, 0);
             }
@@ -1098,6 +1615,14 @@ static void HTTPProcess(void)
                 // Fill TX FIFO from callback
                 HTTPPrint(curHTTP.callbackID);
             }   //MODTRONIX added this line
+
+			//MODTRONIX added. Compress data written by callback
+			#if defined(HTTP_USE_DEFLATE)
+			if(httpDeflateOwner == curHTTPID)
+			{
+				HTTPDeflateEnd();
+			}
+			#endif
 			
 			if(curHTTP.callbackPos == 0u)
 			{// Callback finished its output, so move on
@@ -1108,6 +1633,12 @@ static void HTTPProcess(void)
 			break;
 
 		case SM_HTTP_DISCONNECT:
+			//MODTRONIX added. Release compressor if this connection was using it
+			#if defined(HTTP_USE_DEFLATE)
+			if(httpDeflateOwner == curHTTPID)
+				httpDeflateOwner = 0xff;
+			#endif
+
 			// Make sure any opened files are closed
 			if(curHTTP.file != MPFS_INVALID_HANDLE)
 			{
@@ -1123,6 +1654,24 @@ static void HTTPProcess(void)
 			TCPDisconnect(sktHTTP);
             smHTTP = SM_HTTP_IDLE;
             break;
+
+		//MODTRONIX added. Send changed tags to event stream, until client disconnects
+		#if defined(HTTP_USE_SSE)
+		case SM_HTTP_SSE:
+			if(!TCPIsConnected(sktHTTP))
+			{
+				smHTTP = SM_HTTP_DISCONNECT;
+				isDone = FALSE;
+				break;
+			}
+
+			// Discard anything received from client
+			if(TCPIsGetReady(sktHTTP))
+				TCPDiscard(sktHTTP);
+
+			HTTPSSESend();
+			break;
+		#endif
 		}
 	} while(!isDone);
 
@@ -1149,8 +1698,9 @@ static void HTTPProcess(void)
   ***************************************************************************/
 static BOOL HTTPSendFile(void)
 {
-	WORD numBytes, len;
-	BYTE c, data[64];
+	WORD numBytes, len, nameLen;
+	BYTE c;
+    HTTP_TAG_CACHE_ENTRY* pCache;
     
     //Store the tag in first free space in curHTTP.data, as given by curHTTP.ptrData
     BYTE* ptrTag = curHTTP.ptrData;
@@ -1160,14 +1710,13 @@ static BOOL HTTPSendFile(void)
 	numBytes = mMIN(len, curHTTP.nextCallback - curHTTP.byteCount);
 	
 	// Get/put as many bytes as possible
+	//MODTRONIX changed to move data from MPFS directly into TCP TX buffer, instead of via 64 byte buffer
 	curHTTP.byteCount += numBytes;
 	while(numBytes > 0u)
 	{
-		len = MPFSGetArray(curHTTP.file, data, mMIN(numBytes, sizeof(data)));
+		len = TCPPutMPFS(sktHTTP, curHTTP.file, numBytes);
 		if(len == 0u)
 			return TRUE;
-		else
-			TCPPutArray(sktHTTP, data, len);
 		numBytes -= len;
 	}
 
@@ -1178,40 +1727,79 @@ static BOOL HTTPSendFile(void)
 		smHTTP = SM_HTTP_SEND_FROM_CALLBACK;
 		curHTTP.callbackPos = 0;
 
-        //If NOT at least 2 bytes available for tag, ERROR!! Mark len=0 so no data overwrite occurs!
-        len = 1;
-        if ((WORD)ptrTag >= ((WORD)(curHTTP.data + HTTP_MAX_DATA_LEN - 1))) {
-            DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\nNo space for Tag!");
-            len = 0;    //Mark error, no space!
+        curHTTP.compiledTag.handler = CMD_TAG_HANDLER_NONE;
+
+		// Read in the callback address
+		MPFSGetLong(curHTTP.offsets, &(curHTTP.callbackID));
+        pCache = &httpTagCache[(WORD)curHTTP.callbackID % HTTP_TAG_CACHE_SIZE];
+
+        //MODTRONIX added. If tag is in cache, skip past it without reading and parsing the tag name
+        if (pCache->callbackID == (WORD)curHTTP.callbackID) {
+            MPFSSeek(curHTTP.file, (DWORD)pCache->nameLen + 2, MPFS_SEEK_FORWARD);
+            curHTTP.byteCount += (DWORD)pCache->nameLen + 2;
+            curHTTP.compiledTag = pCache->tag;
+            ptrTag[0] = 0;      //Tag name not available
+            ptrTag[1] = 0;
         }
+        else {
+            //If NOT at least 2 bytes available for tag, ERROR!! Mark len=0 so no data overwrite occurs!
+            len = 1;
+            if ((WORD)ptrTag >= ((WORD)(curHTTP.data + HTTP_MAX_DATA_LEN - 1))) {
+                DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\nNo space for Tag!");
+                len = 0;    //Mark error, no space!
+            }
 
-		// Read past the variable name and close the MPFS
-		MPFSGet(curHTTP.file, NULL);
+            // Read past the variable name and close the MPFS
+            MPFSGet(curHTTP.file, NULL);
 
-        //Save tag in prtTag[]
-		do
-		{
-			if(!MPFSGet(curHTTP.file, &c))
-				break;
-			curHTTP.byteCount++;
+            //Save tag in prtTag[]
+            nameLen = 0;
+            do
+            {
+                if(!MPFSGet(curHTTP.file, &c))
+                {
+                    nameLen = 0xffff;   //Don't cache
+                    break;
+                }
+                curHTTP.byteCount++;
+
+                //MODTRONIX added next 3 lines
+                if (c != '~') {
+                    nameLen++;
+                    //Save next byte of tag if these is enough space (-1 for null termination)
+                    if (((WORD)ptrTag+len) < ((WORD)(curHTTP.data + HTTP_MAX_DATA_LEN - 1))) {
+                        ptrTag[len++] = c;
+                    }
+                }
+            } while(c != '~');
+            curHTTP.byteCount++;
+
+            if (len != 0) {         //Only do if there is space, len is marked with 0 when no space!
+                ptrTag[0] = len-1;  //Store tag string length at ptrTag[0]
+                ptrTag[len] = 0;    //NULL terminate tag string
+
+                //MODTRONIX added. Compile '#' tags, and add tag to cache if it does not need it's name string
+                //when executed. Tags with truncated names are not cached.
+                if ((nameLen == (len-1)) && (nameLen <= 0xff) && ((WORD)curHTTP.callbackID != 0xffff)) {
+                    if (ptrTag[1] == '#') {
+                        if (cmdCompileTag(&ptrTag[1], &curHTTP.compiledTag)) {
+                            nameLen |= 0x8000;  //Mark that tag must be cached
+                        }
+                    }
+                    else {
+                        nameLen |= 0x8000;      //HTTPPrint() callback, mark that tag must be cached
+                    }
 
-            //MODTRONIX added next 3 lines
-            if (c != '~') {
-                //Save next byte of tag if these is enough space (-1 for null termination)
-                if (((WORD)ptrTag+len) < ((WORD)(curHTTP.data + HTTP_MAX_DATA_LEN - 1))) {
-                    ptrTag[len++] = c;
+                    if (nameLen & 0x8000) {
+                        pCache->callbackID = (WORD)curHTTP.callbackID;
+                        pCache->nameLen = (BYTE)nameLen;
+                        pCache->tag = curHTTP.compiledTag;
+                    }
                 }
             }
-		} while(c != '~');
-		curHTTP.byteCount++;
-
-        if (len != 0) {         //Only do if there is space, len is marked with 0 when no space!
-            ptrTag[0] = len-1;  //Store tag string length at ptrTag[0]
-            ptrTag[len] = 0;    //NULL terminate tag string
         }
-		
-		// Read in the callback address and next offset
-		MPFSGetLong(curHTTP.offsets, &(curHTTP.callbackID));
+
+		// Read in the next offset
 		if(!MPFSGetLong(curHTTP.offsets, &(curHTTP.nextCallback)))
 		{
 			curHTTP.nextCallback = 0xffffffff;
@@ -1279,6 +1867,66 @@ static void HTTPHeaderParseLookup(BYTE i, WORD len)
 		return;
 	}
 	#endif
+
+    //MODTRONIX added
+	if(i == 4u)
+	{
+		HTTPHeaderParseAcceptEncoding(len);
+		return;
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPHeaderParseAcceptEncoding(WORD len)
+
+  Summary:
+	Parses the "Accept-Encoding:" header for a request.
+
+  Description:
+	Parses the "Accept-Encoding:" header to determine if the client accepts
+	gzip compressed responses. Sets the HTTP_ACCEPT_GZIP flag in
+	curHTTP.acceptEncoding if "gzip" is found, and it is not followed by
+	a ";q=0" quality value.
+
+  Precondition:
+	None
+
+  Parameters:
+    len - The length of the line contained in the TCP buffer. Is the length up to (but not including) the '/n' character
+
+  Returns:
+	None
+
+  Remarks:
+	MODTRONIX added this function.
+  ***************************************************************************/
+static void HTTPHeaderParseAcceptEncoding(WORD len)
+{
+	WORD pos;
+	BYTE buf[8];
+	BYTE i;
+
+    //===== At this stage we know that whole line of header data is contained in TCP buffer =====
+
+	pos = TCPFindROMArrayEx(sktHTTP, (ROM BYTE*)"gzip", 4, 0, len, TRUE);
+	if(pos == 0xffffu)
+		return;
+
+	// Read quality value following "gzip", if any
+	TCPGetArray(sktHTTP, NULL, pos + 4);
+	len = TCPGetArray(sktHTTP, buf, mMIN(len - pos - 4, sizeof(buf) - 1));
+	buf[len] = '\0';
+
+	// A quality value of 0 (";q=0", ";q=0.0", ...) means gzip is not acceptable
+	if(memcmppgm2ram(buf, (ROM void*)";q=0", 4) == 0)
+	{
+		for(i = 4; (buf[i] == '.') || (buf[i] == '0'); i++);
+		if((buf[i] < '1') || (buf[i] > '9'))
+			return;
+	}
+
+	curHTTP.acceptEncoding |= HTTP_ACCEPT_GZIP;
 }
 
 /*****************************************************************************
@@ -2182,7 +2830,12 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                         }
 
                         //First of all, invalidate firmware by erasing FIRMWARE_INFO
+                        #if defined(XFLASH_USE_ASYNC)
+                        if (xflashAsyncEraseSector((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_INFO_ADR : XFLASH_FIRMWAREA_INFO_ADR) == FALSE)
+                            return HTTP_IO_WAITING; //Flash job queue is full, try again later
+                        #else
                         SPIFlashEraseSector((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_INFO_ADR : XFLASH_FIRMWAREA_INFO_ADR);
+                        #endif
 
                         //Use curHTTP.data[0] to remember how many sectors still have to be erased in SM_MPFSUPLOAD_FIRMWARE_FLASH_ERASE state
                         curHTTP.data[0] = 0;
@@ -2206,10 +2859,19 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                         else {
                             //Next erase FIRMWAREx --AND-- FIRMWAREx_CONFIG area. FIRMWAREx_CONFIG follows FIRMWAREx in External FLASH
 
+                            #if defined(XFLASH_USE_ASYNC)
+                            //Queue as many erases as possible. They are done in the background by xflashAsyncTask(), and
+                            //firmware data written in SM_MPFSUPLOAD_FIRMWARE state is queued after them.
+                            if (xflashAsyncEraseSector( (DWORD)((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_ADR : XFLASH_FIRMWAREA_ADR) + ( ((DWORD)curHTTP.data[0]) * ((DWORD)XFLASH_SECTOR_SIZE) )) == FALSE)
+                                return HTTP_IO_WAITING; //Flash job queue is full, try again later
+                            curHTTP.data[0]++;  //Increment sector
+                            done = FALSE;
+                            #else
                             SPIFlashEraseSector( (DWORD)((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_ADR : XFLASH_FIRMWAREA_ADR) + ( ((DWORD)curHTTP.data[0]) * ((DWORD)XFLASH_SECTOR_SIZE) ));
                             curHTTP.data[0]++;  //Increment sector
 
                             return HTTP_IO_WAITING; //Done, and return from this function. Do this, seeing that each SPIFlashEraseSector() can take up to 400ms.
+                            #endif
                         }
 
                         break;
@@ -2233,6 +2895,12 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
 
                             pData = (HTTP_FIRMWARE_UPLOAD*)curHTTP.data;
 
+                            //Wait for space in flash job queue before reading next line from TCP buffer
+                            #if defined(XFLASH_USE_ASYNC)
+                            if (xflashAsyncGetFree() < (HTTP_MAX_DATA_LEN_FIRMWARE/2))
+                                return HTTP_IO_WAITING;
+                            #endif
+
                             // Verify a whole line line is in the FIFO. Unix ends with '\n', Windows ends with '\r\n'
                             if((lenB = TCPFind(sktHTTP, '\n', 0, FALSE)) == 0xffff)
                             {
@@ -2344,9 +3012,19 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                                 //((FIRMWARE_INFO*)&pData->data[0])->versionMinor = ??;
                                 ((FIRMWARE_INFO*)&pData->data[0])->fwState.Val = FIRMWARE_STATE_NEW;
 
-                                //Write data to External Flash.
+                                //Write data to External Flash. When queued, it is written after all firmware data queued before it.
+                                #if defined(XFLASH_USE_ASYNC)
+                                xflashAsyncBeginWrite(xflAdr, 0);
+                                for (i = 0; i < sizeof(FIRMWARE_INFO); ) {
+                                    i += xflashAsyncWriteArray(&pData->data[i], sizeof(FIRMWARE_INFO) - i);
+                                    if (i < sizeof(FIRMWARE_INFO))
+                                        xflashAsyncTask();
+                                }
+                                xflashAsyncFlush();
+                                #else
                                 SPIFlashBeginWrite(xflAdr);
                                 SPIFlashWriteArray(pData->data, sizeof(FIRMWARE_INFO), FALSE);
+                                #endif
 
                                 //debugPrintFlash((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_INFO_ADR : XFLASH_FIRMWAREA_INFO_ADR, sizeof(FIRMWARE_INFO));
                             }
@@ -2384,6 +3062,16 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                                     //sprintf(debugTempBuf, "\n-CfgMem=%lx, xflAdr=%lx", pData->adr.Val, xflAdr);
                                     //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, debugTempBuf);
                                 }
+                                else if ( (pData->adr.Val >= MEM_FWIMAGE_START) && (pData->adr.Val <= MEM_FWIMAGE_LAST) ) {
+                                    pData->recordType = 0xfe;   //Mark that this contains a compressed and/or delta firmware image
+
+                                    //Get address in External Flash where this firmware image is stored. Packed same as Configuration data.
+                                    // - Subtract offset of MEM_FWIMAGE_START.
+                                    // - Scale, each 4 bytes in hex file is packed to 2 bytes in External Flash
+                                    // - Add offset of XFLASH_FIRMWAREA_ADR or XFLASH_FIRMWAREB_ADR
+                                    xflAdr = (pData->adr.Val - MEM_FWIMAGE_START) / 2;
+                                    xflAdr += ((firmwareFlags.flags.bits.bCurr == CURRENT_FIRMWARE_A) ? XFLASH_FIRMWAREB_ADR : XFLASH_FIRMWAREA_ADR);
+                                }
                                 else {
                                     DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\n-UndefMem=");
                                     DEBUG_PUT_HEXWORD(DEBUG_LEVEL_INFO, pData->adr.word.HW);
@@ -2400,18 +3088,27 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                                     wv.v[0] = pData->data[i++];
 
                                     //- For Program Memory, do NOT use upper byte of odd word
-                                    //- For Configuration Data, do not use odd word.
+                                    //- For Configuration Data and Firmware Image, do not use odd word.
                                     if (   ((pData->recordType == 0) && ((pData->adr.v[0]&0x03) != 0x03))
-                                        || ((pData->recordType == 0xff) && ((pData->adr.v[0]&0x02) == 0)) )
+                                        || ((pData->recordType >= 0xfe) && ((pData->adr.v[0]&0x02) == 0)) )
                                     {
                                         pData->data[j++] = hexatob(wv);
                                     }
                                     pData->adr.v[0]++;  //Increment last byte of address. Only last byte is required above to see if this is upper byte of odd word of program memory.
                                 }
 
-                                //Write data to External Flash.
+                                //Write data to External Flash. Sequential lines are added to the same page program job
+                                #if defined(XFLASH_USE_ASYNC)
+                                xflashAsyncBeginWrite(xflAdr, 0);
+                                for (i = 0; i < j; ) {
+                                    i += xflashAsyncWriteArray(&pData->data[i], j - i);
+                                    if (i < j)
+                                        xflashAsyncTask();  //Only when queue has less free space than xflashAsyncGetFree() reported
+                                }
+                                #else
                                 SPIFlashBeginWrite(xflAdr);
                                 SPIFlashWriteArray(pData->data, j, FALSE);
+                                #endif
 
                                 //debugPutHexLine(xflAdr, pData->data, j);
 
@@ -2433,6 +3130,12 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
 
                         // If we've read all the data, Redirect to the page
                         if(curHTTP.byteCount == 0u) {
+                            //Wait for all queued data to be written to flash
+                            #if defined(XFLASH_USE_ASYNC)
+                            xflashAsyncFlush();
+                            if (xflashAsyncIsIdle() == FALSE)
+                                return HTTP_IO_WAITING;
+                            #endif
                             strcpypgm2ram((char*)curHTTP.data, "uploadfirm.htm");
                             curHTTP.httpStatus = HTTP_REDIRECT;
                             return HTTP_IO_DONE;
@@ -2467,6 +3170,13 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                 if(lenA > curHTTP.byteCount)
                     lenA = curHTTP.byteCount;
 
+                //MODTRONIX added next 5 lines. Only read what fits in flash job queue, rest is read when xflashAsyncTask() has programmed some pages
+                #if defined(MPFS_USE_SPI_FLASH) && defined(XFLASH_USE_ASYNC)
+                lenB = xflashAsyncGetFree();
+                if(lenA > lenB)
+                    lenA = lenB;
+                #endif
+
                 while(lenA > 0u)
                 {
                     lenB = TCPGetArray(sktHTTP, c, mMIN(lenA,16u));
@@ -2480,10 +3190,22 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
                 // If we've read all the data
                 if(curHTTP.byteCount == 0u)
                 {
+                    //MODTRONIX added next 5 lines. Wait for last pages to be programmed without blocking
+                    #if defined(MPFS_USE_SPI_FLASH) && defined(XFLASH_USE_ASYNC)
+                    xflashAsyncFlush();
+                    if(xflashAsyncIsIdle() == FALSE)
+                        return HTTP_IO_WAITING;
+                    #endif
                     MPFSPutEnd(TRUE);
                     return HTTP_IO_DONE;
                 }
 
+                //MODTRONIX added next 4 lines. Flash job queue is full, and data is still waiting in TCP buffer
+                #if defined(MPFS_USE_SPI_FLASH) && defined(XFLASH_USE_ASYNC)
+                if(TCPIsGetReady(sktHTTP) != 0u)
+                    return HTTP_IO_WAITING;
+                #endif
+
             // Other states are not valid here
             default:
                 break;
@@ -161,6 +161,19 @@ static void _Validate(void);
 
 	// Beginning address of MPFS Image
 	#define MPFS_HEAD		MPFS_RESERVE_BLOCK
+
+	//MODTRONIX added next block
+	#if (MPFS_CACHE_WAYS > 0)
+	#define MPFS_CACHE_ENABLED
+	// Set associative read cache. A line is stored in set (line number & (MPFS_CACHE_SETS-1)), in any of its ways.
+	static BYTE cacheData[MPFS_CACHE_SETS][MPFS_CACHE_WAYS][MPFS_CACHE_LINE_SIZE];
+	static DWORD cacheTag[MPFS_CACHE_SETS][MPFS_CACHE_WAYS];	// Line number (SPI Flash address / MPFS_CACHE_LINE_SIZE), MPFS_INVALID if empty
+	static BYTE cacheAge[MPFS_CACHE_SETS][MPFS_CACHE_WAYS];		// 0 for most recently used way of set, (MPFS_CACHE_WAYS-1) for least
+	static DWORD cacheHits;
+	static DWORD cacheMisses;
+
+	static void _CacheRead(DWORD addr, BYTE* cData, WORD wLen);
+	#endif
 	
 #else
 
@@ -223,6 +236,13 @@ void MPFSInit(void)
 	SPIFlashInit();
 	#endif
 
+	//MODTRONIX added next 5 lines
+	#if defined(MPFS_CACHE_ENABLED)
+	MPFSCacheInvalidate();
+	cacheHits = 0;
+	cacheMisses = 0;
+	#endif
+
 	// Validate the image and load numFiles
 	_Validate();
 
@@ -545,7 +565,12 @@ BOOL MPFSGet(MPFS_HANDLE hMPFS, BYTE* c)
 		lastRead = MPFSStubs[hMPFS].addr;
 		MPFSStubs[hMPFS].addr++;
 	#elif defined(MPFS_USE_SPI_FLASH)
+		//MODTRONIX added next 5 lines
+		#if defined(MPFS_CACHE_ENABLED)
+		_CacheRead(MPFSStubs[hMPFS].addr + MPFS_HEAD, c, 1);
+		#else
 		SPIFlashReadArray(MPFSStubs[hMPFS].addr + MPFS_HEAD, c, 1);
+		#endif
 		MPFSStubs[hMPFS].addr++;
 	#else
 		#if defined(__C30__)
@@ -648,6 +673,12 @@ WORD MPFSGetArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen)
 		MPFSStubs[hMPFS].bytesRem -= wLen;
 		lastRead = MPFS_INVALID;
 	#elif defined(MPFS_USE_SPI_FLASH)
+		//MODTRONIX added next 6 lines. Reads larger than a line are not cached, they would only evict other lines
+		#if defined(MPFS_CACHE_ENABLED)
+		if(wLen <= MPFS_CACHE_LINE_SIZE)
+			_CacheRead(MPFSStubs[hMPFS].addr+MPFS_HEAD, cData, wLen);
+		else
+		#endif
 		SPIFlashReadArray(MPFSStubs[hMPFS].addr+MPFS_HEAD, cData, wLen);
 		MPFSStubs[hMPFS].addr += wLen;
 		MPFSStubs[hMPFS].bytesRem -= wLen;
@@ -720,6 +751,94 @@ WORD MPFSGetArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen)
 	return wLen;
 }
 
+/*****************************************************************************
+  Function:
+	WORD MPFSGetArrayToMAC(MPFS_HANDLE hMPFS, WORD wLen)
+
+  Description:
+	Reads a series of bytes from a file, and writes them to the MAC at the
+	current MAC write pointer. This is used to move file data into a TCP or
+	UDP buffer located in Ethernet RAM, without first having to read it into
+	an application buffer.
+	
+	When the MPFS image is in program memory (PIC18 and PIC32), data is written
+	directly from program memory to the MAC. When it is stored in SPI Flash, the
+	data is read in a single Flash transaction, and moved to the MAC in chunks of
+	MPFS_COPY_BUF_SIZE bytes.
+	
+  Precondition:
+	The file handle referenced by hMPFS is already open, and the MAC write
+	pointer has been set with MACSetWritePtr().
+
+  Parameters:
+	hMPFS - the file handle from which to read
+	wLen - how many bytes to read
+
+  Returns:
+	The number of bytes successfully read and written to the MAC. If this is
+	less than wLen, an EOF occurred while attempting to read.
+	
+  Remarks:
+	MODTRONIX added this function
+  ***************************************************************************/
+WORD MPFSGetArrayToMAC(MPFS_HANDLE hMPFS, WORD wLen)
+{
+	#if defined(MPFS_USE_EEPROM) || defined(MPFS_USE_SPI_FLASH) || defined(__C30__)
+	BYTE buf[MPFS_COPY_BUF_SIZE];
+	WORD count;
+	#endif
+	
+	// Make sure we're reading a valid address
+	if(hMPFS > MAX_MPFS_HANDLES) {
+        DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nMPFS: Invld Hndl - MPFSGetArrayToMAC");
+		return 0;
+    }
+		
+	// Determine how many we can actually read
+	if(wLen > MPFSStubs[hMPFS].bytesRem)
+		wLen = MPFSStubs[hMPFS].bytesRem;
+
+	// Make sure we're reading a valid address
+	if(MPFSStubs[hMPFS].addr == MPFS_INVALID || wLen == 0u)
+		return 0;
+
+	#if defined(MPFS_USE_SPI_FLASH)
+		// Read all data in a single SPI Flash transaction
+		xflashBeginRead(MPFSStubs[hMPFS].addr+MPFS_HEAD);
+		for(count = wLen; count > 0u; )
+		{
+			WORD chunk = (count > sizeof(buf)) ? sizeof(buf) : count;
+			xflashReadNext(buf, chunk);
+			MACPutArray(buf, chunk);
+			count -= chunk;
+		}
+		xflashEndRead();
+		MPFSStubs[hMPFS].addr += wLen;
+		MPFSStubs[hMPFS].bytesRem -= wLen;
+	#elif defined(MPFS_USE_EEPROM) || defined(__C30__)
+		// Program memory on 16-bit parts has to be unpacked, use MPFSGetArray()
+		for(count = wLen; count > 0u; )
+		{
+			WORD chunk = (count > sizeof(buf)) ? sizeof(buf) : count;
+			chunk = MPFSGetArray(hMPFS, buf, chunk);
+			if(chunk == 0u)
+				break;
+			MACPutArray(buf, chunk);
+			count -= chunk;
+		}
+		wLen -= count;
+	#else
+		{
+			DWORD dwHITECHWorkaround = MPFS_HEAD;
+			MACPutROMArray((ROM BYTE*)(MPFSStubs[hMPFS].addr + dwHITECHWorkaround), wLen);
+			MPFSStubs[hMPFS].addr += wLen;
+			MPFSStubs[hMPFS].bytesRem -= wLen;
+		}
+	#endif
+	
+	return wLen;
+}
+
 /*****************************************************************************
   Function:
 	BOOL MPFSGetLong(MPFS_HANDLE hMPFS, DWORD* ul)
@@ -865,6 +984,11 @@ MPFS_HANDLE MPFSFormat(void)
 	
 	// Lock the image
 	isMPFSLocked = TRUE;
+
+	//MODTRONIX added next 3 lines. Tag callback IDs of new image can differ, clear HTTP tag cache for all upload paths
+	#if defined(STACK_USE_HTTP2_SERVER) && !defined(STACK_USE_MDD)
+	HTTPTagCacheInvalidate();
+	#endif
 	
 	#if defined(MPFS_USE_EEPROM)
 		// Set FAT ptr for writing
@@ -878,8 +1002,17 @@ MPFS_HANDLE MPFSFormat(void)
 	
 		return MPFS_INVALID_HANDLE;
 	#else
+		//MODTRONIX added next 3 lines
+		#if defined(MPFS_CACHE_ENABLED)
+		MPFSCacheInvalidate();
+		#endif
 		// Set up SPI Flash for writing
+		//MODTRONIX added next 4 lines. Sectors are erased in the background, ahead of the write cursor
+		#if defined(XFLASH_USE_ASYNC)
+		xflashAsyncBeginWrite(MPFS_HEAD, SPI_FLASH_SIZE);
+		#else
 		SPIFlashBeginWrite(MPFS_HEAD);
+		#endif
 		return 0x00;
 	#endif
 }
@@ -934,8 +1067,25 @@ WORD MPFSPutArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen)
 		return count;
 	
 	#else
+		//MODTRONIX added next 3 lines
+		#if defined(MPFS_CACHE_ENABLED)
+		MPFSCacheInvalidate();
+		#endif
 		// Write to the SPI Flash
+		//MODTRONIX added next 11 lines. Data is queued, and programmed in background by xflashAsyncTask()
+		#if defined(XFLASH_USE_ASYNC)
+		{
+			WORD count = 0;
+			while(count < wLen)
+			{
+				count += xflashAsyncWriteArray(&cData[count], wLen - count);
+				if(count < wLen)
+					xflashAsyncTask();	// Queue is full, caller did not check xflashAsyncGetFree()
+			}
+		}
+		#else
 		SPIFlashWriteArray(cData, wLen, TRUE);
+		#endif
 		return wLen;
 	#endif
 }
@@ -967,13 +1117,190 @@ void MPFSPutEnd(BOOL final)
 	    XEEEndWrite();
     	while(XEEIsBusy());
     #endif
+
+	//MODTRONIX added next 7 lines. Image must be in Flash before it is validated and read. Reads done
+	//while data was still queued could have cached old Flash contents, so invalidate cache again.
+	#if defined(MPFS_USE_SPI_FLASH) && defined(XFLASH_USE_ASYNC)
+	xflashAsyncFlush();
+	xflashAsyncWaitIdle();
+	#if defined(MPFS_CACHE_ENABLED)
+	MPFSCacheInvalidate();
+	#endif
+	#endif
     
 	if(final)
+	{
+		//MODTRONIX added next 3 lines. Entries cached while image was written are not valid
+		#if defined(STACK_USE_HTTP2_SERVER) && !defined(STACK_USE_MDD)
+		HTTPTagCacheInvalidate();
+		#endif
 		_Validate();
+	}
 }
 #endif
 
 
+/****************************************************************************
+  Section:
+	SPI Flash Read Cache
+  ***************************************************************************/
+//MODTRONIX added this section
+#if defined(MPFS_CACHE_ENABLED)
+
+/*****************************************************************************
+  Function:
+	void MPFSCacheInvalidate(void)
+
+  Description:
+	Empties the SPI Flash read cache. Must be called when the SPI Flash
+	containing the MPFS image is written to.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+void MPFSCacheInvalidate(void)
+{
+	BYTE set;
+	BYTE way;
+
+	for(set = 0; set < MPFS_CACHE_SETS; set++)
+	{
+		for(way = 0; way < MPFS_CACHE_WAYS; way++)
+		{
+			cacheTag[set][way] = MPFS_INVALID;
+			cacheAge[set][way] = way;
+		}
+	}
+}
+
+/*****************************************************************************
+  Function:
+	void MPFSCacheGetStats(DWORD* pHits, DWORD* pMisses)
+
+  Description:
+	Returns the number of SPI Flash read cache line lookups that were hits
+	and misses since MPFSInit.
+
+  Precondition:
+	None
+
+  Parameters:
+	pHits - returns number of hits
+	pMisses - returns number of misses, each caused a line to be read
+
+  Returns:
+	None
+  ***************************************************************************/
+void MPFSCacheGetStats(DWORD* pHits, DWORD* pMisses)
+{
+	*pHits = cacheHits;
+	*pMisses = cacheMisses;
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE* _CacheGetLine(DWORD line)
+
+  Description:
+	Returns the cached data for the given line. On a miss, the least
+	recently used way of the line's set is replaced.
+
+  Precondition:
+	None
+
+  Parameters:
+	line - SPI Flash address / MPFS_CACHE_LINE_SIZE
+
+  Returns:
+	Pointer to MPFS_CACHE_LINE_SIZE bytes of data
+  ***************************************************************************/
+static BYTE* _CacheGetLine(DWORD line)
+{
+	BYTE set = (BYTE)line & (MPFS_CACHE_SETS-1);
+	BYTE way;
+	BYTE i;
+
+	for(way = 0; way < MPFS_CACHE_WAYS; way++)
+	{
+		if(cacheTag[set][way] == line)
+			break;
+	}
+
+	if(way < MPFS_CACHE_WAYS)
+	{
+		cacheHits++;
+	}
+	else
+	{
+		cacheMisses++;
+
+		// Replace oldest way
+		for(way = 0, i = 1; i < MPFS_CACHE_WAYS; i++)
+		{
+			if(cacheAge[set][i] > cacheAge[set][way])
+				way = i;
+		}
+		SPIFlashReadArray(line * MPFS_CACHE_LINE_SIZE, cacheData[set][way], MPFS_CACHE_LINE_SIZE);
+		cacheTag[set][way] = line;
+	}
+
+	// Make this way the most recently used one
+	for(i = 0; i < MPFS_CACHE_WAYS; i++)
+	{
+		if(cacheAge[set][i] < cacheAge[set][way])
+			cacheAge[set][i]++;
+	}
+	cacheAge[set][way] = 0;
+
+	return cacheData[set][way];
+}
+
+/*****************************************************************************
+  Function:
+	static void _CacheRead(DWORD addr, BYTE* cData, WORD wLen)
+
+  Description:
+	Reads an array of bytes from SPI Flash via the read cache.
+
+  Precondition:
+	None
+
+  Parameters:
+	addr - SPI Flash address to read from
+	cData - where to store the bytes that were read
+	wLen - how many bytes to read
+
+  Returns:
+	None
+  ***************************************************************************/
+static void _CacheRead(DWORD addr, BYTE* cData, WORD wLen)
+{
+	WORD offset;
+	WORD count;
+
+	while(wLen)
+	{
+		offset = (WORD)addr & (MPFS_CACHE_LINE_SIZE-1);
+		count = MPFS_CACHE_LINE_SIZE - offset;
+		if(count > wLen)
+			count = wLen;
+
+		memcpy((void*)cData, (void*)(_CacheGetLine(addr / MPFS_CACHE_LINE_SIZE) + offset), count);
+		addr += count;
+		cData += count;
+		wLen -= count;
+	}
+}
+
+#endif	//#if defined(MPFS_CACHE_ENABLED)
+
+
 /****************************************************************************
   Section:
 	Meta Data Accessors
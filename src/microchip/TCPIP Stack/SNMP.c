@@ -65,6 +65,14 @@
 #if defined(STACK_USE_SNMP_SERVER)
 
 #include "TCPIP Stack/TCPIP.h"
+
+//MODTRONIX added next 5 lines
+#if !defined(DEBUG_CONF_SNMP)
+    #define DEBUG_CONF_SNMP      DEBUG_CONF_DEFAULT   //Default Debug Level, disabled if DEBUG_LEVEL_ALLOFF defined, else DEBUG_LEVEL_ERROR
+#endif
+#define MY_DEBUG_LEVEL   DEBUG_CONF_SNMP
+#include "nz_debug.h"
+
 #ifdef STACK_USE_SNMPV3_SERVER
 #include "TCPIP Stack/SNMPv3.h"
 #endif
@@ -82,6 +90,13 @@ static BOOL IsValidPDU(SNMP_ACTION* pdu);
 static BOOL IsASNNull(void);
 static BOOL SNMPCheckIfPvtMibObjRequested(BYTE* OIDValuePtr);
 static void ReadMIBRecord(DWORD h, OID_INFO* rec);
+static void SNMPParseNode(DWORD h, SNMP_MIB_NODE* node);
+static void SNMPReadNode(DWORD h, SNMP_MIB_NODE* node);
+#if (SNMP_MIB_INDEX_SIZE > 0)
+static void SNMPMibIndexCheck(void);
+#else
+#define SNMPMibIndexCheck()
+#endif
 
 
 
@@ -97,6 +112,11 @@ static void ReadMIBRecord(DWORD h, OID_INFO* rec);
 	Global Variables
   ***************************************************************************/
 WORD SNMPTxOffset=0;	//Snmp udp buffer tx offset
+static WORD SNMPTxLen=0;	//MODTRONIX added. Number of bytes in snmpTxBuf to send
+static BYTE snmpTxBuf[SNMP_TX_BUF_SIZE];	//MODTRONIX added. Message is built in this buffer, and sent by _SNMPFlush()
+static BOOL snmpTxDirect;	//MODTRONIX added. Message did not fit in snmpTxBuf, and is written directly to the UDP socket
+static BOOL snmpTxAbort;	//MODTRONIX added. Message written directly to the UDP socket did not fit, and is discarded by _SNMPFlush()
+WORD snmpTxDropCnt=0;	//MODTRONIX added. Number of messages discarded because they did not fit in snmpTxBuf or the UDP socket
 static WORD SNMPRxOffset=0;	//Snmp udp buffer rx offset		
 static SNMP_STATUS SNMPStatus;	//MIB file access status
 static UDP_SOCKET SNMPAgentSocket = INVALID_UDP_SOCKET;	//Snmp udp socket
@@ -113,6 +133,25 @@ WORD msgSecrtyParamLenOffset=0;
 
 
 
+//MODTRONIX added. In-RAM index of the snmp.bib nodes, in the order they are stored in the file.
+//This is depth first order, so the index is sorted by OID and by node offset.
+#if (SNMP_MIB_INDEX_SIZE > 0)
+static SNMP_MIB_NODE snmpMibIndex[SNMP_MIB_INDEX_SIZE];
+static WORD snmpMibIndexCount;          //Number of nodes in index
+static DWORD snmpMibIndexTimestamp;     //Timestamp of snmp.bib file index was built for
+static DWORD snmpMibIndexFileSize;      //Size of snmp.bib file index was built for, 0 if not built
+#endif
+
+//MODTRONIX added. OID and last returned MIB record of the first GetBulk repeater varbinds
+#if (SNMP_BULK_CACHE_SIZE > 0)
+static struct
+{
+	OID_INFO	rec;				//MIB record returned by last repetition
+	BYTE		oid[OID_MAX_LEN];	//OID of varbind in request
+	BYTE		oidLen;
+} snmpBulkCache[SNMP_BULK_CACHE_SIZE];
+#endif
+
 // SNMPNotifyInfo is not required if TRAP is disabled
 #if !defined(SNMP_TRAP_DISABLED)
 SNMP_NOTIFY_INFO SNMPNotifyInfo; //notify info for trap
@@ -558,6 +597,9 @@ void _SNMPDuplexInit(UDP_SOCKET socket)
 	// Initialize buffer offsets.
 	SNMPRxOffset = 0;
 	SNMPTxOffset = 0;
+	SNMPTxLen = 0;
+	snmpTxDirect = FALSE;	//MODTRONIX added this line
+	snmpTxAbort = FALSE;	//MODTRONIX added this line
 }
 
 
@@ -569,9 +611,10 @@ void _SNMPDuplexInit(UDP_SOCKET socket)
 	Copy byte to tx buffer.
 
   Description:
-	This function writes a single byte to the currently active UDP socket, 
-	transmit buffer, while incrementing the buffer offset for the next write 
-	operation.
+	This function writes a single byte to the SNMP transmit buffer, while
+	incrementing the buffer offset for the next write operation.
+	MODTRONIX - Message is built in RAM, and written to the currently active
+	UDP socket with _SNMPFlush().
 
   Precondition:
 	SNMPTask() is called.	
@@ -588,11 +631,172 @@ void _SNMPDuplexInit(UDP_SOCKET socket)
 ***************************************************************************/
 void _SNMPPut(BYTE v)
 {
-	UDPSetTxBuffer(SNMPTxOffset);
+	//MODTRONIX added next 6 lines
+	if(snmpTxDirect)
+	{
+		if(!snmpTxAbort && !UDPPut(v))
+			snmpTxAbort = TRUE;
+		return;
+	}
 
-	UDPPut(v);
+	if(SNMPTxOffset < sizeof(snmpTxBuf))
+		snmpTxBuf[SNMPTxOffset] = v;
 
 	SNMPTxOffset++;
+	if(SNMPTxOffset > SNMPTxLen)
+		SNMPTxLen = SNMPTxOffset;
+}
+
+
+/****************************************************************************
+  Function:
+	void _SNMPPutArray(BYTE* p, WORD len)
+	
+  Summary:
+	Copy array to tx buffer.
+
+  Description:
+	MODTRONIX added. Writes the given array to the SNMP transmit buffer. Used
+	for SNMPv3 messages, that are built in their own RAM buffer. If the
+	message does not fit in the tx buffer, the data written so far and the
+	given array are written directly to the UDP socket, and all following
+	_SNMPPut() calls also write to the socket. The length placeholders
+	written by _SNMPPutLenAt() can not be used after this. If the message
+	does not fit in the UDP socket either, it is discarded by _SNMPFlush().
+	This is also the case if a later write to the socket is short.
+
+  Precondition:
+	_SNMPDuplexInit() is called.
+	
+  Parameters:
+	p	- Data to write
+	len	- Number of bytes in p
+ 
+  Returns:
+	None.
+***************************************************************************/
+void _SNMPPutArray(BYTE* p, WORD len)
+{
+	WORD len2;
+
+	if(!snmpTxDirect)
+	{
+		if(((DWORD)SNMPTxOffset + len) <= sizeof(snmpTxBuf))
+		{
+			memcpy(&snmpTxBuf[SNMPTxOffset], p, len);
+			SNMPTxOffset += len;
+			if(SNMPTxOffset > SNMPTxLen)
+				SNMPTxLen = SNMPTxOffset;
+			return;
+		}
+
+		// Message will not fit in UDP socket either, _SNMPFlush() discards it
+		if((SNMPTxLen > sizeof(snmpTxBuf)) || (((DWORD)SNMPTxLen + len) > (MAC_TX_BUFFER_SIZE - sizeof(IP_HEADER) - sizeof(UDP_HEADER))))
+		{
+			SNMPTxOffset += len;
+			if(SNMPTxOffset > SNMPTxLen)
+				SNMPTxLen = SNMPTxOffset;
+			return;
+		}
+
+		DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nSNMP: Msg too large for tx buffer, writing to socket");
+		snmpTxDirect = TRUE;
+		UDPSetTxBuffer(0);
+		UDPPutArray(snmpTxBuf, SNMPTxLen);
+	}
+
+	// Socket is full, the message can not be sent
+	if(snmpTxAbort)
+		return;
+	len2 = UDPPutArray(p, len);
+	SNMPTxOffset += len2;
+	if(len2 != len)
+		snmpTxAbort = TRUE;
+}
+
+
+/****************************************************************************
+  Function:
+	void _SNMPPutLenAt(WORD offset, WORD len)
+	
+  Summary:
+	Writes a 2 byte length to a placeholder in the tx buffer.
+
+  Description:
+	MODTRONIX added. Writes the given length, MSB first, to the 2 byte
+	placeholder at the given offset of a long form (0x82) length field. The
+	current tx offset is not changed.
+
+  Precondition:
+	_SNMPDuplexInit() is called.
+	
+  Parameters:
+	offset	- Offset of placeholder in tx buffer
+	len		- Length to write
+ 
+  Returns:
+	None.
+***************************************************************************/
+void _SNMPPutLenAt(WORD offset, WORD len)
+{
+	if((offset + 1u) < sizeof(snmpTxBuf))
+	{
+		snmpTxBuf[offset] = (BYTE)(len >> 8);
+		snmpTxBuf[offset+1] = (BYTE)len;
+	}
+}
+
+
+/****************************************************************************
+  Function:
+	void _SNMPFlush(void)
+	
+  Summary:
+	Sends the message in the tx buffer.
+
+  Description:
+	MODTRONIX added. Writes the message built with _SNMPPut() to the
+	currently active UDP socket with a single UDPPutArray(), and transmits
+	it. If the message did not fit in the tx buffer, it is discarded and
+	snmpTxDropCnt is incremented. Messages written directly to the socket
+	by _SNMPPutArray() are transmitted, unless a write to the socket was
+	short. The partly written message is then discarded from the socket,
+	and snmpTxDropCnt is incremented.
+
+  Precondition:
+	_SNMPDuplexInit() is called for the active UDP socket.
+	
+  Parameters:
+	None.
+ 
+  Returns:
+	None.
+***************************************************************************/
+void _SNMPFlush(void)
+{
+	if(snmpTxDirect)
+	{
+		if(snmpTxAbort)
+		{
+			UDPDiscardTx();
+			snmpTxDropCnt++;
+			DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\nSNMP: Msg too large for UDP socket, discarded");
+			return;
+		}
+		UDPFlush();
+		return;
+	}
+
+	if(SNMPTxLen > sizeof(snmpTxBuf))
+	{
+		snmpTxDropCnt++;
+		DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\nSNMP: Msg too large for tx buffer, discarded");
+		return;
+	}
+
+	UDPSetTxBuffer(0);
+	UDPPutArray(snmpTxBuf, SNMPTxLen);
+	UDPFlush();
 }
 
 
@@ -746,6 +950,7 @@ BOOL SNMPTask(void)
 	if(hMPFS != MPFS_INVALID_HANDLE)
     {
        SNMPStatus.Flags.bIsFileOpen = TRUE;
+       SNMPMibIndexCheck();     //MODTRONIX added
     }
 
 	if(pduInfoDB.snmpVersion != SNMP_V3) // if(SNMP_V1, SNMP_V2C)
@@ -772,7 +977,7 @@ BOOL SNMPTask(void)
 #if !defined(SNMP_TRAP_DISABLED)
 	if(gSendTrapFlag==(BYTE)FALSE)	
 #endif		
-   		UDPFlush();
+   		_SNMPFlush();       //MODTRONIX
 
 	#ifdef STACK_USE_SNMPV3_SERVER
 	Snmpv3FreeDynAllocMem();
@@ -1079,6 +1284,7 @@ BOOL SNMPNotify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index)
 		UDPClose(SNMPNotifyInfo.socket);
 		return FALSE;
 	}
+	SNMPMibIndexCheck();     //MODTRONIX added
 	
 	if((packetStructLenOffset == 0)&&(pduStructLenOffset==0))
 	{
@@ -1399,7 +1605,7 @@ BOOL SNMPNotify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index)
 	varbindlen = 0;
 	
 	MPFSClose(hMPFS);
-	UDPFlush();
+	_SNMPFlush();       //MODTRONIX
 	UDPClose(SNMPNotifyInfo.socket);
 
 	return TRUE;
@@ -1471,6 +1677,7 @@ BOOL SNMPNotify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index)
         UDPClose(SNMPNotifyInfo.socket);
         return FALSE;
     }
+    SNMPMibIndexCheck();     //MODTRONIX added
 
     _SNMPDuplexInit(SNMPNotifyInfo.socket);
 
@@ -1652,7 +1859,7 @@ BOOL SNMPNotify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index)
     _SNMPSetTxOffset(prevOffset);
 
     MPFSClose(hMPFS);
-    UDPFlush();
+    _SNMPFlush();       //MODTRONIX
     UDPClose(SNMPNotifyInfo.socket);
 
     return TRUE;
@@ -3248,6 +3455,7 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
 
 	WORD_VAL tempData;
     DWORD hNode,tempHNode;//    MPFS hNode;
+    SNMP_MIB_NODE node;
 
 	appendZeroToOID=TRUE;
 
@@ -3265,15 +3473,15 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
 
     while( 1 )
     {
-    
-		MPFSSeek(hMPFS, hNode, MPFS_SEEK_START);
+        //MODTRONIX - Node is read from in-RAM MIB index if it is in it, else from MPFS
+        SNMPReadNode(hNode, &node);
 
         // Remember offset of this node so that we can find its sibling
         // and child data.
-        rec->hNode = MPFSTell(hMPFS); // hNode;
+        rec->hNode = hNode;
 
-        // Read OID byte.
-        MPFSGet(hMPFS, &savedOID);
+        // OID byte.
+        savedOID = node.oid;
 
 		if(comapreOidWithSibling==(BYTE)FALSE)
 		{
@@ -3281,36 +3489,19 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
 			tempHNode=hNode;
 		}
 
-        // Read Node Info
-        MPFSGet(hMPFS, &rec->nodeInfo.Val);
+        // Node Info
+        rec->nodeInfo = node.nodeInfo;
 
-	    // Next byte will be node id, if this is a leaf node with variable data.
+	    // Node id, if this is a leaf node with variable data.
         if(rec->nodeInfo.Flags.bIsIDPresent)
         {
-        	MPFSGet(hMPFS,&idLen);
-			if(idLen == 1)
-			{
-                            BYTE temp;
-                            MPFSGet(hMPFS,&temp);
-                            rec->id = temp & 0xFF;
-                           //MPFSGet(hMPFS,(BYTE *)&rec->id);
-			}
-			else if(idLen == 2)
-			{
-				BYTE temp[2];
-				MPFSGetArray(hMPFS, temp,2);
-				rec->id = 0;
-				rec->id = temp[0] & 0xFF;
-				rec->id <<= 8;
-				rec->id |= temp[1] & 0xFF;				
-			}				
+            rec->id = node.id;
         }
 	
-        // Read sibling offset, if there is any.
+        // Sibling offset, if there is any.
         if(rec->nodeInfo.Flags.bIsSibling)
         {
-            MPFSGet(hMPFS, &tempData.v[0]);
-            MPFSGet(hMPFS, &tempData.v[1]);
+            tempData.Val = node.hSibling;
             rec->hSibling = tempData.Val;
         }
 
@@ -3328,8 +3519,7 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
 
 			if ( rec->nodeInfo.Flags.bIsSibling )
             {
- 	            hNode = MPFSSeek(hMPFS, tempData.Val, MPFS_SEEK_START);
-	            hNode = MPFSTell(hMPFS);
+	            hNode = tempData.Val;
 				comapreOidWithSibling=TRUE;
             }
             else
@@ -3346,17 +3536,15 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
             // i.e. single index.
             if ( !rec->nodeInfo.Flags.bIsParent )
             {
-            	// Read and discard Distant Sibling info if there is any.
+            	// Distant Sibling info if there is any.
                 if ( rec->nodeInfo.Flags.bIsDistantSibling )
                 {	
-                   	MPFSGet(hMPFS, &tempData.v[0]);
-                    MPFSGet(hMPFS, &tempData.v[1]);
+                    tempData.Val = node.hSibling;
                     rec->hSibling = tempData.Val;
                 }
 
-		        rec->dataType = 0;
-                MPFSGet(hMPFS, (BYTE*)&rec->dataType);
-                rec->hData = MPFSTell(hMPFS);
+		        rec->dataType = (DATA_TYPE)node.dataType;
+                rec->hData = hNode + node.hdrLen;
 
 				if(snmpReqType==SNMP_GET && matchedCount == 0u)
 				{
@@ -3403,7 +3591,7 @@ BYTE OIDLookup(PDU_INFO* pduDbPtr,BYTE* oid, BYTE oidLen, OID_INFO* rec)
 			}
             else
             {	
-	            hNode = MPFSTell(hMPFS);
+	            hNode = hNode + node.hdrLen;
                 // Try to match following child node.
                 continue;
             }
@@ -3514,8 +3702,10 @@ DidNotFindIt:
 ***************************************************************************/
 BOOL GetNextLeaf(OID_INFO* rec)
 {
-    WORD_VAL temp;
-	BYTE idLen=1; 	 
+    DWORD h;
+    SNMP_MIB_NODE node;
+
+    h = MPFSTell(hMPFS);
 
     // If current node is leaf, its next sibling (near or distant) is the next leaf.
     if ( !rec->nodeInfo.Flags.bIsParent )
@@ -3526,7 +3716,7 @@ BOOL GetNextLeaf(OID_INFO* rec)
            rec->nodeInfo.Flags.bIsDistantSibling )
         {
             // Reposition at sibling.
-            MPFSSeek(hMPFS, rec->hSibling, MPFS_SEEK_START);
+            h = rec->hSibling;
 
             // Fetch node related information
         }
@@ -3540,59 +3730,36 @@ BOOL GetNextLeaf(OID_INFO* rec)
 
     while( 1 )
     {
-        // Remember current MPFS position for this node.
-       rec->hNode = MPFSTell(hMPFS);
+        //MODTRONIX - Node is read from in-RAM MIB index if it is in it, else from MPFS
+        SNMPReadNode(h, &node);
 
-        // Read OID byte.
-        MPFSGet(hMPFS, &rec->oid);
+        // Remember position for this node.
+        rec->hNode = h;
+        rec->oid = node.oid;
+        rec->nodeInfo = node.nodeInfo;
 
-        // Read Node Info
-        MPFSGet(hMPFS, &rec->nodeInfo.Val);
-
-        // Next byte will be node id, if this is a leaf node with variable data.
-       
+        // Node id, if this is a leaf node with variable data.
         if ( rec->nodeInfo.Flags.bIsIDPresent )
-		{
-			 // Fetch index ID.
-		    MPFSGet(hMPFS,&idLen);
-		    if(idLen == 1)  
-                    {
-                        BYTE temp;
-                       	MPFSGet(hMPFS,&temp);
-                        rec->id = temp & 0xFF;
-                    }
-			else if(idLen == 2)
-			{
-				BYTE temp[2];
-				MPFSGetArray(hMPFS, temp,2);
-				rec->id = 0;
-				rec->id = temp[0] & 0xFF;
-				rec->id <<= 8;
-				rec->id |= temp[1] & 0xFF;				
-			}		
-            //MPFSGet(hMPFS,(BYTE *) &rec->id);
-		}
+            rec->id = node.id;
 
-        // Fetch sibling offset, if there is any.
+        // Sibling offset, if there is any.
         if ( rec->nodeInfo.Flags.bIsSibling ||
              rec->nodeInfo.Flags.bIsDistantSibling )
         {
-            MPFSGet(hMPFS, &temp.v[0]);
-            MPFSGet(hMPFS, &temp.v[1]);
-            rec->hSibling = temp.Val;
+            rec->hSibling = node.hSibling;
         }
 
         // If we have not reached a leaf yet, continue fetching next child in line.
+        h += node.hdrLen;
         if ( rec->nodeInfo.Flags.bIsParent )
         {
             continue;
         }
 
-        // Fetch data type.
-        rec->dataType = 0;
-        MPFSGet(hMPFS, (BYTE*)&rec->dataType);
+        // Data type.
+        rec->dataType = (DATA_TYPE)node.dataType;
 
-        rec->hData = MPFSTell(hMPFS);
+        rec->hData = h;
 
         // Since we just found next leaf in line, it will always have zero index
         // to it.
@@ -3638,74 +3805,227 @@ BOOL GetNextLeaf(OID_INFO* rec)
 static void ReadMIBRecord(DWORD h, OID_INFO* rec)
 {
     MIB_INFO nodeInfo;
-    WORD_VAL tempVal;
-	BYTE idLen=1;
+    SNMP_MIB_NODE node;
 
-    MPFSSeek(hMPFS, h, MPFS_SEEK_START);
+    //MODTRONIX - Node is read from in-RAM MIB index if it is in it, else from MPFS
+    SNMPReadNode(h, &node);
 
     // Remember location of this record.
     rec->hNode = h;
 
-    // Read OID
-    MPFSGet(hMPFS, &rec->oid);
+    // OID
+    rec->oid = node.oid;
 
-    // Read nodeInfo
-    MPFSGet(hMPFS, &rec->nodeInfo.Val);
+    // nodeInfo
+    rec->nodeInfo = node.nodeInfo;
     nodeInfo = rec->nodeInfo;
 
-    // Read id, if there is any: Only leaf node with dynamic data will have id.
+    // id, if there is any: Only leaf node with dynamic data will have id.
     if ( nodeInfo.Flags.bIsIDPresent )
-    {
-    	 // Fetch index ID.
-	    MPFSGet(hMPFS,&idLen);
-	    if(idLen == 1)
-	    {
-	    	BYTE temp=0;
-	    	MPFSGet(hMPFS,&temp);
-			rec->id = temp & 0xFF;			
-	    }
-		else if(idLen == 2)
-		{
-			BYTE temp[2];
-			MPFSGetArray(hMPFS, temp,2);
-			rec->id = 0;
-			rec->id = temp[0] & 0xFF;
-			rec->id <<= 8;
-			rec->id |= temp[1] & 0xFF;				
-		}		
-        //MPFSGet(hMPFS, &rec->id);
-    }
-    // Read Sibling offset if there is any - any node may have sibling
+        rec->id = node.id;
+
+    // Sibling offset if there is any - any node may have sibling
     if ( nodeInfo.Flags.bIsSibling )
-    {
-        MPFSGet(hMPFS, &tempVal.v[0]);
-        MPFSGet(hMPFS, &tempVal.v[1]);
-        rec->hSibling = tempVal.Val;
-    }
+        rec->hSibling = node.hSibling;
 
     // All rest of the parameters are applicable to leaf node only.
     if ( nodeInfo.Flags.bIsParent )
-        rec->hChild = MPFSTell(hMPFS);
+        rec->hChild = h + node.hdrLen;
     else
     {
+        // Distant Sibling if there is any - only leaf node will have distant sibling
         if ( nodeInfo.Flags.bIsDistantSibling )
+            rec->hSibling = node.hSibling;
+
+        // Save data type for this node.
+        rec->dataType = (DATA_TYPE)node.dataType;
+
+        rec->hData = h + node.hdrLen;
+    }
+}
+
+/****************************************************************************
+  Function:
+	static void SNMPParseNode(DWORD h, SNMP_MIB_NODE* node)
+	
+  Summary:
+  	Reads the header of a snmp.bib node from MPFS.
+  	
+  Description:
+  	MODTRONIX added. Reads and parses the header of the node at the given
+  	offset: <oid, nodeInfo, [idLen, id], [sibling], [distantSibling],
+  	[dataType]>. The MPFS file position is left at the end of the header.
+  	
+  Precondition:
+	snmp.bib has been opened with hMPFS.
+	
+  Parameters:
+	h		-	Node address
+	node	-	Parsed node is written to this structure
+  
+  Returns:
+	None.
+***************************************************************************/
+static void SNMPParseNode(DWORD h, SNMP_MIB_NODE* node)
+{
+    BYTE temp[2];
+
+    MPFSSeek(hMPFS, h, MPFS_SEEK_START);
+    node->hNode = (WORD)h;
+    node->hSibling = 0;
+    node->id = 0;
+    node->dataType = 0;
+
+    MPFSGet(hMPFS, &node->oid);
+    MPFSGet(hMPFS, &node->nodeInfo.Val);
+
+    // Id is 1 or 2 bytes long, MSB first
+    if ( node->nodeInfo.Flags.bIsIDPresent )
+    {
+        MPFSGet(hMPFS, &temp[0]);
+        if(temp[0] == 1u)
         {
-            // Read Distant Sibling if there is any - only leaf node will have distant sibling
-            MPFSGet(hMPFS, &tempVal.v[0]);
-            MPFSGet(hMPFS, &tempVal.v[1]);
-            rec->hSibling = tempVal.Val;
+            MPFSGet(hMPFS, &temp[1]);
+            node->id = temp[1];
         }
+        else if(temp[0] == 2u)
+        {
+            MPFSGetArray(hMPFS, temp, 2);
+            node->id = ((WORD)temp[0] << 8) | temp[1];
+        }
+    }
 
-        // Save data type for this node.
-        rec->dataType = 0;
-        MPFSGet(hMPFS, (BYTE*)&rec->dataType);
+    // Sibling offset, LSB first. Any node may have a sibling
+    if ( node->nodeInfo.Flags.bIsSibling )
+    {
+        MPFSGetArray(hMPFS, temp, 2);
+        node->hSibling = ((WORD)temp[1] << 8) | temp[0];
+    }
 
-        rec->hData = MPFSTell(hMPFS);
+    if ( !node->nodeInfo.Flags.bIsParent )
+    {
+        // Only leaf nodes have a distant sibling
+        if ( node->nodeInfo.Flags.bIsDistantSibling )
+        {
+            MPFSGetArray(hMPFS, temp, 2);
+            node->hSibling = ((WORD)temp[1] << 8) | temp[0];
+        }
+        MPFSGet(hMPFS, &node->dataType);
+    }
+
+    node->hdrLen = (BYTE)(MPFSTell(hMPFS) - h);
+}
 
+/****************************************************************************
+  Function:
+	static void SNMPReadNode(DWORD h, SNMP_MIB_NODE* node)
+	
+  Summary:
+  	Gets the header of a snmp.bib node, from the in-RAM MIB index if possible.
+  	
+  Description:
+  	MODTRONIX added. The node at the given offset is searched for in the
+  	in-RAM MIB index with a binary search. If it is not in the index, it is
+  	read from MPFS. In both cases the MPFS file position is left at the end
+  	of the node header, same as when the node is read from MPFS.
+  	
+  Precondition:
+	snmp.bib has been opened with hMPFS.
+	
+  Parameters:
+	h		-	Node address
+	node	-	Node is written to this structure
+  
+  Returns:
+	None.
+***************************************************************************/
+static void SNMPReadNode(DWORD h, SNMP_MIB_NODE* node)
+{
+    #if (SNMP_MIB_INDEX_SIZE > 0)
+    WORD lo, hi, mid;
+
+    lo = 0;
+    hi = snmpMibIndexCount;
+    while(lo < hi)
+    {
+        mid = (lo + hi) >> 1;
+        if(snmpMibIndex[mid].hNode < h)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if((lo < snmpMibIndexCount) && (snmpMibIndex[lo].hNode == h))
+    {
+        *node = snmpMibIndex[lo];
+        MPFSSeek(hMPFS, h + node->hdrLen, MPFS_SEEK_START);
+        return;
     }
+    #endif
 
+    SNMPParseNode(h, node);
 }
 
+#if (SNMP_MIB_INDEX_SIZE > 0)
+/****************************************************************************
+  Function:
+	static void SNMPMibIndexCheck(void)
+	
+  Summary:
+  	Builds the in-RAM MIB index if it is not valid for the current snmp.bib.
+  	
+  Description:
+  	MODTRONIX added. The index is built the first time snmp.bib is opened,
+  	and rebuilt if the file changed (for example after an MPFS upload). All
+  	nodes are visited in depth first order, the same order they are stored
+  	in. The child of a parent node follows its header, and the next node
+  	after a leaf is its sibling or distant sibling. If the MIB has more
+  	than SNMP_MIB_INDEX_SIZE nodes, only the first ones are indexed, and the
+  	rest are read from MPFS. Because the index is built at runtime, the
+  	snmp.bib format generated by mib2bib (source in "Utilities/Source/
+  	mib2bib - java") does not change.
+  	
+  Precondition:
+	snmp.bib has been opened with hMPFS.
+	
+  Parameters:
+	None
+  
+  Returns:
+	None.
+***************************************************************************/
+static void SNMPMibIndexCheck(void)
+{
+    SNMP_MIB_NODE* node;
+    DWORD h;
+
+    if((snmpMibIndexFileSize == MPFSGetSize(hMPFS)) && (snmpMibIndexTimestamp == MPFSGetTimestamp(hMPFS)))
+        return;
+
+    snmpMibIndexCount = 0;
+    snmpMibIndexFileSize = MPFSGetSize(hMPFS);
+    snmpMibIndexTimestamp = MPFSGetTimestamp(hMPFS);
+
+    h = 0;
+    while((snmpMibIndexCount < SNMP_MIB_INDEX_SIZE) && (h < snmpMibIndexFileSize))
+    {
+        node = &snmpMibIndex[snmpMibIndexCount];
+        SNMPParseNode(h, node);
+
+        // Index must be sorted by node offset for binary search
+        if((snmpMibIndexCount != 0u) && (node->hNode <= snmpMibIndex[snmpMibIndexCount-1].hNode))
+            break;
+        snmpMibIndexCount++;
+
+        if(node->nodeInfo.Flags.bIsParent)
+            h += node->hdrLen;
+        else if(node->nodeInfo.Flags.bIsSibling || node->nodeInfo.Flags.bIsDistantSibling)
+            h = node->hSibling;
+        else
+            break;      // Last node in MIB
+    }
+}
+#endif
+
 /****************************************************************************
   Function:
 	void SetErrorStatus(WORD errorStatusOffset,
@@ -3740,17 +4060,12 @@ void SetErrorStatus(WORD errorStatusOffset,
                            SNMP_ERR_STATUS errorStatus,
                            BYTE errorIndex)
 {
-    WORD prevOffset;
-
-    prevOffset = _SNMPGetTxOffset();
-
-    _SNMPSetTxOffset(errorStatusOffset);
-    _SNMPPut((BYTE)errorStatus);
+    //MODTRONIX - Placeholders are in RAM tx buffer, write them directly
+    if(errorStatusOffset < sizeof(snmpTxBuf))
+        snmpTxBuf[errorStatusOffset] = (BYTE)errorStatus;
 
-    _SNMPSetTxOffset(errorIndexOffset);
-    _SNMPPut(errorIndex);
-
-    _SNMPSetTxOffset(prevOffset);
+    if(errorIndexOffset < sizeof(snmpTxBuf))
+        snmpTxBuf[errorIndexOffset] = errorIndex;
 }
 
 
@@ -3969,6 +4284,9 @@ static BOOL ProcessVariables(PDU_INFO* pduDbPtr,char* community, BYTE len)
     WORD errorIndexOffset=0;    
     WORD varStructLenOffset=0;	
 	WORD prevSnmpRxOffset=0;	
+	WORD bulkRxOffset=0;	//MODTRONIX added. Rx offset of first GetBulk repeater not in snmpBulkCache
+	BOOL bulkCacheValid;	//MODTRONIX added
+	BOOL bCached;			//MODTRONIX added
     WORD_VAL varBindingLen={0};
     WORD_VAL tempLen={0};
     WORD_VAL varPairLen={0};
@@ -4232,7 +4550,7 @@ WORD_VAL bytesAdded2Pdu;
 			if ( !temp )
 			{
 				SetErrorStatus(errorStatusOffset,errorIndexOffset,SNMP_GEN_ERR,varIndex);
-				UDPTxCount = SNMPTxOffset;
+				SNMPTxLen = SNMPTxOffset;
 				goto GEN_ERROR;
 	//			return FALSE;
 			}
@@ -4259,7 +4577,7 @@ WORD_VAL bytesAdded2Pdu;
 			if ( !IsValidOID(OIDValue, &OIDLen) )
 			{
 				SetErrorStatus(errorStatusOffset,errorIndexOffset,SNMP_GEN_ERR,varIndex);
-				UDPTxCount = SNMPTxOffset-4;
+				SNMPTxLen = SNMPTxOffset-4;
 				goto GEN_ERROR;
 	//			return FALSE;
 			}
@@ -4436,12 +4754,7 @@ WORD_VAL bytesAdded2Pdu;
 
 				//Now update the place holder for var pair length
 				prevOffset = _SNMPGetTxOffset();
-				_SNMPSetTxOffset(varStructLenOffset);
-
-				_SNMPPut(varPairLen.v[1]);
-				_SNMPPut(varPairLen.v[0]);
-
-				_SNMPSetTxOffset(prevOffset);
+				_SNMPPutLenAt(varStructLenOffset, varPairLen.Val);    //MODTRONIX
 
 				varPairLen.Val=0x00;
 
@@ -4657,11 +4970,7 @@ WORD_VAL bytesAdded2Pdu;
 
 			//Update place holder
 			prevOffset = _SNMPGetTxOffset();
-			_SNMPSetTxOffset(varStructLenOffset);
-			_SNMPPut(varPairLen.v[1]);
-			_SNMPPut(varPairLen.v[0]);
-
-			_SNMPSetTxOffset(prevOffset);
+			_SNMPPutLenAt(varStructLenOffset, varPairLen.Val);    //MODTRONIX
 			varStructLenOffset = _SNMPGetTxOffset();
 
 
@@ -4698,9 +5007,16 @@ WORD_VAL bytesAdded2Pdu;
 
 			/*Process each variable in request as Get_Next for 
 			  Getbulk_M (Max_repetition) times */
+			bulkCacheValid = (SNMP_BULK_CACHE_SIZE > 0u);
+			bulkRxOffset = prevSnmpRxOffset;
 			for(repeatCntr=0;repeatCntr<Getbulk_M;repeatCntr++)
 			{
-				SNMPRxOffset=prevSnmpRxOffset;
+				//MODTRONIX - Repeaters in snmpBulkCache are only parsed from the request in the
+				//first repetition. Following repetitions start at the first repeater not cached.
+				if((repeatCntr == 0u) || !bulkCacheValid)
+					SNMPRxOffset=prevSnmpRxOffset;
+				else
+					SNMPRxOffset=bulkRxOffset;
 				
 				//Process every veriable in the request.
 				for(varBindCntr=0;varBindCntr<Getbulk_R;varBindCntr++)
@@ -4711,14 +5027,24 @@ WORD_VAL bytesAdded2Pdu;
 
 					varIndex++;
 
+					bCached = FALSE;
+					#if (SNMP_BULK_CACHE_SIZE > 0)
+					if((repeatCntr == 0u) && (varBindCntr == SNMP_BULK_CACHE_SIZE))
+						bulkRxOffset = SNMPRxOffset;
+					bCached = (repeatCntr != 0u) && bulkCacheValid && (varBindCntr < SNMP_BULK_CACHE_SIZE);
+					#endif
+
 					if((snmpReqVarErrStatus.endOfMibViewErr >> (tempNonRepeators+varBindCntr+1))&0x0001)
  					{
 						noOfVarToBeInResponse--;
- 						temp = IsValidStructure(&tempLen.Val);
-
-						if(varBindCntr!=Getbulk_R)
+						if(!bCached)
 						{
-							SNMPRxOffset=SNMPRxOffset+tempLen.Val;//2+OIDLen+2;
+	 						temp = IsValidStructure(&tempLen.Val);
+
+							if(varBindCntr!=Getbulk_R)
+							{
+								SNMPRxOffset=SNMPRxOffset+tempLen.Val;//2+OIDLen+2;
+							}
 						}
 						continue;
 					}
@@ -4738,31 +5064,63 @@ WORD_VAL bytesAdded2Pdu;
 
 					successor=repeatCntr;
 
-					// Decode variable length structure
-					temp = IsValidStructure(&tempLen.Val);
-					if ( !temp )
-						break;
-
-					// Decode next object
-					if ( !IsValidOID(OIDValue, &OIDLen) )
+					#if (SNMP_BULK_CACHE_SIZE > 0)
+					if(bCached)
 					{
-						SetErrorStatus(errorStatusOffset,errorIndexOffset,SNMP_GEN_ERR,varIndex);
-						UDPTxCount = SNMPTxOffset -4;
-						goto GEN_ERROR;
-						//return FALSE;
+						//MODTRONIX - Continue with the successor of the record returned by the last
+						//repetition. Request is not parsed, and OID is not searched in the MIB again.
+						OIDInfo = snmpBulkCache[varBindCntr].rec;
+						OIDLen = snmpBulkCache[varBindCntr].oidLen;
+						memcpy((void*)OIDValue, (void*)snmpBulkCache[varBindCntr].oid, OIDLen+1);   //Includes 0xff terminator
+						successor = 1;
+						oidLookUpRet = TRUE;
+						temp = 1;
 					}
-					templen=OIDLen;
-					ptroid=OIDValue;
-					
-					// For Get & Get-Next, value must be NULL.
-					if ( pduDbPtr->pduType != (BYTE)SET_REQUEST )
-						if ( !IsASNNull() )
+					else
+					#endif
+					{
+						// Decode variable length structure
+						temp = IsValidStructure(&tempLen.Val);
+						if ( !temp )
+						{
+							bulkCacheValid = FALSE;
 							break;
+						}
 
-					oidLookUpRet = OIDLookup(pduDbPtr,OIDValue, OIDLen, &OIDInfo);
-					if(oidLookUpRet == SNMP_END_OF_MIB_VIEW)
-					{
-						temp = GetNextLeaf(&OIDInfo);
+						// Decode next object
+						if ( !IsValidOID(OIDValue, &OIDLen) )
+						{
+							SetErrorStatus(errorStatusOffset,errorIndexOffset,SNMP_GEN_ERR,varIndex);
+							SNMPTxLen = SNMPTxOffset -4;
+							goto GEN_ERROR;
+							//return FALSE;
+						}
+						templen=OIDLen;
+						ptroid=OIDValue;
+						
+						// For Get & Get-Next, value must be NULL.
+						if ( pduDbPtr->pduType != (BYTE)SET_REQUEST )
+						{
+							if ( !IsASNNull() )
+							{
+								bulkCacheValid = FALSE;
+								break;
+							}
+						}
+
+						#if (SNMP_BULK_CACHE_SIZE > 0)
+						if(varBindCntr < SNMP_BULK_CACHE_SIZE)
+						{
+							snmpBulkCache[varBindCntr].oidLen = OIDLen;
+							memcpy((void*)snmpBulkCache[varBindCntr].oid, (void*)OIDValue, OIDLen+1);
+						}
+						#endif
+
+						oidLookUpRet = OIDLookup(pduDbPtr,OIDValue, OIDLen, &OIDInfo);
+						if(oidLookUpRet == SNMP_END_OF_MIB_VIEW)
+						{
+							temp = GetNextLeaf(&OIDInfo);
+						}
 					}
 					if(oidLookUpRet == FALSE)
 					{
@@ -4825,17 +5183,18 @@ WORD_VAL bytesAdded2Pdu;
 					}
 					else 
 						varPairLen.Val = (temp + 2);        // + OID headerbytes
+
+					#if (SNMP_BULK_CACHE_SIZE > 0)
+					//MODTRONIX - Next repetition of this repeater continues from this record
+					if(varBindCntr < SNMP_BULK_CACHE_SIZE)
+						snmpBulkCache[varBindCntr].rec = OIDInfo;
+					#endif
 				
 					varBindLen.Val += 4	// Variable Pair STRUCTURE byte + 1 length byte.
 					+ varPairLen.Val;
 
 					prevOffset = _SNMPGetTxOffset();
-					_SNMPSetTxOffset(varStructLenOffset);
-
-					_SNMPPut(varPairLen.v[1]);
-					_SNMPPut(varPairLen.v[0]);
-
-					_SNMPSetTxOffset(prevOffset);
+					_SNMPPutLenAt(varStructLenOffset, varPairLen.Val);    //MODTRONIX
 					varStructLenOffset = _SNMPGetTxOffset();
 					if((varStructLenOffset - tempTxOffset) >= SNMP_MAX_MSG_SIZE)
 					{
@@ -4891,7 +5250,7 @@ BIG_ERROR:
 		_SNMPPut(varBindLen.v[1]);
 		_SNMPPut(varBindLen.v[0]);
 								
-		UDPTxCount = _SNMPSetTxOffset(varBindStructOffset-2);
+		SNMPTxLen = _SNMPSetTxOffset(varBindStructOffset-2);
 		
 		smSnmp = SM_PKT_STRUCT_LEN_OFFSET;
 		return TRUE;
@@ -4912,7 +5271,7 @@ GETBULK_MAX_REESPONSE:
 	{
 		SNMPTxOffset = SNMPTxOffset - (varPairLen.Val+4);
 		varBindLen.Val = varBindLen.Val - (varPairLen.Val+4);
-		UDPTxCount = SNMPTxOffset;
+		SNMPTxLen = SNMPTxOffset;
 	}
 GEN_ERROR:
 	prevOffset = _SNMPGetTxOffset();
@@ -2407,10 +2407,7 @@ SNMP_PROCESS_END:
 			
 		gSnmpV3OUTPduWholeMsgBuf.wholeMsgLen.Val = outBufPtr-gSnmpV3OUTPduWholeMsgBuf.wholeMsgHead;
 		outBufPtr=gSnmpV3OUTPduWholeMsgBuf.wholeMsgHead;
-		for(i=0;i < gSnmpV3OUTPduWholeMsgBuf.wholeMsgLen.Val;i++)
-		{	
-			_SNMPPut(*(outBufPtr+i));
-		}
+		_SNMPPutArray(outBufPtr, gSnmpV3OUTPduWholeMsgBuf.wholeMsgLen.Val);	//MODTRONIX, was _SNMPPut() loop
 
 		//if(gSNMPv3ScopedPduResponseBuf.head != NULL)
 		if(gSnmpV3OUTPduWholeMsgBuf.wholeMsgHead != NULL)
@@ -4247,27 +4244,7 @@ BOOL Snmpv3Notify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index,UINT8 targetIndex)
 		//total length number of bytes need to be passed to the wire
 		gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgLen.Val = outBufPtr - gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead;
 		//outBufPtr=gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead;
-		i=0;
-		_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]);		//0x30
-
-		if(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i] == 0x81)
-		{
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]);//0x81
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]);//len_0
-		}
-		else if(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i] == 0x82)
-		{
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]); //0x82
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]); //len_1
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]); //len_0
-		}
-		else
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i++]);//len_o
-			
-		for(;i<gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgLen.Val;i++)
-		{	
-			_SNMPPut(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead[i]);
-		}
+		_SNMPPutArray(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead, gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgLen.Val);	//MODTRONIX, was _SNMPPut() loop
 
 		//if(gSNMPv3ScopedPduResponseBuf.head != NULL)
 		if(gSnmpV3TrapOUTPduWholeMsgBuf.wholeMsgHead != NULL)
@@ -4281,7 +4258,7 @@ BOOL Snmpv3Notify(SNMP_ID var, SNMP_VAL val, SNMP_INDEX index,UINT8 targetIndex)
 		}
 
 		MPFSClose(hMPFS);
-		UDPFlush();
+		_SNMPFlush();       //MODTRONIX
 		UDPClose(SNMPNotifyInfo.socket);
 		SNMPNotifyInfo.socket =  INVALID_UDP_SOCKET;
 
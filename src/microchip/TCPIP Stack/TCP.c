@@ -252,6 +252,13 @@ static WORD NextPort __attribute__((persistent));	// Tracking variable for next
 
 static TCB MyTCB;									// Currently loaded TCB
 static TCP_SOCKET hCurrentTCP = INVALID_SOCKET;		// Current TCP socket
+//MODTRONIX added. State of TX capture, see TCPStartTxCapture()
+#if defined(TCP_USE_TX_CAPTURE)
+static TCP_SOCKET hCaptureTCP = INVALID_SOCKET;		// Socket whose TX data is being captured, INVALID_SOCKET if none
+static BYTE* captureBuf;							// Buffer captured TX data is written to
+static WORD captureLen;								// Number of bytes captured so far
+static WORD captureSize;							// Size of captureBuf
+#endif
 #if TCP_SYN_QUEUE_MAX_ENTRIES
 	#if defined(__18CXX) && !defined(HI_TECH_C)	
 		#pragma udata SYN_QUEUE_RAM_SECT
@@ -275,6 +282,11 @@ static void TCPRAMCopy(PTR_BASE wDest, BYTE vDestType, PTR_BASE wSource, BYTE vS
 	#define TCPRAMCopyROM(a,b,c,d)	TCPRAMCopy(a,b,c,TCP_PIC_RAM,d)
 #endif
 
+//MODTRONIX added next 3 lines
+#if defined(STACK_USE_MPFS2)
+	static WORD TCPRAMCopyMPFS(PTR_BASE wDest, BYTE vDestType, MPFS_HANDLE hMPFS, WORD wLength);
+#endif
+
 static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags);
 static void HandleTCPSeg(TCP_HEADER* h, WORD len);
 static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote);
@@ -1102,6 +1114,12 @@ WORD TCPIsPutReady(TCP_SOCKET hTCP)
     {
         return 0;
     }
+
+	//MODTRONIX added. Return free space in capture buffer if TX data is being captured
+	#if defined(TCP_USE_TX_CAPTURE)
+	if(hTCP == hCaptureTCP)
+		return captureSize - captureLen;
+	#endif
     
 	SyncTCBStub(hTCP);
 
@@ -1164,6 +1182,17 @@ BOOL TCPPut(TCP_SOCKET hTCP, BYTE byte)
     {
         return 0;
     }
+
+	//MODTRONIX added. Write to capture buffer if TX data is being captured
+	#if defined(TCP_USE_TX_CAPTURE)
+	if(hTCP == hCaptureTCP)
+	{
+		if(captureLen >= captureSize)
+			return FALSE;
+		captureBuf[captureLen++] = byte;
+		return TRUE;
+	}
+	#endif
     
 	SyncTCBStub(hTCP);
 
@@ -1250,6 +1279,18 @@ WORD TCPPutArray(TCP_SOCKET hTCP, BYTE* data, WORD len)
     {
         return 0;
     }
+
+	//MODTRONIX added. Write to capture buffer if TX data is being captured
+	#if defined(TCP_USE_TX_CAPTURE)
+	if(hTCP == hCaptureTCP)
+	{
+		if(len > captureSize - captureLen)
+			len = captureSize - captureLen;
+		memcpy((void*)&captureBuf[captureLen], (void*)data, len);
+		captureLen += len;
+		return len;
+	}
+	#endif
     
 	SyncTCBStub(hTCP);
 
@@ -1370,6 +1411,18 @@ WORD TCPPutROMArray(TCP_SOCKET hTCP, ROM BYTE* data, WORD len)
     {
         return 0;
     }
+
+	//MODTRONIX added. Write to capture buffer if TX data is being captured
+	#if defined(TCP_USE_TX_CAPTURE)
+	if(hTCP == hCaptureTCP)
+	{
+		if(len > captureSize - captureLen)
+			len = captureSize - captureLen;
+		memcpypgm2ram((void*)&captureBuf[captureLen], (ROM void*)data, len);
+		captureLen += len;
+		return len;
+	}
+	#endif
     
 	SyncTCBStub(hTCP);
 
@@ -1457,6 +1510,121 @@ WORD TCPPutROMArray(TCP_SOCKET hTCP, ROM BYTE* data, WORD len)
 }
 #endif
 
+/*****************************************************************************
+  Function:
+	WORD TCPPutMPFS(TCP_SOCKET hTCP, MPFS_HANDLE hMPFS, WORD len)
+
+  Description:
+	Writes data read from an MPFS file to a TCP socket. The file data is moved
+	directly from the MPFS image into the socket's TX buffer, without first
+	being copied to an application buffer.
+
+  Precondition:
+	TCP is initialized, and hMPFS is an open MPFS file.
+
+  Parameters:
+	hTCP - The socket to which data is to be written.
+	hMPFS - The MPFS file to read data from. Its read pointer is advanced by
+		the number of bytes written.
+	len  - Number of bytes to be written.
+
+  Returns:
+	The number of bytes written to the socket.  If less than len, the
+	buffer became full, the socket is not conected, or the end of the
+	file was reached.
+
+  Remarks:
+	MODTRONIX added this function
+  ***************************************************************************/
+#if defined(STACK_USE_MPFS2)
+WORD TCPPutMPFS(TCP_SOCKET hTCP, MPFS_HANDLE hMPFS, WORD len)
+{
+	WORD wActualLen;
+	WORD wFreeTXSpace;
+	WORD wRightLen = 0;
+	PTR_BASE* pTxHead;
+
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return 0;
+    }
+
+	// Write to capture buffer if TX data is being captured
+	#if defined(TCP_USE_TX_CAPTURE)
+	if(hTCP == hCaptureTCP)
+	{
+		if(len > captureSize - captureLen)
+			len = captureSize - captureLen;
+		len = MPFSGetArray(hMPFS, &captureBuf[captureLen], len);
+		captureLen += len;
+		return len;
+	}
+	#endif
+    
+	SyncTCBStub(hTCP);
+
+	// Never write more than what is left in the file
+	if(MPFSGetBytesRem(hMPFS) < (DWORD)len)
+		len = (WORD)MPFSGetBytesRem(hMPFS);
+	if(len == 0u)
+		return 0;
+
+	wFreeTXSpace = TCPIsPutReady(hTCP);
+	if(wFreeTXSpace == 0u)
+	{
+		TCPFlush(hTCP);
+		return 0;
+	}
+
+	wActualLen = wFreeTXSpace;
+	if(wFreeTXSpace > len)
+		wActualLen = len;
+
+	// Send all current bytes if we are crossing half full
+	// This is required to improve performance with the delayed 
+	// acknowledgement algorithm
+	if((!MyTCBStub.Flags.bHalfFullFlush) && (wFreeTXSpace <= ((MyTCBStub.bufferRxStart-MyTCBStub.bufferTxStart)>>1)))
+	{
+		TCPFlush(hTCP);	
+		MyTCBStub.Flags.bHalfFullFlush = TRUE;
+	}
+	
+	pTxHead = &MyTCBStub.txHead;
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		pTxHead = &MyTCBStub.sslTxHead;
+	#endif
+
+	// See if we need a two part put
+	if(*pTxHead + wActualLen >= MyTCBStub.bufferRxStart)
+	{
+		wRightLen = MyTCBStub.bufferRxStart - *pTxHead;
+		TCPRAMCopyMPFS(*pTxHead, MyTCBStub.vMemoryMedium, hMPFS, wRightLen);
+		wActualLen -= wRightLen;
+		*pTxHead = MyTCBStub.bufferTxStart;
+	}
+
+	TCPRAMCopyMPFS(*pTxHead, MyTCBStub.vMemoryMedium, hMPFS, wActualLen);
+	*pTxHead += wActualLen;
+
+	// Send these bytes right now if we are out of TX buffer space
+	if(wFreeTXSpace <= len)
+	{
+		TCPFlush(hTCP);
+	}
+	// If not already enabled, start a timer so this data will 
+	// eventually get sent even if the application doens't call
+	// TCPFlush()
+	else if(!MyTCBStub.Flags.bTimer2Enabled)
+	{
+		MyTCBStub.Flags.bTimer2Enabled = TRUE;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+	}
+
+	return wActualLen + wRightLen;
+}
+#endif
+
 /*****************************************************************************
   Function:
 	BYTE* TCPPutString(TCP_SOCKET hTCP, BYTE* data)
@@ -1562,6 +1730,72 @@ WORD TCPGetTxFIFOFull(TCP_SOCKET hTCP)
 	return wFIFOSize - wDataLen;
 }
 
+/*****************************************************************************
+  Function:
+	void TCPStartTxCapture(TCP_SOCKET hTCP, BYTE* buffer, WORD size)
+
+  Summary:
+	Redirects data written to a TCP socket to a RAM buffer.
+
+  Description:
+	After calling this function, all data written to the given socket with
+	the TCPPut, TCPPutArray, TCPPutString, TCPPutROMArray, TCPPutROMString and
+	TCPPutMPFS functions is written to the given buffer instead of the TCP TX
+	FIFO. TCPIsPutReady returns the free space in the buffer.  Call
+	TCPEndTxCapture to stop capturing, and get the number of bytes captured.
+	
+	This allows the application to process data written by other modules (for
+	example HTTP callbacks) before it is sent, like compressing it.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket whose TX data is to be captured.
+	buffer - Buffer to write captured data to.
+	size - Size of buffer.
+
+  Returns:
+	None
+
+  Remarks:
+	Only one socket can be captured at a time.  MODTRONIX added this function.
+  ***************************************************************************/
+#if defined(TCP_USE_TX_CAPTURE)
+void TCPStartTxCapture(TCP_SOCKET hTCP, BYTE* buffer, WORD size)
+{
+	hCaptureTCP = hTCP;
+	captureBuf = buffer;
+	captureSize = size;
+	captureLen = 0;
+}
+
+/*****************************************************************************
+  Function:
+	WORD TCPEndTxCapture(void)
+
+  Summary:
+	Stops capturing TX data started with TCPStartTxCapture.
+
+  Precondition:
+	TCPStartTxCapture has been called.
+
+  Parameters:
+	None
+
+  Returns:
+	Number of bytes written to the capture buffer.
+
+  Remarks:
+	MODTRONIX added this function.
+  ***************************************************************************/
+WORD TCPEndTxCapture(void)
+{
+	hCaptureTCP = INVALID_SOCKET;
+	return captureLen;
+}
+#endif
+
 
 
 /****************************************************************************
@@ -4759,6 +4993,79 @@ static void TCPRAMCopyROM(PTR_BASE wDest, BYTE wDestType, ROM BYTE* wSource, WOR
 }
 #endif
 
+/*****************************************************************************
+  Function:
+	static WORD TCPRAMCopyMPFS(PTR_BASE wDest, BYTE vDestType, MPFS_HANDLE hMPFS,
+								WORD wLength)
+
+  Summary:
+	Copies data from an MPFS file to various memory mediums.
+
+  Description:
+	This function copies data from an open MPFS file to a memory medium (PIC
+	RAM, SPI RAM or Ethernet buffer RAM). For PIC RAM, data is read directly
+	into the destination. For Ethernet RAM, data is written by the MPFS module
+	to the MAC write pointer.
+
+  Precondition:
+	TCP is initialized, and hMPFS is an open MPFS file.
+
+  Parameters:
+	wDest		- Address to write to
+	vDestType	- Destination meidum (TCP_PIC_RAM, TCP_ETH_RAM, TCP_SPI_RAM)
+	hMPFS		- MPFS file to copy from
+	wLength		- Number of bytes to copy
+
+  Returns:
+	Number of bytes copied
+
+  Remarks:
+	MODTRONIX added this function
+  ***************************************************************************/
+#if defined(STACK_USE_MPFS2)
+static WORD TCPRAMCopyMPFS(PTR_BASE wDest, BYTE vDestType, MPFS_HANDLE hMPFS, WORD wLength)
+{
+	#if defined(SPIRAM_CS_TRIS)
+	BYTE vBuffer[16];
+	WORD w, wCopied;
+	#endif
+	
+	switch(vDestType)
+	{
+		case TCP_PIC_RAM:
+			return MPFSGetArray(hMPFS, (BYTE*)wDest, wLength);
+	
+		case TCP_ETH_RAM:
+			if(wDest!=(PTR_BASE)-1)
+				MACSetWritePtr(wDest);
+			return MPFSGetArrayToMAC(hMPFS, wLength);
+	
+		#if defined(SPIRAM_CS_TRIS)
+		case TCP_SPI_RAM:
+			wCopied = 0;
+			while(wLength)
+			{
+				w = sizeof(vBuffer);
+				if(w > wLength)
+					w = wLength;
+				
+				// Read and write a chunk	
+				w = MPFSGetArray(hMPFS, vBuffer, w);
+				if(w == 0u)
+					break;
+				SPIRAMPutArray(wDest, vBuffer, w);
+				wDest += w;
+				wLength -= w;
+				wCopied += w;
+			}
+			return wCopied;
+		#endif
+	}
+	
+	return 0;
+}
+#endif
+
 /****************************************************************************
   Section:
 	SSL Functions
@@ -128,10 +128,34 @@ static struct
 // Indicates which socket has currently received data for this loop
 static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
+// MODTRONIX added. Queue of datagrams given to UDPSendV() while the MAC TX buffer was busy.
+// Datagram data is stored in the UDPTxQueue[] ring buffer, in the order of the descriptors.
+#if (UDP_TX_QUEUE_SIZE > 0)
+typedef struct
+{
+	NODE_INFO remoteNode;		// Remote node at time datagram was queued
+	UDP_PORT localPort;			// Local port at time datagram was queued
+	UDP_PORT remotePort;		// Remote port at time datagram was queued
+	WORD len;					// Length of datagram data
+} UDP_TX_DESC;
+
+static UDP_TX_DESC UDPTxDesc[UDP_TX_QUEUE_DESCS];
+static BYTE UDPTxQueue[UDP_TX_QUEUE_SIZE];
+static BYTE UDPTxDescHead;		// Index of oldest descriptor
+static BYTE UDPTxDescCount;		// Number of queued datagrams
+static WORD UDPTxQueueHead;		// Offset of oldest datagram's data in UDPTxQueue[]
+static WORD UDPTxQueueCount;	// Number of bytes used in UDPTxQueue[]
+#endif
+
 /****************************************************************************
   Section:
 	Function Prototypes
   ***************************************************************************/
+static void UDPTransmit(NODE_INFO *remoteNode, UDP_PORT localPort, UDP_PORT remotePort);
+#if (UDP_TX_QUEUE_SIZE > 0)
+static void UDPTxQueuePut(BYTE *cData, WORD wDataLen);
+static void UDPTxQueueFlush(void);
+#endif
 
 static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h, NODE_INFO *remoteNode,
                                     IP_ADDR *localIP);
@@ -436,6 +460,11 @@ void UDPTask(void)
 #endif // #if defined(STACK_CLIENT_MODE)
 		}
 	}
+
+	// MODTRONIX added. Transmit next queued datagram if MAC TX buffer is free
+	#if (UDP_TX_QUEUE_SIZE > 0)
+	UDPTxQueueFlush();
+	#endif
 } 
 
 /******************************************************************************
@@ -957,17 +986,76 @@ ROM BYTE* UDPPutROMString(ROM BYTE *strData)
   ***************************************************************************/
 void UDPFlush(void)
 {
-    UDP_HEADER      h;
     UDP_SOCKET_INFO *p;
-    WORD			wUDPLength;
 
     p = &UDPSocketInfo[activeUDPSocket];
 
+	UDPTransmit(&p->remote.remoteNode, p->localPort, p->remotePort);
+}
+
+/*****************************************************************************
+  Function:
+	void UDPDiscardTx(void)
+
+  Summary:
+	Discards all pending TX data of the current UDP socket.
+	
+  Description:
+	MODTRONIX added. Discards data written with the UDPPut family of
+	functions that has not been flushed yet, for example when a message
+	did not fit in the socket. Nothing is transmitted. The next call to
+	UDPIsPutReady() starts a new packet.
+
+  Precondition:
+	UDPIsPutReady() was previously called to specify the current socket.
+
+  Parameters:
+	None
+	
+  Returns:
+  	None
+  ***************************************************************************/
+void UDPDiscardTx(void)
+{
+	UDPTxCount = 0;
+	UDPSetTxBuffer(0);
+	LastPutSocket = INVALID_UDP_SOCKET;
+}
+
+/*****************************************************************************
+  Function:
+	static void UDPTransmit(NODE_INFO *remoteNode, UDP_PORT localPort,
+							UDP_PORT remotePort)
+
+  Summary:
+	Transmits the data in the MAC TX buffer to the given remote node.
+	
+  Description:
+	MODTRONIX added. Contains the code previously in UDPFlush(), so that
+	datagrams queued by UDPSendV() can be sent to the remote node and ports
+	that were valid when they were queued.
+
+  Precondition:
+	UDPTxCount bytes of data have been written to the MAC TX buffer.
+
+  Parameters:
+	remoteNode - Remote node to send packet to
+	localPort - Source port
+	remotePort - Destination port
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPTransmit(NODE_INFO *remoteNode, UDP_PORT localPort, UDP_PORT remotePort)
+{
+    UDP_HEADER      h;
+    WORD			wUDPLength;
+
 	wUDPLength = UDPTxCount + sizeof(UDP_HEADER);
 
 	// Generate the correct UDP header
-    h.SourcePort        = swaps(p->localPort);
-    h.DestinationPort   = swaps(p->remotePort);
+    h.SourcePort        = swaps(localPort);
+    h.DestinationPort   = swaps(remotePort);
     h.Length            = swaps(wUDPLength);
 	h.Checksum 			= 0x0000;
     
@@ -978,7 +1066,7 @@ void UDPFlush(void)
 		PSEUDO_HEADER   pseudoHeader;
 		
 		pseudoHeader.SourceAddress	= AppConfig.MyIPAddr;
-		pseudoHeader.DestAddress    = p->remote.remoteNode.IPAddr;
+		pseudoHeader.DestAddress    = remoteNode->IPAddr;
 		pseudoHeader.Zero           = 0x0;
 		pseudoHeader.Protocol       = IP_PROT_UDP;
 		pseudoHeader.Length			= wUDPLength;
@@ -992,7 +1080,7 @@ void UDPFlush(void)
 	MACSetWritePtr(BASE_TX_ADDR + sizeof(ETHER_HEADER));
 	
 	// Write IP header to packet
-	IPPutHeader(&p->remote.remoteNode, IP_PROT_UDP, wUDPLength);
+	IPPutHeader(remoteNode, IP_PROT_UDP, wUDPLength);
 
     // Write UDP header to packet
     MACPutArray((BYTE*)&h, sizeof(h));
@@ -1021,6 +1109,185 @@ void UDPFlush(void)
 	LastPutSocket = INVALID_UDP_SOCKET;
 }
 
+/*****************************************************************************
+  Function:
+	WORD UDPSendV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt)
+
+  Summary:
+	Sends a datagram assembled from a list of buffers.
+	
+  Description:
+	MODTRONIX added. Sends a single datagram containing the data of all
+	given buffers, for example a protocol header followed by the payload.
+	If the MAC TX buffer is free, the datagram is written to it and
+	transmitted immediately. Otherwise it is copied to the TX queue, and
+	transmitted by UDPTask() once the MAC TX buffer is free. This allows an
+	application to send a burst of datagrams without waiting for each one
+	to be transmitted.
+
+	Queued datagrams are sent to the remote node and port of the socket at
+	the time UDPSendV() was called.
+
+  Precondition:
+	UDPInit() must have been previously called. No data has been written
+	with the UDPPut family of functions that has not been flushed yet.
+
+  Parameters:
+	s - The socket to send the datagram with
+	iov - List of buffers containing the datagram data
+	iovCnt - Number of buffers in iov
+	
+  Returns:
+  	Number of bytes sent or queued. Returns 0 if the datagram was not sent,
+  	because the socket is not opened yet (remote node not resolved, see
+  	UDPIsOpened()), it is larger than a packet, or there is no space in the
+  	TX queue (always the case if UDP_TX_QUEUE_SIZE is 0).
+  ***************************************************************************/
+WORD UDPSendV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt)
+{
+	WORD len;
+	BYTE i;
+	#if (UDP_TX_QUEUE_SIZE > 0)
+	UDP_TX_DESC *d;
+	#endif
+
+	// Remote node must be resolved (DNS and ARP) before datagram can be sent or queued
+	if(UDPSocketInfo[s].smState != UDP_OPENED)
+		return 0;
+
+	// Get length of datagram, it is not sent if it does not fit into a single packet
+	len = 0;
+	for(i = 0; i < iovCnt; i++)
+		len += iov[i].len;
+	if(len > (MAC_TX_BUFFER_SIZE - sizeof(IP_HEADER) - sizeof(UDP_HEADER)))
+		return 0;
+
+	// Transmit now if MAC TX buffer is free, and no older datagrams are queued
+	#if (UDP_TX_QUEUE_SIZE > 0)
+	if(UDPTxDescCount == 0u)
+	#endif
+	{
+		if(MACIsTxReady())
+		{
+			activeUDPSocket = s;
+			LastPutSocket = s;
+			UDPTxCount = 0;
+			UDPSetTxBuffer(0);
+			for(i = 0; i < iovCnt; i++)
+				UDPPutArray(iov[i].data, iov[i].len);
+			UDPFlush();
+			return len;
+		}
+	}
+
+	#if (UDP_TX_QUEUE_SIZE > 0)
+	// Add to TX queue, if there is space
+	if((UDPTxDescCount >= UDP_TX_QUEUE_DESCS) || (len > (UDP_TX_QUEUE_SIZE - UDPTxQueueCount)))
+		return 0;
+
+	i = UDPTxDescHead + UDPTxDescCount;
+	if(i >= UDP_TX_QUEUE_DESCS)
+		i -= UDP_TX_QUEUE_DESCS;
+	d = &UDPTxDesc[i];
+	d->remoteNode = UDPSocketInfo[s].remote.remoteNode;
+	d->localPort = UDPSocketInfo[s].localPort;
+	d->remotePort = UDPSocketInfo[s].remotePort;
+	d->len = len;
+	UDPTxDescCount++;
+
+	for(i = 0; i < iovCnt; i++)
+		UDPTxQueuePut(iov[i].data, iov[i].len);
+
+	return len;
+	#else
+	return 0;
+	#endif
+}
+
+#if (UDP_TX_QUEUE_SIZE > 0)
+/*****************************************************************************
+  Function:
+	static void UDPTxQueuePut(BYTE *cData, WORD wDataLen)
+
+  Summary:
+	Adds data to the TX queue ring buffer.
+
+  Precondition:
+	There is space for wDataLen bytes in UDPTxQueue[].
+
+  Parameters:
+	cData - The data to add
+	wDataLen - Number of bytes to add
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPTxQueuePut(BYTE *cData, WORD wDataLen)
+{
+	WORD pos;
+	WORD n;
+
+	pos = UDPTxQueueHead + UDPTxQueueCount;
+	if(pos >= UDP_TX_QUEUE_SIZE)
+		pos -= UDP_TX_QUEUE_SIZE;
+
+	// Copy up to end of buffer, and then remainder to start of buffer
+	n = UDP_TX_QUEUE_SIZE - pos;
+	if(n > wDataLen)
+		n = wDataLen;
+	memcpy((void*)&UDPTxQueue[pos], (void*)cData, n);
+	memcpy((void*)UDPTxQueue, (void*)&cData[n], wDataLen - n);
+	UDPTxQueueCount += wDataLen;
+}
+
+/*****************************************************************************
+  Function:
+	static void UDPTxQueueFlush(void)
+
+  Summary:
+	Transmits the oldest datagram in the TX queue if the MAC TX buffer is
+	free.
+
+  Precondition:
+	Called from UDPTask(), so no UDP datagram is being written.
+
+  Parameters:
+	None
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPTxQueueFlush(void)
+{
+	UDP_TX_DESC *d;
+	WORD n;
+
+	if((UDPTxDescCount == 0u) || !MACIsTxReady())
+		return;
+
+	d = &UDPTxDesc[UDPTxDescHead];
+
+	// Write datagram to MAC TX buffer, it can wrap around end of ring buffer
+	UDPTxCount = 0;
+	UDPSetTxBuffer(0);
+	n = UDP_TX_QUEUE_SIZE - UDPTxQueueHead;
+	if(n > d->len)
+		n = d->len;
+	UDPPutArray(&UDPTxQueue[UDPTxQueueHead], n);
+	UDPPutArray(UDPTxQueue, d->len - n);
+	UDPTransmit(&d->remoteNode, d->localPort, d->remotePort);
+
+	// Remove datagram from queue
+	UDPTxQueueHead += d->len;
+	if(UDPTxQueueHead >= UDP_TX_QUEUE_SIZE)
+		UDPTxQueueHead -= UDP_TX_QUEUE_SIZE;
+	UDPTxQueueCount -= d->len;
+	if(++UDPTxDescHead >= UDP_TX_QUEUE_DESCS)
+		UDPTxDescHead = 0;
+	UDPTxDescCount--;
+}
+#endif
+
 
 
 /****************************************************************************
@@ -1184,6 +1451,53 @@ void UDPDiscard(void)
 	}
 }
 
+/*****************************************************************************
+  Function:
+	WORD UDPRecvV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt)
+
+  Summary:
+	Reads received data from a UDP socket into a list of buffers.
+	
+  Description:
+	MODTRONIX added. Reads the received datagram into the given buffers,
+	filling each buffer before moving on to the next one. For example, a
+	protocol header can be read into a structure, and the payload into a
+	separate array with a single call. UDPDiscard() must still be called
+	when done with the datagram.
+
+  Precondition:
+	UDPInit() must have been previously called.
+
+  Parameters:
+	s - The socket to read from
+	iov - List of buffers to read data into
+	iovCnt - Number of buffers in iov
+	
+  Returns:
+  	Total number of bytes read. If less than the total length of the
+  	buffers, the datagram did not contain more data.
+  ***************************************************************************/
+WORD UDPRecvV(UDP_SOCKET s, UDP_IOVEC* iov, BYTE iovCnt)
+{
+	WORD len;
+	WORD n;
+	BYTE i;
+
+	if(UDPIsGetReady(s) == 0u)
+		return 0;
+
+	len = 0;
+	for(i = 0; i < iovCnt; i++)
+	{
+		n = UDPGetArray(iov[i].data, iov[i].len);
+		len += n;
+		if(n < iov[i].len)
+			break;
+	}
+
+	return len;
+}
+
 
 
 /****************************************************************************
@@ -0,0 +1,210 @@
+/**
+ * Host unit test for the streaming gzip compressor in Deflate.c.
+ *
+ * Compresses the given files the way the HTTP server sends a dynamic page. Static text is given in chunks of up
+ * to DEFLATE_BUF_SIZE bytes, and each ~tag~ is replaced with a short value that is given as a separate chunk.
+ * The gzip stream is decompressed with zlib, and checked against the input. Random chunk sizes, repeated data
+ * and random data are also tested. Prints the size of each page, uncompressed and compressed.
+ *
+ * Build with:  gcc -O2 -o nz_deflateTest nz_deflateTest.c -lz
+ *              gcc -O2 -DDEFLATE_WIN_SIZE=512 -o nz_deflateTest nz_deflateTest.c -lz
+ *
+ * Usage: nz_deflateTest [file ...]
+ *  file  Web pages to compress, for example ../../../projects/webserver/WebPages/Default/status.xml
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+//Same sizes as XC16, DWORD is NOT unsigned long on a 64-bit host
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+#define ROM     const
+#define memcpypgm2ram(d, s, n)  memcpy(d, s, n)
+
+#define NZ_CRC_HOST
+#define DEFLATE_HOST
+#define STACK_USE_DEFLATE
+
+#include "../../../netcruzer/lib/nz_crc.c"
+#include "../../Include/TCPIP Stack/Deflate.h"
+#include "../Deflate.c"
+
+#define MAX_DATA    (64 * 1024)
+
+static DEFLATE_CONTEXT ctx;
+static BYTE gz[MAX_DATA + MAX_DATA / 4];
+static DWORD gzLen;
+static BYTE plain[MAX_DATA];
+static DWORD plainLen;
+
+/**
+ * Starts a new gzip stream.
+ */
+static void streamStart(void) {
+    DeflateInit(&ctx);
+    gzLen = 0;
+    plainLen = 0;
+}
+
+/**
+ * Compresses given chunk, in pieces of up to DEFLATE_BUF_SIZE bytes.
+ */
+static void streamPut(const BYTE* p, DWORD len) {
+    WORD n;
+    WORD outLen;
+
+    while (len != 0) {
+        n = (len > DEFLATE_BUF_SIZE) ? DEFLATE_BUF_SIZE : (WORD)len;
+        memcpy(&plain[plainLen], p, n);
+        plainLen += n;
+        outLen = DeflateBlock(&ctx, (BYTE*)p, n, &gz[gzLen]);
+        if (outLen > n + DEFLATE_MAX_OVERHEAD) {
+            printf("DeflateBlock() wrote %u bytes for %u bytes of data, more than DEFLATE_MAX_OVERHEAD\n", outLen, n);
+            exit(1);
+        }
+        gzLen += outLen;
+        p += n;
+        len -= n;
+    }
+}
+
+/**
+ * Ends the gzip stream, and checks it with zlib.
+ *
+ * @return 0 if OK, else 1
+ */
+static int streamEnd(const char* name) {
+    static BYTE check[MAX_DATA + 1];
+    z_stream zs;
+    int ret;
+
+    gzLen += DeflateFinish(&ctx, &gz[gzLen]);
+    if (ctx.osize != gzLen || ctx.isize != plainLen) {
+        printf("%s: osize or isize wrong\n", name);
+        return 1;
+    }
+
+    memset(&zs, 0, sizeof(zs));
+    inflateInit2(&zs, 16 + MAX_WBITS);
+    zs.next_in = gz;
+    zs.avail_in = gzLen;
+    zs.next_out = check;
+    zs.avail_out = sizeof(check);
+    ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END || zs.total_out != plainLen || memcmp(check, plain, plainLen) != 0 || zs.avail_in != 0) {
+        printf("%s: zlib check FAILED (%d)\n", name, ret);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Compresses given web page like the HTTP server. Each ~tag~ is replaced with a short value.
+ */
+static int testPage(const char* fname) {
+    static BYTE page[MAX_DATA];
+    static const char* values[] = {"0", "1", "25", "3.30", "on", "1023"};
+    FILE* f;
+    DWORD len;
+    DWORD i;
+    DWORD start;
+    DWORD tags = 0;
+
+    if ((f = fopen(fname, "rb")) == NULL) {
+        printf("Can not open %s\n", fname);
+        return 1;
+    }
+    len = fread(page, 1, sizeof(page) / 2, f);
+    fclose(f);
+
+    streamStart();
+    for (i = 0, start = 0; i < len; i++) {
+        if (page[i] != '~')
+            continue;
+        streamPut(&page[start], i - start);
+        for (start = ++i; (i < len) && (page[i] != '~'); i++);
+        if (i > start) {
+            const char* v = values[tags++ % (sizeof(values) / sizeof(values[0]))];
+            streamPut((const BYTE*)v, strlen(v));
+        }
+        else {
+            streamPut((const BYTE*)"~", 1);     //"~~" is a literal '~'
+        }
+        start = i + 1;
+    }
+    if (start < len)
+        streamPut(&page[start], len - start);
+    if (streamEnd(fname))
+        return 1;
+    printf("%s: %u tags, %u bytes, gzip %u bytes (%u%%)\n", fname, tags, plainLen, gzLen,
+        plainLen ? (gzLen * 100) / plainLen : 0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    static BYTE data[MAX_DATA / 2];
+    DWORD i;
+    DWORD n;
+    int j;
+
+    //Empty stream
+    streamStart();
+    if (streamEnd("empty"))
+        return 1;
+
+    //Repeated text, matches must span chunks and the window
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = "<response><temp>25</temp><led>1</led></response>\r\n"[i % 51];
+    streamStart();
+    for (i = 0; i < sizeof(data); i += n) {
+        n = 1 + (rand() % 40);
+        streamPut(&data[i], (i + n > sizeof(data)) ? sizeof(data) - i : n);
+    }
+    if (streamEnd("repeated"))
+        return 1;
+    printf("Repeated text in random chunks: %u bytes, gzip %u bytes\n", plainLen, gzLen);
+
+    //Random data and chunk sizes, must not grow more than fixed Huffman codes allow
+    srand(1);
+    for (j = 0; j < 100; j++) {
+        for (i = 0; i < sizeof(data); i++)
+            data[i] = (BYTE)((j & 1) ? (rand() & 0x07) : rand());
+        streamStart();
+        for (i = 0; i < sizeof(data); i += n) {
+            n = 1 + (rand() % (2 * DEFLATE_BUF_SIZE));
+            streamPut(&data[i], (i + n > sizeof(data)) ? sizeof(data) - i : n);
+        }
+        if (streamEnd("random"))
+            return 1;
+    }
+    printf("Random data OK, last stream %u bytes, gzip %u bytes\n", plainLen, gzLen);
+
+    for (j = 1; j < argc; j++) {
+        if (testPage(argv[j]))
+            return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
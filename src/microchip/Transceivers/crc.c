@@ -61,7 +61,28 @@
     *  to generate CRC code, as long as it fits the particular application 
     *  needs.
     ***********************************************************************/
-    #if defined(CRC_LOOKUP_TABLE)
+    //MODTRONIX added next 21 lines
+    //For PIC24 use the shared CRC functions in nz_crc.c, lookup table size is configured with NZ_CRC_TABLE_SIZE
+    #if defined(__C30__)
+        #include "nz_crc.h"
+
+        /*********************************************************************
+         * WORD CRC16(  INPUT BYTE * data, 
+         *              INPUT signed char dataLength, 
+         *              INPUT WORD initCRC)
+         *
+         * Overview:        This function generates 16-bit CRC code for the input 
+         *                  data, with initial CRC value, using crc16CcittUpdate()
+         ********************************************************************/
+        WORD CRC16(BYTE *ptr, signed char count, WORD initCRC)
+        {
+            if (count <= 0)
+            {
+                return initCRC;
+            }
+            return crc16CcittUpdate(initCRC, ptr, (WORD)count);
+        }
+    #elif defined(CRC_LOOKUP_TABLE)
         const rom unsigned int CRC16Table[256] = 
         {
             0x0000,  0x1021,  0x2042,  0x3063,  0x4084,  0x50a5,  0x60c6,  0x70e7,
@@ -0,0 +1,195 @@
+/**
+ * Host benchmark for the MiWi software security engines in security.c.
+ *
+ * Checks a CCM_Enc() and CCM_Dec() round trip, that a changed frame is rejected, and for AES_128 the FIPS-197
+ * AES-128 test vector and the RFC 3610 Packet Vector #1 CCM* test vector. Then measures the number of frames per
+ * second that CCM_Enc() can secure. The engine is selected at compile time, the same way as in Security.h. XTEA_64
+ * is used if AES_128 is not defined. With AES_128, CCM_Enc() is IEEE 802.15.4 CCM*.
+ *
+ * Build with:  gcc -O2 -I../../Include -o nz_securityBench nz_securityBench.c
+ *              gcc -O2 -I../../Include -DAES_128 -o nz_securityBench nz_securityBench.c
+ *
+ * Usage: nz_securityBench [-h bytes] [-p bytes] [-n frames]
+ *  -h  Header bytes of each frame, authenticated only. Default is 10
+ *  -p  Payload bytes of each frame, encrypted and authenticated. Default is 40
+ *  -n  Number of frames to secure. Default is 1000000
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//Same sizes as XC16, DWORD is NOT unsigned long on a 64-bit host
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+#define TRUE    1
+#define FALSE   0
+#define ROM     const
+
+//Configuration normally in SystemProfile.h. Security level is CCM with 32 bit MIC
+#define SOFTWARE_SECURITY
+#define ENABLE_SECURITY
+#define SECURITY_LEVEL      5
+#define SECURITY_KEY_00     0x00
+#define SECURITY_KEY_01     0x01
+#define SECURITY_KEY_02     0x02
+#define SECURITY_KEY_03     0x03
+#define SECURITY_KEY_04     0x04
+#define SECURITY_KEY_05     0x05
+#define SECURITY_KEY_06     0x06
+#define SECURITY_KEY_07     0x07
+#define SECURITY_KEY_08     0x08
+#define SECURITY_KEY_09     0x09
+#define SECURITY_KEY_10     0x0a
+#define SECURITY_KEY_11     0x0b
+#define SECURITY_KEY_12     0x0c
+#define SECURITY_KEY_13     0x0d
+#define SECURITY_KEY_14     0x0e
+#define SECURITY_KEY_15     0x0f
+
+//Headers that are not used on host, defining their include guards skips them
+#define SECURITY_HOST
+#define __GENERIC_TYPE_DEFS_H_
+#define __TRANSCEIVERS_H
+#define _CONSOLE_H_
+
+#include "../security.c"
+
+#define MAX_FRAME   (127 - SEC_MIC_LEN)     //IEEE 802.15.4 frame
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    BYTE key[KEY_SIZE];
+    BYTE frame[MAX_FRAME + SEC_MIC_LEN];
+    uint32_t hdrLen = 10;
+    uint32_t payloadLen = 40;
+    uint32_t frames = 1000000;
+    uint32_t i;
+    double t;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:n:")) != -1) {
+        switch (opt) {
+        case 'h': hdrLen = strtoul(optarg, NULL, 0); break;
+        case 'p': payloadLen = strtoul(optarg, NULL, 0); break;
+        case 'n': frames = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "Usage: %s [-h bytes] [-p bytes] [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (hdrLen + payloadLen > MAX_FRAME || frames == 0) {
+        fprintf(stderr, "Header plus payload must be at most %d bytes, and frames at least 1\n", MAX_FRAME);
+        return 1;
+    }
+
+    for (i = 0; i < KEY_SIZE; i++)
+        key[i] = mySecurityKey[i];
+
+    #if defined(AES_128)
+    {
+        //FIPS-197 Appendix C.1, key is 000102..0f
+        static const BYTE plain[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                       0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+        static const BYTE cipher[16] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+        BYTE block[16];
+
+        memcpy(block, plain, 16);
+        encode(block, key);
+        if (memcmp(block, cipher, 16) != 0) {
+            printf("FIPS-197 AES-128 test vector FAILED\n");
+            return 1;
+        }
+    }
+    {
+        //RFC 3610 Packet Vector #1, CCM with L = 2 is CCM*. 8 byte header, 23 byte payload, 8 byte MIC
+        static const BYTE ccmKey[16] = {0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+                                        0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf};
+        static const BYTE ccmNonce[13] = {0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5};
+        static const BYTE ccmOut[39] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                        0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2, 0xf0, 0x66, 0xd0, 0xc2,
+                                        0xc0, 0xf9, 0x89, 0x80, 0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84,
+                                        0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0};
+        BYTE pkt[39];
+
+        for (i = 0; i < 31; i++)
+            pkt[i] = (BYTE)i;
+        CCMStar_Enc((BYTE*)ccmNonce, pkt, 8, 23, 8, (BYTE*)ccmKey);
+        if (memcmp(pkt, ccmOut, sizeof(ccmOut)) != 0) {
+            printf("RFC 3610 CCM test vector FAILED\n");
+            return 1;
+        }
+        if (!CCMStar_Dec((BYTE*)ccmNonce, pkt, 8, 23 + 8, 8, (BYTE*)ccmKey)) {
+            printf("RFC 3610 CCM test vector MIC check FAILED\n");
+            return 1;
+        }
+        for (i = 0; i < 31; i++) {
+            if (pkt[i] != (BYTE)i) {
+                printf("RFC 3610 CCM test vector decrypt FAILED\n");
+                return 1;
+            }
+        }
+    }
+    printf("AES_128, CCM*");
+    #else
+    printf("XTEA_64, CCM");
+    #endif
+    printf(" with %d byte MIC, %u byte header, %u byte payload\n", SEC_MIC_LEN, hdrLen, payloadLen);
+
+    //Round trip, and changed frame must be rejected
+    for (i = 0; i < hdrLen + payloadLen; i++)
+        frame[i] = (BYTE)i;
+    CCM_Enc(frame, (BYTE)hdrLen, (BYTE)payloadLen, key);
+    if (!CCM_Dec(frame, (BYTE)hdrLen, (BYTE)(payloadLen + SEC_MIC_LEN), key)) {
+        printf("CCM_Dec() FAILED\n");
+        return 1;
+    }
+    for (i = 0; i < hdrLen + payloadLen; i++) {
+        if (frame[i] != (BYTE)i) {
+            printf("CCM round trip FAILED\n");
+            return 1;
+        }
+    }
+    CCM_Enc(frame, (BYTE)hdrLen, (BYTE)payloadLen, key);
+    frame[0] ^= 0x01;
+    if (CCM_Dec(frame, (BYTE)hdrLen, (BYTE)(payloadLen + SEC_MIC_LEN), key)) {
+        printf("Changed frame was NOT rejected\n");
+        return 1;
+    }
+    printf("Round trip OK\n");
+
+    //Throughput
+    t = now();
+    for (i = 0; i < frames; i++)
+        CCM_Enc(frame, (BYTE)hdrLen, (BYTE)payloadLen, key);
+    t = now() - t;
+    printf("%.0f frames/s, %.2f us per frame\n", frames / t, t * 1e6 / frames);
+    return 0;
+}
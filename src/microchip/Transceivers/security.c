@@ -43,6 +43,11 @@
 *  here to be freely distributed according to US export control regulation.
 *  The security modes CTR, CBC-MAC and CCM are implemented around both XTEA 
 *  engines. 
+*  MODTRONIX added a table driven AES-128 engine with a cached key schedule,
+*  selected with AES_128 in Security.h. The security modes use a 128bit block
+*  with it, and CCM is IEEE 802.15.4 CCM* (RFC 3610 with L = 2) instead of
+*  the XTEA CCM above. The engine is selected at compile time, all nodes
+*  of a network must use the same one.
 *
 * Change History:
 *  Rev   Date         Author    Description
@@ -53,8 +58,11 @@
 *  4.1   6/3/2011     yfy       MAL v2011-06
 ********************************************************************/
 
+//MODTRONIX added next line. The host benchmark (host/nz_securityBench.c) defines SECURITY_HOST and the configuration
+#if !defined(SECURITY_HOST)
 #include "SystemProfile.h"
 #include "Transceivers/Transceivers.h"
+#endif  //MODTRONIX added this line
 
 #if defined(SOFTWARE_SECURITY) && defined(ENABLE_SECURITY)
 
@@ -117,6 +125,237 @@
             }
             text[0]=part1; text[1]=part2;
         }
+        
+    #elif defined(AES_128)
+        #if defined(__18CXX)
+            //#pragma romdata securityKey = 0x2E
+        #endif
+            ROM const unsigned char mySecurityKey[16] = {SECURITY_KEY_00, SECURITY_KEY_01, SECURITY_KEY_02, SECURITY_KEY_03, SECURITY_KEY_04,
+                SECURITY_KEY_05, SECURITY_KEY_06, SECURITY_KEY_07, SECURITY_KEY_08, SECURITY_KEY_09, SECURITY_KEY_10, SECURITY_KEY_11, 
+                SECURITY_KEY_12, SECURITY_KEY_13, SECURITY_KEY_14, SECURITY_KEY_15};    // The 16-byte security key used in the
+                                                                                        // security module.
+        #if defined(__18CXX)
+            //#pragma romdata
+        #endif
+
+        // AES S-box, used by the key schedule and the final round
+        static ROM const BYTE aesSbox[256] = {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+        };
+
+        // SubBytes combined with MixColumns, aesTe0[x] = S[x] * {02, 01, 01, 03}
+        static ROM const DWORD aesTe0[256] = {
+            0xc66363a5ul, 0xf87c7c84ul, 0xee777799ul, 0xf67b7b8dul,
+            0xfff2f20dul, 0xd66b6bbdul, 0xde6f6fb1ul, 0x91c5c554ul,
+            0x60303050ul, 0x02010103ul, 0xce6767a9ul, 0x562b2b7dul,
+            0xe7fefe19ul, 0xb5d7d762ul, 0x4dababe6ul, 0xec76769aul,
+            0x8fcaca45ul, 0x1f82829dul, 0x89c9c940ul, 0xfa7d7d87ul,
+            0xeffafa15ul, 0xb25959ebul, 0x8e4747c9ul, 0xfbf0f00bul,
+            0x41adadecul, 0xb3d4d467ul, 0x5fa2a2fdul, 0x45afafeaul,
+            0x239c9cbful, 0x53a4a4f7ul, 0xe4727296ul, 0x9bc0c05bul,
+            0x75b7b7c2ul, 0xe1fdfd1cul, 0x3d9393aeul, 0x4c26266aul,
+            0x6c36365aul, 0x7e3f3f41ul, 0xf5f7f702ul, 0x83cccc4ful,
+            0x6834345cul, 0x51a5a5f4ul, 0xd1e5e534ul, 0xf9f1f108ul,
+            0xe2717193ul, 0xabd8d873ul, 0x62313153ul, 0x2a15153ful,
+            0x0804040cul, 0x95c7c752ul, 0x46232365ul, 0x9dc3c35eul,
+            0x30181828ul, 0x379696a1ul, 0x0a05050ful, 0x2f9a9ab5ul,
+            0x0e070709ul, 0x24121236ul, 0x1b80809bul, 0xdfe2e23dul,
+            0xcdebeb26ul, 0x4e272769ul, 0x7fb2b2cdul, 0xea75759ful,
+            0x1209091bul, 0x1d83839eul, 0x582c2c74ul, 0x341a1a2eul,
+            0x361b1b2dul, 0xdc6e6eb2ul, 0xb45a5aeeul, 0x5ba0a0fbul,
+            0xa45252f6ul, 0x763b3b4dul, 0xb7d6d661ul, 0x7db3b3ceul,
+            0x5229297bul, 0xdde3e33eul, 0x5e2f2f71ul, 0x13848497ul,
+            0xa65353f5ul, 0xb9d1d168ul, 0x00000000ul, 0xc1eded2cul,
+            0x40202060ul, 0xe3fcfc1ful, 0x79b1b1c8ul, 0xb65b5bedul,
+            0xd46a6abeul, 0x8dcbcb46ul, 0x67bebed9ul, 0x7239394bul,
+            0x944a4adeul, 0x984c4cd4ul, 0xb05858e8ul, 0x85cfcf4aul,
+            0xbbd0d06bul, 0xc5efef2aul, 0x4faaaae5ul, 0xedfbfb16ul,
+            0x864343c5ul, 0x9a4d4dd7ul, 0x66333355ul, 0x11858594ul,
+            0x8a4545cful, 0xe9f9f910ul, 0x04020206ul, 0xfe7f7f81ul,
+            0xa05050f0ul, 0x783c3c44ul, 0x259f9fbaul, 0x4ba8a8e3ul,
+            0xa25151f3ul, 0x5da3a3feul, 0x804040c0ul, 0x058f8f8aul,
+            0x3f9292adul, 0x219d9dbcul, 0x70383848ul, 0xf1f5f504ul,
+            0x63bcbcdful, 0x77b6b6c1ul, 0xafdada75ul, 0x42212163ul,
+            0x20101030ul, 0xe5ffff1aul, 0xfdf3f30eul, 0xbfd2d26dul,
+            0x81cdcd4cul, 0x180c0c14ul, 0x26131335ul, 0xc3ecec2ful,
+            0xbe5f5fe1ul, 0x359797a2ul, 0x884444ccul, 0x2e171739ul,
+            0x93c4c457ul, 0x55a7a7f2ul, 0xfc7e7e82ul, 0x7a3d3d47ul,
+            0xc86464acul, 0xba5d5de7ul, 0x3219192bul, 0xe6737395ul,
+            0xc06060a0ul, 0x19818198ul, 0x9e4f4fd1ul, 0xa3dcdc7ful,
+            0x44222266ul, 0x542a2a7eul, 0x3b9090abul, 0x0b888883ul,
+            0x8c4646caul, 0xc7eeee29ul, 0x6bb8b8d3ul, 0x2814143cul,
+            0xa7dede79ul, 0xbc5e5ee2ul, 0x160b0b1dul, 0xaddbdb76ul,
+            0xdbe0e03bul, 0x64323256ul, 0x743a3a4eul, 0x140a0a1eul,
+            0x924949dbul, 0x0c06060aul, 0x4824246cul, 0xb85c5ce4ul,
+            0x9fc2c25dul, 0xbdd3d36eul, 0x43acaceful, 0xc46262a6ul,
+            0x399191a8ul, 0x319595a4ul, 0xd3e4e437ul, 0xf279798bul,
+            0xd5e7e732ul, 0x8bc8c843ul, 0x6e373759ul, 0xda6d6db7ul,
+            0x018d8d8cul, 0xb1d5d564ul, 0x9c4e4ed2ul, 0x49a9a9e0ul,
+            0xd86c6cb4ul, 0xac5656faul, 0xf3f4f407ul, 0xcfeaea25ul,
+            0xca6565aful, 0xf47a7a8eul, 0x47aeaee9ul, 0x10080818ul,
+            0x6fbabad5ul, 0xf0787888ul, 0x4a25256ful, 0x5c2e2e72ul,
+            0x381c1c24ul, 0x57a6a6f1ul, 0x73b4b4c7ul, 0x97c6c651ul,
+            0xcbe8e823ul, 0xa1dddd7cul, 0xe874749cul, 0x3e1f1f21ul,
+            0x964b4bddul, 0x61bdbddcul, 0x0d8b8b86ul, 0x0f8a8a85ul,
+            0xe0707090ul, 0x7c3e3e42ul, 0x71b5b5c4ul, 0xcc6666aaul,
+            0x904848d8ul, 0x06030305ul, 0xf7f6f601ul, 0x1c0e0e12ul,
+            0xc26161a3ul, 0x6a35355ful, 0xae5757f9ul, 0x69b9b9d0ul,
+            0x17868691ul, 0x99c1c158ul, 0x3a1d1d27ul, 0x279e9eb9ul,
+            0xd9e1e138ul, 0xebf8f813ul, 0x2b9898b3ul, 0x22111133ul,
+            0xd26969bbul, 0xa9d9d970ul, 0x078e8e89ul, 0x339494a7ul,
+            0x2d9b9bb6ul, 0x3c1e1e22ul, 0x15878792ul, 0xc9e9e920ul,
+            0x87cece49ul, 0xaa5555fful, 0x50282878ul, 0xa5dfdf7aul,
+            0x038c8c8ful, 0x59a1a1f8ul, 0x09898980ul, 0x1a0d0d17ul,
+            0x65bfbfdaul, 0xd7e6e631ul, 0x844242c6ul, 0xd06868b8ul,
+            0x824141c3ul, 0x299999b0ul, 0x5a2d2d77ul, 0x1e0f0f11ul,
+            0x7bb0b0cbul, 0xa85454fcul, 0x6dbbbbd6ul, 0x2c16163aul
+        };
+
+        DWORD aesRoundKey[44];      // Expanded key schedule of aesKey
+        BYTE aesKey[KEY_SIZE];      // Key that aesRoundKey was expanded from
+        BOOL aesKeyValid = FALSE;   // aesRoundKey is valid
+
+        // aesTe0 holds SubBytes and MixColumns for the first row. The tables for the other rows
+        // are byte rotations of it, so only one 1KB table is needed.
+        #define AES_ROR8(x)     (((x) >> 8) | ((x) << 24))
+        #define AES_ROR16(x)    (((x) >> 16) | ((x) << 16))
+        #define AES_ROR24(x)    (((x) >> 24) | ((x) << 8))
+        #define AES_GET32(p)    (((DWORD)(p)[0] << 24) | ((DWORD)(p)[1] << 16) | ((DWORD)(p)[2] << 8) | (DWORD)(p)[3])
+        #define AES_SUB32(x)    (((DWORD)aesSbox[(BYTE)((x) >> 24)] << 24) | ((DWORD)aesSbox[(BYTE)((x) >> 16)] << 16) | \
+                                 ((DWORD)aesSbox[(BYTE)((x) >> 8)] << 8) | (DWORD)aesSbox[(BYTE)(x)])
+
+        /*********************************************************************
+         * void AESExpandKey(INPUT BYTE *key)
+         *
+         * Overview:        This function calculates the AES-128 key schedule
+         *                  for the input security key, and stores it in
+         *                  aesRoundKey. It is only called when the key
+         *                  changes, not for every block.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      key         The 16 byte security key
+         * Output:          
+         *          None
+         *
+         * Side Effects:    aesRoundKey and aesKey are updated
+         * 
+         ********************************************************************/
+        void AESExpandKey(BYTE *key)
+        {
+            BYTE i;
+            BYTE rcon = 0x01;
+            DWORD tmp;
+
+            for(i = 0; i < KEY_SIZE; i++)
+            {
+                aesKey[i] = key[i];
+            }
+            for(i = 0; i < 4; i++)
+            {
+                aesRoundKey[i] = AES_GET32(&key[i * 4]);
+            }
+            for(i = 4; i < 44; i++)
+            {
+                tmp = aesRoundKey[i - 1];
+                if( (i & 3) == 0 )
+                {
+                    tmp = AES_SUB32((tmp << 8) | (tmp >> 24)) ^ ((DWORD)rcon << 24);
+                    rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0x00);
+                }
+                aesRoundKey[i] = aesRoundKey[i - 4] ^ tmp;
+            }
+            aesKeyValid = TRUE;
+        }
+        
+        /*********************************************************************
+         * void encode(INPUT BYTE *text, INPUT BYTE *key)
+         *
+         * Overview:        This function apply AES-128 security engine to
+         *                  the input data buffer with input security key. 
+         *                  The encoded data will replace the input data.
+         *                  The key schedule is only recalculated when the
+         *                  key differs from the previous call.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The 16 byte input buffer to the AES engine. 
+         *                                  The encoded data will replace the original 
+         *                                  content after the function call
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        void encode(BYTE *text, BYTE *key)
+        {
+            DWORD s0, s1, s2, s3, t0, t1, t2, t3;
+            DWORD *rk;
+            BYTE i;
+            
+            for(i = 0; i < KEY_SIZE; i++)
+            {
+                if( (aesKeyValid == FALSE) || (aesKey[i] != key[i]) )
+                {
+                    AESExpandKey(key);
+                    break;
+                }
+            }
+            
+            rk = aesRoundKey;
+            s0 = AES_GET32(&text[0]) ^ rk[0];
+            s1 = AES_GET32(&text[4]) ^ rk[1];
+            s2 = AES_GET32(&text[8]) ^ rk[2];
+            s3 = AES_GET32(&text[12]) ^ rk[3];
+            
+            for(i = 1; i < 10; i++)
+            {
+                rk += 4;
+                t0 = aesTe0[(BYTE)(s0 >> 24)] ^ AES_ROR8(aesTe0[(BYTE)(s1 >> 16)]) ^ AES_ROR16(aesTe0[(BYTE)(s2 >> 8)]) ^ AES_ROR24(aesTe0[(BYTE)s3]) ^ rk[0];
+                t1 = aesTe0[(BYTE)(s1 >> 24)] ^ AES_ROR8(aesTe0[(BYTE)(s2 >> 16)]) ^ AES_ROR16(aesTe0[(BYTE)(s3 >> 8)]) ^ AES_ROR24(aesTe0[(BYTE)s0]) ^ rk[1];
+                t2 = aesTe0[(BYTE)(s2 >> 24)] ^ AES_ROR8(aesTe0[(BYTE)(s3 >> 16)]) ^ AES_ROR16(aesTe0[(BYTE)(s0 >> 8)]) ^ AES_ROR24(aesTe0[(BYTE)s1]) ^ rk[2];
+                t3 = aesTe0[(BYTE)(s3 >> 24)] ^ AES_ROR8(aesTe0[(BYTE)(s0 >> 16)]) ^ AES_ROR16(aesTe0[(BYTE)(s1 >> 8)]) ^ AES_ROR24(aesTe0[(BYTE)s2]) ^ rk[3];
+                s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+            }
+            
+            // Final round, no MixColumns
+            rk += 4;
+            t0 = (((DWORD)aesSbox[(BYTE)(s0 >> 24)] << 24) | ((DWORD)aesSbox[(BYTE)(s1 >> 16)] << 16) |
+                  ((DWORD)aesSbox[(BYTE)(s2 >> 8)] << 8) | (DWORD)aesSbox[(BYTE)s3]) ^ rk[0];
+            t1 = (((DWORD)aesSbox[(BYTE)(s1 >> 24)] << 24) | ((DWORD)aesSbox[(BYTE)(s2 >> 16)] << 16) |
+                  ((DWORD)aesSbox[(BYTE)(s3 >> 8)] << 8) | (DWORD)aesSbox[(BYTE)s0]) ^ rk[1];
+            t2 = (((DWORD)aesSbox[(BYTE)(s2 >> 24)] << 24) | ((DWORD)aesSbox[(BYTE)(s3 >> 16)] << 16) |
+                  ((DWORD)aesSbox[(BYTE)(s0 >> 8)] << 8) | (DWORD)aesSbox[(BYTE)s1]) ^ rk[2];
+            t3 = (((DWORD)aesSbox[(BYTE)(s3 >> 24)] << 24) | ((DWORD)aesSbox[(BYTE)(s0 >> 16)] << 16) |
+                  ((DWORD)aesSbox[(BYTE)(s1 >> 8)] << 8) | (DWORD)aesSbox[(BYTE)s2]) ^ rk[3];
+            
+            for(i = 0; i < 4; i++)
+            {
+                text[i]      = (BYTE)(t0 >> (24 - i * 8));
+                text[i + 4]  = (BYTE)(t1 >> (24 - i * 8));
+                text[i + 8]  = (BYTE)(t2 >> (24 - i * 8));
+                text[i + 12] = (BYTE)(t3 >> (24 - i * 8));
+            }
+        }
     #endif
     
     /*********************************************************************
@@ -238,124 +477,509 @@
     
 
 
-    /*********************************************************************
-     * void CCM_Enc(    BYTE *text, 
-     *                  BYTE headerLen, 
-     *                  BYTE payloadLen, 
-     *                  BYTE *key)
-     *
-     * Overview:        This function implements CCM mode of security 
-     *                  engine to the input text. CCM mode ensures data
-     *                  interity as well as secrecy. This function is used
-     *                  to encode the data
-     *
-     * PreCondition:    None
-     *
-     * Input:       
-     *          BYTE *      text        The text to be encrypted. The encrypted
-     *                                  data will replace the original content
-     *                                  after this function call.
-     *          BYTE *      headerLen   The header length, used to authenticate, but
-     *                                  not encrypted
-     *          BYTE        payloadLen  The length of the text to be authenticated
-     *                                  and encrypted
-     *          BYTE *      key         The security key for the XTEA engine
-     * Output:          
-     *          None
-     *
-     * Side Effects:    None
-     * 
-     ********************************************************************/ 
-    void CCM_Enc(   BYTE *text, 
-                    BYTE headerLen, 
-                    BYTE payloadLen, 
-                    BYTE *key)
-    {
-        BYTE i;
-        #if defined(__18CXX)
-            BYTE ITStatus = INTCONbits.GIEH;
+    #if defined(AES_128)
+        #define CCM_NONCE_LEN   13      // CCM* nonce length, leaves 2 bytes for the length and counter fields (L = 2)
         
-            INTCONbits.GIEH = 0;
-        #endif
+        BYTE ccmMac[BLOCK_SIZE];
+        BYTE ccmMacPos;
         
-        CBC_MAC(text, (headerLen + payloadLen), key, tmpBlock);   
+        /*********************************************************************
+         * static void CCMStarBlock(BYTE *block, BYTE flags, BYTE *nonce, WORD val)
+         *
+         * Overview:        This function formats a CCM* B0 or Ai block. It
+         *                  is the flags byte, the 13 byte nonce and a 2 byte
+         *                  big endian length (B0) or counter (Ai).
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE        flags       The flags byte of the block
+         *          BYTE *      nonce       The 13 byte nonce
+         *          WORD        val         The payload length for B0, or the
+         *                                  counter for Ai
+         * Output:          
+         *          BYTE *      block       The formatted 16 byte block
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarBlock(BYTE *block, BYTE flags, BYTE *nonce, WORD val)
+        {
+            BYTE i;
+            
+            block[0] = flags;
+            for(i = 0; i < CCM_NONCE_LEN; i++)
+            {
+                block[1 + i] = nonce[i];
+            }
+            block[BLOCK_SIZE - 2] = (BYTE)(val >> 8);
+            block[BLOCK_SIZE - 1] = (BYTE)val;
+        }
         
-        for(i = 0; i < BLOCK_SIZE; i++)
+        /*********************************************************************
+         * static void CCMStarMac(BYTE *data, BYTE len, BYTE *key)
+         *
+         * Overview:        This function adds the input data to the CBC-MAC
+         *                  in ccmMac. A block is encoded each time it is full.
+         *
+         * PreCondition:    ccmMac and ccmMacPos are initialized by CCMStarAuth()
+         *
+         * Input:       
+         *          BYTE *      data        The data to be authenticated
+         *          BYTE        len         The length of the data
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarMac(BYTE *data, BYTE len, BYTE *key)
         {
-            text[headerLen + payloadLen + i] = tmpBlock[i];
+            while( len-- )
+            {
+                ccmMac[ccmMacPos++] ^= *data++;
+                if( ccmMacPos == BLOCK_SIZE )
+                {
+                    encode(ccmMac, key);
+                    ccmMacPos = 0;
+                }
+            }
         }
         
-        for(i = 0; i < BLOCK_SIZE-1; i++)
+        /*********************************************************************
+         * static void CCMStarMacPad(BYTE *key)
+         *
+         * Overview:        This function zero pads the data added to the
+         *                  CBC-MAC to a full block, and encodes the block.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarMacPad(BYTE *key)
         {
-            tmpBlock[i] = (i < headerLen) ? text[i] : 0;
+            if( ccmMacPos != 0 )
+            {
+                encode(ccmMac, key);
+                ccmMacPos = 0;
+            }
         }
-    
-        CTR(&(text[headerLen]), (payloadLen + BLOCK_SIZE), key, tmpBlock);    
-        #if defined(__18CXX)
-            INTCONbits.GIEH = ITStatus;
-        #endif  
-    }
-    
-    
-    /*********************************************************************
-     * void CCM_Dec(    BYTE *text, 
-     *                  BYTE headerLen, 
-     *                  BYTE payloadLen, 
-     *                  BYTE *key)
-     *
-     * Overview:        This function implements CCM mode of security 
-     *                  engine to the input text. CCM mode ensures data
-     *                  interity as well as secrecy. This function is used
-     *                  to decode the data
-     *
-     * PreCondition:    None
-     *
-     * Input:       
-     *          BYTE *      text        The text to be encrypted. The decrypted
-     *                                  data will replace the original content
-     *                                  after this function call.
-     *          BYTE *      headerLen   The header length, used to authenticate, but
-     *                                  not decrypted
-     *          BYTE        payloadLen  The length of the text to be authenticated
-     *                                  and decrypted
-     *          BYTE *      key         The security key for the XTEA engine
-     * Output:          
-     *          None
-     *
-     * Side Effects:    None
-     * 
-     ********************************************************************/ 
-    BOOL CCM_Dec(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key)
-    {
-        BYTE i;
-        #if defined(__18CXX)
-            BYTE ITStatus = INTCONbits.GIEH;
         
-            INTCONbits.GIEH = 0;
-        #endif
-
-        for(i = 0; i < BLOCK_SIZE-1; i++)
+        /*********************************************************************
+         * static void CCMStarAuth(BYTE *nonce, BYTE *text, BYTE headerLen, 
+         *                         BYTE payloadLen, BYTE micLen, BYTE *key)
+         *
+         * Overview:        This function calculates the CCM* authentication
+         *                  tag T in ccmMac. The CBC-MAC starts with B0, then
+         *                  the 2 byte header length and the header, and then
+         *                  the payload. Both are zero padded to a full block.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      nonce       The 13 byte nonce
+         *          BYTE *      text        The header, followed by the unencrypted payload
+         *          BYTE        headerLen   The header length
+         *          BYTE        payloadLen  The payload length
+         *          BYTE        micLen      The MIC length, 4, 8 or 16
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarAuth(BYTE *nonce, BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE micLen, BYTE *key)
         {
-            tmpBlock[i] = (i < headerLen) ? text[i] : 0;
+            BYTE la[2];
+            
+            CCMStarBlock(ccmMac, ((headerLen != 0) ? 0x40 : 0x00) | (((micLen - 2) / 2) << 3) | 0x01, nonce, payloadLen);
+            encode(ccmMac, key);
+            ccmMacPos = 0;
+            if( headerLen != 0 )
+            {
+                la[0] = 0;
+                la[1] = headerLen;
+                CCMStarMac(la, 2, key);
+                CCMStarMac(text, headerLen, key);
+                CCMStarMacPad(key);
+            }
+            CCMStarMac(&(text[headerLen]), payloadLen, key);
+            CCMStarMacPad(key);
         }
-        CTR(&(text[headerLen]), payloadLen, key, tmpBlock);
-
-        CBC_MAC(text, (headerLen + payloadLen - SEC_MIC_LEN), key, tmpBlock);
-        for(i = 0; i < SEC_MIC_LEN; i++)
+        
+        /*********************************************************************
+         * static void CCMStarCtr(BYTE *nonce, BYTE *text, BYTE len, BYTE *key)
+         *
+         * Overview:        This function encrypts or decrypts the payload
+         *                  with the CCM* key stream E(A1), E(A2), ...
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      nonce       The 13 byte nonce
+         *          BYTE *      text        The payload, it is replaced with the result
+         *          BYTE        len         The payload length
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarCtr(BYTE *nonce, BYTE *text, BYTE len, BYTE *key)
         {
-            if( tmpBlock[i] != text[headerLen + payloadLen - SEC_MIC_LEN + i] )
+            BYTE i;
+            
+            for(i = 0; i < len; i++)
+            {
+                if( (i % BLOCK_SIZE) == 0 )
+                {
+                    CCMStarBlock(tmpBlock, 0x01, nonce, (i / BLOCK_SIZE) + 1);
+                    encode(tmpBlock, key);
+                }
+                text[i] ^= tmpBlock[i % BLOCK_SIZE];
+            }
+        }
+        
+        /*********************************************************************
+         * static void CCMStarNonce(BYTE *nonce, BYTE *text, BYTE headerLen)
+         *
+         * Overview:        This function gets the CCM* nonce of a MiWi frame.
+         *                  It is the last 13 bytes of the header, which ends
+         *                  with the source address, frame counter and key
+         *                  sequence number. It is zero padded at the front
+         *                  if the header is shorter.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The frame, starting with the header
+         *          BYTE        headerLen   The header length
+         * Output:          
+         *          BYTE *      nonce       The 13 byte nonce
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/
+        static void CCMStarNonce(BYTE *nonce, BYTE *text, BYTE headerLen)
+        {
+            BYTE i;
+            
+            for(i = 0; i < CCM_NONCE_LEN; i++)
+            {
+                nonce[i] = ((headerLen + i) >= CCM_NONCE_LEN) ? text[headerLen + i - CCM_NONCE_LEN] : 0;
+            }
+        }
+        
+        /*********************************************************************
+         * void CCMStar_Enc(BYTE *nonce, BYTE *text, BYTE headerLen, 
+         *                  BYTE payloadLen, BYTE micLen, BYTE *key)
+         *
+         * Overview:        This function implements IEEE 802.15.4 CCM* 
+         *                  (RFC 3610 CCM with L = 2) with the AES engine.
+         *                  It authenticates the header and payload, and
+         *                  encrypts the payload. The encrypted MIC is added
+         *                  after the payload.
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      nonce       The 13 byte nonce, must never be reused with the same key
+         *          BYTE *      text        The header followed by the payload. The payload
+         *                                  is replaced with the encrypted data, followed
+         *                                  by micLen bytes of MIC
+         *          BYTE        headerLen   The header length, authenticated but not encrypted
+         *          BYTE        payloadLen  The payload length, authenticated and encrypted
+         *          BYTE        micLen      The MIC length, 4, 8 or 16
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        void CCMStar_Enc(BYTE *nonce, BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE micLen, BYTE *key)
+        {
+            BYTE i;
+            #if defined(__18CXX)
+                BYTE ITStatus = INTCONbits.GIEH;
+            
+                INTCONbits.GIEH = 0;
+            #endif
+            
+            CCMStarAuth(nonce, text, headerLen, payloadLen, micLen, key);
+            
+            CCMStarBlock(tmpBlock, 0x01, nonce, 0);
+            encode(tmpBlock, key);
+            for(i = 0; i < micLen; i++)
+            {
+                text[headerLen + payloadLen + i] = ccmMac[i] ^ tmpBlock[i];
+            }
+            
+            CCMStarCtr(nonce, &(text[headerLen]), payloadLen, key);
+            #if defined(__18CXX)
+                INTCONbits.GIEH = ITStatus;
+            #endif  
+        }
+        
+        /*********************************************************************
+         * BOOL CCMStar_Dec(BYTE *nonce, BYTE *text, BYTE headerLen, 
+         *                  BYTE payloadLen, BYTE micLen, BYTE *key)
+         *
+         * Overview:        This function decrypts and authenticates a frame
+         *                  secured with CCMStar_Enc().
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      nonce       The 13 byte nonce
+         *          BYTE *      text        The header followed by the encrypted payload
+         *                                  and MIC. The payload is replaced with the
+         *                                  decrypted data
+         *          BYTE        headerLen   The header length
+         *          BYTE        payloadLen  The payload length, including the MIC
+         *          BYTE        micLen      The MIC length, 4, 8 or 16
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          BOOL                    TRUE if the MIC is correct
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        BOOL CCMStar_Dec(BYTE *nonce, BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE micLen, BYTE *key)
+        {
+            BYTE i;
+            BYTE diff = 0;
+            #if defined(__18CXX)
+                BYTE ITStatus = INTCONbits.GIEH;
+            
+                INTCONbits.GIEH = 0;
+            #endif
+            
+            if( payloadLen < micLen )
             {
                 #if defined(__18CXX)
                     INTCONbits.GIEH = ITStatus;
                 #endif
                 return FALSE;
-            }       
+            }
+            payloadLen -= micLen;
+            
+            CCMStarCtr(nonce, &(text[headerLen]), payloadLen, key);
+            CCMStarAuth(nonce, text, headerLen, payloadLen, micLen, key);
+            
+            CCMStarBlock(tmpBlock, 0x01, nonce, 0);
+            encode(tmpBlock, key);
+            for(i = 0; i < micLen; i++)
+            {
+                diff |= (ccmMac[i] ^ tmpBlock[i]) ^ text[headerLen + payloadLen + i];
+            }
+            #if defined(__18CXX)
+                INTCONbits.GIEH = ITStatus;
+            #endif  
+            return (diff == 0);
         }
-        #if defined(__18CXX)
-            INTCONbits.GIEH = ITStatus;
-        #endif  
-        return TRUE;
-    }
+        
+        /*********************************************************************
+         * void CCM_Enc(    BYTE *text, 
+         *                  BYTE headerLen, 
+         *                  BYTE payloadLen, 
+         *                  BYTE *key)
+         *
+         * Overview:        This function implements CCM mode of security 
+         *                  engine to the input text. With the AES engine it
+         *                  is CCM*, see CCMStar_Enc(). The nonce is taken from
+         *                  the header, see CCMStarNonce().
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The text to be encrypted. The encrypted
+         *                                  data will replace the original content
+         *                                  after this function call, and is followed
+         *                                  by SEC_MIC_LEN bytes of MIC
+         *          BYTE *      headerLen   The header length, used to authenticate, but
+         *                                  not encrypted
+         *          BYTE        payloadLen  The length of the text to be authenticated
+         *                                  and encrypted
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        void CCM_Enc(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key)
+        {
+            BYTE nonce[CCM_NONCE_LEN];
+            
+            CCMStarNonce(nonce, text, headerLen);
+            CCMStar_Enc(nonce, text, headerLen, payloadLen, SEC_MIC_LEN, key);
+        }
+        
+        /*********************************************************************
+         * BOOL CCM_Dec(    BYTE *text, 
+         *                  BYTE headerLen, 
+         *                  BYTE payloadLen, 
+         *                  BYTE *key)
+         *
+         * Overview:        This function implements CCM mode of security 
+         *                  engine to the input text. With the AES engine it
+         *                  is CCM*, see CCMStar_Dec().
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The text to be decrypted. The decrypted
+         *                                  data will replace the original content
+         *                                  after this function call.
+         *          BYTE *      headerLen   The header length, used to authenticate, but
+         *                                  not decrypted
+         *          BYTE        payloadLen  The length of the text to be authenticated
+         *                                  and decrypted, including the MIC
+         *          BYTE *      key         The security key for the AES engine
+         * Output:          
+         *          BOOL                    TRUE if the MIC is correct
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        BOOL CCM_Dec(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key)
+        {
+            BYTE nonce[CCM_NONCE_LEN];
+            
+            CCMStarNonce(nonce, text, headerLen);
+            return CCMStar_Dec(nonce, text, headerLen, payloadLen, SEC_MIC_LEN, key);
+        }
+        
+    #else
+        /*********************************************************************
+         * void CCM_Enc(    BYTE *text, 
+         *                  BYTE headerLen, 
+         *                  BYTE payloadLen, 
+         *                  BYTE *key)
+         *
+         * Overview:        This function implements CCM mode of security 
+         *                  engine to the input text. CCM mode ensures data
+         *                  interity as well as secrecy. This function is used
+         *                  to encode the data
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The text to be encrypted. The encrypted
+         *                                  data will replace the original content
+         *                                  after this function call.
+         *          BYTE *      headerLen   The header length, used to authenticate, but
+         *                                  not encrypted
+         *          BYTE        payloadLen  The length of the text to be authenticated
+         *                                  and encrypted
+         *          BYTE *      key         The security key for the XTEA engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        void CCM_Enc(   BYTE *text, 
+                        BYTE headerLen, 
+                        BYTE payloadLen, 
+                        BYTE *key)
+        {
+            BYTE i;
+            #if defined(__18CXX)
+                BYTE ITStatus = INTCONbits.GIEH;
+        
+                INTCONbits.GIEH = 0;
+            #endif
+        
+            CBC_MAC(text, (headerLen + payloadLen), key, tmpBlock);   
+        
+            for(i = 0; i < BLOCK_SIZE; i++)
+            {
+                text[headerLen + payloadLen + i] = tmpBlock[i];
+            }
+        
+            for(i = 0; i < BLOCK_SIZE-1; i++)
+            {
+                tmpBlock[i] = (i < headerLen) ? text[i] : 0;
+            }
+    
+            CTR(&(text[headerLen]), (payloadLen + BLOCK_SIZE), key, tmpBlock);    
+            #if defined(__18CXX)
+                INTCONbits.GIEH = ITStatus;
+            #endif  
+        }
+    
+    
+        /*********************************************************************
+         * void CCM_Dec(    BYTE *text, 
+         *                  BYTE headerLen, 
+         *                  BYTE payloadLen, 
+         *                  BYTE *key)
+         *
+         * Overview:        This function implements CCM mode of security 
+         *                  engine to the input text. CCM mode ensures data
+         *                  interity as well as secrecy. This function is used
+         *                  to decode the data
+         *
+         * PreCondition:    None
+         *
+         * Input:       
+         *          BYTE *      text        The text to be encrypted. The decrypted
+         *                                  data will replace the original content
+         *                                  after this function call.
+         *          BYTE *      headerLen   The header length, used to authenticate, but
+         *                                  not decrypted
+         *          BYTE        payloadLen  The length of the text to be authenticated
+         *                                  and decrypted
+         *          BYTE *      key         The security key for the XTEA engine
+         * Output:          
+         *          None
+         *
+         * Side Effects:    None
+         * 
+         ********************************************************************/ 
+        BOOL CCM_Dec(BYTE *text, BYTE headerLen, BYTE payloadLen, BYTE *key)
+        {
+            BYTE i;
+            #if defined(__18CXX)
+                BYTE ITStatus = INTCONbits.GIEH;
+        
+                INTCONbits.GIEH = 0;
+            #endif
+
+            for(i = 0; i < BLOCK_SIZE-1; i++)
+            {
+                tmpBlock[i] = (i < headerLen) ? text[i] : 0;
+            }
+            CTR(&(text[headerLen]), payloadLen, key, tmpBlock);
+
+            CBC_MAC(text, (headerLen + payloadLen - SEC_MIC_LEN), key, tmpBlock);
+            for(i = 0; i < SEC_MIC_LEN; i++)
+            {
+                if( tmpBlock[i] != text[headerLen + payloadLen - SEC_MIC_LEN + i] )
+                {
+                    #if defined(__18CXX)
+                        INTCONbits.GIEH = ITStatus;
+                    #endif
+                    return FALSE;
+                }       
+            }
+            #if defined(__18CXX)
+                INTCONbits.GIEH = ITStatus;
+            #endif  
+            return TRUE;
+        }
+    #endif
 
 #endif
 
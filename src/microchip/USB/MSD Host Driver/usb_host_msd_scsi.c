@@ -85,6 +85,10 @@ Change History:
 #define INITIALIZATION_ATTEMPTS     100         // How many times to try to initialize the media before failing
 #define RDPROTECT_NORMAL            0x00        // Normal Read Protect behavior.
 #define WRPROTECT_NORMAL            0x00        // Normal Write Protect behavior.
+//MODTRONIX added next 3 lines
+#define SCSI_READ10                 0x28        // READ(10) operation code
+#define SCSI_WRITE10                0x2A        // WRITE(10) operation code
+#define SECTOR_NONE                 0xFFFFFFFFul    // No sector, used to reset sequential access detection
 
 
 //******************************************************************************
@@ -105,6 +109,10 @@ Change History:
     BOOL    _USBHostMSDSCSI_TestUnitReady( void );
 #endif
 
+//MODTRONIX added next 2 lines
+BYTE    _USBHostMSDSCSI_Transfer10( BYTE opCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer );
+void    _USBHostMSDSCSI_ResetCache( void );
+
 
 //******************************************************************************
 //******************************************************************************
@@ -119,6 +127,23 @@ Change History:
 static BYTE                deviceAddress = 0;  // USB address of the attached device.
 static MEDIA_INFORMATION   mediaInformation;   // Information about the attached media.
 
+//MODTRONIX added next 15 lines
+static DWORD               lastLBA;            // Last logical block address of the media, 0 if unknown.
+
+#if (USB_MSD_SCSI_READ_AHEAD_SECTORS > 0)
+static BYTE                readAheadBuf[USB_MSD_SCSI_READ_AHEAD_SECTORS * USB_MSD_SCSI_CACHE_SECTOR_SIZE];
+static DWORD               readAheadStart;     // First sector contained in readAheadBuf
+static WORD                readAheadCount;     // Number of valid sectors in readAheadBuf, 0 if empty
+static DWORD               lastReadSector;     // Sector of previous read, used to detect sequential access
+#endif
+
+#if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+static BYTE                writeBehindBuf[USB_MSD_SCSI_WRITE_BEHIND_SECTORS * USB_MSD_SCSI_CACHE_SECTOR_SIZE];
+static DWORD               writeBehindStart;   // Sector written by first entry of writeBehindBuf
+static WORD                writeBehindCount;   // Number of sectors waiting in writeBehindBuf, 0 if empty
+static DWORD               lastDirectWrite;    // Sector of previous write that was not buffered
+#endif
+
 // *****************************************************************************
 // *****************************************************************************
 // Section: MSD Host Stack Callback Functions
@@ -228,6 +253,7 @@ BOOL USBHostMSDSCSIEventHandler( BYTE address, USB_EVENT event, void *data, DWOR
                 #endif
                 deviceAddress                           = 0;
                 mediaInformation.validityFlags.value    = 0;
+                _USBHostMSDSCSI_ResetCache();   //MODTRONIX added this line
                 return TRUE;
                 break;
 
@@ -405,6 +431,11 @@ MEDIA_INFORMATION * USBHostMSDSCSIMediaInitialize( void )
             mediaInformation.sectorSize                     = (inquiryData[7] << 12) + (inquiryData[6] << 8) + (inquiryData[5] << 4) + (inquiryData[4]);
             mediaInformation.validityFlags.bits.sectorSize  = 1;
 
+            //MODTRONIX added next 3 lines
+            lastLBA = ((DWORD)inquiryData[0] << 24) | ((DWORD)inquiryData[1] << 16) |
+                      ((DWORD)inquiryData[2] << 8) | (DWORD)inquiryData[3];     // Big endian!
+            _USBHostMSDSCSI_ResetCache();
+
             mediaInformation.errorCode = MEDIA_NO_ERROR;
             return &mediaInformation;
         }
@@ -551,6 +582,11 @@ MEDIA_INFORMATION * USBHostMSDSCSIMediaInitialize( void )
             mediaInformation.sectorSize                     = (inquiryData[7] << 12) + (inquiryData[6] << 8) + (inquiryData[5] << 4) + (inquiryData[4]);
             mediaInformation.validityFlags.bits.sectorSize  = 1;
 
+            //MODTRONIX added next 3 lines
+            lastLBA = ((DWORD)inquiryData[0] << 24) | ((DWORD)inquiryData[1] << 16) |
+                      ((DWORD)inquiryData[2] << 8) | (DWORD)inquiryData[3];     // Big endian!
+            _USBHostMSDSCSI_ResetCache();
+
             mediaInformation.errorCode = MEDIA_NO_ERROR;
             return &mediaInformation;
         }
@@ -688,9 +724,10 @@ BYTE USBHostMSDSCSIMediaReset( void  )
 
 BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
 {
-    DWORD   byteCount;
-    BYTE    commandBlock[10];
-    BYTE    errorCode;
+    #if (USB_MSD_SCSI_READ_AHEAD_SECTORS > 0)
+    BOOL    sequential;
+    WORD    count;
+    #endif
 
     #ifdef DEBUG_MODE
         UART2PrintString( "SCSI: Reading sector " );
@@ -708,51 +745,57 @@ BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
         return FALSE;       // USB_MSD_DEVICE_NOT_FOUND;
     }
 
-    // Fill in the command block with the READ10 parameters.
-    commandBlock[0] = 0x28;     // Operation code
-    commandBlock[1] = RDPROTECT_NORMAL | FUA_ALLOW_CACHE;
-    commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
-    commandBlock[3] = (BYTE) (sectorAddress >> 16);
-    commandBlock[4] = (BYTE) (sectorAddress >> 8);
-    commandBlock[5] = (BYTE) (sectorAddress);
-    commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
-    commandBlock[9] = 0x00;     // Control
-
-    // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector init error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
+    //MODTRONIX added read-ahead and write-behind buffer lookups
+    #if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+    // Sectors waiting in the write-behind buffer are newer than the media
+    if ((writeBehindCount != 0) && ((sectorAddress - writeBehindStart) < writeBehindCount))
+    {
+        memcpy( dataBuffer, &writeBehindBuf[(WORD)(sectorAddress - writeBehindStart) * USB_MSD_SCSI_CACHE_SECTOR_SIZE],
+                USB_MSD_SCSI_CACHE_SECTOR_SIZE );
+        return TRUE;
+    }
     #endif
 
-    if (!errorCode)
+    #if (USB_MSD_SCSI_READ_AHEAD_SECTORS > 0)
+    if (mediaInformation.sectorSize == USB_MSD_SCSI_CACHE_SECTOR_SIZE)
     {
-        while (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
+        sequential = (sectorAddress == (lastReadSector + 1));
+        lastReadSector = sectorAddress;
+
+        if ((readAheadCount != 0) && ((sectorAddress - readAheadStart) < readAheadCount))
         {
-            USBTasks();
+            memcpy( dataBuffer, &readAheadBuf[(WORD)(sectorAddress - readAheadStart) * USB_MSD_SCSI_CACHE_SECTOR_SIZE],
+                    USB_MSD_SCSI_CACHE_SECTOR_SIZE );
+            return TRUE;
         }
-    }
 
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
+        // Sequential access detected, fetch this and the following sectors with a single READ10.
+        // Do not read past the end of the media.
+        if (sequential)
+        {
+            count = USB_MSD_SCSI_READ_AHEAD_SECTORS;
+            if ((lastLBA != 0) && (sectorAddress <= lastLBA) && ((lastLBA - sectorAddress) < (DWORD)(count - 1)))
+            {
+                count = (WORD)(lastLBA - sectorAddress) + 1;
+            }
 
-    if (!errorCode)
-    {
-        return TRUE;
-    }
-    else
-    {
-//        USBHostMSDSCSIMediaReset();
-        return FALSE;
+            readAheadCount = 0;
+            if (_USBHostMSDSCSI_Transfer10( SCSI_READ10, sectorAddress, count, readAheadBuf ))
+            {
+                readAheadStart = sectorAddress;
+                readAheadCount = count;
+                memcpy( dataBuffer, readAheadBuf, USB_MSD_SCSI_CACHE_SECTOR_SIZE );
+                return TRUE;
+            }
+            // Read-ahead failed, try reading the requested sector only
+        }
     }
+    #endif
+
+    return _USBHostMSDSCSI_Transfer10( SCSI_READ10, sectorAddress, 1, dataBuffer );
 }
 
+
 /****************************************************************************
   Function:
     BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero )
@@ -799,9 +842,9 @@ BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
 
 BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero )
 {
-    DWORD   byteCount;
-    BYTE    commandBlock[10];
-    BYTE    errorCode;
+    #if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+    WORD    index;
+    #endif
 
     #ifdef DEBUG_MODE
         UART2PrintString( "SCSI: Writing sector " );
@@ -824,49 +867,95 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
         return FALSE;
     }
 
-    // Fill in the command block with the WRITE 10 parameters.
-    commandBlock[0] = 0x2A;     // Operation code
-    commandBlock[1] = WRPROTECT_NORMAL | FUA_ALLOW_CACHE;
-    commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
-    commandBlock[3] = (BYTE) (sectorAddress >> 16);
-    commandBlock[4] = (BYTE) (sectorAddress >> 8);
-    commandBlock[5] = (BYTE) (sectorAddress);
-    commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
-    commandBlock[9] = 0x00;     // Control
-
-    // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDWrite( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector init error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
+    //MODTRONIX added read-ahead invalidation and write-behind buffering
+    #if (USB_MSD_SCSI_READ_AHEAD_SECTORS > 0)
+    if ((readAheadCount != 0) && ((sectorAddress - readAheadStart) < readAheadCount))
+    {
+        readAheadCount = 0;
+    }
     #endif
 
-    if (!errorCode)
+    #if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+    if (mediaInformation.sectorSize == USB_MSD_SCSI_CACHE_SECTOR_SIZE)
     {
-        while (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
+        // Sector is already buffered, or follows the last buffered sector
+        if ((writeBehindCount != 0) && ((sectorAddress - writeBehindStart) <= writeBehindCount))
         {
-            USBTasks();
+            index = (WORD)(sectorAddress - writeBehindStart);
+            memcpy( &writeBehindBuf[index * USB_MSD_SCSI_CACHE_SECTOR_SIZE], dataBuffer, USB_MSD_SCSI_CACHE_SECTOR_SIZE );
+            if ((index == writeBehindCount) && (++writeBehindCount == USB_MSD_SCSI_WRITE_BEHIND_SECTORS))
+            {
+                return USBHostMSDSCSIFlush();
+            }
+            return TRUE;
         }
-    }
 
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
+        // Any other write, for example a FAT update or the directory entry written by FSfclose(), is written
+        // directly. Write the buffered sectors first, so file data is on the media before the FAT and
+        // directory entries that refer to it.
+        if (!USBHostMSDSCSIFlush())
+        {
+            return FALSE;
+        }
 
-    if (!errorCode)
-    {
-        return TRUE;
+        // A new sequential run started with the previous unbuffered write
+        if (sectorAddress == (lastDirectWrite + 1))
+        {
+            writeBehindStart = sectorAddress;
+            writeBehindCount = 1;
+            memcpy( writeBehindBuf, dataBuffer, USB_MSD_SCSI_CACHE_SECTOR_SIZE );
+            return TRUE;
+        }
+
+        lastDirectWrite = sectorAddress;
     }
-    else
+    #endif
+
+    return _USBHostMSDSCSI_Transfer10( SCSI_WRITE10, sectorAddress, 1, dataBuffer );
+}
+
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSIFlush( void )
+
+  Summary:
+    This function writes all sectors waiting in the write-behind buffer.
+
+  Description:
+    This function writes all sectors waiting in the write-behind buffer to
+    the media with a single WRITE10 command.  It must be called before the
+    media is removed, for example after closing a file.
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Return Values:
+    TRUE    - write performed successfully, or nothing to write
+    FALSE   - write was not successful
+
+  Remarks:
+    MODTRONIX added this function
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSIFlush( void )
+{
+    #if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+    WORD    count;
+
+    if (writeBehindCount != 0)
     {
-//        USBHostMSDSCSIMediaReset();
-        return FALSE;
+        count = writeBehindCount;
+        writeBehindCount = 0;
+        return _USBHostMSDSCSI_Transfer10( SCSI_WRITE10, writeBehindStart, count, writeBehindBuf );
     }
+    #endif
+
+    return TRUE;
 }
 
 
@@ -989,3 +1078,139 @@ BOOL _USBHostMSDSCSI_TestUnitReady( void )
 }
 #endif
 
+
+/*******************************************************************************
+  Function:
+    BYTE _USBHostMSDSCSI_Transfer10( BYTE opCode, DWORD sectorAddress,
+                        WORD sectorCount, BYTE *dataBuffer )
+
+  Precondition:
+    None
+
+  Overview:
+    This function reads or writes sectorCount consecutive sectors using the
+    READ10 or WRITE10 SCSI command.  Requests larger than
+    USB_MSD_SCSI_MAX_SECTORS_PER_TRANSFER are split into multiple commands.
+    It blocks until all data has been transferred.
+
+  Parameters:
+    BYTE    opCode          - SCSI_READ10 or SCSI_WRITE10
+    DWORD   sectorAddress   - address of first sector
+    WORD    sectorCount     - number of sectors to transfer
+    BYTE    *dataBuffer     - data buffer, must be sectorCount sectors large
+
+  Return Values:
+    TRUE    - Transfer completed without error
+    FALSE   - Error while performing transfer
+
+  Remarks:
+    MODTRONIX added this function. See USBHostMSDSCSISectorRead() for the
+    format of the READ10 and WRITE10 command blocks.
+  ***************************************************************************/
+
+BYTE _USBHostMSDSCSI_Transfer10( BYTE opCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer )
+{
+    DWORD   byteCount;
+    DWORD   dataLength;
+    BYTE    commandBlock[10];
+    BYTE    errorCode;
+    WORD    count;
+
+    while (sectorCount != 0)
+    {
+        count = sectorCount;
+        if (count > USB_MSD_SCSI_MAX_SECTORS_PER_TRANSFER)
+        {
+            count = USB_MSD_SCSI_MAX_SECTORS_PER_TRANSFER;
+        }
+        dataLength = (DWORD)count * mediaInformation.sectorSize;
+
+        // Fill in the command block with the READ10 or WRITE10 parameters.
+        commandBlock[0] = opCode;   // Operation code
+        commandBlock[1] = ((opCode == SCSI_READ10) ? RDPROTECT_NORMAL : WRPROTECT_NORMAL) | FUA_ALLOW_CACHE;
+        commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
+        commandBlock[3] = (BYTE) (sectorAddress >> 16);
+        commandBlock[4] = (BYTE) (sectorAddress >> 8);
+        commandBlock[5] = (BYTE) (sectorAddress);
+        commandBlock[6] = 0x00;     // Group Number
+        commandBlock[7] = (BYTE) (count >> 8);  // Number of blocks - Big endian!
+        commandBlock[8] = (BYTE) (count);
+        commandBlock[9] = 0x00;     // Control
+
+        // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
+        if (opCode == SCSI_READ10)
+        {
+            errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 10, dataBuffer, dataLength );
+        }
+        else
+        {
+            errorCode = USBHostMSDWrite( deviceAddress, 0, commandBlock, 10, dataBuffer, dataLength );
+        }
+        #ifdef DEBUG_MODE
+            UART2PrintString( "SCSI: Transfer init error " );
+            UART2PutHex( errorCode );
+            UART2PrintString( "\r\n" );
+        #endif
+
+        if (!errorCode)
+        {
+            while (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
+            {
+                USBTasks();
+            }
+        }
+
+        #ifdef DEBUG_MODE
+            UART2PrintString( "SCSI: Transfer error " );
+            UART2PutHex( errorCode );
+            UART2PrintString( "\r\n" );
+        #endif
+
+        if (errorCode)
+        {
+//            USBHostMSDSCSIMediaReset();
+            return FALSE;
+        }
+
+        sectorAddress   += count;
+        sectorCount     -= count;
+        dataBuffer      += dataLength;
+    }
+
+    return TRUE;
+}
+
+
+/*******************************************************************************
+  Function:
+    void _USBHostMSDSCSI_ResetCache( void )
+
+  Precondition:
+    None
+
+  Overview:
+    This function discards the contents of the read-ahead and write-behind
+    buffers.  It is called when the media is initialized or detached.
+
+  Parameters:
+    None - None
+
+  Returns:
+    None
+
+  Remarks:
+    MODTRONIX added this function
+  ***************************************************************************/
+
+void _USBHostMSDSCSI_ResetCache( void )
+{
+    #if (USB_MSD_SCSI_READ_AHEAD_SECTORS > 0)
+    readAheadCount  = 0;
+    lastReadSector  = SECTOR_NONE;
+    #endif
+
+    #if (USB_MSD_SCSI_WRITE_BEHIND_SECTORS > 0)
+    writeBehindCount    = 0;
+    lastDirectWrite     = SECTOR_NONE;
+    #endif
+}
@@ -198,6 +198,20 @@
         #pragma udata
     #endif
 
+    #if defined(CONNECTION_HASH_SIZE)
+        #if (CONNECTION_HASH_SIZE > 256) || ((CONNECTION_HASH_SIZE & (CONNECTION_HASH_SIZE - 1)) != 0)
+            #error "CONNECTION_HASH_SIZE must be a power of 2, not more than 256"
+        #endif
+        BYTE connShortHash[CONNECTION_HASH_SIZE];   // connection table index last found for each short address hash
+        BYTE connLongHash[CONNECTION_HASH_SIZE];    // connection table index last found for each long address hash
+        CONNECTION_LOOKUP_STATS connLookupStats;
+
+        #define SHORT_ADDRESS_HASH(a)   ((BYTE)((a).v[0] ^ ((a).v[1] * 37)) & (CONNECTION_HASH_SIZE - 1))
+        BYTE LongAddressHash(BYTE *Address);
+        void ConnectionHashUpdate(BYTE index);
+        void ConnectionHashRebuild(void);
+    #endif
+
     struct _BROADCAST_RECORD
     {
         WORD_VAL    AltSourceAddr;
@@ -3242,6 +3256,21 @@ NO_INDIRECT_MESSAGE:
     BYTE SearchForShortAddress(void)
     {
         BYTE i;   
+        #if defined(CONNECTION_HASH_SIZE)
+            BYTE h = SHORT_ADDRESS_HASH(tempShortAddress);
+            
+            // Try the entry last found for this hash first
+            connLookupStats.shortLookups++;
+            i = connShortHash[h];
+            if( (i < CONNECTION_SIZE) && ConnectionTable[i].status.bits.isValid &&
+                ConnectionTable[i].status.bits.shortAddressValid &&
+                (ConnectionTable[i].AltAddress.Val == tempShortAddress.Val) )
+            {
+                connLookupStats.shortHits++;
+                return i;
+            }
+            connLookupStats.scans++;
+        #endif
         
         for(i=0;i<CONNECTION_SIZE;i++)
         {
@@ -3249,6 +3278,9 @@ NO_INDIRECT_MESSAGE:
             {
                 if(ConnectionTable[i].AltAddress.Val == tempShortAddress.Val)
                 {
+                    #if defined(CONNECTION_HASH_SIZE)
+                        connShortHash[h] = i;
+                    #endif
                     return i;
                 }
             }
@@ -3323,6 +3355,21 @@ NO_INDIRECT_MESSAGE:
     BYTE SearchForLongAddress(void)
     {
         BYTE i,j;   
+        #if defined(CONNECTION_HASH_SIZE)
+            BYTE h = LongAddressHash(tempLongAddress);
+            
+            // Try the entry last found for this hash first
+            connLookupStats.longLookups++;
+            i = connLongHash[h];
+            if( (i < CONNECTION_SIZE) && ConnectionTable[i].status.bits.isValid &&
+                ConnectionTable[i].status.bits.longAddressValid &&
+                isSameAddress(ConnectionTable[i].Address, tempLongAddress) )
+            {
+                connLookupStats.longHits++;
+                return i;
+            }
+            connLookupStats.scans++;
+        #endif
         
         for(i=0;i<CONNECTION_SIZE;i++)
         {
@@ -3335,6 +3382,9 @@ NO_INDIRECT_MESSAGE:
                         goto EndOfSearchLoop;
                     }
                 }
+                #if defined(CONNECTION_HASH_SIZE)
+                    connLongHash[h] = i;
+                #endif
                 return i;
             }
 EndOfSearchLoop:
@@ -3343,6 +3393,100 @@ EndOfSearchLoop:
         return 0xFF;
     }
 
+
+    #if defined(CONNECTION_HASH_SIZE)
+    /*********************************************************************
+     * Function:        BYTE LongAddressHash(BYTE *Address)
+     *
+     * PreCondition:    None
+     *
+     * Input:           BYTE *Address - long address to hash
+     *
+     * Output:          BYTE - the hash bucket of the address, in the range
+     *                  0 to CONNECTION_HASH_SIZE-1
+     *
+     * Side Effects:    None
+     *
+     * Overview:        This function calculates the hash bucket of a long
+     *                  address for the connection table hash index.
+     ********************************************************************/
+    BYTE LongAddressHash(BYTE *Address)
+    {
+        BYTE i;
+        BYTE h = 0;
+        
+        for(i = 0; i < MY_ADDRESS_LENGTH; i++)
+        {
+            h = (h * 31) + Address[i];
+        }
+        return h & (CONNECTION_HASH_SIZE - 1);
+    }
+    
+    
+    /*********************************************************************
+     * Function:        void ConnectionHashUpdate(BYTE index)
+     *
+     * PreCondition:    None
+     *
+     * Input:           BYTE index - the connection table entry that changed
+     *
+     * Output:          None
+     *
+     * Side Effects:    The hash buckets of the entry point to it
+     *
+     * Overview:        This function adds a connection table entry to the
+     *                  short and long address hash indices.
+     ********************************************************************/
+    void ConnectionHashUpdate(BYTE index)
+    {
+        if( ConnectionTable[index].status.bits.isValid == 0 )
+        {
+            return;
+        }
+        if( ConnectionTable[index].status.bits.shortAddressValid )
+        {
+            connShortHash[SHORT_ADDRESS_HASH(ConnectionTable[index].AltAddress)] = index;
+        }
+        if( ConnectionTable[index].status.bits.longAddressValid )
+        {
+            connLongHash[LongAddressHash(ConnectionTable[index].Address)] = index;
+        }
+    }
+    
+    
+    /*********************************************************************
+     * Function:        void ConnectionHashRebuild(void)
+     *
+     * PreCondition:    None
+     *
+     * Input:           None
+     *
+     * Output:          None
+     *
+     * Side Effects:    The hash indices are recreated from ConnectionTable
+     *
+     * Overview:        This function rebuilds the short and long address
+     *                  hash indices from the whole connection table. It is
+     *                  called after the table is restored from NVM. The
+     *                  table is walked backwards, so on a collision the
+     *                  bucket points to the lowest entry, like a scan would.
+     ********************************************************************/
+    void ConnectionHashRebuild(void)
+    {
+        BYTE i;
+        
+        for(i = 0; i < CONNECTION_HASH_SIZE; i++)
+        {
+            connShortHash[i] = 0xFF;
+            connLongHash[i] = 0xFF;
+        }
+        for(i = CONNECTION_SIZE; i > 0; i--)
+        {
+            ConnectionHashUpdate(i - 1);
+        }
+    }
+    #endif
+
     
     
     /*********************************************************************
@@ -3413,6 +3557,9 @@ EndOfSearchLoop:
             #if defined(ENABLE_SECURITY)
                 IncomingFrameCounter[handle].Val = 0;
             #endif
+            #if defined(CONNECTION_HASH_SIZE)
+                ConnectionHashUpdate(handle);
+            #endif
         }
         
         return handle;
@@ -3605,6 +3752,9 @@ EndOfSearchLoop:
         {
             ConnectionTable[i].status.Val = 0;
         }
+        #if defined(CONNECTION_HASH_SIZE)
+            ConnectionHashRebuild();
+        #endif
         
         #ifdef NWK_ROLE_COORDINATOR
             for(i=0;i<8;i++)
@@ -3664,6 +3814,9 @@ EndOfSearchLoop:
                 nvmGetConnMode(&ConnMode);
                 MiWiCapacityInfo.bits.ConnMode = ConnMode;
                 nvmGetConnectionTable(ConnectionTable);
+                #if defined(CONNECTION_HASH_SIZE)
+                    ConnectionHashRebuild();
+                #endif
                 nvmGetMyShortAddress(myShortAddress.v);
                 nvmGetMyParent(&myParent);
                 #if defined(NWK_ROLE_COORDINATOR)
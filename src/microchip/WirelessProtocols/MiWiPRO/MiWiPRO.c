@@ -275,6 +275,20 @@
         #pragma udata
     #endif
 
+    #if defined(CONNECTION_HASH_SIZE)
+        #if (CONNECTION_HASH_SIZE > 256) || ((CONNECTION_HASH_SIZE & (CONNECTION_HASH_SIZE - 1)) != 0)
+            #error "CONNECTION_HASH_SIZE must be a power of 2, not more than 256"
+        #endif
+        BYTE connShortHash[CONNECTION_HASH_SIZE];   // connection table index last found for each short address hash
+        BYTE connLongHash[CONNECTION_HASH_SIZE];    // connection table index last found for each long address hash
+        CONNECTION_LOOKUP_STATS connLookupStats;
+
+        #define SHORT_ADDRESS_HASH(a)   ((BYTE)((a).v[0] ^ ((a).v[1] * 37)) & (CONNECTION_HASH_SIZE - 1))
+        BYTE LongAddressHash(BYTE *Address);
+        void ConnectionHashUpdate(BYTE index);
+        void ConnectionHashRebuild(void);
+    #endif
+
     struct _PACKET_RECORD
     {
         WORD_VAL    AltSourceAddr;
@@ -4191,6 +4205,21 @@ NO_INDIRECT_MESSAGE:
     BYTE SearchForShortAddress(void)
     {
         BYTE i;   
+        #if defined(CONNECTION_HASH_SIZE)
+            BYTE h = SHORT_ADDRESS_HASH(tempShortAddress);
+            
+            // Try the entry last found for this hash first
+            connLookupStats.shortLookups++;
+            i = connShortHash[h];
+            if( (i < CONNECTION_SIZE) && ConnectionTable[i].status.bits.isValid &&
+                ConnectionTable[i].status.bits.shortAddressValid &&
+                (ConnectionTable[i].AltAddress.Val == tempShortAddress.Val) )
+            {
+                connLookupStats.shortHits++;
+                return i;
+            }
+            connLookupStats.scans++;
+        #endif
         
         for(i=0;i<CONNECTION_SIZE;i++)
         {
@@ -4198,6 +4227,9 @@ NO_INDIRECT_MESSAGE:
             {
                 if(ConnectionTable[i].AltAddress.Val == tempShortAddress.Val)
                 {
+                    #if defined(CONNECTION_HASH_SIZE)
+                        connShortHash[h] = i;
+                    #endif
                     return i;
                 }
             }
@@ -4271,6 +4303,21 @@ NO_INDIRECT_MESSAGE:
     BYTE SearchForLongAddress(void)
     {
         BYTE i,j;   
+        #if defined(CONNECTION_HASH_SIZE)
+            BYTE h = LongAddressHash(tempLongAddress);
+            
+            // Try the entry last found for this hash first
+            connLookupStats.longLookups++;
+            i = connLongHash[h];
+            if( (i < CONNECTION_SIZE) && ConnectionTable[i].status.bits.isValid &&
+                ConnectionTable[i].status.bits.longAddressValid &&
+                isSameAddress(ConnectionTable[i].Address, tempLongAddress) )
+            {
+                connLookupStats.longHits++;
+                return i;
+            }
+            connLookupStats.scans++;
+        #endif
         
         for(i=0;i<CONNECTION_SIZE;i++)
         {
@@ -4283,6 +4330,9 @@ NO_INDIRECT_MESSAGE:
                         goto EndOfSearchLoop;
                     }
                 }
+                #if defined(CONNECTION_HASH_SIZE)
+                    connLongHash[h] = i;
+                #endif
                 return i;
             }
 EndOfSearchLoop:
@@ -4291,6 +4341,100 @@ EndOfSearchLoop:
         return 0xFF;
     }
 
+
+    #if defined(CONNECTION_HASH_SIZE)
+    /*********************************************************************
+     * Function:        BYTE LongAddressHash(BYTE *Address)
+     *
+     * PreCondition:    None
+     *
+     * Input:           BYTE *Address - long address to hash
+     *
+     * Output:          BYTE - the hash bucket of the address, in the range
+     *                  0 to CONNECTION_HASH_SIZE-1
+     *
+     * Side Effects:    None
+     *
+     * Overview:        This function calculates the hash bucket of a long
+     *                  address for the connection table hash index.
+     ********************************************************************/
+    BYTE LongAddressHash(BYTE *Address)
+    {
+        BYTE i;
+        BYTE h = 0;
+        
+        for(i = 0; i < MY_ADDRESS_LENGTH; i++)
+        {
+            h = (h * 31) + Address[i];
+        }
+        return h & (CONNECTION_HASH_SIZE - 1);
+    }
+    
+    
+    /*********************************************************************
+     * Function:        void ConnectionHashUpdate(BYTE index)
+     *
+     * PreCondition:    None
+     *
+     * Input:           BYTE index - the connection table entry that changed
+     *
+     * Output:          None
+     *
+     * Side Effects:    The hash buckets of the entry point to it
+     *
+     * Overview:        This function adds a connection table entry to the
+     *                  short and long address hash indices.
+     ********************************************************************/
+    void ConnectionHashUpdate(BYTE index)
+    {
+        if( ConnectionTable[index].status.bits.isValid == 0 )
+        {
+            return;
+        }
+        if( ConnectionTable[index].status.bits.shortAddressValid )
+        {
+            connShortHash[SHORT_ADDRESS_HASH(ConnectionTable[index].AltAddress)] = index;
+        }
+        if( ConnectionTable[index].status.bits.longAddressValid )
+        {
+            connLongHash[LongAddressHash(ConnectionTable[index].Address)] = index;
+        }
+    }
+    
+    
+    /*********************************************************************
+     * Function:        void ConnectionHashRebuild(void)
+     *
+     * PreCondition:    None
+     *
+     * Input:           None
+     *
+     * Output:          None
+     *
+     * Side Effects:    The hash indices are recreated from ConnectionTable
+     *
+     * Overview:        This function rebuilds the short and long address
+     *                  hash indices from the whole connection table. It is
+     *                  called after the table is restored from NVM. The
+     *                  table is walked backwards, so on a collision the
+     *                  bucket points to the lowest entry, like a scan would.
+     ********************************************************************/
+    void ConnectionHashRebuild(void)
+    {
+        BYTE i;
+        
+        for(i = 0; i < CONNECTION_HASH_SIZE; i++)
+        {
+            connShortHash[i] = 0xFF;
+            connLongHash[i] = 0xFF;
+        }
+        for(i = CONNECTION_SIZE; i > 0; i--)
+        {
+            ConnectionHashUpdate(i - 1);
+        }
+    }
+    #endif
+
     
     
     /*********************************************************************
@@ -4361,6 +4505,9 @@ EndOfSearchLoop:
             #if defined(ENABLE_SECURITY)
                 IncomingFrameCounter[handle].Val = 0;
             #endif
+            #if defined(CONNECTION_HASH_SIZE)
+                ConnectionHashUpdate(handle);
+            #endif
         }
 
         return handle;
@@ -4549,6 +4696,9 @@ EndOfSearchLoop:
         {
             ConnectionTable[i].status.Val = 0;
         }
+        #if defined(CONNECTION_HASH_SIZE)
+            ConnectionHashRebuild();
+        #endif
         
         #ifdef NWK_ROLE_COORDINATOR
             for(i=0;i< NUM_COORDINATOR/8;i++)
@@ -4612,6 +4762,9 @@ EndOfSearchLoop:
                 nvmGetConnMode(&ConnMode);
                 MiWiPROCapacityInfo.bits.ConnMode = ConnMode;
                 nvmGetConnectionTable(ConnectionTable);
+                #if defined(CONNECTION_HASH_SIZE)
+                    ConnectionHashRebuild();
+                #endif
                 nvmGetMyShortAddress(myShortAddress.v);
                 nvmGetMyParent(&myParent);
                 #if defined(NWK_ROLE_COORDINATOR)
@@ -35,6 +35,7 @@
 
 #include "nz_ow2482.h"
 #include "nz_serI2C.h"
+#include "nz_crc.h"
 #include "nz_helpers.h"
 #include "nz_helpersCx.h"
 
@@ -1032,18 +1033,8 @@ BYTE ds2482_readStatusRegAgain(DS2482_INFO* pObj) {
  * @return Returns current global crc8 value
  */
 BYTE calc_crc8(DS2482_INFO* pObj, BYTE data) {
-   BYTE i;
-
-   // See Application Note 27
-   pObj->crc8 = pObj->crc8 ^ data;
-   for (i = 0; i < 8; ++i)
-   {
-      if (pObj->crc8 & 1)
-         pObj->crc8 = (pObj->crc8 >> 1) ^ 0x8c;
-      else
-         pObj->crc8 = (pObj->crc8 >> 1);
-   }
-
+   // See Application Note 27, Dallas/Maxim CRC-8
+   pObj->crc8 = crc8Update(pObj->crc8, &data, 1);
    return pObj->crc8;
 }
 
@@ -0,0 +1,173 @@
+/**
+ * Host benchmark for the CRC functions in nz_crc.c.
+ *
+ * Checks each CRC against the standard check value (CRC of "123456789"), and against a bit by bit
+ * calculation of random data. Then measures the throughput of each CRC for the given block size.
+ * The table size and slice-by-8 options are selected at compile time, the same way as in projdefs.h.
+ *
+ * Build with:  gcc -O2 -o nz_crcBench nz_crcBench.c
+ *              gcc -O2 -DNZ_CRC_TABLE_SIZE=256 -o nz_crcBench nz_crcBench.c
+ *              gcc -O2 -DNZ_CRC_TABLE_SIZE=256 -DNZ_CRC8_SLICE8 -DNZ_CRC16_CCITT_SLICE8 -DNZ_CRC16_IBM_SLICE8 -DNZ_CRC32_SLICE8 -o nz_crcBench nz_crcBench.c
+ *
+ * Usage: nz_crcBench [-b bytes] [-n megabytes]
+ *  -b  Block size passed to each CRC call, 1 to 65535. Default is 1024
+ *  -n  Megabytes of data to calculate CRC of for each CRC. Default is 64
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//Same sizes as XC16, DWORD is NOT unsigned long on a 64-bit host
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+
+#define NZ_CRC_HOST
+#include "../nz_crc.c"
+
+#define TEST_LEN    4096
+
+//CRC of data bit by bit, used to check the table driven functions
+static uint32_t refCrc(uint32_t crc, const uint8_t* p, uint32_t len, uint32_t poly, int width, int reflected) {
+    uint32_t top = 1ul << (width - 1);
+    uint32_t mask = (width == 32) ? 0xfffffffful : ((1ul << width) - 1);
+    int i;
+
+    while (len--) {
+        if (reflected) {
+            crc ^= *p++;
+            for (i = 0; i < 8; i++)
+                crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+        }
+        else {
+            crc ^= ((uint32_t)*p++) << (width - 8);
+            for (i = 0; i < 8; i++)
+                crc = ((crc & top) ? ((crc << 1) ^ poly) : (crc << 1)) & mask;
+        }
+    }
+    return crc;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check(const char* name, uint32_t got, uint32_t expected) {
+    if (got != expected) {
+        printf("%-13s FAILED, got 0x%08X, expected 0x%08X\n", name, got, expected);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    static const uint8_t checkStr[] = "123456789";
+    uint8_t* buf;
+    uint8_t* test;
+    uint32_t blockLen = 1024;
+    uint32_t mbytes = 64;
+    uint32_t blocks, b, i;
+    volatile uint32_t sink = 0;
+    double t;
+    int opt, err = 0;
+
+    while ((opt = getopt(argc, argv, "b:n:")) != -1) {
+        switch (opt) {
+        case 'b': blockLen = strtoul(optarg, NULL, 0); break;
+        case 'n': mbytes = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "Usage: %s [-b bytes] [-n megabytes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (blockLen == 0 || blockLen > 65535 || mbytes == 0) {
+        fprintf(stderr, "Block size must be 1 to 65535, and megabytes at least 1\n");
+        return 1;
+    }
+
+    printf("NZ_CRC_TABLE_SIZE=%d", NZ_CRC_TABLE_SIZE);
+    #if defined(NZ_CRC8_SLICE8)
+    printf(" NZ_CRC8_SLICE8");
+    #endif
+    #if defined(NZ_CRC16_CCITT_SLICE8)
+    printf(" NZ_CRC16_CCITT_SLICE8");
+    #endif
+    #if defined(NZ_CRC16_IBM_SLICE8)
+    printf(" NZ_CRC16_IBM_SLICE8");
+    #endif
+    #if defined(NZ_CRC32_SLICE8)
+    printf(" NZ_CRC32_SLICE8");
+    #endif
+    printf(", block size %u bytes\n", blockLen);
+
+    //Check values, and random data of all lengths up to TEST_LEN (odd lengths and unaligned tails)
+    err |= check("CRC-8 Maxim", crc8Update(0, checkStr, 9), 0xA1);
+    err |= check("CRC-16 CCITT", crc16CcittUpdate(0xffff, checkStr, 9), 0x29B1);
+    err |= check("CRC-16 IBM", crc16IbmUpdate(0, checkStr, 9), 0xBB3D);
+    err |= check("CRC-32", ~crc32Update(0xfffffffful, checkStr, 9), 0xCBF43926ul);
+
+    test = malloc(TEST_LEN);
+    srand(1);
+    for (i = 0; i < TEST_LEN; i++)
+        test[i] = (uint8_t)rand();
+    for (i = 0; i <= TEST_LEN && err == 0; i += (i < 64) ? 1 : 61) {
+        err |= check("CRC-8 Maxim", crc8Update(0x5a, test, i), refCrc(0x5a, test, i, 0x8C, 8, 1));
+        err |= check("CRC-16 CCITT", crc16CcittUpdate(0x1234, test, i), refCrc(0x1234, test, i, 0x1021, 16, 0));
+        err |= check("CRC-16 IBM", crc16IbmUpdate(0x1234, test, i), refCrc(0x1234, test, i, 0xA001, 16, 1));
+        err |= check("CRC-32", crc32Update(0x12345678ul, test, i), refCrc(0x12345678ul, test, i, 0xEDB88320ul, 32, 1));
+    }
+    free(test);
+    if (err)
+        return 1;
+    printf("Check values and random data OK\n");
+
+    //Throughput
+    buf = malloc(blockLen);
+    for (i = 0; i < blockLen; i++)
+        buf[i] = (uint8_t)rand();
+    blocks = (uint32_t)(((uint64_t)mbytes << 20) / blockLen);
+
+    #define BENCH(name, expr) \
+        t = now(); \
+        for (b = 0; b < blocks; b++) { expr; } \
+        t = now() - t; \
+        printf("%-13s %8.1f MB/s\n", name, ((double)blocks * blockLen) / t / 1e6);
+
+    {
+        BYTE crc8 = 0;
+        WORD crc16 = 0xffff;
+        DWORD crc32 = 0xfffffffful;
+
+        BENCH("CRC-8 Maxim", crc8 = crc8Update(crc8, buf, (WORD)blockLen))
+        BENCH("CRC-16 CCITT", crc16 = crc16CcittUpdate(crc16, buf, (WORD)blockLen))
+        sink ^= crc16;
+        crc16 = 0;
+        BENCH("CRC-16 IBM", crc16 = crc16IbmUpdate(crc16, buf, (WORD)blockLen))
+        BENCH("CRC-32", crc32 = crc32Update(crc32, buf, (WORD)blockLen))
+        sink ^= crc8 ^ crc16 ^ crc32;
+    }
+    free(buf);
+    return (int)(sink & 0);
+}
@@ -0,0 +1,216 @@
+/**
+ * Host unit test and benchmark for the I2C and UART status map in nz_statusMap.h.
+ *
+ * Tests adding, updating, taking and evicting key-status pairs, including keys that share a home
+ * slot. Then checks random operations against a simple model, and measures the time for a put
+ * (ISR at STOP) followed by a get (i2cGetStatus() or uartGetStatus()). The same is measured for the
+ * previous linear map, that was scanned from the start and shifted on every put.
+ *
+ * Build with:  gcc -O2 -o nz_statusMapTest nz_statusMapTest.c
+ *              gcc -O2 -DMAP_SIZE=32 -o nz_statusMapTest nz_statusMapTest.c
+ *
+ * Usage: nz_statusMapTest [-n iterations] [-k keys]
+ *  -n  Number of put/get pairs to time. Default is 10000000
+ *  -k  Number of different addresses used by benchmark, 1 to 127. Default is 4
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//Same sizes as XC16
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+
+#include "../nz_statusMap.h"
+
+//Size of map in bytes, same as I2C_STATUS_BUF_SIZE and UART_STATUS_BUF_SIZE
+#if !defined(MAP_SIZE)
+#define MAP_SIZE    16
+#endif
+
+static int errors = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        printf("FAILED line %d: %s\n", __LINE__, msg); \
+        errors++; \
+    }
+
+//Previous map, scanned from start. Put shifts pairs one position up, and adds new pair at bottom.
+static BYTE linearGet(BYTE* map, BYTE key) {
+    WORD c;
+    BYTE ret;
+
+    for (c = 0; c < MAP_SIZE; c += 2) {
+        if (map[c] == key) {
+            ret = map[c+1];
+            map[c+1] = 0xff;
+            return ret;
+        }
+    }
+    return 0xff;
+}
+
+static void linearPut(BYTE* map, BYTE key, BYTE status) {
+    WORD idx;
+
+    for (idx = 0; idx < MAP_SIZE; idx += 2) {
+        if ((map[idx] == key) || (map[idx+1] == 0xff))
+            break;
+    }
+    if (idx != 0) {
+        if (idx == MAP_SIZE)
+            idx = MAP_SIZE - 2;
+        memmove(&map[2], &map[0], idx);
+    }
+    map[0] = key;
+    map[1] = status;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void testBasic(void) {
+    BYTE map[MAP_SIZE];
+    BYTE k1 = 0x10;
+    BYTE k2 = (BYTE)(k1 + MAP_SIZE);        //Same home slot as k1
+    BYTE k3 = (BYTE)(k1 + 2*MAP_SIZE);      //Same home slot as k1
+
+    memset(map, 0, sizeof(map));
+    CHECK(statusMapTake(map, MAP_SIZE, 0x20) == 0xff, "empty map must return 0xff");
+
+    //Put, update and take
+    statusMapSet(map, MAP_SIZE, k1, 1);
+    statusMapSet(map, MAP_SIZE, k1, 2);
+    CHECK(statusMapFind(map, MAP_SIZE, k1) == STATUS_MAP_HOME(k1, MAP_SIZE), "key must be in home slot");
+    CHECK(statusMapTake(map, MAP_SIZE, k1) == 2, "take must return last status");
+    CHECK(statusMapTake(map, MAP_SIZE, k1) == 0xff, "second take must return 0xff");
+
+    //Available home slot is reused
+    statusMapSet(map, MAP_SIZE, k2, 3);
+    CHECK(statusMapFind(map, MAP_SIZE, k2) == STATUS_MAP_HOME(k2, MAP_SIZE), "available home slot must be reused");
+
+    //Collision uses next slot, third key with same home evicts home slot
+    statusMapSet(map, MAP_SIZE, k1, 4);
+    CHECK(statusMapFind(map, MAP_SIZE, k1) == ((STATUS_MAP_HOME(k1, MAP_SIZE) + 2) & (MAP_SIZE-1)), "collision must use next slot");
+    statusMapSet(map, MAP_SIZE, k3, 5);
+    CHECK(statusMapFind(map, MAP_SIZE, k2) == MAP_SIZE, "home slot must be evicted");
+    CHECK(statusMapTake(map, MAP_SIZE, k1) == 4, "next slot must be kept");
+    CHECK(statusMapTake(map, MAP_SIZE, k3) == 5, "new key must be found");
+
+    //Next slot of last home slot wraps to slot 0
+    memset(map, 0, sizeof(map));
+    statusMapSet(map, MAP_SIZE, MAP_SIZE-2, 6);
+    statusMapSet(map, MAP_SIZE, 2*MAP_SIZE-2, 7);
+    CHECK(statusMapFind(map, MAP_SIZE, 2*MAP_SIZE-2) == 0, "next slot must wrap");
+    CHECK(statusMapTake(map, MAP_SIZE, MAP_SIZE-2) == 6, "wrapped map must keep home slot");
+}
+
+//Random operations compared to a model. A key that was set and not evicted must return it's last status.
+static void testRandom(void) {
+    BYTE map[MAP_SIZE];
+    int model[128];     //Last status of each address, -1 if taken or never set
+    int i, adr;
+    BYTE got;
+
+    memset(map, 0, sizeof(map));
+    for (i = 0; i < 128; i++)
+        model[i] = -1;
+
+    srand(1);
+    for (i = 0; i < 1000000; i++) {
+        adr = 1 + rand() % 127;
+        if (rand() & 1) {
+            statusMapSet(map, MAP_SIZE, (BYTE)(adr << 1), (BYTE)(i % 0xfe));
+            model[adr] = i % 0xfe;
+            CHECK(statusMapFind(map, MAP_SIZE, (BYTE)(adr << 1)) != MAP_SIZE, "key just set must be found");
+        }
+        else {
+            got = statusMapTake(map, MAP_SIZE, (BYTE)(adr << 1));
+            //Can be evicted, but must never return a wrong status
+            CHECK((got == 0xff) || (got == model[adr]), "take returned wrong status");
+            model[adr] = -1;
+        }
+        if (errors)
+            return;
+    }
+}
+
+int main(int argc, char** argv) {
+    static BYTE keys[127];
+    BYTE map[MAP_SIZE];
+    uint32_t iterations = 10000000;
+    uint32_t nKeys = 4;
+    uint32_t i;
+    volatile BYTE sink = 0;
+    double t;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:k:")) != -1) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 0); break;
+        case 'k': nKeys = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "Usage: %s [-n iterations] [-k keys]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nKeys == 0 || nKeys > 127) {
+        fprintf(stderr, "Number of keys must be 1 to 127\n");
+        return 1;
+    }
+
+    testBasic();
+    if (errors == 0)
+        testRandom();
+    if (errors)
+        return 1;
+    printf("Status map tests OK, map size %d bytes\n", MAP_SIZE);
+
+    //Time put (ISR) followed by get (application), for given number of different addresses
+    for (i = 0; i < nKeys; i++)
+        keys[i] = (BYTE)((1 + (7*i) % 127) << 1);     //Different addresses, 1 to 127
+
+    memset(map, 0, sizeof(map));
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        statusMapSet(map, MAP_SIZE, keys[i % nKeys], (BYTE)i & 0x7f);
+        sink ^= statusMapTake(map, MAP_SIZE, keys[(i * 5) % nKeys]);
+    }
+    t = now() - t;
+    printf("Hash map     %6.1f ns per put/get, %u keys\n", t * 1e9 / iterations, nKeys);
+
+    memset(map, 0, sizeof(map));
+    t = now();
+    for (i = 0; i < iterations; i++) {
+        linearPut(map, keys[i % nKeys], (BYTE)i & 0x7f);
+        sink ^= linearGet(map, keys[(i * 5) % nKeys]);
+    }
+    t = now() - t;
+    printf("Linear map   %6.1f ns per put/get, %u keys\n", t * 1e9 / iterations, nKeys);
+
+    return (int)(sink & 0);
+}
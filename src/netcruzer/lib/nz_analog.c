@@ -37,9 +37,17 @@
 #include <string.h>
 #include "nz_analog.h"
 
+#if (ADC_STREAM_DECIMATION != 0) && defined(ADC_STREAM_USE_FIBER)
+#include "../rtos/nzos_fiber.h"
+#endif
+
 //Global variables
 ADC_INFO    adcInfo;        // physical I2C address
 
+#if (ADC_STREAM_DECIMATION != 0) && defined(ADC_STREAM_USE_FIBER)
+FIBER_TCB   fbrTcbAdcStream;
+#endif
+
 
 /**
  * ADC ISR
@@ -47,33 +55,46 @@ ADC_INFO    adcInfo;        // physical I2C address
 #if defined( __C30__ )
 void __attribute__((interrupt, no_auto_psv)) _ADC1Interrupt (void) {
     WORD* pSrc;
-    WORD* pSrcLast;
     WORD* pDst;
-    WORD mask=0x0001;
+    BYTE n;
 
     //Increment every ISR. Seeing that in worst case ISR shouldn't be called more than once per 100us, will only overflow after 100us x 6.5 seconds
     adcInfo.conversionCount++;
 
     //_ASAM = 0;     //Clear "Auto Sample" bit. Must be done so we can start it again
 
+#if (ADC_STREAM_DECIMATION != 0)
+    pDst = &adcInfo.ppBuf[adcInfo.ppFill][adcInfo.ppScan][0];  //Next scan of ping-pong buffer being filled
+#else
     pDst = &adcInfo.adcFilter[adcInfo.currentFilter][0];    //Address of first destination byte
+#endif
     //The line below brings error, use line below that. Should not bring error, seeing that "unsigned int" and WORD (unsigned short), are both a value from 0- 65535
     //pSrc = ((unsigned int *)(&ADC1BUF0));                 //Address of first source byte
     pSrc = ((WORD *)(&ADC1BUF0));                           //Address of first source byte
-    pSrcLast = ((WORD *)pSrc) + adcInfo.count;              //Address of last source byte
-#if (ADC_CHANNEL_MASK_HIGH == 0)
-    while (pSrc != pSrcLast) {
-        //Is channel pointed to by current pDst an active ADC channel
-        // - If so, copy data from ADC1BUFX to pDst
-        if ((adcInfo.channels.w[0] & mask) != 0) {
-            *pDst++ = *pSrc++;
+
+    //Scanned channels are placed in ADC1BUF0 to ADC1BUFn in order of channel number, same order as index
+    for (n = adcInfo.count; n != 0; n--) {
+        *pDst++ = *pSrc++;
+    }
+
+#if (ADC_STREAM_DECIMATION != 0)
+    if (++adcInfo.ppScan == ADC_STREAM_SCANS) {
+        adcInfo.ppScan = 0;
+
+        //Other buffer has not been processed yet by adcStreamTask(). Drop this one, and fill it again
+        if (adcInfo.ppReady & (0x01 << (adcInfo.ppFill ^ 0x01))) {
+            adcInfo.overruns++;
+        }
+        //Hand this buffer to adcStreamTask(), and start filling other buffer
+        else {
+            adcInfo.ppReady |= (0x01 << adcInfo.ppFill);
+            adcInfo.ppFill ^= 0x01;
+            #if defined(ADC_STREAM_USE_FIBER)
+            nzFbrSchedule(&fbrTcbAdcStream);
+            #endif
         }
-        mask = mask << 1;
     }
 #else
-    #error "ADC ISR not implemented for CPU with more than 16 channels"
-#endif
-
     if (++adcInfo.currentFilter == ADC_FILTER_STAGES) {
         adcInfo.currentFilter = 0;
 
@@ -82,6 +103,7 @@ void __attribute__((interrupt, no_auto_psv)) _ADC1Interrupt (void) {
         //and adcGetChMV() can now be called, and a valid value will be returned.
         adcInfo.flags.bDataValid = 1;
     }
+#endif
 
     //_ASAM = 1;    //Start next conversion sequence
     _AD1IF = 0;     //Clear interrupt flag
@@ -140,7 +162,7 @@ void __attribute((interrupt(ipl2), vector(_ADC_VECTOR), nomips16)) _ADC1Interrup
  */
 void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
 #if defined( __C30__ )
-    WORD mask;
+    DWORD mask;
     BYTE firstAdcChan;
     BYTE i,j;
     BYTE chanCount = 0;                 //Number of ports configured as ADC channels
@@ -151,6 +173,21 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
     adcInfo.flagsVal = 0;               //Clear all flags
     adcInfo.currentFilter = 0;
     adcInfo.conversionCount = 0;
+    #if (ADC_STREAM_DECIMATION != 0)
+    adcInfo.ppFill = 0;
+    adcInfo.ppScan = 0;
+    adcInfo.ppReady = 0;
+    adcInfo.decCount = 0;
+    adcInfo.overruns = 0;
+    memset(adcInfo.acc, 0, sizeof(adcInfo.acc));
+    memset(adcInfo.adcLatest, 0, sizeof(adcInfo.adcLatest));
+    #if defined(ADC_STREAM_USE_FIBER)
+    //Create fiber once, adcOpen() can be called again to change channels
+    if (fbrTcbAdcStream.pSchedule == NULL) {
+        nzFbrCreate(ADC_STREAM_FIBER_LEVEL, FALSE, &adcStreamTask, &fbrTcbAdcStream);
+    }
+    #endif
+    #endif
 
     //Ensure only channels that are possible for this hardware are defined in adcInfo.channels. Mask out all others
     adcInfo.channels.Val = adcChannels;     //Save ADC channels
@@ -158,22 +195,24 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
     adcInfo.channels.w[1] &= ADC_CHANNEL_MASK_HIGH;
 
     //Clear all ADC filter values
+    #if (ADC_STREAM_DECIMATION == 0)
     for (i=0; i<ADC_MAX_CHAN; i++) {
         for (j=0; j<ADC_FILTER_STAGES; j++)
             adcInfo.adcFilter[j][i] = 0;
     }
+    #endif
 
-    //Get channel of first ADC pin. Is a value from 0-15.
-    mask = 0x0001;
+    //Get channel of first ADC pin. Is a value from 0-31. Only first ADC_MAX_CHAN channels are used, and
+    //maximum 16, seeing that scan results are placed in the 16 word ADC1BUF0 to ADC1BUFF buffer.
+    mask = 0x00000001;
     firstAdcChan = 0xff;
-#if (ADC_CHANNEL_MASK_HIGH == 0)
-    for (i=0; i<16; i++) {
+    for (i=0; i<32; i++) {
         //Check if channel indicated by current mask is active
-        if ( (adcInfo.channels.w[0] & mask) != 0) {
+        if ( (adcInfo.channels.Val & mask) != 0) {
             //If we have already reached our maximum configured channels, clear all the rest
-            if (chanCount == ADC_MAX_CHAN) {
+            if ((chanCount == ADC_MAX_CHAN) || (chanCount == 16)) {
                 //Clear current channel. Is not used any more, only first ADC_MAX_CHAN are used!
-                adcInfo.channels.w[0] &= ~mask;
+                adcInfo.channels.Val &= ~mask;
             }
             //Increment channel count, and mark if first channel
             else {
@@ -185,27 +224,6 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
         }
         mask = mask << 1;
     }
-#else
-    j = 0;
-    for (i=0; i<32; i++) {
-        //Is ADC pin indicated by mask active
-        if ( (adcInfo.channels.w[j] & mask) != 0) {
-            chanCount++;
-            if (firstAdcChan==0xff) {
-                firstAdcChan = i;
-            }
-        }
-
-        //Prepare for checking second WORD (bits 17 to 31 of adcChanels)
-        if (i==15) {
-            mask = 0x0001;
-            j = 1;      //Point to second word
-        }
-        else {
-            mask = mask << 1;
-        }
-    }
-#endif
 
     adcInfo.count = chanCount;  //Store number of channels
 
@@ -218,15 +236,13 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
         //1=Analog mode, 0=Digital mode
         ANSB = adcInfo.channels.w[0];  //B0 - B15 = AN0 - AN15
     #elif defined(__PIC24FJ256GB210__)
-        // TODO add support for channels 16 to 23!!!!!!!!!!!!!!
         //These PICs have ANSx registers to select what Ports are Digital and what Analog
-        // TODO Implement AN16 to AN23 configuration
         //1=Analog mode, 0=Digital mode
-        ANSA = 0x0000;                  //A6, A7 = AN22, AN23
-        ANSB = adcInfo.channels.w[0];   //B0 - B15 = AN0 - AN15
-        ANSC = 0x0000;                  //C4 = AN16
-        ANSE = 0x0000;                  //E9 = AN21
-        ANSG = 0x0000;                  //G6 - G9 = AN17 - AN20
+        ANSA = adcInfo.channels.w[1] & 0x00C0;          //A6, A7 = AN22, AN23
+        ANSB = adcInfo.channels.w[0];                   //B0 - B15 = AN0 - AN15
+        ANSC = (adcInfo.channels.w[1] & 0x0001) << 4;   //C4 = AN16
+        ANSE = (adcInfo.channels.w[1] & 0x0020) << 4;   //E9 = AN21
+        ANSG = (adcInfo.channels.w[1] & 0x001E) << 5;   //G6 - G9 = AN17 - AN20
     #else
         #error "ADC channels not configured for selected CPU type!"
     #endif
@@ -245,9 +261,7 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
     //Configure ADC Channels to be included in scan
     AD1CSSL = adcInfo.channels.w[0];
 #if (ADC_CHANNEL_MASK_HIGH != 0)
-    #error "ADC ISR not implemented for CPU with more than 16 channels"
-    //Add support for PIC with more than 16 ADC channels
-    //???? = adcInfo.channels.w[1];
+    AD1CSSH = adcInfo.channels.w[1];    //AN16 to AN31
 #endif
 
     //There are no ADC ports, return
@@ -305,43 +319,28 @@ void adcOpenExtra(DWORD adcChannels, BYTE conversionClock, BYTE sampleTime) {
  * @return Returns index into ADC buffer for this channel. If 0xff, given channel is not enabled!
  */
 BYTE adcChanToIndex(BYTE chan) {
-    WORD mask;
-    BYTE i = 0;
+    DWORD mask;
     BYTE index = 0;
-    BOOL chanIsEnabled;
 
-    mask = 0x0001;
+    if (chan > 31) {
+        return 0xff;
+    }
 
-#if (ADC_CHANNEL_MASK_HIGH == 0)
-    while(1) {
-        chanIsEnabled = FALSE;
-        //Check if channel indicated by current mask is open
-        if ( (adcInfo.channels.w[0] & mask) != 0) {
-            chanIsEnabled = TRUE;
-            index++;
-        }
-        mask = mask << 1;
+    mask = ((DWORD)0x00000001) << chan;
 
-        //i currently points to given channel. If it is not enabled, return 0xff
-        if (i++ == chan) {
-            //If given channel is not enabled, return 0xff
-            if (chanIsEnabled==FALSE) {
-                return 0xff;
-            }
-            break;
-        }
+    //If given channel is not enabled, return 0xff
+    if ((adcInfo.channels.Val & mask) == 0) {
+        return 0xff;
     }
-#else
-    #error "adcChanToIndex() not implemented for CPU with more than 16 channels yet!"
-#endif
 
-    //At this stage, index should be 1 greater than index into buffer. If 0, given channel
-    //was not found - return 0xff
-    if (index == 0) {
-        return 0xff;
+    //Index is number of enabled channels bellow given channel
+    while ((mask >>= 1) != 0) {
+        if ((adcInfo.channels.Val & mask) != 0) {
+            index++;
+        }
     }
 
-    return index-1;
+    return index;
 }
 #endif
 
@@ -408,7 +407,10 @@ WORD adcReadChanMv(BYTE ch) {
  * @return Returns the given channel's 10-bit value. A WORD is returned with value from 0 - 1023.
  */
 WORD adcReadChanForIndex(BYTE index) {
-#if (ADC_FILTER_STAGES == 2)
+#if (ADC_STREAM_DECIMATION != 0)
+  //Written by adcStreamTask(), WORD write is atomic, no need to disable ADC interrupt
+  return adcInfo.adcLatest[index];
+#elif (ADC_FILTER_STAGES == 2)
   return ( (adcInfo.adcFilter[0][index] + adcInfo.adcFilter[1][index]) / 2);
 #elif (ADC_FILTER_STAGES == 4)
   return ( (adcInfo.adcFilter[0][index]
@@ -510,6 +512,13 @@ WORD adcConvertChan(BYTE ch, BYTE times) {
     WORD config2, config3;
     WORD ADCValue = 0;
 
+#if (ADC_STREAM_DECIMATION != 0)
+    //Continuous-scan mode, channel is already oversampled and decimated by adcStreamTask(). Don't stop scanning!
+    if (adcChanToIndex(ch) != 0xff) {
+        return adcReadChan(ch);
+    }
+#endif
+
 #if defined( __C30__ )
     _AD1IE = 0;     // Disable A/D conversion interrupt
     _ADON = 0;      //Turn ADC converter off
@@ -522,8 +531,13 @@ WORD adcConvertChan(BYTE ch, BYTE times) {
     if ((times!=2) && (times!=4) && (times!=8))
         times = 4;
 
+#if (ADC_CHANNEL_MASK_HIGH == 0)
     if (ch > 15)
         ch = 0;
+#else
+    if (ch > 31)
+        ch = 0;
+#endif
 
     //Save current values
     config2 = AD1CON2;
@@ -557,8 +571,10 @@ WORD adcConvertChan(BYTE ch, BYTE times) {
     _CH0SA = ch;     //Set selected ADC channel, these bits are IGNORED when scanning is enabled again at end of this function!
 
     //===== AD1CSSL =====
-    // TODO add support for channels 16 to 23!!!!!!!!!!!!!!
     AD1CSSL = 0;    //Do not scan any channels.
+#if (ADC_CHANNEL_MASK_HIGH != 0)
+    AD1CSSH = 0;
+#endif
 
     //The line below brings error, use line below that. Should not bring error, seeing that "unsigned int" and WORD (unsigned short), are both a value from 0- 65535
     //ADC16Ptr = (WORD*)&ADC1BUF1;  //initialize ADC1BUF pointer. Don't use ADC1BUF0, start at ADC1BUF1. ADC1BUF0 seem to often not be accurate
@@ -590,8 +606,10 @@ WORD adcConvertChan(BYTE ch, BYTE times) {
     AD1CON3 = config3;
 
     //Restore ADC Channels to be included in scan
-    // TODO add support for channels 16 to 23!!!!!!!!!!!!!!
     AD1CSSL = adcInfo.channels.w[0];
+#if (ADC_CHANNEL_MASK_HIGH != 0)
+    AD1CSSH = adcInfo.channels.w[1];
+#endif
 
 
 #if defined( __C30__ )
@@ -697,6 +715,55 @@ WORD adcConvertChanMvForIndex(BYTE index, BYTE times) {
 #endif
 
 
+#if (ADC_STREAM_DECIMATION != 0)
+/**
+ * Processes ping-pong buffer filled by ADC ISR. Decimates (moving average of ADC_STREAM_DECIMATION
+ * scans) each channel, and writes result to adcInfo.adcLatest[]. If set, each decimated result is also
+ * written to the log "Circular Buffer".
+ */
+void adcStreamTask(void) {
+    WORD* pSrc;
+    BYTE buf;
+    BYTE scan;
+    BYTE i;
+
+    //ISR only hands over a buffer when the other one is not ready, so at most one is ready
+    if (adcInfo.ppReady == 0) {
+        return;
+    }
+    buf = (adcInfo.ppReady & 0x01) ? 0 : 1;
+
+    pSrc = &adcInfo.ppBuf[buf][0][0];
+    for (scan=0; scan<ADC_STREAM_SCANS; scan++) {
+        for (i=0; i<adcInfo.count; i++) {
+            adcInfo.acc[i] += pSrc[i];
+        }
+        pSrc += ADC_MAX_CHAN;
+
+        //Got ADC_STREAM_DECIMATION scans, publish result
+        if (++adcInfo.decCount == ADC_STREAM_DECIMATION) {
+            adcInfo.decCount = 0;
+            for (i=0; i<adcInfo.count; i++) {
+                adcInfo.adcLatest[i] = (adcInfo.acc[i] + (ADC_STREAM_DECIMATION/2)) / ADC_STREAM_DECIMATION;
+                adcInfo.acc[i] = 0;
+            }
+            adcInfo.flags.bDataValid = 1;
+
+            //Log all channels, 2 bytes (LSB first) per channel. Record is dropped if buffer does not have space for it.
+            if ((adcInfo.pCbufLog != NULL) && (cbufGetFree(adcInfo.pCbufLog) >= (adcInfo.count*2))) {
+                cbufPutArray(adcInfo.pCbufLog, (BYTE*)adcInfo.adcLatest, adcInfo.count*2);
+            }
+        }
+    }
+
+    //Give buffer back to ISR
+    _AD1IE = 0;
+    adcInfo.ppReady &= ~(0x01 << buf);
+    _AD1IE = 1;
+}
+#endif
+
+
 /**
  * Stop current ADC conversion. All partially converted data is lost.
  */
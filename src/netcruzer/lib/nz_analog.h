@@ -43,6 +43,18 @@
  #define ADC_NO_MV_FUNCTIONS                                //No millivolt functions included
  #define ADC_NO_CONVERT_FUNCTIONS                           //No convert functions included
  #define ADC_NO_CHAN_FUNCTIONS                              //Don't support any channel functions - use indexed functions
+
+ //Continuous-scan streaming mode. When not 0, the filter stages are not used. The ADC ISR copies each scan to
+ //ping-pong buffers, and adcStreamTask() decimates (averages) this many scans per result. Maximum is 64.
+ #define ADC_STREAM_DECIMATION                  ( 0 )       //[-DEFAULT-]
+
+ //Number of scans in each ping-pong buffer. Requires 2 x ADC_STREAM_SCANS x ADC_MAX_CHAN words.
+ #define ADC_STREAM_SCANS                       ( 4 )       //[-DEFAULT-]
+
+ //If defined, adcStreamTask() is run as a fiber scheduled by the ADC ISR. Requires nzosFIBER_ENABLE==1. Else
+ //adcStreamTask() must be called by the application, or is called every 1ms by nzSysTaskDefault().
+ //#define ADC_STREAM_USE_FIBER
+ #define ADC_STREAM_FIBER_LEVEL                 ( 0 )       //[-DEFAULT-]
  
  @endcode
  **********************************************************************
@@ -73,6 +85,8 @@
 
 #if defined(HAS_NZ_ADC)
 
+#include "nz_circularBuffer.h"
+
 /**
  * Convert given millivolt value to 10-bit ADC value
  */
@@ -103,6 +117,28 @@
 #define ADC_CHANNEL_MASK_HIGH  ADC_CHANNEL_MASK_HIGH_BRD
 #endif
 
+//Number of scans averaged for each streamed result. 0 disables continuous-scan streaming mode.
+#ifndef ADC_STREAM_DECIMATION
+#define ADC_STREAM_DECIMATION 0
+#endif
+
+//Number of scans in each ping-pong buffer
+#ifndef ADC_STREAM_SCANS
+#define ADC_STREAM_SCANS 4
+#endif
+
+#ifndef ADC_STREAM_FIBER_LEVEL
+#define ADC_STREAM_FIBER_LEVEL 0
+#endif
+
+#if (ADC_STREAM_DECIMATION > 64)
+#error "ADC_STREAM_DECIMATION can not be more than 64"
+#endif
+
+#if (ADC_STREAM_DECIMATION != 0) && defined(ADC_STREAM_USE_FIBER) && (nzosFIBER_ENABLE != 1)
+#error "ADC_STREAM_USE_FIBER requires nzosFIBER_ENABLE"
+#endif
+
 
 /**
  * Structure containing information on ADC channels
@@ -131,7 +167,19 @@ typedef struct __attribute__((aligned(2), packed))
 
     //Array of ADC filters. For each channel, ADC_FILTER_STAGES WORDs are reserved. Only used channels require
     //reserved adcFilter positions
+    #if (ADC_STREAM_DECIMATION == 0)
     WORD        adcFilter[ADC_FILTER_STAGES][ADC_MAX_CHAN];
+    #else
+    WORD        ppBuf[2][ADC_STREAM_SCANS][ADC_MAX_CHAN];   //Ping-pong buffers, filled by ISR
+    WORD        acc[ADC_MAX_CHAN];              //Decimation accumulators, used by adcStreamTask()
+    WORD        adcLatest[ADC_MAX_CHAN];        //Latest decimated value of each channel
+    CIRBUF*     pCbufLog;                       //Optional log buffer for decimated values, NULL if not used
+    BYTE        ppFill;                         //Ping-pong buffer being filled by ISR, 0 or 1
+    BYTE        ppScan;                         //Next scan of ppBuf[ppFill] to fill
+    BYTE        ppReady;                        //Bit 0 and 1 set if ppBuf[0] and [1] are ready for adcStreamTask()
+    BYTE        decCount;                       //Number of scans added to acc[]
+    WORD        overruns;                       //Number of ping-pong buffers dropped, adcStreamTask() too slow
+    #endif
 
     WORD        conversionCount;                //Free running counter, get's incremented with each ISR
 } ADC_INFO;
@@ -398,6 +446,28 @@ WORD adcConvertChanMvForIndex(BYTE index, BYTE times);
  */
 #define adcGetConversionCount() (adcInfo.conversionCount)
 
+#if (ADC_STREAM_DECIMATION != 0)
+/**
+ * Processes ping-pong buffers filled by the ADC ISR, and updates the decimated channel values. Is
+ * scheduled as a fiber by the ADC ISR if ADC_STREAM_USE_FIBER is defined, else must be called
+ * regularly. Must be called at least every (ADC_STREAM_SCANS x scan time), or scans are dropped.
+ */
+void adcStreamTask(void);
+
+/**
+ * Set "Circular Buffer" that decimated values are written to. For each result, 2 bytes (LSB first) are
+ * written for each channel, in index order. Results are dropped if buffer has no space.
+ *
+ * @param pBuf Pointer to Circular Buffer, or NULL to stop logging
+ */
+#define adcStreamSetCirbuf(pBuf) (adcInfo.pCbufLog = (pBuf))
+
+/**
+ * Get number of ping-pong buffers dropped because adcStreamTask() was not called in time.
+ */
+#define adcStreamGetOverruns() (adcInfo.overruns)
+#endif
+
 /**
  * Get number of filter stages for ADC. If a ADC input changes, we have to wait for ISR to trigger this many times (adcGetConversionCount())
  * before value returned by adcReadChan() and adcReadChanMv() are valid.
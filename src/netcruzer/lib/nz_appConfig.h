@@ -27,6 +27,13 @@
 //If a bootloader is not used, it has to be define in code, and copied to the external Flash.
 #define CFG_STRUCT_IN_CODE
 
+//Uncomment to use the log structured config store, see @ref info_conf_app_log "Config Log". The CFG_COPY area of
+//the external EEPROM is used for the log, and a RAM copy of CFG_STRUCT is kept. Default is disabled.
+//#define NZ_APP_CONFIG_LOG_ENABLED
+
+//Size of RAM copy of CFG_STRUCT when NZ_APP_CONFIG_LOG_ENABLED is defined. Default is size of CFG_STRUCT.
+#define CFG_LOG_SHADOW_SIZE     ( sizeof(CFG_STRUCT) )  //[-DEFAULT-]
+
  @endcode
  *
  *
@@ -381,6 +388,46 @@ typedef struct __attribute__((packed))
 } CFG_COPY;
 
 
+/**
+ * @section info_conf_app_log Config Log
+ * When NZ_APP_CONFIG_LOG_ENABLED is defined, CFG_STRUCT is not updated in place. A RAM copy (shadow) of
+ * CFG_STRUCT is kept, and cfgGetArray() reads from it. cfgSaveArray() only compares given data to the shadow,
+ * and appends a record for each changed run of bytes to the log. The log uses the CFG_COPY area of the
+ * external EEPROM as a circular buffer, so all pages of it are worn evenly. Records are assembled in a RAM
+ * page buffer, and written in page aligned bursts. cfgBeginBatch() and cfgEndBatch() can be used to combine
+ * multiple cfgSaveArray() calls in the same bursts.
+ *
+ * Each log generation starts at a page boundary with a "Generation Start" record. When the log is full,
+ * it is garbage collected. All changed CFG_STRUCT pages are written to the external EEPROM, and a new
+ * generation is started on the next page. Records of older generations are ignored. On startup, CFG_STRUCT
+ * is read into the shadow, and all records of the newest generation are applied to it. If power fails
+ * during garbage collection, the previous generation is still valid, and is simply applied again.
+ *
+ * The format of each record is a CFG_LOG_REC_HDR, followed by 0 to CFG_LOG_REC_DATA_MAX bytes of data. The
+ * CRC is a CRC-16 (CCITT) of the header (excluding the crc member) and data.
+ */
+typedef struct __attribute__((packed))
+{
+    BYTE        magic;          /// Always CFG_LOG_REC_MAGIC
+    BYTE        len;            /// Number of data bytes following header
+    WORD        gen;            /// Generation this record belongs to
+    WORD        offset;         /// Offset in CFG_STRUCT of data, or CFG_LOG_OFS_XXX for special records
+    WORD        crc;            /// CRC-16 of header and data
+} CFG_LOG_REC_HDR;
+#define CFG_LOG_REC_MAGIC       0xA5
+#define CFG_LOG_REC_DATA_MAX    (XEEPROM_PAGE_SIZE - sizeof(CFG_LOG_REC_HDR))
+#define CFG_LOG_OFS_GEN_START   0xFFFF  /* Generation Start record, is always on a page boundary */
+#define CFG_LOG_OFS_WRAP        0xFFFE  /* Next record is at start of log */
+
+#define CFG_LOG_START_ADR       XEEMEM_CFG_COPY_START_ADR
+#define CFG_LOG_STOP_ADR        XEEMEM_CFG_COPY_STOP_ADR
+#define CFG_LOG_SIZE            (CFG_LOG_STOP_ADR - CFG_LOG_START_ADR)
+
+#if !defined(CFG_LOG_SHADOW_SIZE)
+#define CFG_LOG_SHADOW_SIZE     (sizeof(CFG_STRUCT))
+#endif
+
+
 /**
  * @preCondition  fsysInit() is already called.
  */
@@ -497,6 +544,19 @@ void cfgSaveByte(WORD offset, BYTE val);
  */
 void cfgSaveArray(WORD offsetCfg, BYTE* buf, WORD length);
 
+#if defined(NZ_APP_CONFIG_LOG_ENABLED)
+/**
+ * Start a batch of cfgSaveArray() calls. Log records are only written to the external EEPROM when a page
+ * is full, or when cfgEndBatch() is called. Calls can be nested.
+ */
+void cfgBeginBatch(void);
+
+/**
+ * End a batch of cfgSaveArray() calls started with cfgBeginBatch(). Writes all pending log records.
+ */
+void cfgEndBatch(void);
+#endif
+
 /**
  * Save Application Configuartion data to EEPROM
  */
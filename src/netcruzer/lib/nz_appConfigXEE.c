@@ -46,6 +46,7 @@
 #include "nz_xFlash.h"
 #include "nz_helpers.h"
 #include "nz_helpersCx.h"
+#include "nz_crc.h"
 #include "nz_xflashDefsSbc66.h"
 
 #include "appConfig.h"
@@ -65,9 +66,29 @@ WORD            cfgCopyNextAdr;     //Address of where next CFG_COPY block must
 FIRMWARE_FLAGS  firmwareFlags;
 
 
+#if defined(NZ_APP_CONFIG_LOG_ENABLED)
+#define CFG_LOG_DIRTY_PAGES  ((CFG_LOG_SHADOW_SIZE + XEEPROM_PAGE_SIZE - 1) / XEEPROM_PAGE_SIZE)
+
+static BYTE cfgShadow[CFG_LOG_SHADOW_SIZE];         //RAM copy of CFG_STRUCT, with all log records applied
+static BYTE cfgDirty[(CFG_LOG_DIRTY_PAGES+7)/8];    //Bit for each CFG_STRUCT page that differs from external EEPROM
+static BYTE logPage[XEEPROM_PAGE_SIZE];             //Log page currently being appended to
+static WORD logPageAdr;     //External EEPROM address of logPage
+static BYTE logPageFill;    //Number of bytes used in logPage, rest is 0xff
+static BYTE logPageWrFrom;  //First byte of logPage not written to external EEPROM yet
+static WORD logStart;       //Address of "Generation Start" record of current generation
+static WORD logGen;         //Current generation
+static BYTE logBatch;       //Nesting count of cfgBeginBatch()
+
+#define cfgLogPut() (logPageAdr + logPageFill)  //Address where next log record is written
+#endif
+
+
 /////////////////////////////////////////////////
 //Function Prototypes
 void cfgInitCopy(void);
+#if defined(NZ_APP_CONFIG_LOG_ENABLED)
+static void cfgLogInit(void);
+#endif
 
 
 /**
@@ -206,8 +227,10 @@ void cfgInit(BYTE* pCfgStruct)
     if (cfgIsXeepromValid()) {
         DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nXEE Valid");
 
-        //Check "Config Copy" area of external EEPROM.
+        //Check "Config Copy" area of external EEPROM. Is used for the log if NZ_APP_CONFIG_LOG_ENABLED
+        #if !defined(NZ_APP_CONFIG_LOG_ENABLED)
         cfgInitCopy();
+        #endif
     }
     //External EEPROM does NOT contains valid EEPROM data. Restore with default data.
     else {
@@ -254,6 +277,11 @@ void cfgInit(BYTE* pCfgStruct)
         #endif
 
     }
+
+    //Read CFG_STRUCT into RAM, and apply log
+    #if defined(NZ_APP_CONFIG_LOG_ENABLED)
+    cfgLogInit();
+    #endif
 }
 
 
@@ -555,6 +583,14 @@ BYTE cfgBlkGetArray(WORD cfgBlkId, WORD offset, BYTE* buf, BYTE length) {
  *
  */
 BYTE cfgGetArray(WORD offset, BYTE* buf, BYTE length) {
+    #if defined(NZ_APP_CONFIG_LOG_ENABLED)
+    //Read from RAM copy, external EEPROM does not contain log records
+    if ((offset + length) <= CFG_LOG_SHADOW_SIZE) {
+        memcpy(buf, &cfgShadow[offset], length);
+        return length;
+    }
+    #endif
+
     //Read array of data from external EEPROM
     xeeReadArray(XEEMEM_CFG_STRUCT_START_ADR + offset, buf, length);
 
@@ -586,6 +622,7 @@ void cfgSaveByte(WORD offset, BYTE val) {
  * @param buf Source array of data to save
  * @param length Number of bytes to save
  */
+#if !defined(NZ_APP_CONFIG_LOG_ENABLED)
 void cfgSaveArray(WORD offsetCfg, BYTE* buf, WORD length) {
     #define LOOP_COUNT_BLOCKS   0
     #define LOOP_WRITE_CONFIG   1
@@ -857,6 +894,7 @@ void cfgSaveArray(WORD offsetCfg, BYTE* buf, WORD length) {
     if (reading)
         xeeEndRead();
 }
+#endif  //#if !defined(NZ_APP_CONFIG_LOG_ENABLED)
 
 /**
  * Save Application Configuartion data to EEPROM
@@ -893,4 +931,337 @@ void cfgInvalidateXeeprom(void)
     xeeEndWrite();
 }
 
+
+#if defined(NZ_APP_CONFIG_LOG_ENABLED)
+/**
+ * Reads the log record at given address, and checks it is valid. The generation is NOT checked.
+ *
+ * @param adr External EEPROM address of record
+ * @param rec Buffer to read record into, header followed by data
+ *
+ * @return TRUE if a valid record was read
+ */
+static BOOL cfgLogReadRecord(WORD adr, BYTE* rec) {
+    CFG_LOG_REC_HDR* pHdr = (CFG_LOG_REC_HDR*)rec;
+    WORD crc;
+
+    if ((CFG_LOG_STOP_ADR - adr) < sizeof(CFG_LOG_REC_HDR))
+        return FALSE;
+    xeeReadArray(adr, rec, sizeof(CFG_LOG_REC_HDR));
+
+    if ((pHdr->magic != CFG_LOG_REC_MAGIC) || (pHdr->len > CFG_LOG_REC_DATA_MAX)
+            || ((CFG_LOG_STOP_ADR - adr) < (sizeof(CFG_LOG_REC_HDR) + pHdr->len)))
+        return FALSE;
+
+    //Data records must be within CFG_STRUCT
+    if ((pHdr->offset < CFG_LOG_OFS_WRAP) && ((pHdr->offset + pHdr->len) > CFG_LOG_SHADOW_SIZE))
+        return FALSE;
+
+    if (pHdr->len != 0) {
+        xeeReadArray(adr + sizeof(CFG_LOG_REC_HDR), &rec[sizeof(CFG_LOG_REC_HDR)], pHdr->len);
+    }
+
+    crc = crc16CcittUpdate(0xffff, rec, offsetof(CFG_LOG_REC_HDR, crc));
+    crc = crc16CcittUpdate(crc, &rec[sizeof(CFG_LOG_REC_HDR)], pHdr->len);
+    return (crc == pHdr->crc);
+}
+
+
+/**
+ * Mark the CFG_STRUCT pages containing given range as changed.
+ */
+static void cfgLogSetDirty(WORD offset, WORD len) {
+    WORD page;
+
+    for (page = offset / XEEPROM_PAGE_SIZE; page <= ((offset + len - 1) / XEEPROM_PAGE_SIZE); page++) {
+        cfgDirty[page >> 3] |= (0x01 << (page & 0x07));
+    }
+}
+
+
+/**
+ * Writes all bytes of logPage not written yet, up to the end of the page. Is a single page write.
+ * Unused bytes at end of page are 0xff, and mark the end of the log.
+ */
+static void cfgLogFlushPage(void) {
+    if (logPageWrFrom < logPageFill) {
+        xeeBeginWrite(logPageAdr + logPageWrFrom);
+        xeeWriteArray(&logPage[logPageWrFrom], XEEPROM_PAGE_SIZE - logPageWrFrom);
+        logPageWrFrom = logPageFill;
+    }
+}
+
+
+/**
+ * Start appending to given page of the log.
+ */
+static void cfgLogSetPage(WORD adr) {
+    logPageAdr = adr;
+    logPageFill = 0;
+    logPageWrFrom = 0;
+    memset(logPage, 0xff, sizeof(logPage));
+}
+
+
+/**
+ * Append given bytes to log. Full pages are written to the external EEPROM.
+ */
+static void cfgLogPutBytes(BYTE* p, BYTE len) {
+    while (len-- != 0) {
+        logPage[logPageFill++] = *p++;
+
+        if (logPageFill == XEEPROM_PAGE_SIZE) {
+            cfgLogFlushPage();
+            cfgLogSetPage(((logPageAdr + XEEPROM_PAGE_SIZE) >= CFG_LOG_STOP_ADR) ? CFG_LOG_START_ADR : (logPageAdr + XEEPROM_PAGE_SIZE));
+        }
+    }
+}
+
+
+/**
+ * Append a record to the log.
+ *
+ * @param offset Offset in CFG_STRUCT, or CFG_LOG_OFS_XXX
+ * @param pData Data of record
+ * @param len Number of bytes in pData, maximum CFG_LOG_REC_DATA_MAX
+ */
+static void cfgLogPutRecord(WORD offset, BYTE* pData, BYTE len) {
+    CFG_LOG_REC_HDR hdr;
+
+    //Records are not split at end of log. Add "Wrap" record if there is space for it, and continue at start of log
+    if ((CFG_LOG_STOP_ADR - cfgLogPut()) < (sizeof(CFG_LOG_REC_HDR) + len)) {
+        if ((CFG_LOG_STOP_ADR - cfgLogPut()) >= sizeof(CFG_LOG_REC_HDR)) {
+            cfgLogPutRecord(CFG_LOG_OFS_WRAP, NULL, 0);
+        }
+        if (cfgLogPut() != CFG_LOG_START_ADR) {
+            cfgLogFlushPage();
+            cfgLogSetPage(CFG_LOG_START_ADR);
+        }
+    }
+
+    hdr.magic = CFG_LOG_REC_MAGIC;
+    hdr.len = len;
+    hdr.gen = logGen;
+    hdr.offset = offset;
+    hdr.crc = crc16CcittUpdate(0xffff, (BYTE*)&hdr, offsetof(CFG_LOG_REC_HDR, crc));
+    hdr.crc = crc16CcittUpdate(hdr.crc, pData, len);
+
+    cfgLogPutBytes((BYTE*)&hdr, sizeof(hdr));
+    cfgLogPutBytes(pData, len);
+}
+
+
+/**
+ * Get number of bytes used by current generation of the log.
+ */
+static WORD cfgLogUsed(void) {
+    return (cfgLogPut() >= logStart) ? (cfgLogPut() - logStart) : (CFG_LOG_SIZE - (logStart - cfgLogPut()));
+}
+
+
+/**
+ * Start a new log generation at logPageAdr, which must be the start of an unused page.
+ */
+static void cfgLogStartGen(void) {
+    logStart = logPageAdr;
+    cfgLogPutRecord(CFG_LOG_OFS_GEN_START, NULL, 0);
+    cfgLogFlushPage();
+}
+
+
+/**
+ * Garbage collect the log. All changed pages of the shadow are written to CFG_STRUCT in the external
+ * EEPROM, after which a new generation is started on the next page of the log.
+ */
+static void cfgLogCompact(void) {
+    WORD page;
+    WORD ofs;
+
+    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nCfgLog compact");
+
+    cfgLogFlushPage();
+
+    //Write changed CFG_STRUCT pages. Previous generation is still valid if power fails now
+    for (page = 0; page < CFG_LOG_DIRTY_PAGES; page++) {
+        if (cfgDirty[page >> 3] & (0x01 << (page & 0x07))) {
+            ofs = page * XEEPROM_PAGE_SIZE;
+            xeeBeginWrite(XEEMEM_CFG_STRUCT_START_ADR + ofs);
+            xeeWriteArray(&cfgShadow[ofs], ((CFG_LOG_SHADOW_SIZE - ofs) < XEEPROM_PAGE_SIZE) ? (CFG_LOG_SHADOW_SIZE - ofs) : XEEPROM_PAGE_SIZE);
+        }
+    }
+    memset(cfgDirty, 0, sizeof(cfgDirty));
+
+    //Start new generation on next page, so log pages are used in turn
+    logGen++;
+    cfgLogSetPage(((logPageAdr + XEEPROM_PAGE_SIZE) >= CFG_LOG_STOP_ADR) ? CFG_LOG_START_ADR : (logPageAdr + XEEPROM_PAGE_SIZE));
+    cfgLogStartGen();
+}
+
+
+/**
+ * Read CFG_STRUCT into RAM shadow, find newest log generation, and apply all it's records.
+ */
+static void cfgLogInit(void) {
+    BYTE rec[XEEPROM_PAGE_SIZE];
+    CFG_LOG_REC_HDR* pHdr = (CFG_LOG_REC_HDR*)rec;
+    WORD adr;
+    WORD count;
+    BOOL found = FALSE;
+
+    logBatch = 0;
+    memset(cfgDirty, 0, sizeof(cfgDirty));
+    xeeReadArray(XEEMEM_CFG_STRUCT_START_ADR, cfgShadow, CFG_LOG_SHADOW_SIZE);
+
+    //Find newest "Generation Start" record. Are always at start of a page
+    for (adr = CFG_LOG_START_ADR; adr < CFG_LOG_STOP_ADR; adr += XEEPROM_PAGE_SIZE) {
+        if (cfgLogReadRecord(adr, rec) && (pHdr->offset == CFG_LOG_OFS_GEN_START)) {
+            if ((found == FALSE) || (((short)(pHdr->gen - logGen)) > 0)) {
+                found = TRUE;
+                logGen = pHdr->gen;
+                logStart = adr;
+            }
+        }
+    }
+
+    //No log found, start first generation
+    if (found == FALSE) {
+        DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nCfgLog new");
+        logGen = 0;
+        cfgLogSetPage(CFG_LOG_START_ADR);
+        cfgLogStartGen();
+        return;
+    }
+
+    //Apply all records of current generation. Stop at first invalid record, or record of other generation.
+    adr = logStart + sizeof(CFG_LOG_REC_HDR);
+    for (count = 0; count < CFG_LOG_SIZE; count += (sizeof(CFG_LOG_REC_HDR) + pHdr->len)) {
+        if ((CFG_LOG_STOP_ADR - adr) < sizeof(CFG_LOG_REC_HDR))
+            adr = CFG_LOG_START_ADR;
+        if ((adr == logStart) || !cfgLogReadRecord(adr, rec) || (pHdr->gen != logGen) || (pHdr->offset == CFG_LOG_OFS_GEN_START))
+            break;
+
+        if (pHdr->offset == CFG_LOG_OFS_WRAP) {
+            adr = CFG_LOG_START_ADR;
+            continue;
+        }
+
+        memcpy(&cfgShadow[pHdr->offset], &rec[sizeof(CFG_LOG_REC_HDR)], pHdr->len);
+        cfgLogSetDirty(pHdr->offset, pHdr->len);
+        adr += (sizeof(CFG_LOG_REC_HDR) + pHdr->len);
+    }
+
+    //Continue appending at end of log. Bytes before it in the page have already been written
+    if (adr >= CFG_LOG_STOP_ADR)
+        adr = CFG_LOG_START_ADR;
+    cfgLogSetPage(adr & ~(XEEPROM_PAGE_SIZE-1));
+    logPageFill = logPageWrFrom = (BYTE)(adr - logPageAdr);
+
+    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nCfgLog gen=");
+    DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, logGen);
+    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, " used=");
+    DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, cfgLogUsed());
+}
+
+
+/**
+ * Finds the next run of changed bytes in given array, starting at *pStart. Runs closer together than a
+ * record header are merged, and a run is never longer than CFG_LOG_REC_DATA_MAX.
+ *
+ * @param offsetCfg Offset in CFG_STRUCT of given array
+ * @param buf Given array
+ * @param length Length of buf
+ * @param pStart Input is where to start searching, returns start of run
+ *
+ * @return Length of run, or 0 if no more changed bytes
+ */
+static BYTE cfgLogNextRun(WORD offsetCfg, BYTE* buf, WORD length, WORD* pStart) {
+    WORD i;
+    WORD runEnd;
+
+    for (i = *pStart; (i < length) && (cfgShadow[offsetCfg + i] == buf[i]); i++);
+    if (i >= length)
+        return 0;
+
+    *pStart = i;
+    runEnd = i + 1;
+    for (i++; (i < length) && ((i - *pStart) < CFG_LOG_REC_DATA_MAX); i++) {
+        if (cfgShadow[offsetCfg + i] != buf[i])
+            runEnd = i + 1;
+        else if ((i - runEnd) >= sizeof(CFG_LOG_REC_HDR))
+            break;
+    }
+    return (BYTE)(runEnd - *pStart);
+}
+
+
+/**
+ * Saves the given array to CFG_STRUCT. Only changed bytes are saved, by appending records to the
+ * log. The external EEPROM is not read.
+ *
+ * @param offsetCfg Contains the offset in CFG_STRUCT of given array
+ * @param buf Source array of data to save
+ * @param length Number of bytes to save
+ */
+void cfgSaveArray(WORD offsetCfg, BYTE* buf, WORD length) {
+    WORD start;
+    WORD needed;
+    BYTE len;
+
+    if ((offsetCfg + length) > CFG_LOG_SHADOW_SIZE) {
+        DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\ncfgSaveArray() outside shadow!");
+        return;
+    }
+
+    //Get log space required for all records, so they are all written in the same generation
+    needed = 0;
+    for (start = 0; (len = cfgLogNextRun(offsetCfg, buf, length, &start)) != 0; start += len) {
+        needed += sizeof(CFG_LOG_REC_HDR) + len;
+    }
+    if (needed == 0) {
+        DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nNthng to save");
+        return;
+    }
+
+    //Leave a page free for "Wrap" record waste, and so new generation never starts on a used page
+    if ((cfgLogUsed() + needed + (2*XEEPROM_PAGE_SIZE)) > CFG_LOG_SIZE) {
+        //Too large for log, write directly to CFG_STRUCT
+        if ((needed + (3*XEEPROM_PAGE_SIZE)) > CFG_LOG_SIZE) {
+            memcpy(&cfgShadow[offsetCfg], buf, length);
+            cfgLogSetDirty(offsetCfg, length);
+        }
+        cfgLogCompact();
+        if (memcmp(&cfgShadow[offsetCfg], buf, length) == 0)
+            return;
+    }
+
+    for (start = 0; (len = cfgLogNextRun(offsetCfg, buf, length, &start)) != 0; start += len) {
+        cfgLogPutRecord(offsetCfg + start, &buf[start], len);
+        memcpy(&cfgShadow[offsetCfg + start], &buf[start], len);
+        cfgLogSetDirty(offsetCfg + start, len);
+    }
+
+    if (logBatch == 0) {
+        cfgLogFlushPage();
+    }
+}
+
+
+/**
+ * Start a batch of cfgSaveArray() calls.
+ */
+void cfgBeginBatch(void) {
+    logBatch++;
+}
+
+
+/**
+ * End a batch of cfgSaveArray() calls, and write all pending log records.
+ */
+void cfgEndBatch(void) {
+    if ((logBatch != 0) && (--logBatch == 0)) {
+        cfgLogFlushPage();
+    }
+}
+#endif  //#if defined(NZ_APP_CONFIG_LOG_ENABLED)
+
 #endif  //#if defined(NZ_APP_CONFIG_XEE_ENABLED)
\ No newline at end of file
@@ -0,0 +1,418 @@
+/**
+ * @brief           CRC-8, CRC-16 and CRC-32 functions
+ * @file            nz_crc.c
+ * @author          <a href="www.modtronix.com">Modtronix Engineering</a>
+ * @compiler        MPLAB XC16 compiler
+ *
+ **********************************************************************
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ **********************************************************************
+ * File History
+ *
+ * 2026-10-19:
+ *    - Initial version, table driven and slice-by-8 CRC functions. Used by the 1-Wire driver, configuration
+ *      log, MiWi crc.c, Deflate and the USB HID bootloader
+ *********************************************************************/
+#define THIS_IS_NZ_CRC_C
+
+//The host benchmark (host/nz_crcBench.c) defines NZ_CRC_HOST, and the BYTE, WORD and DWORD types
+#if !defined(NZ_CRC_HOST)
+#include "HardwareProfile.h"
+#endif
+
+#include "nz_crc.h"
+
+
+/////////////////////////////////////////////////
+// CRC-8 Dallas/Maxim, reflected polynomial 0x8C
+#if (NZ_CRC_TABLE_SIZE == 256)
+static const BYTE crc8Table[256] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+#elif (NZ_CRC_TABLE_SIZE == 16)
+static const BYTE crc8Table[16] = {
+    0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8, 0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+#endif
+
+#if defined(NZ_CRC8_SLICE8)
+static BYTE crc8Slice[7][256];  //Tables 1 to 7 for slice-by-8, table 0 is crc8Table
+static BYTE crc8SliceInit;
+#endif
+
+/**
+ * Update given CRC-8 Dallas/Maxim with given data.
+ */
+BYTE crc8Update(BYTE crc, const BYTE* p, WORD len) {
+    #if defined(NZ_CRC8_SLICE8)
+    WORD i;
+    BYTE k;
+
+    //Create slice tables the first time. Table k gives the CRC of a byte followed by k zero bytes
+    if (crc8SliceInit == 0) {
+        for (i = 0; i < 256; i++) {
+            crc8Slice[0][i] = crc8Table[crc8Table[i]];
+            for (k = 1; k < 7; k++) {
+                crc8Slice[k][i] = crc8Table[crc8Slice[k - 1][i]];
+            }
+        }
+        crc8SliceInit = 1;
+    }
+
+    while (len >= 8) {
+        crc = crc8Slice[6][crc ^ p[0]] ^ crc8Slice[5][p[1]] ^ crc8Slice[4][p[2]] ^ crc8Slice[3][p[3]]
+            ^ crc8Slice[2][p[4]] ^ crc8Slice[1][p[5]] ^ crc8Slice[0][p[6]] ^ crc8Table[p[7]];
+        p += 8;
+        len -= 8;
+    }
+    #endif
+
+    while (len-- != 0) {
+        #if (NZ_CRC_TABLE_SIZE == 256)
+        crc = crc8Table[crc ^ *p++];
+        #elif (NZ_CRC_TABLE_SIZE == 16)
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc8Table[crc & 0x0f];
+        crc = (crc >> 4) ^ crc8Table[crc & 0x0f];
+        #else
+        BYTE i;
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+        }
+        #endif
+    }
+    return crc;
+}
+
+
+/////////////////////////////////////////////////
+// CRC-16 CCITT, polynomial 0x1021, MSB first
+#if (NZ_CRC_TABLE_SIZE == 256)
+static const WORD crc16CcittTable[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+#elif (NZ_CRC_TABLE_SIZE == 16)
+static const WORD crc16CcittTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+#endif
+
+#if defined(NZ_CRC16_CCITT_SLICE8)
+static WORD crc16CcittSlice[7][256];    //Tables 1 to 7 for slice-by-8, table 0 is crc16CcittTable
+static BYTE crc16CcittSliceInit;
+#endif
+
+/**
+ * Update given CRC-16 CCITT with given data.
+ */
+WORD crc16CcittUpdate(WORD crc, const BYTE* p, WORD len) {
+    #if defined(NZ_CRC16_CCITT_SLICE8)
+    WORD i;
+    BYTE k;
+
+    //Create slice tables the first time. Table k gives the CRC of a byte followed by k zero bytes
+    if (crc16CcittSliceInit == 0) {
+        for (i = 0; i < 256; i++) {
+            crc16CcittSlice[0][i] = (crc16CcittTable[i] << 8) ^ crc16CcittTable[crc16CcittTable[i] >> 8];
+            for (k = 1; k < 7; k++) {
+                crc16CcittSlice[k][i] = (crc16CcittSlice[k - 1][i] << 8) ^ crc16CcittTable[crc16CcittSlice[k - 1][i] >> 8];
+            }
+        }
+        crc16CcittSliceInit = 1;
+    }
+
+    while (len >= 8) {
+        crc ^= (((WORD)p[0]) << 8) | p[1];
+        crc = crc16CcittSlice[6][crc >> 8] ^ crc16CcittSlice[5][crc & 0xff] ^ crc16CcittSlice[4][p[2]]
+            ^ crc16CcittSlice[3][p[3]] ^ crc16CcittSlice[2][p[4]] ^ crc16CcittSlice[1][p[5]]
+            ^ crc16CcittSlice[0][p[6]] ^ crc16CcittTable[p[7]];
+        p += 8;
+        len -= 8;
+    }
+    #endif
+
+    while (len-- != 0) {
+        #if (NZ_CRC_TABLE_SIZE == 256)
+        crc = (crc << 8) ^ crc16CcittTable[(crc >> 8) ^ *p++];
+        #elif (NZ_CRC_TABLE_SIZE == 16)
+        crc ^= ((WORD)*p++) << 8;
+        crc = (crc << 4) ^ crc16CcittTable[crc >> 12];
+        crc = (crc << 4) ^ crc16CcittTable[crc >> 12];
+        #else
+        BYTE i;
+        crc ^= ((WORD)*p++) << 8;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+        #endif
+    }
+    return crc;
+}
+
+
+/////////////////////////////////////////////////
+// CRC-16 IBM, reflected polynomial 0xA001
+#if (NZ_CRC_TABLE_SIZE == 256)
+static const WORD crc16IbmTable[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+#elif (NZ_CRC_TABLE_SIZE == 16)
+static const WORD crc16IbmTable[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+#endif
+
+#if defined(NZ_CRC16_IBM_SLICE8)
+static WORD crc16IbmSlice[7][256];  //Tables 1 to 7 for slice-by-8, table 0 is crc16IbmTable
+static BYTE crc16IbmSliceInit;
+#endif
+
+/**
+ * Update given CRC-16 IBM with given data.
+ */
+WORD crc16IbmUpdate(WORD crc, const BYTE* p, WORD len) {
+    #if defined(NZ_CRC16_IBM_SLICE8)
+    WORD i;
+    BYTE k;
+
+    //Create slice tables the first time. Table k gives the CRC of a byte followed by k zero bytes
+    if (crc16IbmSliceInit == 0) {
+        for (i = 0; i < 256; i++) {
+            crc16IbmSlice[0][i] = (crc16IbmTable[i] >> 8) ^ crc16IbmTable[crc16IbmTable[i] & 0xff];
+            for (k = 1; k < 7; k++) {
+                crc16IbmSlice[k][i] = (crc16IbmSlice[k - 1][i] >> 8) ^ crc16IbmTable[crc16IbmSlice[k - 1][i] & 0xff];
+            }
+        }
+        crc16IbmSliceInit = 1;
+    }
+
+    while (len >= 8) {
+        crc ^= p[0] | (((WORD)p[1]) << 8);
+        crc = crc16IbmSlice[6][crc & 0xff] ^ crc16IbmSlice[5][crc >> 8] ^ crc16IbmSlice[4][p[2]]
+            ^ crc16IbmSlice[3][p[3]] ^ crc16IbmSlice[2][p[4]] ^ crc16IbmSlice[1][p[5]]
+            ^ crc16IbmSlice[0][p[6]] ^ crc16IbmTable[p[7]];
+        p += 8;
+        len -= 8;
+    }
+    #endif
+
+    while (len-- != 0) {
+        #if (NZ_CRC_TABLE_SIZE == 256)
+        crc = (crc >> 8) ^ crc16IbmTable[(BYTE)crc ^ *p++];
+        #elif (NZ_CRC_TABLE_SIZE == 16)
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc16IbmTable[crc & 0x0f];
+        crc = (crc >> 4) ^ crc16IbmTable[crc & 0x0f];
+        #else
+        BYTE i;
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x0001) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+        }
+        #endif
+    }
+    return crc;
+}
+
+
+/////////////////////////////////////////////////
+// CRC-32, reflected polynomial 0xEDB88320
+#if (NZ_CRC_TABLE_SIZE == 256)
+static const DWORD crc32Table[256] = {
+    0x00000000ul, 0x77073096ul, 0xEE0E612Cul, 0x990951BAul, 0x076DC419ul, 0x706AF48Ful,
+    0xE963A535ul, 0x9E6495A3ul, 0x0EDB8832ul, 0x79DCB8A4ul, 0xE0D5E91Eul, 0x97D2D988ul,
+    0x09B64C2Bul, 0x7EB17CBDul, 0xE7B82D07ul, 0x90BF1D91ul, 0x1DB71064ul, 0x6AB020F2ul,
+    0xF3B97148ul, 0x84BE41DEul, 0x1ADAD47Dul, 0x6DDDE4EBul, 0xF4D4B551ul, 0x83D385C7ul,
+    0x136C9856ul, 0x646BA8C0ul, 0xFD62F97Aul, 0x8A65C9ECul, 0x14015C4Ful, 0x63066CD9ul,
+    0xFA0F3D63ul, 0x8D080DF5ul, 0x3B6E20C8ul, 0x4C69105Eul, 0xD56041E4ul, 0xA2677172ul,
+    0x3C03E4D1ul, 0x4B04D447ul, 0xD20D85FDul, 0xA50AB56Bul, 0x35B5A8FAul, 0x42B2986Cul,
+    0xDBBBC9D6ul, 0xACBCF940ul, 0x32D86CE3ul, 0x45DF5C75ul, 0xDCD60DCFul, 0xABD13D59ul,
+    0x26D930ACul, 0x51DE003Aul, 0xC8D75180ul, 0xBFD06116ul, 0x21B4F4B5ul, 0x56B3C423ul,
+    0xCFBA9599ul, 0xB8BDA50Ful, 0x2802B89Eul, 0x5F058808ul, 0xC60CD9B2ul, 0xB10BE924ul,
+    0x2F6F7C87ul, 0x58684C11ul, 0xC1611DABul, 0xB6662D3Dul, 0x76DC4190ul, 0x01DB7106ul,
+    0x98D220BCul, 0xEFD5102Aul, 0x71B18589ul, 0x06B6B51Ful, 0x9FBFE4A5ul, 0xE8B8D433ul,
+    0x7807C9A2ul, 0x0F00F934ul, 0x9609A88Eul, 0xE10E9818ul, 0x7F6A0DBBul, 0x086D3D2Dul,
+    0x91646C97ul, 0xE6635C01ul, 0x6B6B51F4ul, 0x1C6C6162ul, 0x856530D8ul, 0xF262004Eul,
+    0x6C0695EDul, 0x1B01A57Bul, 0x8208F4C1ul, 0xF50FC457ul, 0x65B0D9C6ul, 0x12B7E950ul,
+    0x8BBEB8EAul, 0xFCB9887Cul, 0x62DD1DDFul, 0x15DA2D49ul, 0x8CD37CF3ul, 0xFBD44C65ul,
+    0x4DB26158ul, 0x3AB551CEul, 0xA3BC0074ul, 0xD4BB30E2ul, 0x4ADFA541ul, 0x3DD895D7ul,
+    0xA4D1C46Dul, 0xD3D6F4FBul, 0x4369E96Aul, 0x346ED9FCul, 0xAD678846ul, 0xDA60B8D0ul,
+    0x44042D73ul, 0x33031DE5ul, 0xAA0A4C5Ful, 0xDD0D7CC9ul, 0x5005713Cul, 0x270241AAul,
+    0xBE0B1010ul, 0xC90C2086ul, 0x5768B525ul, 0x206F85B3ul, 0xB966D409ul, 0xCE61E49Ful,
+    0x5EDEF90Eul, 0x29D9C998ul, 0xB0D09822ul, 0xC7D7A8B4ul, 0x59B33D17ul, 0x2EB40D81ul,
+    0xB7BD5C3Bul, 0xC0BA6CADul, 0xEDB88320ul, 0x9ABFB3B6ul, 0x03B6E20Cul, 0x74B1D29Aul,
+    0xEAD54739ul, 0x9DD277AFul, 0x04DB2615ul, 0x73DC1683ul, 0xE3630B12ul, 0x94643B84ul,
+    0x0D6D6A3Eul, 0x7A6A5AA8ul, 0xE40ECF0Bul, 0x9309FF9Dul, 0x0A00AE27ul, 0x7D079EB1ul,
+    0xF00F9344ul, 0x8708A3D2ul, 0x1E01F268ul, 0x6906C2FEul, 0xF762575Dul, 0x806567CBul,
+    0x196C3671ul, 0x6E6B06E7ul, 0xFED41B76ul, 0x89D32BE0ul, 0x10DA7A5Aul, 0x67DD4ACCul,
+    0xF9B9DF6Ful, 0x8EBEEFF9ul, 0x17B7BE43ul, 0x60B08ED5ul, 0xD6D6A3E8ul, 0xA1D1937Eul,
+    0x38D8C2C4ul, 0x4FDFF252ul, 0xD1BB67F1ul, 0xA6BC5767ul, 0x3FB506DDul, 0x48B2364Bul,
+    0xD80D2BDAul, 0xAF0A1B4Cul, 0x36034AF6ul, 0x41047A60ul, 0xDF60EFC3ul, 0xA867DF55ul,
+    0x316E8EEFul, 0x4669BE79ul, 0xCB61B38Cul, 0xBC66831Aul, 0x256FD2A0ul, 0x5268E236ul,
+    0xCC0C7795ul, 0xBB0B4703ul, 0x220216B9ul, 0x5505262Ful, 0xC5BA3BBEul, 0xB2BD0B28ul,
+    0x2BB45A92ul, 0x5CB36A04ul, 0xC2D7FFA7ul, 0xB5D0CF31ul, 0x2CD99E8Bul, 0x5BDEAE1Dul,
+    0x9B64C2B0ul, 0xEC63F226ul, 0x756AA39Cul, 0x026D930Aul, 0x9C0906A9ul, 0xEB0E363Ful,
+    0x72076785ul, 0x05005713ul, 0x95BF4A82ul, 0xE2B87A14ul, 0x7BB12BAEul, 0x0CB61B38ul,
+    0x92D28E9Bul, 0xE5D5BE0Dul, 0x7CDCEFB7ul, 0x0BDBDF21ul, 0x86D3D2D4ul, 0xF1D4E242ul,
+    0x68DDB3F8ul, 0x1FDA836Eul, 0x81BE16CDul, 0xF6B9265Bul, 0x6FB077E1ul, 0x18B74777ul,
+    0x88085AE6ul, 0xFF0F6A70ul, 0x66063BCAul, 0x11010B5Cul, 0x8F659EFFul, 0xF862AE69ul,
+    0x616BFFD3ul, 0x166CCF45ul, 0xA00AE278ul, 0xD70DD2EEul, 0x4E048354ul, 0x3903B3C2ul,
+    0xA7672661ul, 0xD06016F7ul, 0x4969474Dul, 0x3E6E77DBul, 0xAED16A4Aul, 0xD9D65ADCul,
+    0x40DF0B66ul, 0x37D83BF0ul, 0xA9BCAE53ul, 0xDEBB9EC5ul, 0x47B2CF7Ful, 0x30B5FFE9ul,
+    0xBDBDF21Cul, 0xCABAC28Aul, 0x53B39330ul, 0x24B4A3A6ul, 0xBAD03605ul, 0xCDD70693ul,
+    0x54DE5729ul, 0x23D967BFul, 0xB3667A2Eul, 0xC4614AB8ul, 0x5D681B02ul, 0x2A6F2B94ul,
+    0xB40BBE37ul, 0xC30C8EA1ul, 0x5A05DF1Bul, 0x2D02EF8Dul
+};
+#elif (NZ_CRC_TABLE_SIZE == 16)
+static const DWORD crc32Table[16] = {
+    0x00000000ul, 0x1DB71064ul, 0x3B6E20C8ul, 0x26D930ACul, 0x76DC4190ul, 0x6B6B51F4ul, 0x4DB26158ul, 0x5005713Cul,
+    0xEDB88320ul, 0xF00F9344ul, 0xD6D6A3E8ul, 0xCB61B38Cul, 0x9B64C2B0ul, 0x86D3D2D4ul, 0xA00AE278ul, 0xBDBDF21Cul
+};
+#endif
+
+#if defined(NZ_CRC32_SLICE8)
+static DWORD crc32Slice[7][256];    //Tables 1 to 7 for slice-by-8, table 0 is crc32Table
+static BYTE crc32SliceInit;
+#endif
+
+/**
+ * Update given CRC-32 with given data.
+ */
+DWORD crc32Update(DWORD crc, const BYTE* p, WORD len) {
+    #if defined(NZ_CRC32_SLICE8)
+    WORD i;
+    BYTE k;
+
+    //Create slice tables the first time. Table k gives the CRC of a byte followed by k zero bytes
+    if (crc32SliceInit == 0) {
+        for (i = 0; i < 256; i++) {
+            crc32Slice[0][i] = (crc32Table[i] >> 8) ^ crc32Table[(BYTE)crc32Table[i]];
+            for (k = 1; k < 7; k++) {
+                crc32Slice[k][i] = (crc32Slice[k - 1][i] >> 8) ^ crc32Table[(BYTE)crc32Slice[k - 1][i]];
+            }
+        }
+        crc32SliceInit = 1;
+    }
+
+    while (len >= 8) {
+        crc ^= p[0] | (((WORD)p[1]) << 8) | (((DWORD)p[2]) << 16) | (((DWORD)p[3]) << 24);
+        crc = crc32Slice[6][(BYTE)crc] ^ crc32Slice[5][(BYTE)(crc >> 8)] ^ crc32Slice[4][(BYTE)(crc >> 16)]
+            ^ crc32Slice[3][(BYTE)(crc >> 24)] ^ crc32Slice[2][p[4]] ^ crc32Slice[1][p[5]]
+            ^ crc32Slice[0][p[6]] ^ crc32Table[p[7]];
+        p += 8;
+        len -= 8;
+    }
+    #endif
+
+    while (len-- != 0) {
+        #if (NZ_CRC_TABLE_SIZE == 256)
+        crc = (crc >> 8) ^ crc32Table[(BYTE)crc ^ *p++];
+        #elif (NZ_CRC_TABLE_SIZE == 16)
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32Table[(BYTE)crc & 0x0f];
+        crc = (crc >> 4) ^ crc32Table[(BYTE)crc & 0x0f];
+        #else
+        BYTE i;
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x00000001ul) ? ((crc >> 1) ^ 0xEDB88320ul) : (crc >> 1);
+        }
+        #endif
+    }
+    return crc;
+}
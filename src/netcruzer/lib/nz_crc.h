@@ -0,0 +1,140 @@
+/**
+ * @brief           CRC-8, CRC-16 and CRC-32 functions
+ * @file            nz_crc.h
+ * @author          <a href="www.modtronix.com">Modtronix Engineering</a>
+ * @compiler        MPLAB XC16 compiler
+ *
+ * @section nz_crc_desc Description
+ *****************************************
+ * This module contains CRC functions shared by the drivers, libraries and bootloader. Supported are:
+ * - CRC-8 Dallas/Maxim (1-Wire ROM and scratchpad CRC), reflected polynomial 0x8C.
+ * - CRC-16 CCITT, polynomial 0x1021, MSB first. Used by MiWi transceivers and the configuration log.
+ * - CRC-16 IBM (CRC-16/ARC, Modbus), reflected polynomial 0xA001.
+ * - CRC-32 (Ethernet, gzip, zip), reflected polynomial 0xEDB88320.
+ *
+ * All functions update the given CRC with the given data, and can be called multiple times to calculate
+ * the CRC of data given in blocks. No initial or final XOR is done, the caller does this. For example,
+ * for a standard CRC-32 the initial value is 0xffffffff, and the final CRC is ~crc.
+ *
+ * The lookup table size is selected at compile time with NZ_CRC_TABLE_SIZE. Tables are placed in FLASH.
+ * - 0 = No table, the CRC is calculated bit by bit. Smallest, and slowest.
+ * - 16 = 16 entry table per CRC, the CRC is calculated 4 bits at a time. About 2 to 3 times faster than
+ *   bit by bit, for 16 to 64 bytes of FLASH per CRC.
+ * - 256 = 256 entry table per CRC, the CRC is calculated a byte at a time. About twice as fast as
+ *   16 entries, for 256 to 1024 bytes of FLASH per CRC.
+ *
+ * When NZ_CRC_TABLE_SIZE is 256, the slice-by-8 algorithm can be enabled for each CRC. It processes
+ * 8 bytes per loop using 8 tables. The additional 7 tables are created in RAM from the FLASH table the
+ * first time the CRC function is called, and use 1792 (CRC-8), 3584 (CRC-16) or 7168 (CRC-32) bytes of RAM.
+ * This is only worth it for large blocks of data. Use the host benchmark in the "host" folder to
+ * compare the options.
+ *
+ * @subsection nz_crc_conf Configuration
+ *****************************************
+ * The following defines are used to configure this module, and should be placed in projdefs.h. Note
+ * that all items marked [-DEFAULT-] are defaults, and do not have to be placed in projdefs.h if they
+ * contain desired configuration! For details, see @ref info_conf_proj "Project Configuration".
+ @code
+ // *********************************************************************
+ // ------------------- CRC Configuration (nz_crc.h) --------------------
+ // *********************************************************************
+ //Size of lookup tables, can be 0, 16 or 256
+ #define NZ_CRC_TABLE_SIZE    16     //[-DEFAULT-]
+
+ //Uncomment to use slice-by-8 algorithm for given CRC. Requires NZ_CRC_TABLE_SIZE to be 256
+ //#define NZ_CRC8_SLICE8
+ //#define NZ_CRC16_CCITT_SLICE8
+ //#define NZ_CRC16_IBM_SLICE8
+ //#define NZ_CRC32_SLICE8
+ @endcode
+ **********************************************************************
+ * @section nz_crc_lic Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ **********************************************************************
+ * File History
+ *
+ * 2026-10-19:
+ *    - Initial version, table driven and slice-by-8 CRC functions. Used by the 1-Wire driver, configuration
+ *      log, MiWi crc.c, Deflate and the USB HID bootloader
+ *********************************************************************/
+#ifndef NZ_CRC_H
+#define NZ_CRC_H
+
+#if !defined(NZ_CRC_TABLE_SIZE)
+#define NZ_CRC_TABLE_SIZE   16
+#endif
+
+#if (NZ_CRC_TABLE_SIZE != 0) && (NZ_CRC_TABLE_SIZE != 16) && (NZ_CRC_TABLE_SIZE != 256)
+#error "NZ_CRC_TABLE_SIZE must be 0, 16 or 256!"
+#endif
+
+#if (NZ_CRC_TABLE_SIZE != 256) && (defined(NZ_CRC8_SLICE8) || defined(NZ_CRC16_CCITT_SLICE8) || defined(NZ_CRC16_IBM_SLICE8) || defined(NZ_CRC32_SLICE8))
+#error "Slice-by-8 CRC requires NZ_CRC_TABLE_SIZE to be 256!"
+#endif
+
+
+/**
+ * Update given CRC-8 Dallas/Maxim with given data. Initial value is 0 for 1-Wire devices.
+ *
+ * @param crc Current CRC
+ * @param p Data to add to CRC
+ * @param len Number of bytes in p
+ *
+ * @return Updated CRC
+ */
+BYTE crc8Update(BYTE crc, const BYTE* p, WORD len);
+
+
+/**
+ * Update given CRC-16 CCITT (polynomial 0x1021, MSB first) with given data. Initial value is
+ * usually 0xffff (CRC-16/CCITT-FALSE) or 0 (XMODEM).
+ *
+ * @param crc Current CRC
+ * @param p Data to add to CRC
+ * @param len Number of bytes in p
+ *
+ * @return Updated CRC
+ */
+WORD crc16CcittUpdate(WORD crc, const BYTE* p, WORD len);
+
+
+/**
+ * Update given CRC-16 IBM (reflected polynomial 0xA001) with given data. Initial value is 0 for
+ * CRC-16/ARC, and 0xffff for Modbus.
+ *
+ * @param crc Current CRC
+ * @param p Data to add to CRC
+ * @param len Number of bytes in p
+ *
+ * @return Updated CRC
+ */
+WORD crc16IbmUpdate(WORD crc, const BYTE* p, WORD len);
+
+
+/**
+ * Update given CRC-32 (reflected polynomial 0xEDB88320) with given data. Initial value is 0xffffffff,
+ * and the final CRC is ~crc.
+ *
+ * @param crc Current CRC
+ * @param p Data to add to CRC
+ * @param len Number of bytes in p
+ *
+ * @return Updated CRC
+ */
+DWORD crc32Update(DWORD crc, const BYTE* p, WORD len);
+
+#endif  //#ifndef NZ_CRC_H
@@ -32,6 +32,7 @@
 #include "HardwareProfile.h"
 
 #if defined(NZ_DEBOUNCE_ENABLED)
+#include <string.h>
 #include "nz_debounce.h"
 
 //Add debugging to this file. The DEBUG_CONF_DEBOUNCE macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
@@ -83,6 +84,11 @@ static BYTE portsLatch;                     //Holds latched and debounced value
 static BYTE debounceArr[DEBOUNCE_PORTS];    //A register for each port
 static BYTE btnRepeated;
 
+#if defined(DEBOUNCE_VC_ENABLED)
+static DEBOUNCE_VC_GROUP vcGroups[DEBOUNCE_VC_GROUPS];
+static CIRBUF* pVcCbuf;
+#endif
+
 
 // Function Prototypes //////////////////////////
 BYTE portService(BYTE btn, BYTE state);
@@ -104,6 +110,11 @@ void debounceInit() {
     portsLatch = 0;       //All ports off
 
     btnRepeated = 0;
+
+    #if defined(DEBOUNCE_VC_ENABLED)
+    //Groups are not cleared here, ports might already have been added by portConfig()
+    pVcCbuf = NULL;
+    #endif
 }
 
 
@@ -248,5 +259,187 @@ BYTE portService(BYTE port, BYTE state) {
     return state;
 }
 
+#if defined(DEBOUNCE_VC_ENABLED)
+
+/**
+ * Get the group for given port, and the port's mask in that group.
+ *
+ * @param portID The port ID
+ * @param pMask Returns mask of port in group
+ * @param add If TRUE, a free group is assigned if no group uses the port's PORTx register yet
+ *
+ * @return Pointer to group, or NULL if not found
+ */
+static DEBOUNCE_VC_GROUP* vcGetGroup(BYTE portID, WORD* pMask, BOOL add) {
+    PORT_DESC* pDesc;
+    volatile WORD* pPort;
+    DEBOUNCE_VC_GROUP* pFree = NULL;
+    BYTE i;
+
+    if ((portID > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portID))) {
+        return NULL;
+    }
+    pPort = &pDesc->pTris[PORT_DESC_OFS_PORT];
+    *pMask = pDesc->mask;
+
+    for (i = 0; i < DEBOUNCE_VC_GROUPS; i++) {
+        if (vcGroups[i].pPort == pPort) {
+            return &vcGroups[i];
+        }
+        if ((vcGroups[i].pPort == NULL) && (pFree == NULL)) {
+            pFree = &vcGroups[i];
+        }
+    }
+
+    if (add && (pFree != NULL)) {
+        memset(pFree, 0, sizeof(DEBOUNCE_VC_GROUP));
+        pFree->pPort = pPort;
+        return pFree;
+    }
+    return NULL;
+}
+
+
+/**
+ * Writes an event for each bit set in given toggle mask to the Circular Buffer. The port ID of
+ * each bit is searched for, this is only done when a port changes.
+ *
+ * @param pGroup The group that changed
+ * @param toggle Bits that changed
+ */
+static void vcPutEvents(DEBOUNCE_VC_GROUP* pGroup, WORD toggle) {
+    PORT_DESC* pDesc;
+    BYTE portID;
+
+    for (portID = 0, pDesc = portDescTable; portID <= PORT_ID_MAX; portID++, pDesc++) {
+        if (!portDescIsValid(pDesc) || (&pDesc->pTris[PORT_DESC_OFS_PORT] != pGroup->pPort) || ((toggle & pDesc->mask) == 0))
+            continue;
+
+        if (cbufGetFree(pVcCbuf) != 0) {
+            cbufPutByte(pVcCbuf, ((pGroup->state & pDesc->mask) != 0) ? (portID | 0x80) : portID);
+        }
+    }
+}
+
+
+/**
+ * Vertical counter service function. For each PORTx register, all pins are debounced in parallel. Each
+ * pin has a 2-bit counter, stored in the matching bits of cnt0 and cnt1. The counter is reset while a
+ * pin equals it's debounced state, and counts 4 samples while it differs. When it wraps, the debounced
+ * state of the pin toggles.
+ */
+void debounceVcService(void) {
+    DEBOUNCE_VC_GROUP* pGroup;
+    WORD delta;
+    WORD toggle;
+    BYTE i;
+
+    for (i = 0, pGroup = vcGroups; i < DEBOUNCE_VC_GROUPS; i++, pGroup++) {
+        if (pGroup->pPort == NULL)
+            continue;
+
+        delta = (*pGroup->pPort & pGroup->mask) ^ pGroup->state;
+        pGroup->cnt1 = (pGroup->cnt1 ^ pGroup->cnt0) & delta;
+        pGroup->cnt0 = ~pGroup->cnt0 & delta;
+        toggle = delta & ~(pGroup->cnt0 | pGroup->cnt1);
+
+        if (toggle != 0) {
+            pGroup->state ^= toggle;
+            pGroup->latch |= (toggle & pGroup->state);  //Latch rising edges
+
+            if (pVcCbuf != NULL) {
+                vcPutEvents(pGroup, toggle);
+            }
+        }
+    }
+}
+
+
+/**
+ * Adds given port to the vertical counter debouncer.
+ */
+BYTE debounceVcAddPort(BYTE portID) {
+    DEBOUNCE_VC_GROUP* pGroup;
+    WORD mask;
+
+    if ((pGroup = vcGetGroup(portID, &mask, TRUE)) == NULL) {
+        DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\ndebounceVcAddPort() failed");
+        return 0xff;
+    }
+
+    //Start with current value, so no edge is reported for the initial state
+    pGroup->cnt0 &= ~mask;
+    pGroup->cnt1 &= ~mask;
+    pGroup->latch &= ~mask;
+    pGroup->state = (pGroup->state & ~mask) | (*pGroup->pPort & mask);
+    pGroup->mask |= mask;
+    return 0;
+}
+
+
+/**
+ * Removes given port from the vertical counter debouncer.
+ */
+void debounceVcRemovePort(BYTE portID) {
+    DEBOUNCE_VC_GROUP* pGroup;
+    WORD mask;
+
+    if ((pGroup = vcGetGroup(portID, &mask, FALSE)) == NULL) {
+        return;
+    }
+
+    pGroup->mask &= ~mask;
+    pGroup->state &= ~mask;
+    pGroup->latch &= ~mask;
+
+    //Free group if no more ports use it
+    if (pGroup->mask == 0) {
+        pGroup->pPort = NULL;
+    }
+}
+
+
+/**
+ * Returns the latched state of the requested port, and clears it.
+ */
+BYTE debounceVcGetLatchedPort(BYTE portID) {
+    DEBOUNCE_VC_GROUP* pGroup;
+    WORD mask;
+
+    if ((pGroup = vcGetGroup(portID, &mask, FALSE)) == NULL) {
+        return 0;
+    }
+
+    if ((pGroup->latch & mask) == 0) {
+        return 0;
+    }
+    pGroup->latch &= ~mask;
+    return 1;
+}
+
+
+/**
+ * Returns the debounced value of the requested port.
+ */
+BYTE debounceVcGetPort(BYTE portID) {
+    DEBOUNCE_VC_GROUP* pGroup;
+    WORD mask;
+
+    if ((pGroup = vcGetGroup(portID, &mask, FALSE)) == NULL) {
+        return 0;
+    }
+    return ((pGroup->state & mask) == 0) ? 0 : 1;
+}
+
+
+/**
+ * Set "Circular Buffer" that debounced edges are written to.
+ */
+void debounceVcSetCirbuf(CIRBUF* pBuf) {
+    pVcCbuf = pBuf;
+}
+
+#endif  //#if defined(DEBOUNCE_VC_ENABLED)
+
 #endif  //#if defined(NZ_DEBOUNCE_ENABLED)
 
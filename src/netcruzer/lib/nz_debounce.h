@@ -40,6 +40,11 @@
 #define DEBOUNCE_REPEAT3        ( 80 )      //80ms [-DEFAULT-]
 #define DEBOUNCE_REPEAT3_TIMES  ( 20 )      //20 times = 20 x 80ms = 1.6 Seconds [-DEFAULT-]
 #define DEBOUNCE_REPEAT4        ( 40 )      //60ms [-DEFAULT-]
+
+//Uncomment to enable the vertical counter debouncer. It debounces all ports configured as digital inputs
+//with portConfig(), see @ref nz_debounce_vc "Vertical Counter Debouncer".
+//#define DEBOUNCE_VC_ENABLED
+#define DEBOUNCE_VC_GROUPS      ( 4 )       //Maximum number of PORTx registers used by debounced ports [-DEFAULT-]
  @endcode
  *
  *
@@ -79,6 +84,25 @@
  * If a button is attached to pin 4 (old port name X4), it should be tied to 3.3V via a resistor(10k for
  * example). And, the internal pull-down resistor of port 4 (X4) should be enabled.
  *
+ *
+ * @subsection nz_debounce_vc Vertical Counter Debouncer
+ *****************************************
+ * When DEBOUNCE_VC_ENABLED is defined, all ports configured as digital inputs with portConfig() are
+ * also debounced by a vertical counter debouncer. It samples each used PORTx register as a whole, and
+ * debounces all 16 bits in parallel with a couple of logic operations. A port is debounced when it had
+ * the same value for 4 samples (4 x DEBOUNCE_VC_SERVICE_TIME = 40ms). Ports can also be added with
+ * debounceVcAddPort(). For example:
+@code
+    portConfig(4, PTYPE_DIN | PCFG_DIN_PULLDOWN);
+
+    //Port 4 went from 0 to 1
+    if(debounceVcGetLatchedPort(4)) {
+        //... Do something
+    }
+@endcode
+ * Optionally, each debounced edge can be written to a Circular Buffer with debounceVcSetCirbuf(). For
+ * each edge, a single byte is written. It is the port ID, with bit 7 set if new value is 1.
+ *
  **********************************************************************
  * @section nz_debounce_lic Software License Agreement
  *
@@ -193,6 +217,87 @@ BYTE debounceGetLatchedPorts();
  */
 BYTE debounceGetLatchedPort(BYTE port);
 
+
+#if defined(DEBOUNCE_VC_ENABLED)
+
+#include "nz_circularBuffer.h"
+
+#ifndef DEBOUNCE_VC_GROUPS
+#define DEBOUNCE_VC_GROUPS  4
+#endif
+
+#define DEBOUNCE_VC_SERVICE_TIME    10  //Vertical counter debounce service time in MS
+
+/**
+ * Vertical counter debouncer for a single PORTx register. Bit n of each member is for pin n of the register.
+ */
+typedef struct DEBOUNCE_VC_GROUP_
+{
+    volatile WORD*  pPort;  //PORTx register, NULL if group is not used
+    WORD    mask;           //Pins of the register that are debounced
+    WORD    cnt0;           //Bit 0 of the 2-bit vertical counter for each pin
+    WORD    cnt1;           //Bit 1 of the 2-bit vertical counter for each pin
+    WORD    state;          //Debounced state
+    WORD    latch;          //Latched rising edges, cleared when read
+} DEBOUNCE_VC_GROUP;
+
+
+/**
+ * Vertical counter service function. Must be called every DEBOUNCE_VC_SERVICE_TIME
+ */
+void debounceVcService(void);
+
+
+/**
+ * Adds given port to the vertical counter debouncer. Is called by portConfig() for all ports configured
+ * as digital inputs.
+ *
+ * @param portID The port ID, is the port number as printed on the board.
+ *
+ * @return Returns 0 if success, else 0xff. Fails if the port is not valid, or all DEBOUNCE_VC_GROUPS
+ *         are used by other PORTx registers.
+ */
+BYTE debounceVcAddPort(BYTE portID);
+
+
+/**
+ * Removes given port from the vertical counter debouncer.
+ *
+ * @param portID The port ID, is the port number as printed on the board.
+ */
+void debounceVcRemovePort(BYTE portID);
+
+
+/**
+ * Returns the latched state of the requested port. Is set when the debounced value of the port
+ * goes from 0 to 1, and is cleared by this call.
+ *
+ * @param portID The port ID, is the port number as printed on the board.
+ *
+ * @return 1 if port went from 0 to 1 since last call, else 0.
+ */
+BYTE debounceVcGetLatchedPort(BYTE portID);
+
+
+/**
+ * Returns the debounced value of the requested port.
+ *
+ * @param portID The port ID, is the port number as printed on the board.
+ *
+ * @return Debounced value of port, 0 or 1. Returns 0 if port is not debounced.
+ */
+BYTE debounceVcGetPort(BYTE portID);
+
+
+/**
+ * Set "Circular Buffer" that debounced edges are written to. Edges are dropped if it is full.
+ *
+ * @param pBuf Pointer to Circular Buffer, or NULL to disable
+ */
+void debounceVcSetCirbuf(CIRBUF* pBuf);
+
+#endif  //#if defined(DEBOUNCE_VC_ENABLED)
+
 #endif  //#if defined(NZ_DEBOUNCE_ENABLED)
 
 #endif
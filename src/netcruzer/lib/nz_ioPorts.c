@@ -33,9 +33,14 @@
 
 #include <ctype.h>  // for tolower
 #include <stdlib.h> // for atoi
+#include <string.h>
 
 #include "nz_ioPorts.h"
 
+#if defined(NZ_DEBOUNCE_ENABLED) && defined(DEBOUNCE_VC_ENABLED)
+#include "nz_debounce.h"
+#endif
+
 //Add debugging to this file. The DEBUG_CONF_IOPORTS macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
 #if !defined(DEBUG_CONF_IOPORTS)
     #define DEBUG_CONF_IOPORTS      DEBUG_LEVEL_ERROR  //Default Debugging level if not defined = ERROR
@@ -523,11 +528,41 @@ const BYTE ICN_UCPORT_PIC24F_MAP[] = {
 #define ICN_UCPORT_PIC24F_MAP_LASTENTRY UCPORT_ID_G9
 
 
+//Port Descriptor for each "Port ID", created by portInit()
+PORT_DESC portDescTable[PORT_ID_MAX+1];
+
+
 /**
- * Initialization
+ * Get pointer to register of given "Port bitAdr".
+ */
+#if defined(__C30__)
+#define BITADR_TO_PTR(bitAdr) ((volatile WORD*)((bitAdr) & 0x07FF))
+#elif defined(__C32__)
+#define BITADR_TO_PTR(bitAdr) ((volatile WORD*)(0xBF886000 | ((DWORD)((bitAdr) & 0x0FFF))))
+#endif
+
+
+/**
+ * Initialization. Creates the Port Descriptor table.
  */
 void portInit(void) {
+    BYTE portID;
+    WORD bitadr;
+    PORT_DESC* pDesc;
+
+    for (portID = 0, pDesc = portDescTable; portID <= PORT_ID_MAX; portID++, pDesc++) {
+        memset(pDesc, 0, sizeof(PORT_DESC));
 
+        if ((bitadr = TRIS_PORTID_BITADR_MAP[portID]) == BITADR_NA)
+            continue;
+        pDesc->pTris = BITADR_TO_PTR(bitadr);
+        pDesc->mask = 0x01 << (bitadr >> 12);
+
+        if ((bitadr = portGetCNPD(portID)) == BITADR_NA)
+            continue;
+        pDesc->pCnpd = BITADR_TO_PTR(bitadr);
+        pDesc->maskCn = 0x01 << (bitadr >> 12);
+    }
 }
 
 
@@ -581,6 +616,13 @@ BYTE portConfig(BYTE portID, WORD typeConf) {
         return 0xff;
     }
 
+    #if defined(NZ_DEBOUNCE_ENABLED) && defined(DEBOUNCE_VC_ENABLED)
+    //Not a digital input (any more), stop debouncing it
+    if (type != PCFG_DIN_TYPE) {
+        debounceVcRemovePort(portID);
+    }
+    #endif
+
     if (type == PCFG_DIN_TYPE) {
     //if (type == WORD_HIGH_BYTE(PTYPE_DIN)) {  //Alternative - generates same code
     //if ((typeConf&0xff00) == PTYPE_DIN) {     //Alternative - generates same code
@@ -601,6 +643,10 @@ BYTE portConfig(BYTE portID, WORD typeConf) {
             portClearBitadr(portGetCNPU(portID));
             DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "-Pulldwn");
         }
+
+        #if defined(NZ_DEBOUNCE_ENABLED) && defined(DEBOUNCE_VC_ENABLED)
+        debounceVcAddPort(portID);
+        #endif
     }
     else if (type == PCFG_DOUT_TYPE) {
         //Clear TRIS register = output
@@ -1311,18 +1357,13 @@ WORD ucportGetCNPDwOffset(BYTE ucportID, BYTE offset) {
  * @param value HIGH will set the port(3.3V), and LOW will clear(0V) the port pin.
  */
 void portConfigDir(BYTE portID, BOOL dir) {
-    WORD bitadr;
-    bitadr = portGetTRIS(portID);
+    PORT_DESC* pDesc;
 
-    //Do nothing if given "Port bitAdr" is BITADR_NA
-    if (bitadr == BITADR_NA)
+    //Do nothing if given port is not available
+    if ((portID > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portID)))
         return;
 
-    #if defined(IOPORTS_OPTIMIZE_SIZE)
-    portWriteBitadr(bitadr, dir);
-    #else
-    portWriteBitadr_MACRO(bitadr, dir);
-    #endif
+    portDescWriteTRIS(pDesc, dir);
 }
 
 
@@ -1335,18 +1376,13 @@ void portConfigDir(BYTE portID, BOOL dir) {
  * @param value HIGH will set the port(3.3V), and LOW will clear(0V) the port pin.
  */
 void portWrite(BYTE portID, BYTE value) {
-    WORD bitadr;
-    bitadr = portGetLAT(portID);
+    PORT_DESC* pDesc;
 
-    //Do nothing if given "Port bitAdr" is BITADR_NA
-    if (bitadr == BITADR_NA)
+    //Do nothing if given port is not available
+    if ((portID > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portID)))
         return;
 
-    #if defined(IOPORTS_OPTIMIZE_SIZE)
-    portWriteBitadr(bitadr, value);
-    #else
-    portWriteBitadr_MACRO(bitadr, value);
-    #endif
+    portDescWriteLAT(pDesc, value);
 }
 
 
@@ -1360,18 +1396,105 @@ void portWrite(BYTE portID, BYTE value) {
  *      or 1 (HIGH = 3.3V) if set.
  */
 BOOL portRead(BYTE portID) {
-    WORD bitadr;
-    bitadr = portGetPIN(portID);
+    PORT_DESC* pDesc;
 
-    //Do nothing if given "Port bitAdr" is BITADR_NA
-    if (bitadr == BITADR_NA)
+    //Return 0 if given port is not available
+    if ((portID > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portID)))
         return 0;
 
-    #if defined(IOPORTS_OPTIMIZE_SIZE)
-    return portReadBitadr(bitadr);
-    #else
-    return portReadBitadr_MACRO(bitadr);
-    #endif
+    return (portDescReadPIN(pDesc) == 0) ? 0 : 1;
+}
+
+
+/**
+ * Reads the given ports, reading each PORT register only once.
+ *
+ * @param portIDs Array with "Port IDs" of ports to read. Invalid ports read as 0.
+ * @param count Number of ports in portIDs, maximum 32.
+ *
+ * @return Bit n contains the value of portIDs[n].
+ */
+DWORD portReadMulti(const BYTE* portIDs, BYTE count) {
+    volatile WORD* regs[8];     //PORT registers read so far
+    WORD vals[8];               //Values read from regs[]
+    volatile WORD* pReg;
+    PORT_DESC* pDesc;
+    DWORD ret = 0;
+    DWORD bit = 0x00000001;
+    BYTE nRegs = 0;
+    BYTE i, r;
+
+    for (i = 0; i < count; i++, bit <<= 1) {
+        if ((portIDs[i] > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portIDs[i])))
+            continue;
+
+        //Find PORT register in snapshot, read and add it if not found
+        pReg = &pDesc->pTris[PORT_DESC_OFS_PORT];
+        for (r = 0; (r < nRegs) && (regs[r] != pReg); r++);
+        if (r == nRegs) {
+            //Snapshot full, read register directly. Won't happen for less than 8 PORT registers
+            if (nRegs == 8) {
+                if (*pReg & pDesc->mask)
+                    ret |= bit;
+                continue;
+            }
+            regs[r] = pReg;
+            vals[r] = *pReg;
+            nRegs++;
+        }
+
+        if (vals[r] & pDesc->mask)
+            ret |= bit;
+    }
+    return ret;
+}
+
+
+/**
+ * Writes the given ports, writing each LAT register only once.
+ *
+ * @param portIDs Array with "Port IDs" of ports to write. Invalid ports are ignored.
+ * @param count Number of ports in portIDs, maximum 32.
+ * @param values Bit n contains the value to write to portIDs[n].
+ */
+void portWriteMulti(const BYTE* portIDs, BYTE count, DWORD values) {
+    volatile WORD* regs[8];     //LAT registers to update
+    WORD setMasks[8];           //Bits to set in regs[]
+    WORD clrMasks[8];           //Bits to clear in regs[]
+    volatile WORD* pReg;
+    PORT_DESC* pDesc;
+    BYTE nRegs = 0;
+    BYTE i, r;
+
+    for (i = 0; i < count; i++, values >>= 1) {
+        if ((portIDs[i] > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portIDs[i])))
+            continue;
+
+        //Find LAT register, add it if not found
+        pReg = &pDesc->pTris[PORT_DESC_OFS_LAT];
+        for (r = 0; (r < nRegs) && (regs[r] != pReg); r++);
+        if (r == nRegs) {
+            //All entries used, write port directly. Won't happen for less than 8 LAT registers
+            if (nRegs == 8) {
+                portDescWriteLAT(pDesc, (values & 0x01));
+                continue;
+            }
+            regs[r] = pReg;
+            setMasks[r] = 0;
+            clrMasks[r] = 0;
+            nRegs++;
+        }
+
+        if (values & 0x01)
+            setMasks[r] |= pDesc->mask;
+        else
+            clrMasks[r] |= pDesc->mask;
+    }
+
+    //Update each LAT register once
+    for (r = 0; r < nRegs; r++) {
+        *regs[r] = (*regs[r] & ~clrMasks[r]) | setMasks[r];
+    }
 }
 
 
@@ -927,6 +927,116 @@ BOOL portRead(BYTE portID);
 
 
 
+/////////////////////////////////////////////////
+//Port Descriptor functions
+//The "Port bitAdr" functions decode the register address and bit mask on each call. The Port Descriptor
+//table contains the register pointers and masks of all ports, and is created once by portInit().
+
+/**
+ * Port Descriptor, contains pointers to the registers of a port, and the port's mask in them.
+ */
+typedef struct PORT_DESC_
+{
+    volatile WORD*  pTris;      //TRIS register, PORT, LAT and ODC registers are at PORT_DESC_OFS_XX from it. NULL if not available
+    volatile WORD*  pCnpd;      //CNPD (Pull-Down) register, CNPU is at PORT_DESC_OFS_CNPU from it. NULL if not available
+    WORD            mask;       //Mask of port in TRIS, PORT, LAT and ODC registers
+    WORD            maskCn;     //Mask of port in CNPD and CNPU registers
+} PORT_DESC;
+
+//WORD offsets of registers from PORT_DESC pTris and pCnpd members
+#if defined(__C30__)
+    #define PORT_DESC_OFS_PORT      1
+    #define PORT_DESC_OFS_LAT       2
+    #define PORT_DESC_OFS_ODC       3
+    #define PORT_DESC_OFS_CNPU      12
+#elif defined(__C32__)
+    #define PORT_DESC_OFS_PORT      0x10
+    #define PORT_DESC_OFS_LAT       0x18
+    #define PORT_DESC_OFS_ODC       0x20
+    #define PORT_DESC_OFS_CNPU      (-8)
+#else
+    #error "PORT_DESC not defined for this compiler!"
+#endif
+
+#if !defined(THIS_IS_NZ_IO_PORTS_C)
+extern PORT_DESC portDescTable[PORT_ID_MAX+1];
+#endif
+
+/**
+ * Get the PORT_DESC for the given "Port ID". The portID is NOT checked, must be 0 to PORT_ID_MAX!
+ */
+#define portDescGet(portID) (&portDescTable[portID])
+
+/**
+ * Returns TRUE if the given port descriptor is for an available port
+ */
+#define portDescIsValid(pDesc) ((pDesc)->pTris != NULL)
+
+/**
+ * Read the TRIS, PORT, LAT or ODC bit of a port with the given PORT_DESC. Returns 0 if clear, or
+ * non-zero if set. Given descriptor must be valid!
+ */
+#define portDescReadTRIS(pDesc) ((pDesc)->pTris[0] & (pDesc)->mask)
+#define portDescReadPIN(pDesc)  ((pDesc)->pTris[PORT_DESC_OFS_PORT] & (pDesc)->mask)
+#define portDescReadLAT(pDesc)  ((pDesc)->pTris[PORT_DESC_OFS_LAT] & (pDesc)->mask)
+#define portDescReadODC(pDesc)  ((pDesc)->pTris[PORT_DESC_OFS_ODC] & (pDesc)->mask)
+
+/**
+ * Read the CNPD (Pull-Down) or CNPU (Pull-Up) bit of a port with the given PORT_DESC. Returns 0 if
+ * clear or not available, or non-zero if set.
+ */
+#define portDescReadCNPD(pDesc) (((pDesc)->pCnpd == NULL) ? 0 : ((pDesc)->pCnpd[0] & (pDesc)->maskCn))
+#define portDescReadCNPU(pDesc) (((pDesc)->pCnpd == NULL) ? 0 : ((pDesc)->pCnpd[PORT_DESC_OFS_CNPU] & (pDesc)->maskCn))
+
+/**
+ * Write the LAT bit of a port with the given PORT_DESC. Given descriptor must be valid!
+ */
+#define portDescWriteLAT(pDesc, value) (((value)==0) ? ((pDesc)->pTris[PORT_DESC_OFS_LAT] &= ~(pDesc)->mask) : ((pDesc)->pTris[PORT_DESC_OFS_LAT] |= (pDesc)->mask))
+
+/**
+ * Write the TRIS bit of a port with the given PORT_DESC. Given descriptor must be valid!
+ */
+#define portDescWriteTRIS(pDesc, value) (((value)==0) ? ((pDesc)->pTris[0] &= ~(pDesc)->mask) : ((pDesc)->pTris[0] |= (pDesc)->mask))
+
+
+/**
+ * Read or write a port given as a literal 2 digit "Port ID". No table lookup is done, the PIN_xx_BITADR and
+ * LAT_xx_BITADR constants are used, and a single instruction is generated. For example:
+ * @code
+ * portWriteConst(08, 1);
+ * if (portReadConst(04)) {
+ *     //... Do something
+ * }
+ * @endcode
+ */
+#define portReadConst(id)           (portReadBitadr_MACRO(PIN_##id##_BITADR) != 0)
+#define portWriteConst(id, value)   portWriteBitadr_MACRO(LAT_##id##_BITADR, value)
+
+
+/**
+ * Reads the given ports. Each PORT register is only read once, so all ports sharing a register are
+ * read at the same time.
+ *
+ * @param portIDs Array with "Port IDs" of ports to read. Invalid ports read as 0.
+ * @param count Number of ports in portIDs, maximum 32.
+ *
+ * @return Bit n contains the value of portIDs[n].
+ */
+DWORD portReadMulti(const BYTE* portIDs, BYTE count);
+
+
+/**
+ * Writes the given ports. Each LAT register is only written once, so all ports sharing a register are
+ * updated at the same time.
+ *
+ * @param portIDs Array with "Port IDs" of ports to write. Invalid ports are ignored.
+ * @param count Number of ports in portIDs, maximum 32.
+ * @param values Bit n contains the value to write to portIDs[n].
+ */
+void portWriteMulti(const BYTE* portIDs, BYTE count, DWORD values);
+
+
+
 /////////////////////////////////////////////////
 //Arduino compatible functions
 //All the following functions use the "Microcontroller port ID"(a UCPORT_ID_xx define)
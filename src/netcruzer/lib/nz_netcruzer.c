@@ -46,6 +46,11 @@
 #include "nz_rtc.h"
 #endif
 
+//External Flash
+#if defined(XFLASH_USE_ASYNC)
+#include "nz_xFlash.h"
+#endif
+
 //I2C includes
 #if (defined(HAS_SERPORT_I2C1) || defined(HAS_SERPORT_I2C2) || defined(HAS_SERPORT_I2C3)) && !defined(NZSYS_NO_SERI2C_H_FILES)
     #include "nz_serI2C.h"
@@ -168,6 +173,9 @@ void nzSysInitDefault(void)
         #endif
     #endif
 
+    //Create Port Descriptor table, used by portRead(), portWrite()....
+    portInit();
+
     //Debugging must be initialized right at the start. At this stage, no port is required! Will write
     //add debug into to Circular Buffer, that is written out on port later on when port get's initialized.
     #if defined(NZSYS_MANAGE_DEBUG)
@@ -305,6 +313,10 @@ void nzSysTaskDefault(void)
         if(taskCount10ms-- == 0) {
             taskCount10ms=9;
 
+            #if defined(NZ_DEBOUNCE_ENABLED) && defined(DEBOUNCE_VC_ENABLED)
+            debounceVcService();
+            #endif
+
             #if defined(HAS_SERPORT_USB_HID)
                 #if defined(USB_INTERRUPT)
                 if (USB_BUS_SENSE && (USBGetDeviceState() == DETACHED_STATE)) {
@@ -363,6 +375,16 @@ void nzSysTaskDefault(void)
     serTask();
     #endif
 
+    //Start queued external Flash erases and programs. Returns immediately if Flash is busy
+    #if defined(XFLASH_USE_ASYNC)
+    xflashAsyncTask();
+    #endif
+
+    //Process ADC ping-pong buffers. Returns immediately if none are ready
+    #if defined(HAS_NZ_ADC) && !defined(NZ_ADC_DISABLE) && (ADC_STREAM_DECIMATION != 0) && !defined(ADC_STREAM_USE_FIBER)
+    adcStreamTask();
+    #endif
+
 //  !!!!! This is broken, fix !!!!!    
 //    #ifdef NZSYS_ENABLE_LCD2S_AND_I2C1
 //    if (inTask.bits.lcd2sTask == FALSE) {
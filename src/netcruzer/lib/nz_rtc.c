@@ -92,6 +92,7 @@ typedef struct __attribute__((__packed__)) {
 ////////// Function Prototypes //////////////////
 BYTE bcd2bin (BYTE val, BYTE bcdFormat);
 BYTE bin2bcd (BYTE val);
+BYTE rtcI2CJob(BYTE* pWr, BYTE wrSize, BYTE* pRd, BYTE rdSize);
 
 
 
@@ -206,20 +207,19 @@ BYTE rtcGetHour(void) {
  */
 BYTE nz_rtcGetTimeAndDate(BYTE* pt, BYTE offset, BYTE size, BYTE bcdFormat) {
     BYTE msg[7];
-    //memset(msg, 0, sizeof(msg));
-    i2cBeginTransmission(objI2C, RTC_I2C_ADDR);     //Start transmission to slave at address RTC_I2C_ADDR
-    i2cWrite(objI2C, 0x0 + offset);                 //Write 0 = address of register to read = 0 = 'seconds'
-    i2cReadToArray(objI2C, &msg[offset], size);     //Read 2 bytes to buf
-    i2cEndTransmission(objI2C);                     //End transmission, and start sending message in background
+    BYTE reg;
+
+    //Write address of first register to read (0 = 'seconds'), followed by REPEATED START and reading size bytes
+    reg = 0x0 + offset;
 
     //Wait till transmission finished (background via interrupt), and get status
 #if (RTC_GET_ERROR_CHECKING==1)
-    if (i2cGetStatusWait(objI2C, 0) != 0) {
+    if (rtcI2CJob(&reg, 1, &msg[offset], size) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\nnz_rtcGetTimeAndDate() I2C Error!");
         return 1;   //Error
     }
 #else
-    i2cGetStatusWait(objI2C, 0);
+    rtcI2CJob(&reg, 1, &msg[offset], size);
 #endif
 
     //Requested Time
@@ -390,16 +390,15 @@ BYTE rtcSetTime(RTC_TIME* tm) {
 
     //Sequencial write, starting at regigister with address 0
     msg[0] = 0; //Register address 0
-    i2cWriteMessage(objI2C, RTC_I2C_ADDR, msg, sizeof(msg));
 
     //Wait till transmission finished (background via interrupt), and check if successful
 #if (RTC_SET_ERROR_CHECKING==1)
-    if (i2cGetStatusWait(objI2C, 0) != 0) {
+    if (rtcI2CJob(msg, sizeof(msg), NULL, 0) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\rtcSetTime() I2C Error!");
         return 1;   //Error
     }
 #else
-    i2cGetStatusWait(objI2C, 0);
+    rtcI2CJob(msg, sizeof(msg), NULL, 0);
 #endif
     return 0;
 }
@@ -444,16 +443,15 @@ BYTE rtcSetTimeAndDate(RTC_TIME_AND_DATE* td) {
 
     //Sequencial write, starting at regigister with address 0
     msg[0] = 0; //Register address 0
-    i2cWriteMessage(objI2C, RTC_I2C_ADDR, msg, sizeof(msg));
 
     //Wait till transmission finished (background via interrupt), and check if successful
 #if (RTC_SET_ERROR_CHECKING==1)
-    if (i2cGetStatusWait(objI2C, 0) != 0) {
+    if (rtcI2CJob(msg, sizeof(msg), NULL, 0) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\rtcSetTimeAndDate() I2C Error!");
         return 1;   //Error
     }
 #else
-    i2cGetStatusWait(objI2C, 0);
+    rtcI2CJob(msg, sizeof(msg), NULL, 0);
 #endif
     return 0;
 }
@@ -574,11 +572,8 @@ BYTE nz_rtcSetRegBin2Bcd(BYTE reg, BYTE val) {
  * @return Returns 0 if success, else error code
  */
 BYTE rtcGetReg(BYTE regAdr, BYTE* reg) {
-    //Read status register, and save result in c
-    i2cReadSlaveReg(objI2C, RTC_I2C_ADDR, regAdr, reg, 1);
-
-    //Wait till transmission finished (background via interrupt), and check if successful
-    if (i2cGetStatusWait(objI2C, 0) != 0) {
+    //Read register, and wait till transmission finished (background via interrupt), and check if successful
+    if (rtcI2CJob(&regAdr, 1, reg, 1) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\rtcGetReg() I2C Error!");
         *reg = 0;   //Return 0
         return 1;   //Error
@@ -595,13 +590,13 @@ BYTE rtcGetReg(BYTE regAdr, BYTE* reg) {
  * @return Returns 0 if success, else error code
  */
 BYTE rtcSetReg(BYTE regAdr, BYTE val) {
-    i2cBeginTransmission(objI2C, RTC_I2C_ADDR);
-    i2cWrite(objI2C, regAdr);
-    i2cWrite(objI2C, val);
-    i2cEndTransmission(objI2C);
+    BYTE msg[2];
+
+    msg[0] = regAdr;
+    msg[1] = val;
 
     //Wait till transmission finished (background via interrupt), and check if successful
-    if (i2cGetStatusWait(objI2C, 0)!=0) {
+    if (rtcI2CJob(msg, sizeof(msg), NULL, 0) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\rtcSetReg() I2C Error!");
         return 1;
     }
@@ -609,6 +604,30 @@ BYTE rtcSetReg(BYTE regAdr, BYTE val) {
 }
 
 
+/**
+ * Adds a job to the I2C job queue that writes given bytes to the RTC, followed by reading given
+ * number of bytes (with a REPEATED START). Waits till the job is done.
+ *
+ * @param pWr Bytes to write, first byte is the register address
+ * @param wrSize Number of bytes to write
+ * @param pRd Buffer for read bytes, or NULL if nothing is read
+ * @param rdSize Number of bytes to read, or 0
+ * @return Returns 0 if OK, else I2C_TXION_STATUS_ERR_XX error code
+ */
+BYTE rtcI2CJob(BYTE* pWr, BYTE wrSize, BYTE* pRd, BYTE rdSize) {
+    I2C_JOB job;
+
+    job.adr = RTC_I2C_ADDR;
+    job.pWr = pWr;
+    job.wrSize = wrSize;
+    job.pRd = pRd;
+    job.rdSize = rdSize;
+    job.callback = NULL;
+
+    return i2cJobAddWait(objI2C, &job);
+}
+
+
 /**
  * BCD format to binary
  * @param val
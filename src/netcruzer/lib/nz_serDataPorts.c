@@ -857,4 +857,219 @@ void serDefaultInit(void) {
 }
 #endif  //#if !defined(SERPORT_DONT_MANAGE_SER_INFO_INIT)
 
+
+#if defined(SERPORT_USE_DMA)
+/////////////////////////////////////////////////
+// "Serial Data Port" DMA, PIC32MX
+
+#include <sys/kmem.h>
+
+//Get register of given DMA channel. Registers of all channels have the same layout, and each register is
+//followed by it's CLR, SET and INV registers (4 x 32-bit words).
+#define DMA_CH_OFFSET(ch)       ((ch) * (&DCH1CON - &DCH0CON))
+#define pDCHxCON(ch)            (&DCH0CON + DMA_CH_OFFSET(ch))
+#define pDCHxCONCLR(ch)         (&DCH0CONCLR + DMA_CH_OFFSET(ch))
+#define pDCHxECON(ch)           (&DCH0ECON + DMA_CH_OFFSET(ch))
+#define pDCHxINT(ch)            (&DCH0INT + DMA_CH_OFFSET(ch))
+#define pDCHxINTCLR(ch)         (&DCH0INTCLR + DMA_CH_OFFSET(ch))
+#define pDCHxINTSET(ch)         (&DCH0INTSET + DMA_CH_OFFSET(ch))
+#define pDCHxSSA(ch)            (&DCH0SSA + DMA_CH_OFFSET(ch))
+#define pDCHxDSA(ch)            (&DCH0DSA + DMA_CH_OFFSET(ch))
+#define pDCHxSSIZ(ch)           (&DCH0SSIZ + DMA_CH_OFFSET(ch))
+#define pDCHxDSIZ(ch)           (&DCH0DSIZ + DMA_CH_OFFSET(ch))
+#define pDCHxSPTR(ch)           (&DCH0SPTR + DMA_CH_OFFSET(ch))
+#define pDCHxDPTR(ch)           (&DCH0DPTR + DMA_CH_OFFSET(ch))
+#define pDCHxCSIZ(ch)           (&DCH0CSIZ + DMA_CH_OFFSET(ch))
+
+#define DCHCON_CHEN             0x00000080ul    //Channel enable
+#define DCHECON_CFORCE          0x00000080ul    //Force a single cell transfer
+#define DCHECON_SIRQEN          0x00000010ul    //Start cell transfer on CHSIRQ
+#define DCHINT_CHBCIF           0x00000008ul    //Block transfer complete
+#define DCHINT_CHBCIE           0x00080000ul    //Block transfer complete interrupt enable
+
+//Interrupt flag, enable and priority registers of DMA channel interrupts. IFSx, IECx and IPCx registers are each
+//followed by their CLR, SET and INV registers. The IRQ and vector numbers of channels 0 to 3 are consecutive.
+#define DMA_IRQ(ch)             (_DMA0_IRQ + (ch))
+#define DMA_IRQ_BIT(ch)         (1ul << (DMA_IRQ(ch) & 0x1f))
+#define pIFSxCLR(ch)            (&IFS0CLR + ((DMA_IRQ(ch) >> 5) * (&IFS1 - &IFS0)))
+#define pIECxCLR(ch)            (&IEC0CLR + ((DMA_IRQ(ch) >> 5) * (&IEC1 - &IEC0)))
+#define pIECxSET(ch)            (&IEC0SET + ((DMA_IRQ(ch) >> 5) * (&IEC1 - &IEC0)))
+#define pIPCx(ch)               (&IPC0 + (((_DMA_0_VECTOR + (ch)) >> 2) * (&IPC1 - &IPC0)))
+#define IPC_SHIFT(ch)           ((((_DMA_0_VECTOR + (ch)) & 0x03) * 8) + 2)
+
+#if !defined(SERPORT_DMA_PRIORITY)
+#define SERPORT_DMA_PRIORITY    2               //DMA channel priority, 0 to 3
+#endif
+
+//Maximum number of bytes in a DMA block. PIC32MX3xx/4xx have 8-bit DCHxSSIZ and DCHxDSIZ registers, where 0 is
+//256 bytes. Larger contiguous regions are split into multiple blocks.
+#if ((__PIC32_FEATURE_SET__ >= 300) && (__PIC32_FEATURE_SET__ <= 499))
+#define SERPORT_DMA_MAX_BLOCK   256
+#else
+#define SERPORT_DMA_MAX_BLOCK   0xffff
+#endif
+
+/**
+ * Starts a DMA block for the next contiguous region of the "Circular Buffer". Nothing is done if
+ * there is no data to transmit (TX), or no space to receive (RX).
+ */
+static void serDmaStart(SERPORT_DMA* pDma) {
+    BYTE ch = pDma->ch;
+
+    if (pDma->flags & SERPORT_DMA_FLAG_TX) {
+        pDma->size = cbufGetRdArrSize(pDma->pBuf);
+        if (pDma->size == 0)
+            return;
+        if (pDma->size > SERPORT_DMA_MAX_BLOCK)
+            pDma->size = SERPORT_DMA_MAX_BLOCK;
+        *pDCHxSSA(ch) = KVA_TO_PA(cbufGetRdArr(pDma->pBuf));
+        *pDCHxDSA(ch) = KVA_TO_PA(pDma->pReg);
+        *pDCHxSSIZ(ch) = pDma->size;
+        *pDCHxDSIZ(ch) = 1;
+    }
+    else {
+        pDma->size = cbufGetWrArrSize(pDma->pBuf);
+        if (pDma->size == 0)
+            return;
+        if (pDma->size > SERPORT_DMA_MAX_BLOCK)
+            pDma->size = SERPORT_DMA_MAX_BLOCK;
+        *pDCHxSSA(ch) = KVA_TO_PA(pDma->pReg);
+        *pDCHxDSA(ch) = KVA_TO_PA(cbufGetWrArr(pDma->pBuf));
+        *pDCHxSSIZ(ch) = 1;
+        *pDCHxDSIZ(ch) = pDma->size;
+    }
+    pDma->done = 0;
+    *pDCHxCSIZ(ch) = 1;                         //One byte transferred per peripheral request
+    *pDCHxINTCLR(ch) = 0x000000fful;            //Clear all channel flags
+    *pDCHxINTSET(ch) = DCHINT_CHBCIE;           //Interrupt when block is done, serDmaIsr() starts next block
+    *pDCHxECON(ch) = (((DWORD)pDma->irq) << 8) | DCHECON_SIRQEN;
+    *pDCHxCON(ch) = DCHCON_CHEN | SERPORT_DMA_PRIORITY;
+    pDma->flags |= SERPORT_DMA_FLAG_BUSY;
+
+    //TX peripherals only request data when space becomes available, force first byte
+    if (pDma->flags & SERPORT_DMA_FLAG_TX) {
+        *pDCHxECON(ch) |= DCHECON_CFORCE;
+    }
+}
+
+
+/**
+ * Commits the DMA block that just completed to the "Circular Buffer", and starts a new block for the
+ * wrapped region of the buffer, or the next data to transmit. Common code for serDmaTask() and serDmaIsr().
+ */
+static void serDmaBlockDone(SERPORT_DMA* pDma) {
+    //TX - Bytes are only removed from buffer once whole block has been sent
+    if (pDma->flags & SERPORT_DMA_FLAG_TX) {
+        cbufRemoveBytes(pDma->pBuf, pDma->size);
+    }
+    //RX - Add rest of block to buffer
+    else {
+        cbufUpdatePut(pDma->pBuf, pDma->size - pDma->done);
+    }
+
+    //Block done, channel was disabled by hardware
+    pDma->flags &= ~SERPORT_DMA_FLAG_BUSY;
+    serDmaStart(pDma);
+}
+
+
+/**
+ * Initializes given DMA channel. Common code for serDmaInitTx() and serDmaInitRx().
+ */
+static void serDmaInit(SERPORT_DMA* pDma, BYTE ch, BYTE irq, volatile void* pReg, CIRBUF* pBuf, BYTE flags) {
+    DMACONSET = _DMACON_ON_MASK;                //Enable DMA controller
+    *pDCHxCONCLR(ch) = DCHCON_CHEN;             //Disable channel
+
+    //Channel interrupt, priority SERPORT_DMA_IPL
+    *pIECxCLR(ch) = DMA_IRQ_BIT(ch);
+    *pIPCx(ch) = (*pIPCx(ch) & ~(0x07ul << IPC_SHIFT(ch))) | (((DWORD)SERPORT_DMA_IPL) << IPC_SHIFT(ch));
+    *pIFSxCLR(ch) = DMA_IRQ_BIT(ch);
+
+    pDma->pBuf = pBuf;
+    pDma->pReg = pReg;
+    pDma->size = 0;
+    pDma->done = 0;
+    pDma->ch = ch;
+    pDma->irq = irq;
+    pDma->flags = flags;
+    *pIECxSET(ch) = DMA_IRQ_BIT(ch);
+}
+
+
+void serDmaInitTx(SERPORT_DMA* pDma, BYTE ch, BYTE irq, volatile void* pReg, CIRBUF* pBuf) {
+    serDmaInit(pDma, ch, irq, pReg, pBuf, SERPORT_DMA_FLAG_TX);
+}
+
+
+void serDmaInitRx(SERPORT_DMA* pDma, BYTE ch, BYTE irq, volatile void* pReg, CIRBUF* pBuf) {
+    serDmaInit(pDma, ch, irq, pReg, pBuf, SERPORT_DMA_FLAG_RX);
+    serDmaStart(pDma);
+}
+
+
+void serDmaTask(SERPORT_DMA* pDma) {
+    WORD ptr;
+    BYTE ch = pDma->ch;
+
+    //Disable channel interrupt, serDmaIsr() also updates the "Circular Buffer" and starts blocks
+    *pIECxCLR(ch) = DMA_IRQ_BIT(ch);
+
+    if ((pDma->flags & SERPORT_DMA_FLAG_BUSY) == 0) {
+        serDmaStart(pDma);
+    }
+    //Block done, but interrupt not serviced yet
+    else if (*pDCHxINT(ch) & DCHINT_CHBCIF) {
+        serDmaBlockDone(pDma);
+    }
+    //RX - Add bytes received so far to buffer. Read DPTR before CHBCIF, DPTR is reset to 0 when block completes.
+    else if (pDma->flags & SERPORT_DMA_FLAG_RX) {
+        ptr = *pDCHxDPTR(ch);
+        if ((*pDCHxINT(ch) & DCHINT_CHBCIF) == 0) {
+            if (ptr > pDma->done) {
+                cbufUpdatePut(pDma->pBuf, ptr - pDma->done);
+                pDma->done = ptr;
+            }
+        }
+    }
+
+    *pIECxSET(ch) = DMA_IRQ_BIT(ch);
+}
+
+
+void serDmaIsr(SERPORT_DMA* pDma) {
+    BYTE ch = pDma->ch;
+
+    *pIFSxCLR(ch) = DMA_IRQ_BIT(ch);
+
+    //Block could already have been committed by serDmaTask()
+    if (((pDma->flags & SERPORT_DMA_FLAG_BUSY) == 0) || ((*pDCHxINT(ch) & DCHINT_CHBCIF) == 0))
+        return;
+
+    serDmaBlockDone(pDma);
+}
+
+
+void serDmaStop(SERPORT_DMA* pDma) {
+    WORD ptr;
+    BYTE ch = pDma->ch;
+
+    *pDCHxCONCLR(ch) = DCHCON_CHEN;
+    *pIECxCLR(ch) = DMA_IRQ_BIT(ch);
+    if ((pDma->flags & SERPORT_DMA_FLAG_BUSY) == 0)
+        return;
+    pDma->flags &= ~SERPORT_DMA_FLAG_BUSY;
+
+    if (pDma->flags & SERPORT_DMA_FLAG_TX) {
+        //Remove bytes already sent
+        ptr = (*pDCHxINT(ch) & DCHINT_CHBCIF) ? pDma->size : *pDCHxSPTR(ch);
+        cbufRemoveBytes(pDma->pBuf, ptr);
+    }
+    else {
+        ptr = (*pDCHxINT(ch) & DCHINT_CHBCIF) ? pDma->size : *pDCHxDPTR(ch);
+        if (ptr > pDma->done)
+            cbufUpdatePut(pDma->pBuf, ptr - pDma->done);
+    }
+}
+#endif  //#if defined(SERPORT_USE_DMA)
+
 #endif  //#if defined(HAS_A_SERPORT)
\ No newline at end of file
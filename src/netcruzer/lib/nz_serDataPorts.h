@@ -646,6 +646,115 @@ typedef struct __attribute__((__packed__))
 
 
 
+/////////////////////////////////////////////////
+// "Serial Data Port" DMA
+//
+// Optional DMA backend, moves data directly between a "Serial Data Port" "Circular Buffer"
+// and a peripheral register (UxTXREG, UxRXREG, SPIxBUF). Each DMA block is the largest contiguous
+// region of the "Circular Buffer" (cbufGetRdArr() or cbufGetWrArr()), up to 256 bytes on PIC32MX3xx/4xx.
+// When a block is done, the DMA channel interrupt (serDmaIsr()) commits it and starts a new block for
+// the rest of the data, or the wrapped region of the buffer.
+//
+// Enable for a port by defining SERPORT_UARTx_USE_DMA in projdefs.h. Only available on PIC32MX,
+// the PIC24FJ GB1/GB2 devices used on the SBC66 boards do not have a DMA controller.
+/////////////////////////////////////////////////
+#if defined(SERPORT_UART1_USE_DMA) || defined(SERPORT_UART2_USE_DMA) || defined(SERPORT_UART3_USE_DMA) || defined(SERPORT_UART4_USE_DMA)
+    #if !defined(SERPORT_USE_DMA)
+    #define SERPORT_USE_DMA
+    #endif
+#endif
+
+#if defined(SERPORT_USE_DMA)
+#if !defined(__PIC32MX__)
+#error "SERPORT_USE_DMA requires a target with a DMA controller (PIC32MX)!"
+#endif
+
+#define SERPORT_DMA_FLAG_TX         0x01    ///< Transfers from "Circular Buffer" to peripheral
+#define SERPORT_DMA_FLAG_RX         0x02    ///< Transfers from peripheral to "Circular Buffer"
+#define SERPORT_DMA_FLAG_BUSY       0x80    ///< DMA block is currently active
+
+#define SERPORT_DMA_IPL             5       ///< Priority of DMA channel interrupts, must match ipl of ISRs calling serDmaIsr()
+
+/**
+ * DMA channel used by a "Serial Data Port" for one direction
+ */
+typedef struct SERPORT_DMA_
+{
+    CIRBUF*         pBuf;       ///< "Circular Buffer" data is moved to or from
+    volatile void*  pReg;       ///< Peripheral data register, for example UxTXREG, UxRXREG or SPIxBUF
+    WORD            size;       ///< Number of bytes in current DMA block
+    WORD            done;       ///< RX only, number of bytes of current block already committed to pBuf
+    BYTE            ch;         ///< DMA channel, 0 to 3
+    BYTE            irq;        ///< Peripheral IRQ number that triggers transfer of each byte
+    BYTE            flags;      ///< SERPORT_DMA_FLAG_XX flags
+} SERPORT_DMA;
+
+
+/**
+ * Initializes given DMA channel for transmitting data from given "Circular Buffer" to a peripheral.
+ * Transfers are started by serDmaTask().
+ *
+ * @param pDma Pointer to SERPORT_DMA structure to initialize
+ * @param ch DMA channel to use, 0 to 3
+ * @param irq Peripheral IRQ that requests next byte, for example _UART1_TX_IRQ
+ * @param pReg Peripheral register to write to, for example &U1TXREG
+ * @param pBuf "Circular Buffer" containing data to transmit
+ */
+void serDmaInitTx(SERPORT_DMA* pDma, BYTE ch, BYTE irq, volatile void* pReg, CIRBUF* pBuf);
+
+
+/**
+ * Initializes given DMA channel for receiving data from a peripheral to given "Circular Buffer",
+ * and starts the first transfer.
+ *
+ * @param pDma Pointer to SERPORT_DMA structure to initialize
+ * @param ch DMA channel to use, 0 to 3
+ * @param irq Peripheral IRQ that indicates a byte is available, for example _UART1_RX_IRQ
+ * @param pReg Peripheral register to read from, for example &U1RXREG
+ * @param pBuf "Circular Buffer" to write received data to
+ */
+void serDmaInitRx(SERPORT_DMA* pDma, BYTE ch, BYTE irq, volatile void* pReg, CIRBUF* pBuf);
+
+
+/**
+ * Services given DMA channel. For TX, starts a new block if the channel is idle and there is data. For
+ * RX, adds bytes received so far in the current block to the "Circular Buffer". Completed blocks are
+ * handled by serDmaIsr(), or here if its interrupt is still pending. Must be called regularly by the
+ * "Serial Data Port" task, does not block.
+ *
+ * @param pDma Pointer to SERPORT_DMA structure
+ */
+void serDmaTask(SERPORT_DMA* pDma);
+
+
+/**
+ * Must be called by the interrupt of given DMA channel, with priority SERPORT_DMA_IPL. Clears the
+ * interrupt flag. If the block is done, commits it to the "Circular Buffer" and starts the next block.
+ *
+ * @param pDma Pointer to SERPORT_DMA structure
+ */
+void serDmaIsr(SERPORT_DMA* pDma);
+
+
+/**
+ * Stops given DMA channel. For RX, bytes already received are added to the "Circular Buffer".
+ *
+ * @param pDma Pointer to SERPORT_DMA structure
+ */
+void serDmaStop(SERPORT_DMA* pDma);
+
+
+/**
+ * Returns TRUE if a DMA block is active for given channel.
+ *
+ * @param pDma Pointer to SERPORT_DMA structure
+ */
+#define serDmaIsBusy(pDma) (((pDma)->flags & SERPORT_DMA_FLAG_BUSY) != 0)
+
+#endif  //#if defined(SERPORT_USE_DMA)
+
+
+
 /////////////////////////////////////////////////
 // "Serial Data Port" includes and Macros
 /////////////////////////////////////////////////
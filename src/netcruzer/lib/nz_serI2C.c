@@ -46,6 +46,7 @@
 #include "nz_serI2C.h"
 #include "nz_helpers.h"
 #include "nz_helpersCx.h"
+#include "nz_statusMap.h"
 
 
 //Add debugging to this file. The DEBUG_CONF_SERPORTI2C macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
@@ -99,7 +100,13 @@ enum SM_I2C_ISR_ {
     SM_ISR_MASTER_TX,
     SM_ISR_STOP,
     SM_ISR_MASTER_RX,
-    SM_ISR_MASTER_ACK
+    SM_ISR_MASTER_ACK,
+    SM_ISR_JOB_START,       //START or REPEATED START for next I2C_JOB just sent
+    SM_ISR_JOB_TX,          //Address or data byte of I2C_JOB just sent
+    SM_ISR_JOB_RSTART,      //REPEATED START for reading just sent
+    SM_ISR_JOB_RXADR,       //Address for reading just sent
+    SM_ISR_JOB_RX,          //Byte just read
+    SM_ISR_JOB_ACK          //ACK or NACK just sent
 } I2C_SM_ISR;
 
 enum SM_I2C_TASK_ {
@@ -545,6 +552,14 @@ BYTE i2c1ReadToArray(BYTE* buf, BYTE size) {
     return i2cReadToArray(&i2c1Info, buf, size);
 }
 
+void i2c1JobAdd(I2C_JOB* pJob) {
+    i2cJobAdd(&i2c1Info, pJob);
+}
+
+BYTE i2c1JobAddWait(I2C_JOB* pJob) {
+    return i2cJobAddWait(&i2c1Info, pJob);
+}
+
 BYTE i2c1ReadSlaveReg(BYTE adr, BYTE reg, BYTE* buf, BYTE size) {
     return i2cReadSlaveReg(&i2c1Info, adr, reg, buf, size);
 }
@@ -554,6 +569,48 @@ BYTE i2c1ReadSlaveReg(BYTE adr, BYTE reg, BYTE* buf, BYTE size) {
 
 #define I2C1_ISR_DETAILED_DEBUG_INFO
 
+#if defined(__C30__)
+/**
+ * Completes the I2C_JOB currently executed by ISR. Sets it's status, adds status to the status map,
+ * and calls it's callback. Is called from ISR.
+ */
+static void i2cJobComplete(I2C_INFO* objI2C, BYTE status) {
+    I2C_JOB* pJob;
+
+    pJob = objI2C->pJobRun;
+    objI2C->pJobRun = NULL;
+    statusMapPut(objI2C, pJob->adr, status);
+    pJob->status = status;
+    if (pJob->callback != NULL) {
+        pJob->callback(pJob);
+    }
+}
+
+
+/**
+ * Completes the I2C_JOB currently executed by ISR. If there are more jobs in queue, puts a REPEATED
+ * START on the bus for next job. Else, puts a STOP on bus. Is called from ISR.
+ */
+static void i2cJobDone(I2C_INFO* objI2C, BYTE status) {
+    volatile unsigned int* pI2CCON;
+    pI2CCON = pI2CxCON(objI2C->flags.ch);
+
+    objI2C->isrAdr = objI2C->pJobRun->adr;
+    i2cJobComplete(objI2C, status);
+
+    //More jobs, no STOP between jobs
+    if (objI2C->pJobHead != NULL) {
+        objI2C->isr.bits.sm = SM_ISR_JOB_START;
+        ((I2C1CONBITS*)pI2CCON)->RSEN = 1;  //Put Repeated START on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+    }
+    else {
+        objI2C->isr.bits.isrTxionStatus = status;
+        objI2C->isr.bits.sm = SM_ISR_STOP;
+        ((I2C1CONBITS*)pI2CCON)->PEN = 1;   //Put STOP on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+    }
+}
+#endif
+
 void i2cISR(I2C_INFO* objI2C)
 {
 #if defined(__C30__)
@@ -896,11 +953,23 @@ void i2cISR(I2C_INFO* objI2C)
             #ifdef I2C1_ISR_DETAILED_DEBUG_INFO
             DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\ni2c P");
             #endif
+            //STOP was forced by task (timeout) while executing a job. i2cJobComplete() adds status for job's address to map
+            if (objI2C->pJobRun != NULL) {
+                i2cJobComplete(objI2C, objI2C->isr.bits.isrTxionStatus);
+            }
             //Add status for current address to Address-Status Map
-            statusMapPut(objI2C, objI2C->isrAdr, objI2C->isr.bits.isrTxionStatus);
+            else {
+                statusMapPut(objI2C, objI2C->isrAdr, objI2C->isr.bits.isrTxionStatus);
+            }
 
             objI2C->isrCnt++;                 //Incremented for each STOP sent
             objI2C->isr.bits.sm=SM_ISR_IDLE;  //Reset state machine to idle
+
+            //Start next queued job immediately, no need to wait for task
+            if (objI2C->pJobHead != NULL) {
+                objI2C->isr.bits.sm = SM_ISR_JOB_START;
+                ((I2C1CONBITS*)pI2CCON)->SEN = 1;   //Put START on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+            }
             break;
         }
         case SM_ISR_MASTER_RX:  //Just finished reading a byte
@@ -981,6 +1050,94 @@ void i2cISR(I2C_INFO* objI2C)
             }
             break;
         }
+        case SM_ISR_JOB_START:  //Just finished sending START or REPEATED START for next job
+        {
+            I2C_JOB* pJob;
+
+            //Remove next job from queue
+            pJob = objI2C->pJobHead;
+            objI2C->pJobHead = pJob->pNext;
+            objI2C->pJobRun = pJob;
+            objI2C->jobIdx = 0;
+            objI2C->isr.bits.sAddress = 1;      //Mark that Address following START was just sent
+            objI2C->timeout = tick16Get() + tick16ConvertFromMS(I2C_TIMEOUT); //ISR Timeout, for each job
+
+            //Nothing to write, start reading immediately
+            if ((pJob->wrSize == 0) && (pJob->rdSize != 0)) {
+                *((BYTE*)I2CTRN_ARR[objI2C->flags.ch]) = pJob->adr | 0x01;
+                objI2C->isr.bits.sm = SM_ISR_JOB_RXADR;
+            }
+            else {
+                *((BYTE*)I2CTRN_ARR[objI2C->flags.ch]) = pJob->adr & 0xfe;
+                objI2C->isr.bits.sm = SM_ISR_JOB_TX;
+            }
+            break;
+        }
+        case SM_ISR_JOB_TX:     //Just finished sending address or data byte of job
+        {
+            I2C_JOB* pJob = objI2C->pJobRun;
+
+            //ERROR!!!! NO ACK received
+            if (((I2C1STATBITS*)pI2CxSTAT(objI2C->flags.ch))->ACKSTAT == TRUE) {    //cast to I2C1STATBITS, because all I2CxSTATBITS vars have the same bits!
+                DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nERR: Job NoACK");
+                i2cJobDone(objI2C, objI2C->isr.bits.sAddress ? I2C_TXION_STATUS_ERR_ADR_NOACK : I2C_TXION_STATUS_ERR_DAT_NOACK);
+            }
+            //Write next byte
+            else if (objI2C->jobIdx < pJob->wrSize) {
+                *((BYTE*)I2CTRN_ARR[objI2C->flags.ch]) = pJob->pWr[objI2C->jobIdx++];
+            }
+            //Done writing, send REPEATED START for reading
+            else if (pJob->rdSize != 0) {
+                ((I2C1CONBITS*)pI2CCON)->RSEN = 1;  //Put Repeated START on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+                objI2C->isr.bits.sm = SM_ISR_JOB_RSTART;
+            }
+            else {
+                i2cJobDone(objI2C, I2C_TXION_STATUS_OK);
+            }
+            objI2C->isr.bits.sAddress = 0;
+            break;
+        }
+        case SM_ISR_JOB_RSTART: //Just finished sending REPEATED START for reading
+        {
+            *((BYTE*)I2CTRN_ARR[objI2C->flags.ch]) = objI2C->pJobRun->adr | 0x01;
+            objI2C->isr.bits.sm = SM_ISR_JOB_RXADR;
+            break;
+        }
+        case SM_ISR_JOB_RXADR:  //Just finished sending address for reading
+        {
+            if (((I2C1STATBITS*)pI2CxSTAT(objI2C->flags.ch))->ACKSTAT == TRUE) {    //cast to I2C1STATBITS, because all I2CxSTATBITS vars have the same bits!
+                DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nERR: Job NoACK");
+                i2cJobDone(objI2C, I2C_TXION_STATUS_ERR_ADR_NOACK);
+                break;
+            }
+            objI2C->jobIdx = 0;
+            ((I2C1CONBITS*)pI2CCON)->RCEN = 1;      //Read a byte (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+            objI2C->isr.bits.sm = SM_ISR_JOB_RX;
+            break;
+        }
+        case SM_ISR_JOB_RX:     //Just finished reading a byte
+        {
+            I2C_JOB* pJob = objI2C->pJobRun;
+
+            pJob->pRd[objI2C->jobIdx++] = *((BYTE*)I2CRCV_ARR[objI2C->flags.ch]);
+
+            //Put ACK if more bytes to read, else NACK (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+            ((I2C1CONBITS*)pI2CCON)->ACKDT = (objI2C->jobIdx < pJob->rdSize) ? 0 : 1;
+            ((I2C1CONBITS*)pI2CCON)->ACKEN = 1;
+            objI2C->isr.bits.sm = SM_ISR_JOB_ACK;
+            break;
+        }
+        case SM_ISR_JOB_ACK:    //Just finished sending an ACK or NACK
+        {
+            if (objI2C->jobIdx < objI2C->pJobRun->rdSize) {
+                ((I2C1CONBITS*)pI2CCON)->RCEN = 1;  //Read a byte (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+                objI2C->isr.bits.sm = SM_ISR_JOB_RX;
+            }
+            else {
+                i2cJobDone(objI2C, I2C_TXION_STATUS_OK);
+            }
+            break;
+        }
     }
 #elif defined(__PIC32MX__)
 #endif
@@ -1050,6 +1207,16 @@ void serI2CTask(I2C_INFO* objI2C)
             //Check for locked I2C bus
             i2cCheckBus(objI2C->flags.ch);
 
+            //Queued jobs that could not be started when added (task was busy with escape-string message)
+            if (objI2C->pJobHead != NULL) {
+                i2cWriteMI2CIE(objI2C->flags.ch, 0);    //Disable I2C interrupt
+                objI2C->isr.bits.sm = SM_ISR_JOB_START;
+                objI2C->timeout = tick16Get() + tick16ConvertFromMS(I2C_TIMEOUT); //ISR Timeout
+                i2cWriteMI2CIE(objI2C->flags.ch, 1);    //Enable I2C interrupt
+                ((I2C1CONBITS*)pI2CCON)->SEN = 1;       //Put START on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+                return;
+            }
+
             //Message must start with "Escape Character", followed by START "Control Character", remove all other data
             while (cbufHasData(objI2C->pCbufTx)) {
                 //If next character in buffer is NOT the "Escape Character", remove it!
@@ -1419,6 +1586,54 @@ BYTE i2cGetStatusWait(I2C_INFO* objI2C, BYTE adr) {
     return i2cGetStatus(objI2C, adr);
 }
 
+void i2cJobAdd(I2C_INFO* objI2C, I2C_JOB* pJob) {
+#if defined(__C30__)
+    volatile unsigned int* pI2CCON;
+    pI2CCON = pI2CxCON(objI2C->flags.ch);
+
+    pJob->pNext = NULL;
+    pJob->status = I2C_JOB_STATUS_PENDING;
+
+    i2cWriteMI2CIE(objI2C->flags.ch, 0);    //Disable I2C interrupt, ISR removes jobs from queue
+
+    //Add to end of queue. Tail is only valid if queue is not empty
+    if (objI2C->pJobHead == NULL)
+        objI2C->pJobHead = pJob;
+    else
+        objI2C->pJobTail->pNext = pJob;
+    objI2C->pJobTail = pJob;
+
+    //Bus is idle, start job now. Else it is started by ISR when current message or job is done.
+    //Don't start if task is about to start an escape-string message.
+    if ((objI2C->isr.bits.sm == SM_ISR_IDLE) && (objI2C->taskSm == SM_I2C_TASK_IDLE)) {
+        objI2C->isr.bits.sm = SM_ISR_JOB_START;
+        objI2C->timeout = tick16Get() + tick16ConvertFromMS(I2C_TIMEOUT); //ISR Timeout
+        ((I2C1CONBITS*)pI2CCON)->SEN = 1;   //Put START on bus (cast to I2C1CONBITS, because all I2CnCONBITS vars have the same bits!)
+    }
+
+    i2cWriteMI2CIE(objI2C->flags.ch, 1);    //Enable I2C interrupt
+#elif defined(__PIC32MX__)
+    //I2C ISR is not implemented for PIC32MX, reject job
+    pJob->pNext = NULL;
+    pJob->status = I2C_TXION_STATUS_ERROR;
+    DEBUG_PUT_STR(DEBUG_LEVEL_ERROR, "\ni2cJobAdd() not supported on PIC32MX!");
+    if (pJob->callback != NULL) {
+        pJob->callback(pJob);
+    }
+#endif
+}
+
+BYTE i2cJobAddWait(I2C_INFO* objI2C, I2C_JOB* pJob) {
+    i2cJobAdd(objI2C, pJob);
+
+    //Task forces a STOP if ISR times out, which completes the job
+    while(pJob->status == I2C_JOB_STATUS_PENDING) {
+        serI2CTask(objI2C);
+    }
+    return pJob->status;
+}
+
+
 #if defined I2C_USE_SHARED_FUNCTIONS
 BYTE i2cIsBusy(I2C_INFO* objI2C) {
     //Return TRUE if the ISR is NOT in the idle state!
@@ -1714,186 +1929,34 @@ BYTE i2cReadSlaveReg(I2C_INFO* objI2C, BYTE adr, BYTE reg, BYTE* buf, BYTE size)
  * If not found, returns 0xff.
  *
  * IMPORTANT not to add or remove key-status pairs! Only statusMapPut (interrupt ISR) can
- * do that!
+ * do that! The I2C interrupt is only disabled once, while the (at most 2) slots for key are checked.
  *
  * @param key
  * @return
  */
 BYTE statusMapGet(I2C_INFO* objI2C, BYTE key) {
-    BYTE ret = 0xff;    //Not found
-    WORD   c;
+    BYTE ret;
 
     //Clear bit 0 of key (I2C address). Bit 0 is NOT part of the address
     key = key & 0xfe;
 
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    BYTE*  pCurr;
-//    pCurr = objI2C->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nstatusMapGet  Pre: ");
-//    for(c=I2C_STATUS_BUF_SIZE ; c!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        c -= 2;
-//    }
-//    #endif
-
-    //Search for entry with given key, and mark it as available (set status to 0xff)
-    //if found.
-    //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nSearch");
-    for(c=0; c<I2C_STATUS_BUF_SIZE; c+=2) {
-        //DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '.');
-
-        //NZ_BUILTIN_DISI(0x3FFF);               //Disable all interrupts, excluding level 7
-        i2cWriteMI2CIE(objI2C->flags.ch, 0);    //Disable I2C interrupt for this channel
-
-        //Current entry is equal to current key (ignore bit 0 of adr!), use it.
-        if(objI2C->bufStat[c] == key) {
-            //DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, 'F');
-            ret = objI2C->bufStat[c+1];     //Get status for this key
-            objI2C->bufStat[c+1] = 0xff;    //Mark current key-status pair as available
-
-            //NZ_BUILTIN_DISI(0x0000);               //Enable interrupts
-            i2cWriteMI2CIE(objI2C->flags.ch, 1);    //Enable I2C interrupt for this channel
-
-//            //Move all pairs one position down. ONLY do this if current pair is NOT top pair!
-//            if (c < (I2C_STATUS_BUF_SIZE-2)) {
-//                BYTE*  pSrc;
-//                DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, 'R');
-//                pCurr = &objI2C->bufStat[c];
-//                pSrc = pCurr+2; //Source is one pair higher in map
-//                // - Ensure size IS NOT 0
-//                // - Note dst and src will be incremented by this macro!
-//                //*((volatile BYTE*)(&c)) = I2C_STATUS_BUF_SIZE-2-c;
-//                c = I2C_STATUS_BUF_SIZE-2-c;
-//                nzMemCpy_ASM_RRR(pCurr, pSrc, c);
-//                //nzMemCpy_ASM_RRR(pCurr, pSrc, I2C_STATUS_BUF_SIZE-2-c);
-//                //Alternative using nzMemCpyNoCheck() or memcpy. Will NOT increment pointers!
-//                //nzMemCpyNoCheck(pCurr, pSrc, c);
-//                //nzMemCpy(pCurr, pSrc, c);
-//            }
-            break;
-        }
-
-        //NZ_BUILTIN_DISI(0x0000);               // Enable interrupts
-        i2cWriteMI2CIE(objI2C->flags.ch, 1);    //Enable I2C interrupt for this channel
-    }
-
-
-//    if (ret == 0xff) {
-//    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    BYTE*  pCurr;
-//    pCurr = objI2C->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nstatusMapGet Post: ");
-//    for(c=I2C_STATUS_BUF_SIZE ; c!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        c -= 2;
-//    }
-//    #endif
-//    }
+    i2cWriteMI2CIE(objI2C->flags.ch, 0);    //Disable I2C interrupt for this channel
+    ret = statusMapTake(objI2C->bufStat, I2C_STATUS_BUF_SIZE, key);
+    i2cWriteMI2CIE(objI2C->flags.ch, 1);    //Enable I2C interrupt for this channel
 
-    return ret;    //Not found
+    return ret;
 }
 
 /**
- * Add given key-status pair to bottom of map, moving existing items one position
- * up (effectively removing top pair).
+ * Add given key-status pair to map. Is called from ISR. See statusMapSet() in nz_statusMap.h for details.
  *
- * DETAILS:
- * Search for key-status pair with key=given key, OR status=0xff (marked available).
- * If found:
- * - Move all lower pairs one position up, effectively removing found pair
- *
- * If NOT found:
- * - Move all map pairs one position up, effectively removing top entry
- *
- * When done moving pairs up:
- * - Add new entry to bottom of map
- * 
  * @param key
  * @param status
  * @return
  */
 void statusMapPut(I2C_INFO* objI2C, BYTE key, BYTE status) {
-    WORD idx;
-    BYTE* volatile pCurr;
-    BYTE* volatile pSrc;
-
     //Clear bit 0 of key (I2C address). Bit 0 is NOT part of the address
-    key = key & 0xfe;
-
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    pCurr = objI2C->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nstatusMapPut  Pre: ");
-//    for(idx=I2C_STATUS_BUF_SIZE ; idx!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        idx -= 2;
-//    }
-//    #endif
-
-    /////////////////////////////////////////////////
-    //Search for key-status pair with key=given key, OR status=0xff (marked available).
-    //If found:
-    //- Move all lower pairs one position up, effectively removing found pair
-    //
-    //If NOT found:
-    //- Move all map pairs one position up, effectively removing top entry
-    //
-    //When done moving pairs up:
-    //- Add new entry to bottom of map
-    for(idx=0; idx<I2C_STATUS_BUF_SIZE; idx+=2) {
-        //Key of current entry is equal to current key, use it.
-        if(objI2C->bufStat[idx] == key) {
-            break;
-        }
-        //Status of current entry = 0xff (marked available), break
-        if (objI2C->bufStat[idx+1] == 0xff)
-            break;
-    }
-    //Move all lower pairs one position up, effectively removing found pair. Only continue if
-    //NOT first pair, seeing that first pair is overwritten in next step bellow, effectively removing it.
-    if (idx!=0) {
-        //If NOT found, reduce idx to second last pair.
-        if (idx == I2C_STATUS_BUF_SIZE)
-            idx = I2C_STATUS_BUF_SIZE-2;
-
-        pCurr = &objI2C->bufStat[idx+1];    //Address of "status" part of key-status pair just found
-        pSrc = pCurr-2;                     //Source is one pair lower in map
-
-        nzMemCpyDecNoOut_ASM_RRR(pCurr, pSrc, idx);
-        //nzMemCpyDec_ASM_RRR(pCurr, pSrc, idx);
-        //nzMemCpyDecNoCheck(pCurr, pSrc, idx);
-        //while(idx--!=0) {
-        //    *pCurr-- = *pSrc--;
-        //}
-    }
-
-    //Write given key-status pair to bottom of map
-    objI2C->bufStat[0] = key;
-    objI2C->bufStat[1] = status;
-
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    pCurr = objI2C->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nstatusMapPut Post: ");
-//    for(idx=I2C_STATUS_BUF_SIZE ; idx!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        idx -= 2;
-//    }
-//    #endif
+    statusMapSet(objI2C->bufStat, I2C_STATUS_BUF_SIZE, key & 0xfe, status);
 }
 
 #endif  //#if defined(HAS_SERPORT_I2C)
\ No newline at end of file
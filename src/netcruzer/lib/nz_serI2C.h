@@ -275,13 +275,39 @@
  }
  @endcode
 
- The status of the last 4 transmissions are stored, and can be requested by passing
+ The status of the last transmissions are stored, and can be requested by passing
  the address of the slave in the "adr" parameter of the i2c1GetStatus() function. Passing 0 to
  this function will return the status of the last transmission. This function is useful
  when sending an I2C message, and checking the status at a later stage. If other tasks also
  send I2C messages to other slaves, this function can be used to be sure to get the status
  of the desired message.
 
+ <!-- - - I2C Job Queue - - -->
+ @subsection nz_seri2c_job_queue I2C Job Queue
+ For drivers doing many small transactions, the i2c1JobAdd() function can be used in stead of the
+ escape-string functions. Each I2C_JOB describes a single transaction (address, bytes to write,
+ buffer for bytes to read and a callback). Queued jobs are executed back-to-back by the I2C ISR,
+ separated by a REPEATED START, without waiting for serI2CTask(). For example:
+ @code
+ static BYTE reg = 0x00;
+ static BYTE buf[2];
+ static I2C_JOB job;
+ job.adr = 0x50;
+ job.pWr = &reg;
+ job.wrSize = 1;
+ job.pRd = buf;
+ job.rdSize = 2;
+ job.callback = NULL;
+ i2c1JobAdd(&job);
+ ...
+ if (job.status != I2C_JOB_STATUS_PENDING) {
+     //Job done, status is a I2C_TXION_STATUS_XX value
+ }
+ @endcode
+
+To wait till a job is done, use i2cJobAddWait(). The job can then be on the stack. For an example,
+see rtcI2CJob() in nz_rtc.c, the RTC driver does all its I2C transactions with jobs.
+
  <!-- - - Port Independent I2C Functions - - -->
  @subsection nz_seri2c_port_independent Port Independent I2C Functions
  In stead of using the normal port specific i2c1Xxx(), i2c2Xxx() and i2c3Xxx() functions,
@@ -698,14 +724,46 @@ typedef struct __attribute__((__packed__)) I2C_ISR_SMFLAGS_
     };
 } I2C_ISR_SMFLAGS;
 
-//Must be a power of two value: 4,8,16,32,64
-#define I2C_STATUS_BUF_SIZE 8
+//Size of status map, 2 bytes per entry. Must be a power of two value: 8,16,32,64
+#if !defined(I2C_STATUS_BUF_SIZE)
+#define I2C_STATUS_BUF_SIZE 16
+#endif
+
+//I2C_JOB.status value while job is queued or being executed
+#define I2C_JOB_STATUS_PENDING  0xFE
+
+struct I2C_JOB_;
+
+/**
+ * Function called by I2C ISR when a I2C_JOB is done. Is called from interrupt context, keep it short!
+ * Can call i2cJobAdd() to queue a follow up job.
+ */
+typedef void (*I2C_JOB_CALLBACK)(struct I2C_JOB_* pJob);
+
+/**
+ * I2C Job descriptor, see i2cJobAdd(). The job is executed by the I2C ISR. It writes wrSize bytes
+ * from pWr to the slave, followed by a REPEATED START and reading rdSize bytes to pRd. Queued jobs
+ * are executed back-to-back, separated by a REPEATED START. A STOP is only put on the bus after
+ * the last job in the queue. Memory is owned by the caller, and must stay valid till status is no
+ * longer I2C_JOB_STATUS_PENDING.
+ */
+typedef struct I2C_JOB_
+{
+    BYTE*               pWr;        ///< Bytes to write to slave, can be NULL if wrSize is 0
+    BYTE*               pRd;        ///< Buffer for bytes read from slave, can be NULL if rdSize is 0
+    I2C_JOB_CALLBACK    callback;   ///< Called from ISR when job is done, can be NULL
+    struct I2C_JOB_*    pNext;      ///< Used internally for queue, don't modify
+    BYTE                adr;        ///< 8-bit I2C slave address, bit 0 (R/W) is ignored
+    BYTE                wrSize;     ///< Number of bytes to write
+    BYTE                rdSize;     ///< Number of bytes to read
+    volatile BYTE       status;     ///< I2C_TXION_STATUS_XX when done, or I2C_JOB_STATUS_PENDING
+} I2C_JOB;
 
 typedef struct I2C_INFO_
 //typedef struct __attribute__((__packed__)) I2C_INFO_
 //typedef struct __attribute__((aligned(2), packed)) I2C_INFO_
 {
-    //Buffer containing status. Two bytes are used for each entry, the LSB=Address (0=empty), and MSB=Status.
+    //Status map, hash table indexed by address, see nz_statusMap.h. Two bytes are used for each entry, the LSB=Address (0=empty), and MSB=Status.
     BYTE            bufStat[I2C_STATUS_BUF_SIZE];
     //BYTE            putStat;    //Put pointer to bufStat. Points to last entry added.
     BYTE            adr;        //Used by non-ISR functions to remember current slave address
@@ -713,7 +771,7 @@ typedef struct I2C_INFO_
     BYTE            isrAdr;     //Used in ISR - address of slave
     BYTE            isrCnt;     //Incremented in ISR each time a STOP condition is put on the bus
     BYTE            isrRead;    //Used in ISR - number of bytes to to read
-    BYTE            fillByte;
+    BYTE            jobIdx;     //Used in ISR - index of next byte to write or read for pJobRun
     
     WORD            isrRdDest;  //Destination for read, meaning depends on value of i2c1.isr.bits.wrDstType
                                 // - When 0, bits 0-15 indicates which "Circular Buffer" listeners are destinations (0=default)
@@ -722,6 +780,9 @@ typedef struct I2C_INFO_
     CIRBUF*         pCbufTx;
     CIRBUF*         pCbufRx;
     I2C_ISR_SMFLAGS isr;        //ISR State machine AND flags.
+    I2C_JOB*        pJobHead;   //First queued I2C_JOB, NULL if none. Removed by ISR when job is started
+    I2C_JOB*        pJobTail;   //Last queued I2C_JOB
+    I2C_JOB*        pJobRun;    //I2C_JOB currently executed by ISR, NULL if none
     union {
         struct
         {
@@ -1054,6 +1115,39 @@ BYTE i2cReadToArray(I2C_INFO* objI2C, BYTE* buf, BYTE size);
  */
 BYTE i2cReadSlaveReg(I2C_INFO* objI2C, BYTE adr, BYTE reg, BYTE* buf, BYTE size);
 
+
+/**
+ * Adds given job to the I2C job queue. The adr, pWr, wrSize, pRd, rdSize and callback members
+ * of the job must be set. The job is executed in the background by the I2C ISR. Queued jobs are
+ * executed back-to-back, using a REPEATED START between jobs, and a single STOP after the last
+ * job. If the bus is idle, the job is started immediately.
+ *
+ * Jobs and messages added with the escape-string functions (i2cBeginTransmission(), i2cWrite(),
+ * i2cWriteAsciiEscString()...) share the bus. Queued jobs are started by the ISR as soon as the
+ * current message ends.
+ *
+ * When done, the job's status is set to a I2C_TXION_STATUS_XX value, it is added to the status
+ * map (see i2cGetStatus()), and the callback is called from the ISR. On PIC32MX the I2C ISR is not
+ * implemented yet, the job is rejected with status I2C_TXION_STATUS_ERROR, and the callback is called
+ * before this function returns.
+ *
+ * @param objI2C The I2C bus to use. Use I2Cx_INFO defines, for example I2C1_INFO = I2C 1.
+ * @param pJob The job to add. Must not already be queued.
+ */
+void i2cJobAdd(I2C_INFO* objI2C, I2C_JOB* pJob);
+
+/**
+ * Adds given job to the I2C job queue, and waits till it is done. See i2cJobAdd() for details. The job
+ * can be on the stack, because it is not used by the ISR after this function returns.
+ *
+ * On PIC32MX the I2C ISR is not implemented yet, and jobs are rejected with I2C_TXION_STATUS_ERROR.
+ *
+ * @param objI2C The I2C bus to use. Use I2Cx_INFO defines, for example I2C1_INFO = I2C 1.
+ * @param pJob The job to add. Must not already be queued.
+ * @return The job's status, 0 (I2C_TXION_STATUS_OK) if successful, else a I2C_TXION_STATUS_ERR_XX error.
+ */
+BYTE i2cJobAddWait(I2C_INFO* objI2C, I2C_JOB* pJob);
+
 /**
  * Reads a single byte from the Receive Queue(Circular Buffer). They can be read
  * with the i2c1Read... functions.
@@ -1501,6 +1595,23 @@ BYTE i2c1ReadToArray(BYTE* buf, BYTE size);
 BYTE i2c1ReadSlaveReg(BYTE adr, BYTE reg, BYTE* buf, BYTE size);
 
 
+/**
+ * Adds given job to the I2C 1 job queue, see i2cJobAdd() for details.
+ *
+ * @param pJob The job to add. Must not already be queued.
+ */
+void i2c1JobAdd(I2C_JOB* pJob);
+
+
+/**
+ * Adds given job to the I2C 1 job queue, and waits till it is done, see i2cJobAddWait() for details.
+ *
+ * @param pJob The job to add. Must not already be queued.
+ * @return The job's status, 0 if successful, else a I2C_TXION_STATUS_ERR_XX error.
+ */
+BYTE i2c1JobAddWait(I2C_JOB* pJob);
+
+
 /*
 #define i2c1EmptyTxBuf()              cbufEmpty(CIRBUF_TX_I2C1)
 #define i2c1IsTxBufEmpty()            cbufIsEmpty(CIRBUF_TX_I2C1)
@@ -48,6 +48,16 @@
     #include "USB\usb_function_hid.h"
 #endif
 
+//With ping-pong buffering, the USB stack alternately uses the even and odd buffer descriptors of an endpoint. Two
+//transfers can be armed on the data endpoint, one is received or sent while the other one is processed.
+#if (USB_PING_PONG_MODE == USB_PING_PONG__FULL_PING_PONG) || (USB_PING_PONG_MODE == USB_PING_PONG__ALL_BUT_EP0)
+    #define SERUSB_PING_PONG
+    #define SERUSB_EP_BUFS          2
+#else
+    #define SERUSB_EP_BUFS          1
+#endif
+#define SERUSB_NEXT_BUF(idx)        ((idx + 1) & (SERUSB_EP_BUFS - 1))
+
 
 //Add debugging to this file. The DEBUG_CONF_USB_BUFFERED macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
 #if !defined(DEBUG_CONF_USB_BUFFERED)
@@ -88,12 +98,30 @@
 
 #if defined(HAS_SERPORT_USB_CDC)
     char USB_Out_Buffer[64];
+    #if defined(SERUSB_PING_PONG)
+    //CDCInitEP() arms the first OUT buffer with cdc_data_rx, we arm the second one with USB_Out_Buffer
+    extern volatile FAR unsigned char cdc_data_rx[CDC_DATA_OUT_EP_SIZE];
+    extern USB_HANDLE CDCDataOutHandle;
+    BYTE* usbRxBuf[2] = {(BYTE*)cdc_data_rx, (BYTE*)USB_Out_Buffer};
+    USB_HANDLE usbRxHandle[2];
+    BYTE usbRxIdx;                  //Index of next usbRxBuf[] to be received
+    BYTE usbRxOfs;                  //Number of bytes of usbRxBuf[usbRxIdx] already added to CIRBUF_RX_DEBUG
+
+    //IN transfers are sent directly from CIRBUF_TX_USB, data is only removed once it has been sent
+    USB_HANDLE usbTxHandle[2];
+    BYTE usbTxLen[2];
+    BYTE usbTxIdx;                  //Index of oldest IN transfer in progress
+    BYTE usbTxCnt;                  //Number of IN transfers in progress
+    WORD usbTxInFlight;             //Number of CIRBUF_TX_USB bytes in IN transfers in progress
+    BOOL usbTxZlp;                  //Last packet sent was full. If no more data, send zero length packet
+    #endif
 #elif defined(HAS_SERPORT_USB_HID)
-    PacketToFromPC PacketFromPC;            //64 byte buffer for receiving packets on EP1 OUT from the PC
-    PacketToFromPC PacketToPC;              //64 byte buffer for sending packets on EP1 IN to the PC
-    PacketToFromPC PacketFromPCBuffer;
-    USB_HANDLE USBOutHandle = 0;
-    USB_HANDLE USBInHandle = 0;
+    PacketToFromPC usbRxPacket[SERUSB_EP_BUFS]; //64 byte buffers for receiving packets on EP1 OUT from the PC
+    PacketToFromPC usbTxPacket[SERUSB_EP_BUFS]; //64 byte buffers for sending packets on EP1 IN to the PC
+    USB_HANDLE usbRxHandle[SERUSB_EP_BUFS];
+    USB_HANDLE usbTxHandle[SERUSB_EP_BUFS];
+    BYTE usbRxIdx;                  //Index of next usbRxPacket[] to be received
+    BYTE usbTxIdx;                  //Index of next usbTxPacket[] to send
     unsigned char usbState;
 #endif
 
@@ -128,6 +156,10 @@ USB_CMD_AND_DBG_FLAGS usbCmdDbgFlags;
  */
 void serUSBInit(void)
 {
+    #if defined(HAS_SERPORT_USB_HID)
+    BYTE i;
+    #endif
+
     #if defined(USE_USB_BUS_SENSE_IO)
     tris_usb_bus_sense = INPUT_PIN; // See HardwareProfile.h
     #endif
@@ -142,8 +174,12 @@ void serUSBInit(void)
         //....
     #elif defined(HAS_SERPORT_USB_HID)
         //initialize the variable holding the handle for the last transmission
-        USBOutHandle = 0;
-        USBInHandle = 0;
+        for (i=0; i<SERUSB_EP_BUFS; i++) {
+            usbRxHandle[i] = 0;
+            usbTxHandle[i] = 0;
+        }
+        usbRxIdx = 0;
+        usbTxIdx = 0;
 
         usbState = IDLE_STATE;
     #endif
@@ -190,10 +226,18 @@ void serUSBTask(void) {
     //char cbuf[16];
 
     #if (defined HAS_SERPORT_USB_CDC)
+    #if defined(SERUSB_PING_PONG)
+    BYTE* p;
+    BYTE slot;
+    #else
     BYTE numBytesRead;
-    WORD len;
     BYTE buff[100];
     #endif
+    WORD len;
+    #elif (defined HAS_SERPORT_USB_HID)
+    PacketToFromPC* pFromPC;
+    PacketToFromPC* pToPC;
+    #endif
 
     nzGlobals.wdtFlags.bits.serUSB = 1;
     
@@ -214,6 +258,69 @@ void serUSBTask(void) {
     /////////////////////////////////////////////////
     // Process USB if configured, and not suspended
     #if (defined HAS_SERPORT_USB_CDC)
+    #if defined(SERUSB_PING_PONG)
+    /////////////////////////////////////////////////
+    //Check if anything received on USB CDC "Serial Data Port". Both OUT buffers are armed, and complete in the order
+    //they were armed. A buffer is only re-armed once all it's data has been added to CIRBUF_RX_DEBUG. Until then the
+    //host is NAKed, so no data is lost when the buffer is full.
+    while (!USBHandleBusy(usbRxHandle[usbRxIdx])) {
+        len = USBHandleGetLength(usbRxHandle[usbRxIdx]) - usbRxOfs;
+        if (len > cbufGetFree(CIRBUF_RX_DEBUG)) {
+            len = cbufGetFree(CIRBUF_RX_DEBUG);
+        }
+        cbufPutArray(CIRBUF_RX_DEBUG, &usbRxBuf[usbRxIdx][usbRxOfs], len);
+        usbRxOfs += len;
+
+        //Not all data could be added
+        if (usbRxOfs < USBHandleGetLength(usbRxHandle[usbRxIdx])) {
+            break;
+        }
+
+        //Re-arm, the stack uses the same (even or odd) buffer descriptor again
+        usbRxHandle[usbRxIdx] = USBRxOnePacket(CDC_DATA_EP, usbRxBuf[usbRxIdx], CDC_DATA_OUT_EP_SIZE);
+        usbRxIdx ^= 1;
+        usbRxOfs = 0;
+    }
+
+    /////////////////////////////////////////////////
+    //Remove data of completed IN transfers from CIRBUF_TX_USB
+    while ((usbTxCnt != 0) && !USBHandleBusy(usbTxHandle[usbTxIdx])) {
+        cbufRemoveBytes(CIRBUF_TX_USB, usbTxLen[usbTxIdx]);
+        usbTxInFlight -= usbTxLen[usbTxIdx];
+        usbTxIdx ^= 1;
+        usbTxCnt--;
+    }
+
+    //Arm free IN buffers with data directly from CIRBUF_TX_USB. If the data wraps around, the second
+    //contiguous block at the start of the buffer is sent in the same pass.
+    while (usbTxCnt < 2) {
+        len = cbufGetRdArrSize(CIRBUF_TX_USB);
+        if (usbTxInFlight < len) {
+            p = cbufGetRdArr(CIRBUF_TX_USB) + usbTxInFlight;
+            len = len - usbTxInFlight;
+        }
+        else {
+            p = CIRBUF_TX_USB->buf + (usbTxInFlight - len);
+            len = cbufGetCount(CIRBUF_TX_USB) - usbTxInFlight;
+        }
+
+        if (len > CDC_DATA_IN_EP_SIZE) {
+            len = CDC_DATA_IN_EP_SIZE;
+        }
+
+        //Nothing to send. If last packet was full, send zero length packet to terminate transfer on host
+        if ((len == 0) && (usbTxZlp == FALSE)) {
+            break;
+        }
+
+        slot = usbTxIdx ^ usbTxCnt;
+        usbTxHandle[slot] = USBTxOnePacket(CDC_DATA_EP, p, len);
+        usbTxLen[slot] = len;
+        usbTxInFlight += len;
+        usbTxCnt++;
+        usbTxZlp = (len == CDC_DATA_IN_EP_SIZE);
+    }
+    #else
     //Check if anything received on USB CDC "Serial Data Port".
     numBytesRead = getsUSBUSART(USB_Out_Buffer, 64);
     if (numBytesRead != 0) {
@@ -243,6 +350,7 @@ void serUSBTask(void) {
             }
         }
     }
+    #endif
 
     //Handles device-to-host transaction(s)
     CDCTxService();
@@ -254,45 +362,49 @@ void serUSBTask(void) {
     //Check if anything has been received
 
     //Ensure we are done sending the last response. Have to check this because we might have to send
-    //a reply to host depending on what we receive
-    if(!HIDTxHandleBusy(USBInHandle))
+    //a reply to host depending on what we receive. With ping-pong, the next packet is being received
+    //while this one is processed.
+    pFromPC = &usbRxPacket[usbRxIdx];
+    pToPC = &usbTxPacket[usbTxIdx];
+    if(!HIDTxHandleBusy(usbTxHandle[usbTxIdx]))
     {
         //Did we receive something?
-        if(!HIDRxHandleBusy(USBOutHandle))
+        if(!HIDRxHandleBusy(usbRxHandle[usbRxIdx]))
         {
             //Check if it is a command we handle here in this function, normally lower level commands.
             //Higher level commands, like CMDUSB_COMMAND, is added to buffer, and handled later, they could potentially
             //take time to execute.
-            switch(PacketFromPC.Command)
+            switch(pFromPC->Command)
             {
                 //USB HID is used for debugging! Data received with CMDUSB_DEBUG_MESSAGE command is not added
                 //to CIRBUF_RX_USB, but to debug receive buffer!
                 #if defined(HAS_USBHID_DEBUGGING)
                 //Debug message. Add the received debug message to the debug buffer. Is handled by "debug.c".
                 case CMDUSB_DEBUG_MESSAGE:
-                    //Debug messages are always NULL terminated strings. This means PacketFromPC.Size = string lenght + 1 (for NULL)
+                    //Debug messages are always NULL terminated strings. This means pFromPC->Size = string lenght + 1 (for NULL)
                     #if defined(DEBUG_USE_STREAMING)
                         //Ensure enough size for data
-                        if (cbufGetFree(CIRBUF_RX_DEBUG) > (PacketFromPC.Size)) {
+                        if (cbufGetFree(CIRBUF_RX_DEBUG) > (pFromPC->Size)) {
                             //Add all bytes received via DEBUG MESSAGE to Debug "Serial Data Port" Receive buffer. If too little space, remaining bytes are lost!
-                            cbufPutArray(CIRBUF_RX_DEBUG, (BYTE*) &PacketFromPC.Data[0], PacketFromPC.Size);
+                            cbufPutArray(CIRBUF_RX_DEBUG, (BYTE*) &pFromPC->Data[0], pFromPC->Size);
                         }
                     #else
                         //Add debug string as a packet. Don't included NULL string terminator, not needed for "Packet Circular Buffer"
-                        if (PacketFromPC.Size > 0) {
-                            cbufPutPacket(CIRBUF_RX_DEBUG, (BYTE*) &PacketFromPC.Data[0], PacketFromPC.Size - 1);    //"-1" to remove NULL string terminator
+                        if (pFromPC->Size > 0) {
+                            cbufPutPacket(CIRBUF_RX_DEBUG, (BYTE*) &pFromPC->Data[0], pFromPC->Size - 1);    //"-1" to remove NULL string terminator
                         }
                     #endif
                     break;
                 #endif
                 //We received a "Device Info" request. Return Board ID and Revision
                 case CMDUSB_DEVICE_INFO:
-                    PacketToPC.Command = PacketFromPC.Command;  //Build reply message
+                    pToPC->Command = pFromPC->Command;  //Build reply message
 
-                    PacketToPC.DeviceInfo.BoardID = USBHID_BOARD_ID_MAIN;
-                    PacketToPC.DeviceInfo.BoardRev = USBHID_BOARD_REV;
+                    pToPC->DeviceInfo.BoardID = USBHID_BOARD_ID_MAIN;
+                    pToPC->DeviceInfo.BoardRev = USBHID_BOARD_REV;
 
-                    USBInHandle = HIDTxPacket(HID_EP,(BYTE*)&PacketToPC.Contents[0],64);
+                    usbTxHandle[usbTxIdx] = HIDTxPacket(HID_EP,(BYTE*)&pToPC->Contents[0],64);
+                    usbTxIdx = SERUSB_NEXT_BUF(usbTxIdx);
                     usbCmdDbgFlags.flags.bDeviceInfoCmdSent = TRUE;
                     break;
                 case CMDUSB_RESET_DEVICE:
@@ -312,12 +424,12 @@ void serUSBTask(void) {
                 #if defined(APP_HANDLES_USB_COMMANDS)
                 default:
                     //Add to USB buffer. It is added as a Packet (see nz_serUSB.h for details on "Circular Buffer Packets").
-                    //A "Circular Buffer Packet" has the format [Size][Data]. We store PacketFromPC.Command and PacketFromPC.Data
+                    //A "Circular Buffer Packet" has the format [Size][Data]. We store pFromPC->Command and pFromPC->Data
                     //in the [Data] part of the packet.
-                    size = PacketFromPC.Size+1; //Packet [Size] = PacketFromPC.Command + PacketFromPC.Data (PacketFromPC.Size is just for PacketFromPC.Data)
-                    //!!!! Don't use PacketFromPC.Size any more after next line, it is overwritten! It is PacketFromPC.CommandData[0]
-                    PacketFromPC.UsbCommandData[0] = PacketFromPC.Command; //Make Command second byte in PacketFromPC.Contents. Data starts from third byte.
-                    cbufPutPacket(CIRBUF_RX_USB, (BYTE*) &PacketFromPC.UsbCommandData[0], size);
+                    size = pFromPC->Size+1; //Packet [Size] = pFromPC->Command + pFromPC->Data (pFromPC->Size is just for pFromPC->Data)
+                    //!!!! Don't use pFromPC->Size any more after next line, it is overwritten! It is pFromPC->CommandData[0]
+                    pFromPC->UsbCommandData[0] = pFromPC->Command; //Make Command second byte in pFromPC->Contents. Data starts from third byte.
+                    cbufPutPacket(CIRBUF_RX_USB, (BYTE*) &pFromPC->UsbCommandData[0], size);
 
                     DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nUSBTask CMD, size=");
                     DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, size);
@@ -325,8 +437,9 @@ void serUSBTask(void) {
                 #endif
             }
 
-            //Re-arm the OUT endpoint for the next packet
-            USBOutHandle = HIDRxPacket(HID_EP,(BYTE*)&PacketFromPC,64);
+            //Re-arm the OUT endpoint for the next packet. The stack uses the same (even or odd) buffer descriptor again
+            usbRxHandle[usbRxIdx] = HIDRxPacket(HID_EP,(BYTE*)pFromPC,64);
+            usbRxIdx = SERUSB_NEXT_BUF(usbRxIdx);
         }
     }
 
@@ -337,8 +450,9 @@ void serUSBTask(void) {
     // - Application configured debug message to be sent via USB HID port
     // - There is "Debug Message" to send AND "Device Info" has already been sent.
 
-    //Ensure we are done sending the last response.
-    if(!HIDTxHandleBusy(USBInHandle))
+    //Ensure we are done sending the last response. With ping-pong, this is the next of the two IN buffers.
+    pToPC = &usbTxPacket[usbTxIdx];
+    if(!HIDTxHandleBusy(usbTxHandle[usbTxIdx]))
     {
         WORD sizeData;
 
@@ -351,39 +465,40 @@ void serUSBTask(void) {
             //This method uses cbufGetRdArrSize() and cbufGetRdArr() to get contiguous blocks of data, and nzMemCpy() to copy them
             WORD sizeAvailable = cbufGetRdArrSize(CIRBUF_TX_DEBUG);     //Get number bytes available in contiguous packet to send
             //Set size to maximum bytes that can be sent per HID USB message
-            size = sizeof(PacketToPC.Data);
+            size = sizeof(pToPC->Data);
             //There are less bytes to send than bytes we ALWAYS send in standard USB message
             if (size > sizeAvailable) {
                 size = sizeAvailable;
             }
-            PacketToPC.Size = size;
-            PacketToPC.Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
-            nzMemCpy(PacketToPC.Data, cbufGetRdArr(CIRBUF_TX_DEBUG), size);
+            pToPC->Size = size;
+            pToPC->Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
+            nzMemCpy(pToPC->Data, cbufGetRdArr(CIRBUF_TX_DEBUG), size);
             cbufRemoveBytes(CIRBUF_TX_DEBUG, size);
 
 //            //This method uses cbufGetRdArrSize() and cbufGetRdArr() to get contiguous blocks of data, and nzMemCpy() to copy them
 //            //Set size to maximum bytes that can be sent per HID USB message
-//            PacketToPC.Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
-//            size = sizeof(PacketToPC.Data);
-//            PacketToPC.Size = cbufGetArray(CIRBUF_TX_DEBUG, PacketToPC.Data, size);
+//            pToPC->Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
+//            size = sizeof(pToPC->Data);
+//            pToPC->Size = cbufGetArray(CIRBUF_TX_DEBUG, pToPC->Data, size);
 //            cbufEmpty(CIRBUF_TX_DEBUG);
 //            //cbufRemoveBytes(CIRBUF_TX_DEBUG);
 
             //This method uses cbufGetByte_MACRO() for each byte it copies
 //            WORD sizeAvailable = cbufGetCount(CIRBUF_TX_DEBUG);  //Bytes available to send
 //            //Set size to maximum bytes that can be sent per HID USB message
-//            size = sizeof(PacketToPC.Data);
+//            size = sizeof(pToPC->Data);
 //            //There are less bytes to send than bytes we ALWAYS send in standard USB message
 //            if (size > sizeAvailable) {
 //                size = sizeAvailable;
 //            }
-//            PacketToPC.Size = size;
-//            PacketToPC.Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
+//            pToPC->Size = size;
+//            pToPC->Command = CMDUSB_DEBUG_MESSAGE;          //Debug Message
 //            for (i=0; i<size; i++) {
-//                PacketToPC.Data[i] = cbufGetByte_MACRO(CIRBUF_TX_DEBUG); //Read next byte from buffer, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
+//                pToPC->Data[i] = cbufGetByte_MACRO(CIRBUF_TX_DEBUG); //Read next byte from buffer, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
 //            }
 
-            USBInHandle = HIDTxPacket(HID_EP,(BYTE*)&PacketToPC.Contents[0],64);
+            usbTxHandle[usbTxIdx] = HIDTxPacket(HID_EP,(BYTE*)&pToPC->Contents[0],64);
+            usbTxIdx = SERUSB_NEXT_BUF(usbTxIdx);
         }
         else
         {
@@ -397,27 +512,28 @@ void serUSBTask(void) {
             //that the [Data] part can have a size of 0 - not be there.
             sizeData--;    //Get size of [Data] part
 
-            if (sizeData > sizeof(PacketToPC.Data)) {
+            if (sizeData > sizeof(pToPC->Data)) {
                 DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "USB Tx Pckt too big");
                 cbufEmpty(CIRBUF_TX_USB);
                 return;
             }
 
             //Set size of [Data] part of message HID USB message
-            PacketToPC.Size = sizeData;
-            //PacketToPC.Command = CMDUSB_COMMAND;              //Command
-            PacketToPC.Command = cbufGetByte_MACRO(CIRBUF_TX_USB);   //First byte in packet is Command, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
+            pToPC->Size = sizeData;
+            //pToPC->Command = CMDUSB_COMMAND;              //Command
+            pToPC->Command = cbufGetByte_MACRO(CIRBUF_TX_USB);   //First byte in packet is Command, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
 
             for (i=0; i<sizeData; i++) {
-                PacketToPC.Data[i] = cbufGetByte_MACRO(CIRBUF_TX_USB);   //Read next byte from buffer, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
+                pToPC->Data[i] = cbufGetByte_MACRO(CIRBUF_TX_USB);   //Read next byte from buffer, MACRO version, ONLY use as expression, like "c=cbufGetByte_MACRO(pBuf);" !
             }
 
-            USBInHandle = HIDTxPacket(HID_EP,(BYTE*)&PacketToPC.Contents[0],64);
+            usbTxHandle[usbTxIdx] = HIDTxPacket(HID_EP,(BYTE*)&pToPC->Contents[0],64);
+            usbTxIdx = SERUSB_NEXT_BUF(usbTxIdx);
         }
         #if defined(HAS_USBHID_DEBUGGING)
         }
         #endif
-    }       //if(!HIDTxHandleBusy(USBInHandle))
+    }       //if(!HIDTxHandleBusy(usbTxHandle[usbTxIdx]))
     #endif
 
 
@@ -735,13 +851,29 @@ void USBCBStdSetDscHandler(void) {
 void USBCBInitEP(void) {
     #if defined(HAS_SERPORT_USB_CDC)
         CDCInitEP();
+
+        #if defined(SERUSB_PING_PONG)
+        //CDCInitEP() armed the first OUT buffer with cdc_data_rx. Arm the second one with USB_Out_Buffer
+        usbRxHandle[0] = CDCDataOutHandle;
+        usbRxHandle[1] = USBRxOnePacket(CDC_DATA_EP, usbRxBuf[1], CDC_DATA_OUT_EP_SIZE);
+        usbRxIdx = 0;
+        usbRxOfs = 0;
+        usbTxIdx = 0;
+        usbTxCnt = 0;
+        usbTxInFlight = 0;
+        usbTxZlp = FALSE;
+        #endif
     #elif defined(HAS_SERPORT_USB_HID)
         //enable the HID endpoint
         USBEnableEndpoint(HID_EP,USB_IN_ENABLED|USB_OUT_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
 
-        //Arm the OUT endpoint for the first packet
-        //USBOutHandle = HIDRxPacket(HID_EP,(BYTE*)&PacketFromPCBuffer,64);
-        USBOutHandle = HIDRxPacket(HID_EP,(BYTE*)&PacketFromPC,64);
+        //Arm the OUT endpoint for the first packet. With ping-pong, both buffers are armed
+        for (usbRxIdx=0; usbRxIdx<SERUSB_EP_BUFS; usbRxIdx++) {
+            usbRxHandle[usbRxIdx] = HIDRxPacket(HID_EP,(BYTE*)&usbRxPacket[usbRxIdx],64);
+            usbTxHandle[usbRxIdx] = 0;
+        }
+        usbRxIdx = 0;
+        usbTxIdx = 0;
     #endif
 }
 
@@ -61,6 +61,7 @@
 #include "nz_serUart.h"
 #include "nz_helpers.h"
 #include "nz_helpersCx.h"
+#include "nz_statusMap.h"
 
 
 //Add debugging to this file. The DEBUG_CONF_SERPORTUART macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
@@ -108,6 +109,28 @@
 #define UART_USE_FORMATTED_TXBUFFER 0
 #endif
 
+//Size of buffer used by ISR to read receive FIFO, is written to "Circular Buffer" with single call
+#define UART_RX_READ_SIZE   8
+
+//DMA channels used by UART1 when SERPORT_UART1_USE_DMA is defined
+#if !defined(UART1_DMA_TX_CH)
+#define UART1_DMA_TX_CH     0
+#endif
+#if !defined(UART1_DMA_RX_CH)
+#define UART1_DMA_RX_CH     1
+#endif
+#if defined(SERPORT_UART1_USE_DMA) && defined(SERPORT_UART1_CREATE_OWN_CIRBUFS)
+#error "SERPORT_UART1_USE_DMA requires nz_serDataPorts.c, can not be used with SERPORT_UART1_CREATE_OWN_CIRBUFS!"
+#endif
+
+#if (UART_USE_STATS==1)
+#define UART_STATS_INC(objUART, cntr)       (objUART)->stats.cntr++
+#define UART_STATS_ADD(objUART, cntr, n)    (objUART)->stats.cntr += (n)
+#else
+#define UART_STATS_INC(objUART, cntr)
+#define UART_STATS_ADD(objUART, cntr, n)
+#endif
+
 
 ////////// Defines //////////////////////////////
 
@@ -127,6 +150,8 @@ enum SM_UART_TASK_ {
 
 void uartRxISR (UART_INFO* objUART);
 void uartTxISR (UART_INFO* objUART);
+static void uartRxRead(UART_INFO* objUART);
+static void uartTxFill(UART_INFO* objUART);
 void serUartTask(UART_INFO* objUART);
 void serUartKickstart(UART_INFO* objUART);
 void uartWriteUartIE(BYTE ch, BOOL val);
@@ -150,6 +175,11 @@ SERPORT_UART_CONFIG  serportUART1Conf;
     CIRBUF  cbufRxUART1;
     BYTE    bufRxUART1[UART1_RXBUF_SIZE];
 #endif
+
+#if defined(SERPORT_UART1_USE_DMA)
+static SERPORT_DMA   uart1DmaTx;
+static SERPORT_DMA   uart1DmaRx;
+#endif
 #endif
 
 #if defined(HAS_SERPORT_UART2)
@@ -208,58 +238,85 @@ static CIRBUF* uartListeners[UART_LISTENERS];    //Array of "Circular Buffer" po
  * @param objUART
  */
 void uartRxISR(UART_INFO* objUART) {
-    char c;
+    UART_STATS_INC(objUART, rxInts);
+    uartRxRead(objUART);
+}
+
+
+/**
+ * Reads all bytes in the receive FIFO, and writes them to the RX "Circular Buffer" with a
+ * single cbufPutArray() call. Called from ISR, or from task with UART interrupts disabled.
+ * @param objUART
+ */
+static void uartRxRead(UART_INFO* objUART) {
+    BYTE buf[UART_RX_READ_SIZE];
+    BYTE n;
+    WORD sta;
 
     /////////////////////////////////////////////////
     // Check for errors /////////////////////////////
     //Check for Overun (OERR bit 1), or Framming (FERR bit 2) or Parity (PERR bit 3) Errors
     //Any of these errors will cause a Receive interrupt.
-    if ((*pUxSTA(objUART->flags.ch) & 0x000E) != 0) {
+    sta = *pUxSTA(objUART->flags.ch);
+    if ((sta & 0x000E) != 0) {
         DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nUART");
         DEBUG_PUT_BYTE(DEBUG_LEVEL_WARNING, objUART->flags.ch+1);
         DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, " ERR = 0x");
-        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_WARNING, *pUxSTA(objUART->flags.ch) & 0x000E);
+        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_WARNING, sta & 0x000E);
 
-        //if(((U1STABITS*)pUxSTA(objUART->flags.ch))->FERR==1) {
-        //    DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nFERR1!");
-        //    ((U1STABITS*)pUxSTA(objUART->flags.ch))->FERR = 0;
-        //}
-        //if(((U1STABITS*)pUxSTA(objUART->flags.ch))->OERR==1) {
-        //    DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nOERR1!");
-        //    ((U1STABITS*)pUxSTA(objUART->flags.ch))->OERR = 0;
-        //}
-        //if(((U1STABITS*)pUxSTA(objUART->flags.ch))->PERR==1) {
-        //    DEBUG_PUT_STR(DEBUG_LEVEL_WARNING, "\nPERR1!");
-        //    ((U1STABITS*)pUxSTA(objUART->flags.ch))->PERR = 0;
-        //}
+        if (sta & 0x0002) {
+            UART_STATS_INC(objUART, rxOverruns);
+        }
+        if (sta & 0x000C) {
+            UART_STATS_INC(objUART, rxErrors);
+        }
 
         //((U1STABITS*)pUxSTA(objUART->flags.ch))->OERR = 0;      //cast to U1STABITS possible, because all UxSTABITS have the same bits!
-        //((U1STABITS*)pUxSTA(objUART->flags.ch))->FERR = 0;      //cast to U1STABITS possible, because all UxSTABITS have the same bits!
-        //((U1STABITS*)pUxSTA(objUART->flags.ch))->PERR = 0;      //cast to U1STABITS possible, because all UxSTABITS have the same bits!
         *((WORD*)pUxSTA(objUART->flags.ch)) &= ~0x000E;         //Clear OERR, FERR and PERR bits
     }
 
 
     /////////////////////////////////////////////////
-    // Get next byte from Rx Buffer /////////////////
-#if defined(__C30__)
-    //While there are more bytes in the Receive buffer (URXDA = 1)
-    while ((((U1STABITS*)pUxSTA(objUART->flags.ch))->URXDA == TRUE)) {    //cast to U1STABITS possible, because all UxSTABITS have the same bits!
-        c = *pUxRXREG(objUART->flags.ch);   //Get next byte
-#elif defined(__PIC32MX__)
-    //While there are more bytes in the Receive buffer (URXDA = 1)
-    while ((((U1STABITS*)pUxSTA(objUART->flags.ch))->URXDA == TRUE)) {    //cast to U1STABITS possible, because all UxSTABITS have the same bits!
-        c = *pUxRXREG(objUART->flags.ch);   //Get next byte
-#endif
-        cbufPutByte(objUART->pCbufRx, c);
+    // Read Rx FIFO /////////////////////////////////
+    //While there are more bytes in the Receive buffer (URXDA = 1). Cast to U1STABITS possible,
+    //because all UxSTABITS have the same bits!
+    n = 0;
+    while ((((U1STABITS*)pUxSTA(objUART->flags.ch))->URXDA == TRUE)) {
+        buf[n++] = *pUxRXREG(objUART->flags.ch);   //Get next byte
+        if (n == sizeof(buf)) {
+            UART_STATS_ADD(objUART, rxDropped, n - cbufPutArray(objUART->pCbufRx, buf, n));
+            UART_STATS_ADD(objUART, rxBytes, n);
+            n = 0;
+        }
+    }
+    if (n != 0) {
+        UART_STATS_ADD(objUART, rxDropped, n - cbufPutArray(objUART->pCbufRx, buf, n));
+        UART_STATS_ADD(objUART, rxBytes, n);
     }
 }
 
+
+/**
+ * Writes bytes from TX "Circular Buffer" to transmit FIFO, until FIFO is full (UTXBF = 1)
+ * or there is no more data.
+ * @param objUART
+ */
+static void uartTxFill(UART_INFO* objUART) {
+    //Cast to U1STABITS possible, because all UxSTABITS have the same bits!
+    while ((((U1STABITS*)pUxSTA(objUART->flags.ch))->UTXBF == 0) && cbufHasData(objUART->pCbufTx)) {
+        *pUxTXREG(objUART->flags.ch) = cbufGetByte(objUART->pCbufTx);
+        UART_STATS_INC(objUART, txBytes);
+    }
+}
+
+
 /**
  * Transmit interrupt routine
  * @param objUART
  */
 void uartTxISR(UART_INFO* objUART) {
+    UART_STATS_INC(objUART, txInts);
+
     switch(objUART->isr.bits.sm) {
         case SM_ISR_IDLE:
             break;
@@ -267,8 +324,8 @@ void uartTxISR(UART_INFO* objUART) {
         {
             //Is there data to transmit
             if (cbufHasData(objUART->pCbufTx)) {
-                //Send next byte in buffer
-                *pUxTXREG(objUART->flags.ch) = cbufGetByte(objUART->pCbufTx);
+                //Fill transmit FIFO with next bytes in buffer
+                uartTxFill(objUART);
             }
             else {
                 //Finished sending all data, return to idle state
@@ -303,6 +360,24 @@ void __attribute__((__interrupt__, no_auto_psv)) _U1RXInterrupt (void)
     uartRxISR(&uart1Info);
 }
 #elif defined(__PIC32MX__)
+#if defined(SERPORT_UART1_USE_DMA)
+//DMA channel interrupts of UART1. Commit the completed block, and start the next one. Each interrupt only services
+//it's own channel, serDmaTask() only disables the interrupt of the channel it services.
+#define UART1_DMA_OF_CH(ch) (((UART1_DMA_TX_CH) == (ch)) ? &uart1DmaTx : &uart1DmaRx)
+#if ((UART1_DMA_TX_CH) == 0) || ((UART1_DMA_RX_CH) == 0)
+void __attribute((interrupt(ipl5), vector(_DMA_0_VECTOR), nomips16)) DMA0Interrupt(void) { serDmaIsr(UART1_DMA_OF_CH(0)); }
+#endif
+#if ((UART1_DMA_TX_CH) == 1) || ((UART1_DMA_RX_CH) == 1)
+void __attribute((interrupt(ipl5), vector(_DMA_1_VECTOR), nomips16)) DMA1Interrupt(void) { serDmaIsr(UART1_DMA_OF_CH(1)); }
+#endif
+#if ((UART1_DMA_TX_CH) == 2) || ((UART1_DMA_RX_CH) == 2)
+void __attribute((interrupt(ipl5), vector(_DMA_2_VECTOR), nomips16)) DMA2Interrupt(void) { serDmaIsr(UART1_DMA_OF_CH(2)); }
+#endif
+#if ((UART1_DMA_TX_CH) == 3) || ((UART1_DMA_RX_CH) == 3)
+void __attribute((interrupt(ipl5), vector(_DMA_3_VECTOR), nomips16)) DMA3Interrupt(void) { serDmaIsr(UART1_DMA_OF_CH(3)); }
+#endif
+#endif  //#if defined(SERPORT_UART1_USE_DMA)
+
 void __attribute((interrupt(ipl6), vector(_UART1_VECTOR), nomips16)) U1Interrupt(void)
 {
 	if(IFS1bits.U1RXIF) {
@@ -357,8 +432,9 @@ void serUart1Init(void) {
     CloseUART1();    //Disable UART1 module if enabled previously
 
 
-    //Enable UART TX and RX interrupts
-#if (nzINT_PRIORITY_UART1==1)
+    //Enable UART TX and RX interrupts. Not used with DMA, interrupt flags trigger DMA transfers.
+#if defined(SERPORT_UART1_USE_DMA)
+#elif (nzINT_PRIORITY_UART1==1)
     ConfigIntUART1(UART_RX_INT_EN | UART_RX_INT_PR1 | UART_TX_INT_EN | UART_TX_INT_PR1);
 #elif (nzINT_PRIORITY_UART1==2)
     ConfigIntUART1(UART_RX_INT_EN | UART_RX_INT_PR2 | UART_TX_INT_EN | UART_TX_INT_PR2);
@@ -420,7 +496,7 @@ void serUart1Init(void) {
 
     //UART initialized, 9600 Buad, 8bit, no parity, 1 stop bit, High BAUD rate
 #if (USER_CONFIGURES_UART1==0)
-    OpenUART1(UART_EN | UART_NO_PAR_8BIT | UART_1STOPBIT | UART_UEN_00 | UART_BRGH_FOUR , UART_TX_ENABLE, UART_BAUD_9K6);
+    OpenUART1(UART_EN | UART_NO_PAR_8BIT | UART_1STOPBIT | UART_UEN_00 | UART_BRGH_FOUR , UART_TX_ENABLE | UART_TXINT_MODE | UART_RXINT_MODE, UART_BAUD_9K6);
 #endif
 
 #if defined(__C30__)
@@ -431,6 +507,12 @@ void serUart1Init(void) {
 
     //_MUART1IE = 1; // Enable UART 1 interrupt
 #elif defined(__PIC32MX__)
+    #if defined(SERPORT_UART1_USE_DMA)
+    //Request DMA transfer while TX FIFO has space, and while RX FIFO has data
+    U1STACLR = _U1STA_UTXISEL_MASK | _U1STA_URXISEL_MASK;
+    serDmaInitTx(&uart1DmaTx, UART1_DMA_TX_CH, _UART1_TX_IRQ, &U1TXREG, uart1Info.pCbufTx);
+    serDmaInitRx(&uart1DmaRx, UART1_DMA_RX_CH, _UART1_RX_IRQ, &U1RXREG, uart1Info.pCbufRx);
+    #endif
 #endif
 }
 
@@ -439,7 +521,23 @@ void serUart1Init(void) {
  * Task
  */
 void serUart1Task(void) {
+    #if defined(SERPORT_UART1_USE_DMA)
+    //Receive overrun stops UART receiver, clear it. Bytes in FIFO are lost.
+    if (U1STAbits.OERR) {
+        U1STACLR = _U1STA_OERR_MASK;
+        UART_STATS_INC(&uart1Info, rxOverruns);
+    }
+
+    //Commit data received so far, and start transmitting new data. Completed blocks are restarted by the DMA interrupts.
+    serDmaTask(&uart1DmaRx);
+    serDmaTask(&uart1DmaTx);
+
+    //ISR state is used by serUart1IsBusy()
+    uart1Info.isr.bits.sm = serDmaIsBusy(&uart1DmaTx) ? SM_ISR_TXING : SM_ISR_IDLE;
+    nzGlobals.wdtFlags.bits.serUART = 1;     //Indicate that this module is still alive, and clear WDT
+    #else
     serUartTask(&uart1Info);
+    #endif
 }
 
 
@@ -531,6 +629,15 @@ void serUartTask(UART_INFO* objUART) {
     //}
     #endif
 
+    //Read bytes bellow receive interrupt watermark, they do not cause an interrupt
+    #if (UART_RXINT_MODE != UART_INT_RX_CHAR)
+    if ((((U1STABITS*)pUxSTA(objUART->flags.ch))->URXDA == TRUE)) {
+        uartWriteUartIE(objUART->flags.ch, 0);  //Disable UART interrupt
+        uartRxRead(objUART);
+        uartWriteUartIE(objUART->flags.ch, 1);  //Enable UART interrupt
+    }
+    #endif
+
     bDone = TRUE;
     do {
     switch(objUART->taskSm) {
@@ -562,8 +669,10 @@ void serUartTask(UART_INFO* objUART) {
                 objUART->isr.bits.sm = SM_ISR_TXING;    //Set ISR state machine to START condition
                 objUART->timeout = tick16Get() + tick16ConvertFromMS(UART_TIMEOUT); //ISR Timeout
 
-                //Send next byte in buffer
-                *pUxTXREG(objUART->flags.ch) = cbufGetByte(objUART->pCbufTx);
+                //Fill transmit FIFO with next bytes in buffer
+                uartWriteUartIE(objUART->flags.ch, 0);  //Disable UART interrupt, ISR also fills FIFO
+                uartTxFill(objUART);
+                uartWriteUartIE(objUART->flags.ch, 1);  //Enable UART interrupt
 
                 //uartWriteUartIE(objUART->flags.ch, 1);  //Enable UART interrupt
 
@@ -580,6 +689,15 @@ void serUartTask(UART_INFO* objUART) {
  * Start Uart transmission. ONLY CALL if TX buffer has data!!!
  */
 void serUartKickstart(UART_INFO* objUART) {
+    #if defined(SERPORT_UART1_USE_DMA)
+    //TX FIFO is filled by DMA from same "Circular Buffer", do NOT fill it here. Only start DMA transfer.
+    if (objUART == &uart1Info) {
+        serDmaTask(&uart1DmaTx);
+        objUART->isr.bits.sm = serDmaIsBusy(&uart1DmaTx) ? SM_ISR_TXING : SM_ISR_IDLE;
+        return;
+    }
+    #endif
+
     //Ensure ISR is in idle state! We can not modify TXBUF if ISR is also modifying it!
     if (objUART->isr.bits.sm == SM_ISR_IDLE) {
         //No need to check, this function is ONLY CALLED WHEN THERE IS DATA!!! Is there data to transmit
@@ -587,8 +705,10 @@ void serUartKickstart(UART_INFO* objUART) {
             objUART->isr.bits.sm = SM_ISR_TXING;    //Set ISR state machine to START condition
             objUART->timeout = tick16Get() + tick16ConvertFromMS(UART_TIMEOUT); //ISR Timeout
 
-            //Send next byte in buffer
-            *pUxTXREG(objUART->flags.ch) = cbufGetByte(objUART->pCbufTx);
+            //Fill transmit FIFO with next bytes in buffer
+            uartWriteUartIE(objUART->flags.ch, 0);  //Disable UART interrupt, ISR also fills FIFO
+            uartTxFill(objUART);
+            uartWriteUartIE(objUART->flags.ch, 1);  //Enable UART interrupt
         //}
     }
 }
@@ -718,6 +838,15 @@ BYTE serUartIsBusy(UART_INFO* objUART) {
 #endif
 
 
+#if (UART_USE_STATS==1)
+void serUartClearStats(UART_INFO* objUART) {
+    uartWriteUartIE(objUART->flags.ch, 0);    //Disable UART interrupt for this channel
+    memset(&objUART->stats, 0, sizeof(objUART->stats));
+    uartWriteUartIE(objUART->flags.ch, 1);    //Enable UART interrupt for this channel
+}
+#endif
+
+
 #if defined UART_USE_SHARED_FUNCTIONS
 BYTE serUartWrite(UART_INFO* objUART, BYTE b) {
     //If current transmission has already encountered an error, Stop, and return that error
@@ -819,186 +948,34 @@ BYTE serUartWriteString(UART_INFO* objUART, const char* str) {
  * If not found, returns 0xff.
  *
  * IMPORTANT not to add or remove key-status pairs! Only uartStatusMapPut (interrupt ISR) can
- * do that!
+ * do that! The UART interrupt is only disabled once, while the (at most 2) slots for key are checked.
  *
  * @param key
  * @return
  */
 BYTE uartStatusMapGet(UART_INFO* objUART, BYTE key) {
-    BYTE ret = 0xff;    //Not found
-    WORD   c;
+    BYTE ret;
 
     //Clear bit 0 of key (UART address). Bit 0 is NOT part of the address
     key = key & 0xfe;
 
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    BYTE*  pCurr;
-//    pCurr = objUART->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nuartStatusMapGet  Pre: ");
-//    for(c=UART_STATUS_BUF_SIZE ; c!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        c -= 2;
-//    }
-//    #endif
-
-    //Search for entry with given key, and mark it as available (set status to 0xff)
-    //if found.
-    //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nSearch");
-    for(c=0; c<UART_STATUS_BUF_SIZE; c+=2) {
-        //DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '.');
-
-        //NZ_BUILTIN_DISI(0x3FFF);               //Disable all interrupts, excluding level 7
-        uartWriteUartIE(objUART->flags.ch, 0);    //Disable UART interrupt for this channel
-
-        //Current entry is equal to current key (ignore bit 0 of adr!), use it.
-        if(objUART->bufStat[c] == key) {
-            //DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, 'F');
-            ret = objUART->bufStat[c+1];     //Get status for this key
-            objUART->bufStat[c+1] = 0xff;    //Mark current key-status pair as available
-
-            //NZ_BUILTIN_DISI(0x0000);               //Enable interrupts
-            uartWriteUartIE(objUART->flags.ch, 1);    //Enable UART interrupt for this channel
-
-//            //Move all pairs one position down. ONLY do this if current pair is NOT top pair!
-//            if (c < (UART_STATUS_BUF_SIZE-2)) {
-//                BYTE*  pSrc;
-//                DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, 'R');
-//                pCurr = &objUART->bufStat[c];
-//                pSrc = pCurr+2; //Source is one pair higher in map
-//                // - Ensure size IS NOT 0
-//                // - Note dst and src will be incremented by this macro!
-//                //*((volatile BYTE*)(&c)) = UART_STATUS_BUF_SIZE-2-c;
-//                c = UART_STATUS_BUF_SIZE-2-c;
-//                nzMemCpy_ASM_RRR(pCurr, pSrc, c);
-//                //nzMemCpy_ASM_RRR(pCurr, pSrc, UART_STATUS_BUF_SIZE-2-c);
-//                //Alternative using nzMemCpyNoCheck() or memcpy. Will NOT increment pointers!
-//                //nzMemCpyNoCheck(pCurr, pSrc, c);
-//                //nzMemCpy(pCurr, pSrc, c);
-//            }
-            break;
-        }
-
-        //NZ_BUILTIN_DISI(0x0000);               // Enable interrupts
-        uartWriteUartIE(objUART->flags.ch, 1);    //Enable UART interrupt for this channel
-    }
-
+    uartWriteUartIE(objUART->flags.ch, 0);    //Disable UART interrupt for this channel
+    ret = statusMapTake(objUART->bufStat, UART_STATUS_BUF_SIZE, key);
+    uartWriteUartIE(objUART->flags.ch, 1);    //Enable UART interrupt for this channel
 
-//    if (ret == 0xff) {
-//    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    BYTE*  pCurr;
-//    pCurr = objUART->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nuartStatusMapGet Post: ");
-//    for(c=UART_STATUS_BUF_SIZE ; c!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        c -= 2;
-//    }
-//    #endif
-//    }
-
-    return ret;    //Not found
+    return ret;
 }
 
 /**
- * Add given key-status pair to bottom of map, moving existing items one position
- * up (effectively removing top pair).
+ * Add given key-status pair to map. Is called from ISR. See statusMapSet() in nz_statusMap.h for details.
  *
- * DETAILS:
- * Search for key-status pair with key=given key, OR status=0xff (marked available).
- * If found:
- * - Move all lower pairs one position up, effectively removing found pair
- *
- * If NOT found:
- * - Move all map pairs one position up, effectively removing top entry
- *
- * When done moving pairs up:
- * - Add new entry to bottom of map
- * 
  * @param key
  * @param status
  * @return
  */
 void uartStatusMapPut(UART_INFO* objUART, BYTE key, BYTE status) {
-    WORD idx;
-    BYTE* volatile pCurr;
-    BYTE* volatile pSrc;
-
     //Clear bit 0 of key (UART address). Bit 0 is NOT part of the address
-    key = key & 0xfe;
-
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    pCurr = objUART->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nuartStatusMapPut  Pre: ");
-//    for(idx=UART_STATUS_BUF_SIZE ; idx!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        idx -= 2;
-//    }
-//    #endif
-
-    /////////////////////////////////////////////////
-    //Search for key-status pair with key=given key, OR status=0xff (marked available).
-    //If found:
-    //- Move all lower pairs one position up, effectively removing found pair
-    //
-    //If NOT found:
-    //- Move all map pairs one position up, effectively removing top entry
-    //
-    //When done moving pairs up:
-    //- Add new entry to bottom of map
-    for(idx=0; idx<UART_STATUS_BUF_SIZE; idx+=2) {
-        //Key of current entry is equal to current key, use it.
-        if(objUART->bufStat[idx] == key) {
-            break;
-        }
-        //Status of current entry = 0xff (marked available), break
-        if (objUART->bufStat[idx+1] == 0xff)
-            break;
-    }
-    //Move all lower pairs one position up, effectively removing found pair. Only continue if
-    //NOT first pair, seeing that first pair is overwritten in next step bellow, effectively removing it.
-    if (idx!=0) {
-        //If NOT found, reduce idx to second last pair.
-        if (idx == UART_STATUS_BUF_SIZE)
-            idx = UART_STATUS_BUF_SIZE-2;
-
-        pCurr = &objUART->bufStat[idx+1];    //Address of "status" part of key-status pair just found
-        pSrc = pCurr-2;                     //Source is one pair lower in map
-
-        nzMemCpyDecNoOut_ASM_RRR(pCurr, pSrc, idx);
-        //nzMemCpyDec_ASM_RRR(pCurr, pSrc, idx);
-        //nzMemCpyDecNoCheck(pCurr, pSrc, idx);
-        //while(idx--!=0) {
-        //    *pCurr-- = *pSrc--;
-        //}
-    }
-
-    //Write given key-status pair to bottom of map
-    objUART->bufStat[0] = key;
-    objUART->bufStat[1] = status;
-
-    //Print current status map
-//    #if (MY_DEBUG_LEVEL >= DEBUG_LEVEL_INFO)
-//    pCurr = objUART->bufStat; //Initialize with first position in buffer
-//    DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nuartStatusMapPut Post: ");
-//    for(idx=UART_STATUS_BUF_SIZE ; idx!=0;) {
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, '=');
-//        DEBUG_PUT_HEXBYTE(DEBUG_LEVEL_INFO, *pCurr++);
-//        DEBUG_PUT_CHAR(DEBUG_LEVEL_INFO, ' ');
-//        idx -= 2;
-//    }
-//    #endif
+    statusMapSet(objUART->bufStat, UART_STATUS_BUF_SIZE, key & 0xfe, status);
 }
 
 #endif  //#if defined(HAS_SERPORT_UART)
\ No newline at end of file
@@ -28,6 +28,16 @@
 //Number of listeners that can be registered for all UART ports, a value from 1 to 7.
 #define     UART_LISTENERS          (4)             //[-DEFAULT-]
 
+//Collect interrupt, byte and error counters for each UART port, see UART_STATS. Set to 0 to disable.
+#define     UART_USE_STATS          (1)             //[-DEFAULT-]
+
+//UART transmit interrupt mode. Default interrupts when transmit FIFO is empty, ISR then refills whole FIFO.
+#define     UART_TXINT_MODE         (UART_INT_TX_BUF_EMPTY) //[-DEFAULT-]
+
+//UART receive interrupt mode. Default interrupts when receive FIFO is 3/4 full, ISR then reads whole FIFO.
+//Bytes bellow watermark are read by serUartTask(). Use UART_INT_RX_CHAR to interrupt on each byte.
+#define     UART_RXINT_MODE         (UART_INT_RX_3_4_FUL)   //[-DEFAULT-]
+
 //---- Enable UART1 as a "Serial Data Port" ----
 #define     NZ_UART1_ENABLE
 #define     USER_CONFIGURES_UART1   (0)             //[-DEFAULT-]
@@ -49,6 +59,12 @@
 //UART1 ISR timeout, default is 200ms. This is maximum time allowed from START till STOP
 #define     UART1_TIMEOUT           (200)           //[-DEFAULT-]
 
+//Uncomment to use DMA to move data between UART1 and it's "Circular Buffers", only available on PIC32MX.
+//UART1 interrupts are not used. The DMA channel interrupts (ipl5) start the next block at buffer wraparound.
+//#define     SERPORT_UART1_USE_DMA
+#define     UART1_DMA_TX_CH         (0)             //[-DEFAULT-]
+#define     UART1_DMA_RX_CH         (1)             //[-DEFAULT-]
+
 //---- Enable UART2 as a "Serial Data Port" ----
 #define     NZ_UART2_ENABLE
 #define     USER_CONFIGURES_UART1   (0)             //[-DEFAULT-]
@@ -167,6 +183,21 @@
 #endif
 
 
+//UART transmit interrupt mode (UTXISEL bits). Default interrupts when transmit FIFO is empty
+#if !defined(UART_TXINT_MODE)
+#define UART_TXINT_MODE UART_INT_TX_BUF_EMPTY
+#endif
+
+//UART receive interrupt mode (URXISEL bits). Default interrupts when receive FIFO is 3/4 full
+#if !defined(UART_RXINT_MODE)
+#define UART_RXINT_MODE UART_INT_RX_3_4_FUL
+#endif
+
+//Collect interrupt, byte and error counters for each UART port, see UART_STATS
+#if !defined(UART_USE_STATS)
+#define UART_USE_STATS  1
+#endif
+
 //Transmit and Receive buffer sizes
 #if !defined(UART1_RXBUF_SIZE)
 #define    UART1_RXBUF_SIZE  64
@@ -301,14 +332,31 @@ typedef struct __attribute__((__packed__)) UART_ISR_SMFLAGS_
     };
 } UART_ISR_SMFLAGS;
 
-//Must be a power of two value: 4,8,16,32,64
-#define UART_STATUS_BUF_SIZE 8
+//Size of status map, 2 bytes per entry. Must be a power of two value: 8,16,32,64
+#if !defined(UART_STATUS_BUF_SIZE)
+#define UART_STATUS_BUF_SIZE 16
+#endif
+
+/**
+ * UART counters, updated in ISR. Only available if UART_USE_STATS is 1.
+ * Values are NOT read atomically, only use them for statistics!
+ */
+typedef struct UART_STATS_
+{
+    WORD            txInts;     //Number of TX interrupts
+    WORD            rxInts;     //Number of RX interrupts
+    DWORD           txBytes;    //Number of bytes written to TX FIFO
+    DWORD           rxBytes;    //Number of bytes read from RX FIFO
+    WORD            rxOverruns; //Number of RX FIFO overruns (OERR), bytes in FIFO are lost
+    WORD            rxErrors;   //Number of Framing (FERR) and Parity (PERR) errors
+    WORD            rxDropped;  //Number of bytes dropped, because RX "Circular Buffer" was full
+} UART_STATS;
 
 typedef struct UART_INFO_
 //typedef struct __attribute__((__packed__)) UART_INFO_
 //typedef struct __attribute__((aligned(2), packed)) UART_INFO_
 {
-    //Buffer containing status. Two bytes are used for each entry, the LSB=Address (0=empty), and MSB=Status.
+    //Status map, hash table indexed by address, see nz_statusMap.h. Two bytes are used for each entry, the LSB=Address (0=empty), and MSB=Status.
     BYTE            bufStat[UART_STATUS_BUF_SIZE];
     BYTE            adr;        //Used by non-ISR functions to remember current slave address
     BYTE            taskSm;     //ISR State machine. 0 is idle.
@@ -331,6 +379,9 @@ typedef struct UART_INFO_
         } flags;
         WORD flagsVal;
     };
+    #if (UART_USE_STATS==1)
+    UART_STATS      stats;      //Counters, for statistics
+    #endif
 } UART_INFO;
 
 
@@ -391,6 +442,17 @@ UART_INFO* uartGetInfoForBus(BYTE uartBus);
  */
 BYTE serUartIsBusy(UART_INFO* objUART);
 
+
+#if (UART_USE_STATS==1)
+/**
+ * Clear all counters of given UART port.
+ *
+ * @param objUART The UART bus to clear counters for. Use UARTx_INFO defines,
+ *        for example UART1_INFO = UART 1.
+ */
+void serUartClearStats(UART_INFO* objUART);
+#endif
+
 /**
  * Add a byte to the UART Transmit Queue (Circular Buffer).
  *
@@ -0,0 +1,117 @@
+/**
+ * @brief           Status map used by I2C and UART "Serial Data Ports"
+ * @file            nz_statusMap.h
+ * @author          <a href="www.modtronix.com">Modtronix Engineering</a>
+ * @compiler        MPLAB XC16 compiler
+ *
+ * @section nz_statusMap_desc Description
+ *****************************************
+ * Small hash table of key-status pairs, used by nz_serI2C.c and nz_serUart.c to remember the
+ * status of the last transmission to each address. Two bytes are used for each entry, the
+ * LSB=Key (7-bit address, 0=empty), and MSB=Status (0xff=available). The size of the map in bytes
+ * must be a power of 2, and at least 4.
+ *
+ * A key is stored in it's home slot (key modulo number of entries), or the slot after it. So a
+ * lookup checks at most 2 slots.
+ *
+ * The functions are defined static in this file, so the map size is a constant in each function
+ * call. It is only included by nz_serI2C.c, nz_serUart.c and the host test in the "host" folder.
+ *
+ **********************************************************************
+ * @section nz_statusMap_lic Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ *********************************************************************/
+#ifndef NZ_STATUS_MAP_H
+#define NZ_STATUS_MAP_H
+
+//Home slot (index of key byte in map) of given key. Is 7-bit address, modulo number of entries
+#define STATUS_MAP_HOME(key, size) ((WORD)(key) & ((size)-2))
+
+
+/**
+ * Gets index in map of key-status pair for given key. A key can only be stored in it's
+ * home slot, or the slot after it.
+ *
+ * @param map Status map
+ * @param size Size of map in bytes, power of 2
+ * @param key Key, bit 0 must be clear
+ * @return Index in map of key-status pair, or size if not found
+ */
+static WORD statusMapFind(const BYTE* map, WORD size, BYTE key) {
+    WORD idx;
+
+    idx = STATUS_MAP_HOME(key, size);
+    if (map[idx] == key)
+        return idx;
+    idx = (idx + 2) & (size-1);
+    if (map[idx] == key)
+        return idx;
+    return size;
+}
+
+
+/**
+ * Gets status for given key, and marks that key-value pair as available (set status to 0xff).
+ * The caller must ensure statusMapSet() is not called at the same time (disable interrupt).
+ *
+ * @param map Status map
+ * @param size Size of map in bytes, power of 2
+ * @param key Key, bit 0 must be clear
+ * @return Status, or 0xff if not found
+ */
+static BYTE statusMapTake(BYTE* map, WORD size, BYTE key) {
+    BYTE ret;
+    WORD idx;
+
+    idx = statusMapFind(map, size, key);
+    if (idx == size)
+        return 0xff;
+    ret = map[idx+1];       //Get status for this key
+    map[idx+1] = 0xff;      //Mark current key-status pair as available
+    return ret;
+}
+
+
+/**
+ * Add given key-status pair to map.
+ * - If key is already in it's home slot or the slot after it, it's status is updated
+ * - Else, it is added to one of these slots that is empty (key=0) or available (status=0xff), home slot first
+ * - Else, the home slot is overwritten, effectively removing that older entry
+ *
+ * @param map Status map
+ * @param size Size of map in bytes, power of 2
+ * @param key Key, bit 0 must be clear
+ * @param status Status
+ */
+static void statusMapSet(BYTE* map, WORD size, BYTE key, BYTE status) {
+    WORD idx;
+    WORD idxNext;
+
+    idx = statusMapFind(map, size, key);
+    if (idx == size) {
+        idx = STATUS_MAP_HOME(key, size);
+        idxNext = (idx + 2) & (size-1);
+        //Use next slot if home slot is used, and next slot is empty (key=0) or available (status=0xff)
+        if ((map[idx] != 0) && (map[idx+1] != 0xff)
+                && ((map[idxNext] == 0) || (map[idxNext+1] == 0xff)))
+            idx = idxNext;
+        map[idx] = key;
+    }
+    map[idx+1] = status;
+}
+
+#endif  //#ifndef NZ_STATUS_MAP_H
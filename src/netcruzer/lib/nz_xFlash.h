@@ -100,6 +100,39 @@ void xflashInit(void);
 void xflashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen);
 
 
+/**
+ * Starts a streaming read from the SPI Flash module. The chip select is left
+ * asserted after the READ opcode and address have been sent, so that following
+ * calls to xflashReadNext() continue reading from sequential addresses without
+ * sending a new opcode and address. Must be terminated with xflashEndRead().
+ * No other devices on the same SPI bus may be accessed until xflashEndRead() is
+ * called!
+ *
+ * @preCondition xflashInit has been called, and the chip is not busy (should be
+ * handled elsewhere automatically.)
+ *
+ * @param dwAddress Address from which to start reading
+ */
+void xflashBeginRead(DWORD dwAddress);
+
+
+/**
+ * Reads the next array of bytes of a streaming read started with xflashBeginRead().
+ *
+ * @preCondition xflashBeginRead() has been called
+ *
+ * @param vData Where to store data that has been read
+ * @param wLen Length of data to read
+ */
+void xflashReadNext(BYTE *vData, WORD wLen);
+
+
+/**
+ * Ends a streaming read started with xflashBeginRead(), and releases the chip select.
+ */
+void xflashEndRead(void);
+
+
 /**
  * Prepares the SPI Flash module for writing. Subsequent calls to xflashWrite or
  * xflashWriteArray will begin at this location and continue sequentially.
@@ -188,4 +221,97 @@ void xflashWriteArray(BYTE *vData, WORD wLen, BOOL bEraseSector);
 void xflashEraseSector(DWORD dwAddr);
 
 
+#if defined(XFLASH_USE_ASYNC)
+/////////////////////////////////////////////////
+//Asynchronous erase and program. Erases and page programs are queued, and started by xflashAsyncTask()
+//when the Flash is not busy. Sequential writes are added to the same page buffer, so each page is
+//programmed with a single page program. Enable by defining XFLASH_USE_ASYNC in projdefs.h.
+//All other (blocking) write functions first wait for the queue to be empty. Read functions only wait
+//for the current erase or program to finish, so data still in the queue is not read back!
+#if !defined(XFLASH_ASYNC_JOBS)
+#define XFLASH_ASYNC_JOBS           8       //Size of erase and program job queue
+#endif
+#if !defined(XFLASH_ASYNC_PAGES)
+#define XFLASH_ASYNC_PAGES          2       //Number of page buffers, each SPI_FLASH_PAGE_SIZE bytes
+#endif
+#if !defined(XFLASH_ASYNC_FLUSH_TIME)
+#define XFLASH_ASYNC_FLUSH_TIME     20      //A partial page is programmed after this many ms without new data
+#endif
+
+
+/**
+ * Sets the write cursor for following xflashAsyncWriteArray() calls. If dwEraseEnd is not 0, sectors
+ * following the write cursor are erased in the background, ahead of the data written to them. This
+ * is done for all sectors starting at the first sector boundary at or above dwAddr, up to dwEraseEnd.
+ *
+ * @preCondition xflashInit has been called.
+ *
+ * @param dwAddr Address where the writing will begin
+ * @param dwEraseEnd Erase sectors ahead of write cursor up to this address. Use 0 if the area has
+ *        already been erased.
+ */
+void xflashAsyncBeginWrite(DWORD dwAddr, DWORD dwEraseEnd);
+
+
+/**
+ * Queues given data for writing at the current write cursor. Only the data that fits in the queue
+ * is accepted, use xflashAsyncGetFree() to check how much space is available.
+ *
+ * @preCondition xflashAsyncBeginWrite() has been called
+ *
+ * @param vData The array to write
+ * @param wLen The length of the data to be written
+ *
+ * @return Returns number of bytes accepted, is less than wLen if queue is full
+ */
+WORD xflashAsyncWriteArray(BYTE* vData, WORD wLen);
+
+
+/**
+ * Queues the erase of the sector containing given address.
+ *
+ * @param dwAddr The address of the sector to be erased.
+ *
+ * @return Returns TRUE if queued, or FALSE if queue is full
+ */
+BOOL xflashAsyncEraseSector(DWORD dwAddr);
+
+
+/**
+ * Gets the number of bytes xflashAsyncWriteArray() will currently accept at the write cursor.
+ *
+ * @return Number of free bytes
+ */
+WORD xflashAsyncGetFree(void);
+
+
+/**
+ * Causes a partially filled last page to be programmed without waiting XFLASH_ASYNC_FLUSH_TIME for
+ * more data.
+ */
+void xflashAsyncFlush(void);
+
+
+/**
+ * Checks if all queued erases and programs have completed.
+ *
+ * @return Returns TRUE if queue is empty, and the Flash is not busy
+ */
+BOOL xflashAsyncIsIdle(void);
+
+
+/**
+ * Flushes the queue, and waits (blocking) until all queued erases and programs have completed.
+ */
+void xflashAsyncWaitIdle(void);
+
+
+/**
+ * Must be called frequently, is called by nzSysTaskDefault(). Polls the status register of the Flash
+ * once if it is busy, and starts the next queued job when it is done. Never waits for the Flash.
+ */
+void xflashAsyncTask(void);
+#endif  //#if defined(XFLASH_USE_ASYNC)
+
+
 #endif
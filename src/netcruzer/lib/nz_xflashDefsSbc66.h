@@ -125,6 +125,12 @@
     #error "This bootloader only covers the PIC24FJ256GB210 family devices.  Please see another folder for the bootloader appropriate for the selected device."
 #endif
 
+//Byte address (in hex file) of start of "Firmware Image" = 0x900000 word address. A compressed and/or delta firmware image (starts
+//with a FIRMWARE_IMAGE_HDR) located in this range is written as is to the FirmwareX area, instead of the Program Memory data.
+//Only 50% contains data, same as for MEM_XEEPROM_START.
+#define MEM_FWIMAGE_START           0x01200000
+#define MEM_FWIMAGE_LAST           (MEM_FWIMAGE_START + (XFLASH_FIRMWARE_SIZE_IN_SECTORS*0x1000*2) - 1)
+
 
 
 /////////////////////////////////////////////////
@@ -245,5 +251,24 @@ typedef struct __attribute__ ((packed)) _FIRMWARE_INFO
 #define FIRMWARE_INFO_MAGIC_NUMBER 0x536A
 
 
+/**
+ * Header of a compressed and/or delta firmware image in the FirmwareA or FirmwareB area. When the FirmwareX area
+ * does not start with this header, it contains the raw packed Program Memory. The image data format is described
+ * in the bootloader (usb_hid_boot/main.c), which decodes and verifies it before programming.
+ */
+typedef struct __attribute__ ((packed)) _FIRMWARE_IMAGE_HDR
+{
+    DWORD   magicNumber;    //Must have the value FIRMWARE_IMAGE_MAGIC_NUMBER
+    BYTE    format;         //FIRMWARE_FORMAT_xx flags
+    BYTE    reserved[3];
+    DWORD   size;           //Size of image data following this header
+    DWORD   crc;            //CRC-32 of decoded image
+    DWORD   crcBase;        //Only for FIRMWARE_FORMAT_DELTA. CRC-32 of raw image in other Firmware area
+} FIRMWARE_IMAGE_HDR;
+#define FIRMWARE_IMAGE_MAGIC_NUMBER 0x57465A4Eul    //"NZFW"
+#define FIRMWARE_FORMAT_LZ          0x01            //Image data is LZSS compressed
+#define FIRMWARE_FORMAT_DELTA       0x02            //Image data is a delta patch to other Firmware area
+
+
 #endif
 
@@ -0,0 +1,340 @@
+/**
+ * Linux host tool for the pipelined bulk write protocol of the USB HID Bootloader.
+ *
+ * Writes a file (or generated test data) to the external FLASH of a board running the bootloader, using
+ * the vendor class bulk interface (bootloader must be compiled with BOOT_USE_BULK defined). Measures and
+ * prints the throughput, and checks the CRC-32 returned by the bootloader.
+ *
+ * Requires libusb 1.0 and its development headers. For example "apt-get install libusb-1.0-0-dev" on Debian
+ * and Ubuntu, or "dnf install libusb1-devel" on Fedora. The bootloader (VID 0x04D8, PID 0xF8E0) is opened
+ * directly, so run as root, or add a udev rule giving the user access to the device. For example, put the
+ * following line in /etc/udev/rules.d/99-nzboot.rules:
+ *   SUBSYSTEM=="usb", ATTR{idVendor}=="04d8", ATTR{idProduct}=="f8e0", MODE="0666"
+ *
+ * Build with:  gcc -O2 -o nzbootbulk nzbootbulk.c -lusb-1.0
+ *
+ * If the headers are not in the default include path, add the output of "pkg-config --cflags --libs libusb-1.0".
+ *
+ * Usage: nzbootbulk [-a address] [-e] [-w window] [-n bytes] [file]
+ *  -a  External FLASH byte address to write to, default is 0x86000 (start of User Space)
+ *  -e  Erase each sector before writing to it, address must be sector (4096 byte) aligned
+ *  -w  Acknowledgment window in packets, 1 to 255. Default is 16
+ *  -n  Number of bytes of test data to write if no file is given. Default is 262144
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <libusb-1.0/libusb.h>
+
+#define BOOT_VID                0x04D8
+#define BOOT_PID                0xF8E0
+#define BULK_INTF_ID            1
+#define BULK_EP_OUT             0x02
+#define BULK_EP_IN              0x82
+#define BULK_EP_SIZE            64
+
+//Must be same as in bootloader main.c
+#define BULK_CMD_WRITE_XFLASH   0xA0
+#define BULK_CMD_ACK            0xA1
+#define BULK_FLAG_ERASE         0x01
+#define BULK_STAT_BUSY          0x00
+#define BULK_STAT_DONE          0x01
+#define BULK_STAT_ERROR         0x02
+
+#define TIMEOUT_MS              5000
+
+static struct {
+    uint8_t* data;
+    uint32_t len;
+    uint32_t sentBytes;     //Bytes submitted to OUT endpoint
+    uint32_t sentPkts;      //Packets submitted to OUT endpoint
+    uint32_t ackPkts;       //Packets acknowledged by bootloader
+    uint32_t written;       //Bytes written to FLASH, as given in last acknowledgment
+    uint32_t crc;           //CRC-32 given in last acknowledgment
+    int outPending;         //Number of OUT transfers not completed yet
+    int done;
+    int error;
+    uint8_t ackBuf[BULK_EP_SIZE];
+} st;
+
+static uint32_t getLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t crc32(const uint8_t* p, uint32_t len) {
+    uint32_t crc = 0xffffffff;
+    int i;
+
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Parses acknowledgment received from bootloader. Returns status, or -1 if not an acknowledgment.
+ */
+static int parseAck(const uint8_t* p, int len) {
+    uint16_t seq;
+
+    if ((len < 12) || (p[0] != BULK_CMD_ACK))
+        return -1;
+
+    //Extend 16-bit sequence number
+    seq = p[2] | (p[3] << 8);
+    st.ackPkts += (uint16_t)(seq - (uint16_t)st.ackPkts);
+    st.written = getLE32(&p[4]);
+    st.crc = getLE32(&p[8]);
+    return p[1];
+}
+
+static void LIBUSB_CALL outDone(struct libusb_transfer* xfer) {
+    if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        fprintf(stderr, "OUT transfer failed, status %d\n", xfer->status);
+        st.error = 1;
+    }
+    st.outPending--;
+    libusb_free_transfer(xfer);
+}
+
+static void LIBUSB_CALL inDone(struct libusb_transfer* xfer) {
+    int status;
+
+    //Cancelled after an error
+    if (xfer->status == LIBUSB_TRANSFER_CANCELLED) {
+        st.outPending--;
+        return;
+    }
+    if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        fprintf(stderr, "IN transfer failed, status %d\n", xfer->status);
+        st.error = 1;
+        return;
+    }
+
+    status = parseAck(xfer->buffer, xfer->actual_length);
+    if (status == BULK_STAT_DONE) {
+        st.done = 1;
+        return;
+    }
+    if (status != BULK_STAT_BUSY) {
+        fprintf(stderr, "Bootloader returned error, status %d\n", status);
+        st.error = 1;
+        return;
+    }
+
+    if (libusb_submit_transfer(xfer) != 0)
+        st.error = 1;
+}
+
+/**
+ * Submits next chunk of "window" packets to OUT endpoint, if window allows it.
+ * Returns 1 if a transfer was submitted.
+ */
+static int submitChunk(libusb_device_handle* h, int window) {
+    struct libusb_transfer* xfer;
+    uint32_t bytes;
+    uint32_t pkts;
+
+    if (st.sentBytes >= st.len)
+        return 0;
+
+    bytes = st.len - st.sentBytes;
+    if (bytes > (uint32_t)window * BULK_EP_SIZE)
+        bytes = (uint32_t)window * BULK_EP_SIZE;
+    pkts = (bytes + BULK_EP_SIZE - 1) / BULK_EP_SIZE;
+
+    //Not more than 2 x window unacknowledged packets
+    if ((st.sentPkts + pkts - st.ackPkts) > (uint32_t)(2 * window))
+        return 0;
+
+    xfer = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(xfer, h, BULK_EP_OUT, st.data + st.sentBytes, bytes, outDone, NULL, TIMEOUT_MS);
+    if (libusb_submit_transfer(xfer) != 0) {
+        libusb_free_transfer(xfer);
+        st.error = 1;
+        return 0;
+    }
+
+    st.outPending++;
+    st.sentBytes += bytes;
+    st.sentPkts += pkts;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    libusb_context* ctx = NULL;
+    libusb_device_handle* h;
+    struct libusb_transfer* inXfer;
+    struct timeval tv;
+    uint8_t cmd[BULK_EP_SIZE];
+    uint32_t address = 0x86000;
+    uint32_t i;
+    int flags = 0;
+    int window = 16;
+    int len;
+    int opt;
+    double tStart;
+    double tEnd;
+    double tProgress;
+    FILE* f;
+
+    st.len = 262144;
+    while ((opt = getopt(argc, argv, "a:ew:n:")) != -1) {
+        switch (opt) {
+        case 'a': address = strtoul(optarg, NULL, 0); break;
+        case 'e': flags |= BULK_FLAG_ERASE; break;
+        case 'w': window = atoi(optarg); break;
+        case 'n': st.len = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "Usage: %s [-a address] [-e] [-w window] [-n bytes] [file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if ((window < 1) || (window > 255)) {
+        fprintf(stderr, "Window must be 1 to 255\n");
+        return 1;
+    }
+    if ((flags & BULK_FLAG_ERASE) && (address & 0xfff)) {
+        fprintf(stderr, "Address must be sector (4096 byte) aligned with -e\n");
+        return 1;
+    }
+
+    //Read file, or generate test data
+    if (optind < argc) {
+        if ((f = fopen(argv[optind], "rb")) == NULL) {
+            perror(argv[optind]);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        st.len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        st.data = malloc(st.len);
+        if (fread(st.data, 1, st.len, f) != st.len) {
+            perror(argv[optind]);
+            return 1;
+        }
+        fclose(f);
+    } else {
+        st.data = malloc(st.len);
+        srand(1);
+        for (i = 0; i < st.len; i++)
+            st.data[i] = (uint8_t)rand();
+    }
+
+    if (libusb_init(&ctx) != 0) {
+        fprintf(stderr, "libusb_init failed\n");
+        return 1;
+    }
+    if ((h = libusb_open_device_with_vid_pid(ctx, BOOT_VID, BOOT_PID)) == NULL) {
+        fprintf(stderr, "Bootloader not found (%04X:%04X)\n", BOOT_VID, BOOT_PID);
+        return 1;
+    }
+    if (libusb_claim_interface(h, BULK_INTF_ID) != 0) {
+        fprintf(stderr, "Can not claim bulk interface, is bootloader compiled with BOOT_USE_BULK?\n");
+        return 1;
+    }
+
+    //Send write command, and wait for acknowledgment
+    memset(cmd, 0, sizeof(cmd));
+    cmd[0] = BULK_CMD_WRITE_XFLASH;
+    cmd[1] = (uint8_t)window;
+    cmd[2] = (uint8_t)flags;
+    putLE32(&cmd[4], address);
+    putLE32(&cmd[8], st.len);
+
+    tStart = now();
+    if ((libusb_bulk_transfer(h, BULK_EP_OUT, cmd, 12, &len, TIMEOUT_MS) != 0)
+            || (libusb_bulk_transfer(h, BULK_EP_IN, st.ackBuf, BULK_EP_SIZE, &len, TIMEOUT_MS) != 0)
+            || (parseAck(st.ackBuf, len) < 0)) {
+        fprintf(stderr, "No acknowledgment for write command\n");
+        return 1;
+    }
+    st.ackPkts = 0;
+    st.done = (st.len == 0);
+
+    //Keep an IN transfer pending for deferred acknowledgments, and pipeline OUT transfers
+    inXfer = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(inXfer, h, BULK_EP_IN, st.ackBuf, BULK_EP_SIZE, inDone, NULL, 0);
+    if (!st.done && (libusb_submit_transfer(inXfer) != 0)) {
+        fprintf(stderr, "Can not submit IN transfer\n");
+        return 1;
+    }
+
+    tProgress = now();
+    while (!st.done && !st.error) {
+        while (submitChunk(h, window))
+            ;
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        i = st.ackPkts;
+        libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+        if (i != st.ackPkts) {
+            tProgress = now();
+        } else if ((now() - tProgress) > (TIMEOUT_MS / 1000.0)) {
+            fprintf(stderr, "Timeout, %u of %u bytes written\n", st.written, st.len);
+            st.error = 1;
+        }
+    }
+    tEnd = now();
+
+    //Wait for outstanding transfers to finish
+    if (st.error && (libusb_cancel_transfer(inXfer) == 0))
+        st.outPending++;    //Cancelled IN transfer also has to complete
+    while (st.outPending > 0) {
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+        libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+    }
+
+    if (!st.error) {
+        printf("Wrote %u bytes to 0x%06X in %.3f s, %.1f KB/s (window %d)\n", st.len, address,
+                tEnd - tStart, st.len / 1024.0 / (tEnd - tStart), window);
+        if (st.crc != crc32(st.data, st.len)) {
+            fprintf(stderr, "CRC mismatch, bootloader 0x%08X, expected 0x%08X\n", st.crc, crc32(st.data, st.len));
+            st.error = 1;
+        }
+    }
+
+    libusb_free_transfer(inXfer);
+    libusb_release_interface(h, BULK_INTF_ID);
+    libusb_close(h);
+    libusb_exit(ctx);
+    free(st.data);
+    return st.error ? 1 : 0;
+}
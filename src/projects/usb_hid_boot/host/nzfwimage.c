@@ -0,0 +1,681 @@
+/**
+ * Linux host tool that creates LZSS compressed and delta firmware images for the USB HID Bootloader.
+ *
+ * Reads the raw packed program memory of the new firmware (as stored in a FirmwareA or FirmwareB area of the
+ * external FLASH), and writes it with a FIRMWARE_IMAGE_HDR header as a compressed (-l) and/or delta (-d) image.
+ * The delta is created against the raw packed program memory in the other Firmware area. The created image is
+ * decoded again with a copy of the bootloader decoder, and checked before it is written. See FIRMWARE_IMAGE_HDR
+ * in the bootloader main.c for the format.
+ *
+ * The -t option runs the self test. It decodes fixed test vectors, including corrupt images that must be rejected,
+ * and encodes and decodes generated firmware with all formats.
+ *
+ * Build with:  gcc -O2 -o nzfwimage nzfwimage.c
+ *
+ * Usage: nzfwimage [-l] [-d base] -o output input
+ *        nzfwimage -t
+ *  -l  LZSS compress image data
+ *  -d  Create delta patch to given raw image, that must be in the other Firmware area
+ *  -o  Output file, written to FirmwareA or FirmwareB area with nzbootbulk or the HID bootloader
+ *  -t  Run self test
+ *
+ * Software License Agreement
+ *
+ * The software supplied herewith is owned by Modtronix Engineering, and is
+ * protected under applicable copyright laws. The software supplied herewith is
+ * intended and supplied to you, the Company customer, for use solely and
+ * exclusively on products manufactured by Modtronix Engineering. The code may
+ * be modified and can be used free of charge for commercial and non commercial
+ * applications. All rights are reserved. Any use in violation of the foregoing
+ * restrictions may subject the user to criminal sanctions under applicable laws,
+ * as well as to civil liability for the breach of the terms and conditions of this license.
+ *
+ * THIS SOFTWARE IS PROVIDED IN AN 'AS IS' CONDITION. NO WARRANTIES, WHETHER EXPRESS,
+ * IMPLIED OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE APPLY TO THIS SOFTWARE. THE
+ * COMPANY SHALL NOT, IN ANY CIRCUMSTANCES, BE LIABLE FOR SPECIAL, INCIDENTAL OR
+ * CONSEQUENTIAL DAMAGES, FOR ANY REASON WHATSOEVER.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+//Same sizes as XC16, DWORD is NOT unsigned long on a 64-bit host
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+
+#define NZ_CRC_HOST
+#include "../../../netcruzer/lib/nz_crc.c"
+
+//Must be same as in bootloader main.c
+#define FIRMWARE_IMAGE_MAGIC_NUMBER 0x57465A4Eul    //"NZFW"
+#define FIRMWARE_FORMAT_LZ          0x01
+#define FIRMWARE_FORMAT_DELTA       0x02
+#define FIRMWARE_IMAGE_HDR_SIZE     24
+#define FW_LZ_WIN_SIZE              4096
+#define FW_LZ_WIN_MASK              (FW_LZ_WIN_SIZE-1)
+#define FW_LZ_MIN_MATCH             3
+#define FW_LZ_MAX_MATCH             (15 + FW_LZ_MIN_MATCH)
+#define FW_DELTA_MAX_LEN            0x8000
+#define FW_FIRMWARE_AREA_SIZE       (63*4096)       //XFLASH_FIRMWARE_SIZE_IN_SECTORS*XFLASH_SECTOR_SIZE
+
+//Size of raw packed program memory for PIC24FJ256GB2xx, FW_IMAGE_SIZE in main.c. Used by self test
+#define TEST_IMAGE_SIZE             (((0x2A800 - 0x1C00)/2)*3)
+
+#define LZ_HASH_SIZE                4096
+#define LZ_MAX_CHAIN                256
+#define DT_BLOCK                    8               //Bytes hashed to find copies for delta
+#define DT_HASH_SIZE                65536
+
+typedef struct {
+    uint8_t* p;
+    uint32_t len;
+    uint32_t size;
+} BUF;
+
+static int errors = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        printf("FAILED line %d: %s\n", __LINE__, msg); \
+        errors++; \
+    }
+
+static void bufPut(BUF* b, uint8_t c) {
+    if (b->len == b->size) {
+        b->size = b->size ? (b->size * 2) : 4096;
+        b->p = realloc(b->p, b->size);
+    }
+    b->p[b->len++] = c;
+}
+
+static void bufPutArray(BUF* b, const uint8_t* p, uint32_t len) {
+    while (len--)
+        bufPut(b, *p++);
+}
+
+static void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t crc32(const uint8_t* p, uint32_t len) {
+    DWORD crc = 0xfffffffful;
+    WORD n;
+
+    while (len) {
+        n = (len > 0x8000) ? 0x8000 : (WORD)len;
+        crc = crc32Update(crc, p, n);
+        p += n;
+        len -= n;
+    }
+    return ~crc;
+}
+
+
+/////////////////////////////////////////////////
+//Decoder, same as fwInGet(), fwLzGet(), fwStreamGet() and fwDeltaGet() in bootloader main.c. FLASH reads
+//are replaced by reads from memory.
+static struct {
+    uint8_t format;
+    int err;
+    const uint8_t* in;
+    uint32_t inLeft;
+    const uint8_t* base;
+    uint32_t baseSize;
+    uint8_t lzWin[FW_LZ_WIN_SIZE];
+    uint16_t lzWinPos;
+    uint16_t lzCount;
+    uint16_t lzMatchDist;
+    uint8_t lzMatchLen;
+    uint8_t lzFlags;
+    uint8_t lzFlagCnt;
+    uint32_t dtCopyOfs;
+    uint16_t dtLeft;
+    int dtCopy;
+} dec;
+
+static uint8_t decInGet(void) {
+    if (dec.inLeft == 0) {
+        dec.err = 1;
+        return 0xff;
+    }
+    dec.inLeft--;
+    return *dec.in++;
+}
+
+static uint8_t decLzGet(void) {
+    uint8_t c;
+    uint16_t w;
+
+    if (dec.lzMatchLen == 0) {
+        if (dec.lzFlagCnt == 0) {
+            dec.lzFlags = decInGet();
+            dec.lzFlagCnt = 8;
+        }
+        dec.lzFlagCnt--;
+        c = dec.lzFlags & 0x01;
+        dec.lzFlags >>= 1;
+
+        //Literal. Is put in window, and copied to itself below as a match of length 1 at distance 0
+        if (c) {
+            dec.lzWin[dec.lzWinPos] = decInGet();
+            dec.lzMatchDist = 0;
+            dec.lzMatchLen = 1;
+        }
+        //Match
+        else {
+            w = decInGet();
+            w |= ((uint16_t)decInGet()) << 8;
+            dec.lzMatchDist = (w & FW_LZ_WIN_MASK) + 1;
+            dec.lzMatchLen = (w >> 12) + FW_LZ_MIN_MATCH;
+            if (dec.lzMatchDist > dec.lzCount)
+                dec.err = 1;
+        }
+    }
+
+    dec.lzMatchLen--;
+    c = dec.lzWin[(dec.lzWinPos - dec.lzMatchDist) & FW_LZ_WIN_MASK];
+    dec.lzWin[dec.lzWinPos] = c;
+    dec.lzWinPos = (dec.lzWinPos + 1) & FW_LZ_WIN_MASK;
+    if (dec.lzCount < FW_LZ_WIN_SIZE)
+        dec.lzCount++;
+    return c;
+}
+
+static uint8_t decStreamGet(void) {
+    return (dec.format & FIRMWARE_FORMAT_LZ) ? decLzGet() : decInGet();
+}
+
+static uint8_t decDeltaGet(void) {
+    uint8_t b;
+    uint32_t offset;
+
+    if (dec.dtLeft == 0) {
+        b = decStreamGet();
+        dec.dtCopy = (b & 0x80) ? 1 : 0;
+        dec.dtLeft = ((((uint16_t)b) & 0x7f) << 8) | decStreamGet();
+        dec.dtLeft++;
+        if (dec.dtCopy) {
+            offset = decStreamGet();
+            offset |= ((uint32_t)decStreamGet()) << 8;
+            offset |= ((uint32_t)decStreamGet()) << 16;
+            if ((offset + dec.dtLeft) > dec.baseSize)
+                dec.err = 1;
+            dec.dtCopyOfs = offset;
+        }
+    }
+    dec.dtLeft--;
+
+    if (dec.dtCopy == 0)
+        return decStreamGet();
+    if (dec.dtCopyOfs >= dec.baseSize)
+        return 0xff;
+    return dec.base[dec.dtCopyOfs++];
+}
+
+/**
+ * Decodes given image (with header) to given buffer, and checks it's header and CRC.
+ *
+ * @return 0 if OK, else -1
+ */
+static int decodeImage(const uint8_t* img, uint32_t imgLen, const uint8_t* base, uint32_t baseSize,
+        uint8_t* out, uint32_t outLen) {
+    uint32_t i;
+
+    if (imgLen < FIRMWARE_IMAGE_HDR_SIZE || getLE32(&img[0]) != FIRMWARE_IMAGE_MAGIC_NUMBER)
+        return -1;
+    memset(&dec, 0, sizeof(dec));
+    dec.format = img[4];
+    dec.in = &img[FIRMWARE_IMAGE_HDR_SIZE];
+    dec.inLeft = getLE32(&img[8]);
+    dec.base = base;
+    dec.baseSize = baseSize;
+    if ((dec.format & ~(FIRMWARE_FORMAT_LZ | FIRMWARE_FORMAT_DELTA))
+            || (dec.inLeft != imgLen - FIRMWARE_IMAGE_HDR_SIZE))
+        return -1;
+    if ((dec.format & FIRMWARE_FORMAT_DELTA) && (base == NULL || crc32(base, baseSize) != getLE32(&img[16])))
+        return -1;
+
+    //Delta can only be applied to a raw image, same as bootloader
+    if ((dec.format & FIRMWARE_FORMAT_DELTA) && (baseSize < 4 || getLE32(base) == FIRMWARE_IMAGE_MAGIC_NUMBER))
+        return -1;
+
+    for (i = 0; i < outLen && dec.err == 0; i++)
+        out[i] = (dec.format & FIRMWARE_FORMAT_DELTA) ? decDeltaGet() : decStreamGet();
+
+    return (dec.err == 0 && crc32(out, outLen) == getLE32(&img[12])) ? 0 : -1;
+}
+
+
+/////////////////////////////////////////////////
+//Encoder
+
+/**
+ * LZSS compress given data. Greedy, finds longest match in window with hash chains.
+ */
+static void lzEncode(const uint8_t* in, uint32_t len, BUF* out) {
+    static int32_t head[LZ_HASH_SIZE];
+    static int32_t prev[FW_LZ_WIN_SIZE];
+    uint32_t pos = 0, flagPos = 0, i, h;
+    uint32_t bestLen, bestDist, n, chain;
+    int32_t cand;
+    int items = 8;
+
+    for (i = 0; i < LZ_HASH_SIZE; i++)
+        head[i] = -1;
+
+    #define LZ_HASH(p) ((((p)[0] << 8) ^ ((p)[1] << 4) ^ (p)[2]) & (LZ_HASH_SIZE-1))
+
+    while (pos < len) {
+        if (items == 8) {
+            flagPos = out->len;
+            bufPut(out, 0);
+            items = 0;
+        }
+
+        //Find longest match in window
+        bestLen = 0;
+        bestDist = 0;
+        if (pos + FW_LZ_MIN_MATCH <= len) {
+            cand = head[LZ_HASH(&in[pos])];
+            for (chain = 0; cand >= 0 && (pos - cand) <= FW_LZ_WIN_SIZE && chain < LZ_MAX_CHAIN; chain++) {
+                for (n = 0; n < FW_LZ_MAX_MATCH && pos + n < len && in[cand + n] == in[pos + n]; n++)
+                    ;
+                if (n > bestLen) {
+                    bestLen = n;
+                    bestDist = pos - cand;
+                    if (n == FW_LZ_MAX_MATCH)
+                        break;
+                }
+                cand = prev[cand & FW_LZ_WIN_MASK];
+            }
+        }
+
+        if (bestLen >= FW_LZ_MIN_MATCH) {
+            n = (bestDist - 1) | ((bestLen - FW_LZ_MIN_MATCH) << 12);
+            bufPut(out, (uint8_t)n);
+            bufPut(out, (uint8_t)(n >> 8));
+        }
+        else {
+            bestLen = 1;
+            out->p[flagPos] |= 1 << items;
+            bufPut(out, in[pos]);
+        }
+        items++;
+
+        //Add all positions of this item to hash chains
+        for (i = 0; i < bestLen; i++, pos++) {
+            if (pos + FW_LZ_MIN_MATCH <= len) {
+                h = LZ_HASH(&in[pos]);
+                prev[pos & FW_LZ_WIN_MASK] = head[h];
+                head[h] = pos;
+            }
+        }
+    }
+}
+
+static void dtPutOp(BUF* out, int copy, uint32_t len, uint32_t offset, const uint8_t* lit) {
+    uint32_t n;
+
+    while (len) {
+        n = (len > FW_DELTA_MAX_LEN) ? FW_DELTA_MAX_LEN : len;
+        bufPut(out, (uint8_t)(((n - 1) >> 8) | (copy ? 0x80 : 0)));
+        bufPut(out, (uint8_t)(n - 1));
+        if (copy) {
+            bufPut(out, (uint8_t)offset);
+            bufPut(out, (uint8_t)(offset >> 8));
+            bufPut(out, (uint8_t)(offset >> 16));
+            offset += n;
+        }
+        else {
+            bufPutArray(out, lit, n);
+            lit += n;
+        }
+        len -= n;
+    }
+}
+
+/**
+ * Creates delta operations that create given data from given base. Copies are found by hashing DT_BLOCK byte
+ * blocks of base. A copy continues at the same offset as the previous copy if possible, seeing that most code
+ * is only moved by a few bytes.
+ */
+static void dtEncode(const uint8_t* in, uint32_t len, const uint8_t* base, uint32_t baseSize, BUF* out) {
+    int32_t* table = malloc(DT_HASH_SIZE * sizeof(int32_t));
+    uint32_t pos = 0, litStart = 0, i, h, n, bestLen, bestOfs = 0, next = 0;
+    int32_t cand;
+
+    #define DT_HASH(p) ((((p)[0] << 8) ^ ((p)[1] << 5) ^ ((p)[2] << 11) ^ ((p)[3] << 2) ^ ((p)[4] << 13) \
+            ^ ((p)[5] << 7) ^ (p)[6] ^ ((p)[7] << 10)) & (DT_HASH_SIZE-1))
+
+    for (i = 0; i < DT_HASH_SIZE; i++)
+        table[i] = -1;
+    for (i = 0; i + DT_BLOCK <= baseSize; i++) {
+        h = DT_HASH(&base[i]);
+        if (table[h] < 0)
+            table[h] = i;
+    }
+
+    while (pos < len) {
+        bestLen = 0;
+
+        //Continue at offset after previous copy, or find block in base
+        for (i = 0; i < 2 && pos + DT_BLOCK <= len; i++) {
+            if (i == 0)
+                cand = (next < baseSize) ? (int32_t)next : -1;
+            else
+                cand = table[DT_HASH(&in[pos])];
+            if (cand < 0)
+                continue;
+            for (n = 0; pos + n < len && cand + n < baseSize && in[pos + n] == base[cand + n]; n++)
+                ;
+            if (n > bestLen) {
+                bestLen = n;
+                bestOfs = cand;
+            }
+        }
+
+        //A copy operation is 5 bytes, only use it if it saves bytes
+        if (bestLen >= DT_BLOCK) {
+            dtPutOp(out, 0, pos - litStart, 0, &in[litStart]);
+            dtPutOp(out, 1, bestLen, bestOfs, NULL);
+            pos += bestLen;
+            litStart = pos;
+            next = bestOfs + bestLen;
+        }
+        else {
+            pos++;
+            next++;
+        }
+    }
+    dtPutOp(out, 0, pos - litStart, 0, &in[litStart]);
+    free(table);
+}
+
+/**
+ * Creates image with header for given raw image.
+ *
+ * @param base Raw image in other Firmware area, only used for FIRMWARE_FORMAT_DELTA
+ */
+static void createImage(const uint8_t* in, uint32_t len, const uint8_t* base, uint32_t baseSize, uint8_t format, BUF* out) {
+    BUF data = {0};
+    BUF lz = {0};
+    const BUF* src;
+
+    if (format & FIRMWARE_FORMAT_DELTA) {
+        dtEncode(in, len, base, baseSize, &data);
+    }
+    else {
+        bufPutArray(&data, in, len);
+    }
+    src = &data;
+    if (format & FIRMWARE_FORMAT_LZ) {
+        lzEncode(data.p, data.len, &lz);
+        src = &lz;
+    }
+
+    out->len = 0;
+    bufPutArray(out, (const uint8_t*)"\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", FIRMWARE_IMAGE_HDR_SIZE);
+    putLE32(&out->p[0], FIRMWARE_IMAGE_MAGIC_NUMBER);
+    out->p[4] = format;
+    putLE32(&out->p[8], src->len);
+    putLE32(&out->p[12], crc32(in, len));
+    putLE32(&out->p[16], (format & FIRMWARE_FORMAT_DELTA) ? crc32(base, baseSize) : 0);
+    bufPutArray(out, src->p, src->len);
+    free(data.p);
+    free(lz.p);
+}
+
+
+/////////////////////////////////////////////////
+//Self test
+
+/**
+ * Creates image for given test vector data, with given format and CRC of given expected output.
+ */
+static void testVector(const uint8_t* data, uint32_t dataLen, uint8_t format, const uint8_t* expected, uint32_t len,
+        const uint8_t* base, uint32_t baseSize, BUF* img) {
+    img->len = 0;
+    bufPutArray(img, (const uint8_t*)"\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", FIRMWARE_IMAGE_HDR_SIZE);
+    putLE32(&img->p[0], FIRMWARE_IMAGE_MAGIC_NUMBER);
+    img->p[4] = format;
+    putLE32(&img->p[8], dataLen);
+    putLE32(&img->p[12], crc32(expected, len));
+    putLE32(&img->p[16], base ? crc32(base, baseSize) : 0);
+    bufPutArray(img, data, dataLen);
+}
+
+static void testVectors(void) {
+    //"abc" as 3 literals, then match of distance 3 and length 9. Flags 0x07, match 0x6002 (LSB first)
+    static const uint8_t lzOk[] = {0x07, 'a', 'b', 'c', 0x02, 0x60};
+    static const uint8_t lzOkOut[] = "abcabcabcabc";
+    //First item is a match of distance 1, before start of image
+    static const uint8_t lzBadDist[] = {0x00, 0x00, 0x00};
+    //"ab" then match of distance 3, one byte before start of image
+    static const uint8_t lzBadDist2[] = {0x03, 'a', 'b', 0x02, 0x00};
+    //Truncated, flags promise 2 literals
+    static const uint8_t lzShort[] = {0x03, 'a'};
+    static const uint8_t base[] = "0123456789";
+    //Copy 4 bytes from offset 2, literal "xy", copy 3 bytes from offset 7
+    static const uint8_t dtOk[] = {0x80, 0x03, 0x02, 0x00, 0x00, 0x00, 0x01, 'x', 'y', 0x80, 0x02, 0x07, 0x00, 0x00};
+    static const uint8_t dtOkOut[] = "2345xy789";
+    //Copy 4 bytes from offset 8, past end of base
+    static const uint8_t dtBadOfs[] = {0x80, 0x03, 0x08, 0x00, 0x00};
+    //Base is not raw, starts with FIRMWARE_IMAGE_MAGIC_NUMBER
+    static const uint8_t baseImg[] = "NZFW456789";
+    uint8_t out[32];
+    BUF img = {0};
+
+    testVector(lzOk, sizeof(lzOk), FIRMWARE_FORMAT_LZ, lzOkOut, 12, NULL, 0, &img);
+    CHECK(decodeImage(img.p, img.len, NULL, 0, out, 12) == 0 && memcmp(out, lzOkOut, 12) == 0, "LZ test vector");
+
+    testVector(lzBadDist, sizeof(lzBadDist), FIRMWARE_FORMAT_LZ, (const uint8_t*)"\0\0\0", 3, NULL, 0, &img);
+    CHECK(decodeImage(img.p, img.len, NULL, 0, out, 3) != 0, "LZ match before start of image must be rejected");
+
+    testVector(lzBadDist2, sizeof(lzBadDist2), FIRMWARE_FORMAT_LZ, (const uint8_t*)"ab\0ab", 5, NULL, 0, &img);
+    CHECK(decodeImage(img.p, img.len, NULL, 0, out, 5) != 0, "LZ match before start of image must be rejected");
+
+    testVector(lzShort, sizeof(lzShort), FIRMWARE_FORMAT_LZ, (const uint8_t*)"ab", 2, NULL, 0, &img);
+    CHECK(decodeImage(img.p, img.len, NULL, 0, out, 2) != 0, "truncated LZ data must be rejected");
+
+    testVector(dtOk, sizeof(dtOk), FIRMWARE_FORMAT_DELTA, dtOkOut, 9, base, 10, &img);
+    CHECK(decodeImage(img.p, img.len, base, 10, out, 9) == 0 && memcmp(out, dtOkOut, 9) == 0, "delta test vector");
+
+    testVector(dtOk, sizeof(dtOk), FIRMWARE_FORMAT_DELTA, dtOkOut, 9, (const uint8_t*)"0123456780", 10, &img);
+    CHECK(decodeImage(img.p, img.len, base, 10, out, 9) != 0, "delta with wrong base must be rejected");
+
+    testVector(dtBadOfs, sizeof(dtBadOfs), FIRMWARE_FORMAT_DELTA, (const uint8_t*)"89\xff\xff", 4, base, 10, &img);
+    CHECK(decodeImage(img.p, img.len, base, 10, out, 4) != 0, "delta copy past end of base must be rejected");
+
+    testVector(dtOk, sizeof(dtOk), FIRMWARE_FORMAT_DELTA, (const uint8_t*)"FW45xy789", 9, baseImg, 10, &img);
+    CHECK(decodeImage(img.p, img.len, baseImg, 10, out, 9) != 0, "delta to base that is not raw must be rejected");
+
+    free(img.p);
+}
+
+/**
+ * Creates test firmware. Instructions are taken from a small set, like real code.
+ */
+static void testFirmware(uint8_t* p, uint32_t len) {
+    uint8_t instr[64][3];
+    uint32_t i, used;
+
+    for (i = 0; i < 64; i++) {
+        instr[i][0] = (uint8_t)rand();
+        instr[i][1] = (uint8_t)rand();
+        instr[i][2] = (uint8_t)rand();
+    }
+    used = len - (len / 4);     //Unused program memory is 0xff
+    for (i = 0; i + 3 <= used; i += 3) {
+        if (rand() % 4 == 0) {
+            p[i] = (uint8_t)rand();
+            p[i+1] = (uint8_t)rand();
+            p[i+2] = 0;
+        }
+        else {
+            memcpy(&p[i], instr[rand() % 64], 3);
+        }
+    }
+    memset(&p[i], 0xff, len - i);
+}
+
+static void testRoundTrip(const char* name, const uint8_t* in, uint32_t len, const uint8_t* base, uint8_t format) {
+    BUF img = {0};
+    uint8_t* out = malloc(len);
+
+    createImage(in, len, base, len, format, &img);
+    CHECK(decodeImage(img.p, img.len, base, len, out, len) == 0 && memcmp(out, in, len) == 0, name);
+    CHECK(img.len <= FW_FIRMWARE_AREA_SIZE, "image must fit in Firmware area");
+    printf("%-14s %7u bytes, %5.1f%%\n", name, img.len, 100.0 * img.len / len);
+
+    //Corrupt one byte of image data, must be rejected
+    if (img.len > FIRMWARE_IMAGE_HDR_SIZE + 100) {
+        img.p[FIRMWARE_IMAGE_HDR_SIZE + 100] ^= 0x5a;
+        CHECK(decodeImage(img.p, img.len, base, len, out, len) != 0, "corrupt image must be rejected");
+    }
+    free(img.p);
+    free(out);
+}
+
+static int selfTest(void) {
+    uint32_t len = TEST_IMAGE_SIZE;
+    uint8_t* base = malloc(len);
+    uint8_t* fw = malloc(len);
+    uint32_t i, ofs;
+
+    testVectors();
+    if (errors)
+        return 1;
+    printf("Test vectors OK\n");
+
+    //New firmware is old firmware with some changed, inserted and removed code
+    srand(1);
+    testFirmware(base, len);
+    memcpy(fw, base, len);
+    for (i = 0; i < 20; i++) {
+        ofs = (rand() % (len / 2)) / 3 * 3;
+        if (i & 1) {
+            memmove(&fw[ofs + 12], &fw[ofs], len - ofs - 12);   //Insert 4 instructions
+            memset(&fw[ofs], 0x5a, 12);
+        }
+        else {
+            memmove(&fw[ofs], &fw[ofs + 6], len - ofs - 6);     //Remove 2 instructions
+            fw[ofs] ^= 0x33;
+        }
+    }
+
+    printf("Raw image      %7u bytes\n", len);
+    testRoundTrip("LZ", fw, len, NULL, FIRMWARE_FORMAT_LZ);
+    testRoundTrip("Delta", fw, len, base, FIRMWARE_FORMAT_DELTA);
+    testRoundTrip("LZ and delta", fw, len, base, FIRMWARE_FORMAT_LZ | FIRMWARE_FORMAT_DELTA);
+    free(base);
+    free(fw);
+
+    if (errors)
+        return 1;
+    printf("Self test OK\n");
+    return 0;
+}
+
+
+/////////////////////////////////////////////////
+//Main
+
+static uint8_t* readFile(const char* name, uint32_t* len) {
+    FILE* f = fopen(name, "rb");
+    uint8_t* p;
+    long n;
+
+    if (f == NULL) {
+        perror(name);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    p = malloc(n ? n : 1);
+    if (fread(p, 1, n, f) != (size_t)n) {
+        perror(name);
+        free(p);
+        p = NULL;
+    }
+    fclose(f);
+    *len = (uint32_t)n;
+    return p;
+}
+
+int main(int argc, char** argv) {
+    const char* baseName = NULL;
+    const char* outName = NULL;
+    uint8_t format = 0;
+    uint8_t* in;
+    uint8_t* base = NULL;
+    uint8_t* check;
+    uint32_t len, baseLen = 0;
+    BUF img = {0};
+    FILE* f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ld:o:t")) != -1) {
+        switch (opt) {
+        case 'l': format |= FIRMWARE_FORMAT_LZ; break;
+        case 'd': format |= FIRMWARE_FORMAT_DELTA; baseName = optarg; break;
+        case 'o': outName = optarg; break;
+        case 't': return selfTest();
+        default:
+            fprintf(stderr, "Usage: %s [-l] [-d base] -o output input\n       %s -t\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || outName == NULL || format == 0) {
+        fprintf(stderr, "Usage: %s [-l] [-d base] -o output input\n       %s -t\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if ((in = readFile(argv[optind], &len)) == NULL)
+        return 1;
+    if (baseName) {
+        if ((base = readFile(baseName, &baseLen)) == NULL)
+            return 1;
+        if (baseLen != len) {
+            fprintf(stderr, "Base image must have same size as input, %u bytes\n", len);
+            return 1;
+        }
+        if (getLE32(base) == FIRMWARE_IMAGE_MAGIC_NUMBER) {
+            fprintf(stderr, "Base must be a raw image, not a compressed or delta image\n");
+            return 1;
+        }
+    }
+
+    createImage(in, len, base, baseLen, format, &img);
+    if (img.len > FW_FIRMWARE_AREA_SIZE) {
+        fprintf(stderr, "Image is %u bytes, does not fit in Firmware area\n", img.len);
+        return 1;
+    }
+
+    //Decode with same decoder as bootloader
+    check = malloc(len);
+    if (decodeImage(img.p, img.len, base, baseLen, check, len) != 0 || memcmp(check, in, len) != 0) {
+        fprintf(stderr, "Created image does not decode correctly\n");
+        return 1;
+    }
+
+    if ((f = fopen(outName, "wb")) == NULL || fwrite(img.p, 1, img.len, f) != img.len) {
+        perror(outName);
+        return 1;
+    }
+    fclose(f);
+    printf("Wrote %u bytes (%.1f%% of %u), format 0x%02X, CRC-32 0x%08X\n", img.len, 100.0 * img.len / len, len,
+            format, getLE32(&img.p[12]));
+    return 0;
+}
@@ -77,6 +77,7 @@
 
 #include "spiEEProm.h"
 #include "spiFlash.h"
+#include "nz_crc.h"
 
 
 //#define DEBUGGING
@@ -288,6 +289,11 @@ BYTE FlashFirmwareUpgrade(void);
 
 void LEDTask(void);
 
+//MODTRONIX added next 3 lines
+#if defined(BOOT_USE_BULK)
+void bulkTask(void);
+#endif
+
 
 /** T Y P E  D E F I N I T I O N S ************************************/
 
@@ -435,6 +441,87 @@ typedef struct __attribute__ ((packed)) _FIRMWARE_INFO
 #define FIRMWARE_INFO_MAGIC_NUMBER 0x536A
 
 
+/**
+ * A FirmwareA or FirmwareB area can contain a compressed image and/or a delta patch, instead of the raw packed
+ * program memory. In this case it starts with this header, followed by "size" bytes of image data.
+ *
+ * For FIRMWARE_FORMAT_LZ, the image data is LZSS compressed. Each flag byte is followed by 8 items, bit 0 of the
+ * flag byte is for the first item. A 1 bit is a literal byte. A 0 bit is a match of 2 bytes (LSB first), bits 0-11
+ * give the distance - 1 in the 4096 byte window, bits 12-15 give the length - FW_LZ_MIN_MATCH. A distance larger
+ * than the number of bytes decompressed so far is invalid, the window is not preset.
+ *
+ * For FIRMWARE_FORMAT_DELTA, the (decompressed) image data is a list of operations, applied to the raw packed
+ * program memory in the other Firmware area. Each operation starts with 2 bytes (MSB first). Bit 15 is set for a
+ * copy, and bits 0-14 give the length - 1. A copy is followed by the 3 byte offset (LSB first) in the other Firmware
+ * area to copy from, all other operations by the literal bytes.
+ *
+ * The decoded image is the raw packed program memory, as it would have been stored without this header. Images are
+ * created with the host tool in host/nzfwimage.c, which also contains test vectors for both formats.
+ */
+typedef struct __attribute__ ((packed)) _FIRMWARE_IMAGE_HDR
+{
+    DWORD   magicNumber;    //Must have the value FIRMWARE_IMAGE_MAGIC_NUMBER
+    BYTE    format;         //FIRMWARE_FORMAT_xx flags
+    BYTE    reserved[3];
+    DWORD   size;           //Size of image data following this header
+    DWORD   crc;            //CRC-32 of decoded image
+    DWORD   crcBase;        //Only for FIRMWARE_FORMAT_DELTA. CRC-32 of raw image in other Firmware area
+} FIRMWARE_IMAGE_HDR;
+#define FIRMWARE_IMAGE_MAGIC_NUMBER 0x57465A4Eul    //"NZFW"
+#define FIRMWARE_FORMAT_LZ          0x01            //Image data is LZSS compressed
+#define FIRMWARE_FORMAT_DELTA       0x02            //Image data is a delta patch to other Firmware area
+
+#define FW_IMAGE_SIZE               (((PROGRAM_MEM_STOP_NO_CONFIGS - PROGRAM_MEM_START)/2)*3)   //Size of decoded image
+#define FW_LZ_WIN_SIZE              4096
+#define FW_LZ_WIN_MASK              (FW_LZ_WIN_SIZE-1)
+#define FW_LZ_MIN_MATCH             3
+
+//MODTRONIX added next lines
+#if defined(BOOT_USE_BULK)
+/**
+ * Pipelined write protocol on vendor class bulk interface (BULK_EP). The host sends a BULK_WRITE_CMD packet, and
+ * the bootloader replies with a BULK_ACK. The host then streams "length" bytes of raw data in packets of up to 64
+ * bytes, without waiting for a reply to each packet. The bootloader only sends a BULK_ACK after every "window"
+ * data packets, giving the number of packets received so far in "seq". The host must not have more than 2 x window
+ * unacknowledged packets outstanding. After the last data packet has been written to the FLASH, a BULK_ACK with
+ * status BULK_STAT_DONE is sent, containing the CRC-32 of all data.
+ *
+ * The bulk OUT endpoint is double buffered. It is armed with the second buffer before the data in the first
+ * buffer is processed, so a FLASH page can be programmed while the next packet is being received. The FLASH busy
+ * status is polled by bulkTask(), it never waits for an erase or program to finish. While a page is waiting to be
+ * written, no new packets are processed, and the host is flow controlled by the USB NAK handshake.
+ *
+ * With BULK_FLAG_ERASE, the address must be sector aligned, else the command is rejected with BULK_STAT_ERROR.
+ */
+typedef struct __attribute__ ((packed)) _BULK_WRITE_CMD
+{
+    BYTE    command;        //BULK_CMD_WRITE_XFLASH
+    BYTE    window;         //Acknowledge every "window" data packets, 0 = BULK_WINDOW_DEFAULT
+    BYTE    flags;          //BULK_FLAG_xx flags
+    BYTE    reserved;
+    DWORD   address;        //External FLASH byte address to write to
+    DWORD   length;         //Number of data bytes that follow
+} BULK_WRITE_CMD;
+
+typedef struct __attribute__ ((packed)) _BULK_ACK
+{
+    BYTE    command;        //BULK_CMD_ACK
+    BYTE    status;         //BULK_STAT_xx value
+    WORD    seq;            //Number of data packets received so far
+    DWORD   written;        //Number of bytes written to FLASH so far
+    DWORD   crc;            //CRC-32 of data received so far
+} BULK_ACK;
+
+#define BULK_CMD_WRITE_XFLASH       0xA0        //Begin pipelined write to external FLASH
+#define BULK_CMD_ACK                0xA1        //Acknowledgment sent to host
+#define BULK_FLAG_ERASE             0x01        //Erase each sector before writing to it. Address must be sector aligned
+#define BULK_STAT_BUSY              0x00        //Write in progress
+#define BULK_STAT_DONE              0x01        //All data has been written
+#define BULK_STAT_ERROR             0x02        //Command not recognized or invalid
+#define BULK_WINDOW_DEFAULT         16
+#endif
+
+
 /** VARIABLES ******************************************************/
 #pragma udata
 
@@ -488,12 +575,62 @@ FIRMWARE_INFO firmwareInfo;
 FIRMWARE_INFO firmwareAInfo;    //FirmwareAInfo
 FIRMWARE_INFO firmwareBInfo;    //FirmwareBInfo
 
+#if defined(BOOT_USE_FWIMAGE)
+//Compressed and delta image decoder
+FIRMWARE_IMAGE_HDR fwHdr;       //Header of image being decoded
+BOOL fwErr;                     //Set if image data is corrupt
+DWORD fwInAdr;                  //External FLASH address of next image data to read
+DWORD fwInLeft;                 //Image data bytes not read yet
+BYTE fwInBuf[64];
+BYTE fwInPos;
+BYTE fwInLen;
+BYTE lzWin[FW_LZ_WIN_SIZE];     //LZSS window, contains last decompressed bytes
+WORD lzWinPos;
+WORD lzCount;                   //Number of valid bytes in lzWin, is number of decompressed bytes up to FW_LZ_WIN_SIZE
+WORD lzMatchDist;
+BYTE lzMatchLen;
+BYTE lzFlags;
+BYTE lzFlagCnt;
+DWORD dtBaseAdr;                //External FLASH address of other Firmware area, delta is applied to it
+DWORD dtCopyAdr;                //External FLASH address of next byte to copy
+WORD dtLeft;                    //Bytes left in current delta operation
+BOOL dtCopy;                    //Current delta operation is a copy
+BYTE dtBuf[64];
+BYTE dtPos;
+BYTE dtLen;
+#endif
+
 DWORD_VAL progmemWriteAdr;      //Word address of program memory to write to
 
 //128 Words of data to write to 1 row of program memory (192 write block). Even and Odd address words are alway written together = 1 Instuction.
 //Only lower byte of odd Words are used.
 WORD_VAL progmemWriteBuf[128];
 
+//MODTRONIX added next lines
+#if defined(BOOT_USE_BULK)
+//Pipelined writes on bulk interface
+BYTE bulkBuf[2][BULK_EP_SIZE];  //Double buffered OUT endpoint, one is armed while the other is processed
+BYTE bulkBufIdx;                //Index of bulkBuf[] the OUT endpoint is armed with
+USB_HANDLE bulkOutHandle = 0;
+USB_HANDLE bulkInHandle = 0;
+BULK_ACK bulkAck;               //Acknowledgment being sent to host
+BOOL bulkAckPending;            //Acknowledgment could not be sent yet, IN endpoint was busy
+BYTE bulkStatus;                //BULK_STAT_xx value
+BYTE bulkFlags;                 //BULK_FLAG_xx flags of current write
+BYTE bulkWindow;                //Acknowledge every "bulkWindow" data packets
+WORD bulkSeq;                   //Number of data packets received
+DWORD bulkLeft;                 //Number of data bytes still to receive. 0 if no write in progress
+DWORD bulkWritten;              //Number of data bytes written to FLASH
+DWORD bulkCrc;                  //CRC-32 of received data
+DWORD bulkAdr;                  //External FLASH address of first byte in bulkPage[]
+BYTE bulkPage[SPI_FLASH_PAGE_SIZE]; //Data for current FLASH page
+WORD bulkPageLen;               //Number of bytes in bulkPage[]
+BOOL bulkPageFull;              //bulkPage[] is full (or has last data), and has to be written
+BOOL bulkErasing;               //Sector erase was started for page in bulkPage[]
+BYTE* bulkRxPtr;                //Data of current packet not added to bulkPage[] yet
+WORD bulkRxLen;                 //Number of bytes at bulkRxPtr
+#endif
+
 
 /** DECLARATIONS ***************************************************/
 #pragma code
@@ -751,6 +888,211 @@ void LEDTask(void) {
     }
 }
 
+#if defined(BOOT_USE_FWIMAGE)
+/**
+ * Gets next byte of image data from external FLASH. Sets fwErr if there is no more data.
+ */
+BYTE fwInGet(void) {
+    if (fwInPos >= fwInLen) {
+        if (fwInLeft == 0) {
+            fwErr = TRUE;
+            return 0xff;
+        }
+        fwInLen = (fwInLeft > sizeof(fwInBuf)) ? sizeof(fwInBuf) : (BYTE)fwInLeft;
+        spiFlashReadArray(fwInAdr, fwInBuf, fwInLen);
+        fwInAdr += fwInLen;
+        fwInLeft -= fwInLen;
+        fwInPos = 0;
+    }
+    return fwInBuf[fwInPos++];
+}
+
+
+/**
+ * Gets next decompressed byte of LZSS compressed image data.
+ */
+BYTE fwLzGet(void) {
+    BYTE c;
+    WORD w;
+
+    if (lzMatchLen == 0) {
+        if (lzFlagCnt == 0) {
+            lzFlags = fwInGet();
+            lzFlagCnt = 8;
+        }
+        lzFlagCnt--;
+        c = lzFlags & 0x01;
+        lzFlags >>= 1;
+
+        //Literal. Is put in window, and copied to itself below as a match of length 1 at distance 0
+        if (c) {
+            lzWin[lzWinPos] = fwInGet();
+            lzMatchDist = 0;
+            lzMatchLen = 1;
+        }
+        //Match
+        else {
+            w = fwInGet();
+            w |= ((WORD)fwInGet()) << 8;
+            lzMatchDist = (w & FW_LZ_WIN_MASK) + 1;
+            lzMatchLen = (w >> 12) + FW_LZ_MIN_MATCH;
+
+            //Match can not refer to bytes before start of image, they are not in window
+            if (lzMatchDist > lzCount)
+                fwErr = TRUE;
+        }
+    }
+
+    lzMatchLen--;
+    c = lzWin[(lzWinPos - lzMatchDist) & FW_LZ_WIN_MASK];
+    lzWin[lzWinPos] = c;
+    lzWinPos = (lzWinPos + 1) & FW_LZ_WIN_MASK;
+    if (lzCount < FW_LZ_WIN_SIZE)
+        lzCount++;
+    return c;
+}
+
+
+/**
+ * Gets next byte of image data, decompressed if required.
+ */
+BYTE fwStreamGet(void) {
+    return (fwHdr.format & FIRMWARE_FORMAT_LZ) ? fwLzGet() : fwInGet();
+}
+
+
+/**
+ * Gets next byte of image, applying delta operations to other Firmware area.
+ */
+BYTE fwDeltaGet(void) {
+    BYTE b;
+    DWORD offset;
+
+    //Get next operation
+    if (dtLeft == 0) {
+        b = fwStreamGet();
+        dtCopy = (b & 0x80) ? TRUE : FALSE;
+        dtLeft = ((((WORD)b) & 0x7f) << 8) | fwStreamGet();
+        dtLeft++;
+        if (dtCopy) {
+            offset = fwStreamGet();
+            offset |= ((DWORD)fwStreamGet()) << 8;
+            offset |= ((DWORD)fwStreamGet()) << 16;
+            if ((offset + dtLeft) > FW_IMAGE_SIZE)
+                fwErr = TRUE;
+            dtCopyAdr = dtBaseAdr + offset;
+            dtPos = dtLen = 0;
+        }
+    }
+    dtLeft--;
+
+    if (dtCopy == FALSE)
+        return fwStreamGet();
+
+    //Copy from other Firmware area. Read up to end of operation, dtLeft + 1 bytes are left
+    if (dtPos >= dtLen) {
+        dtLen = (dtLeft >= sizeof(dtBuf)) ? sizeof(dtBuf) : (BYTE)(dtLeft + 1);
+        spiFlashReadArray(dtCopyAdr, dtBuf, dtLen);
+        dtCopyAdr += dtLen;
+        dtPos = 0;
+    }
+    return dtBuf[dtPos++];
+}
+
+
+/**
+ * Starts decoding the image in given Firmware area. fwHdr must contain its header.
+ *
+ * @param xflAdr Address of Firmware area containing image
+ * @param baseAdr Address of other Firmware area, only used for delta images
+ */
+void fwImageBegin(DWORD xflAdr, DWORD baseAdr) {
+    fwErr = FALSE;
+    fwInAdr = xflAdr + sizeof(FIRMWARE_IMAGE_HDR);
+    fwInLeft = fwHdr.size;
+    fwInPos = fwInLen = 0;
+    lzWinPos = 0;
+    lzCount = 0;
+    lzMatchLen = 0;
+    lzFlagCnt = 0;
+    dtBaseAdr = baseAdr;
+    dtLeft = 0;
+}
+
+
+/**
+ * Reads next decoded bytes of image started with fwImageBegin().
+ *
+ * @param p Buffer to write decoded bytes to
+ * @param len Number of bytes to read
+ */
+void fwImageRead(BYTE* p, WORD len) {
+    while (len--) {
+        *p++ = (fwHdr.format & FIRMWARE_FORMAT_DELTA) ? fwDeltaGet() : fwStreamGet();
+    }
+}
+
+
+/**
+ * Decodes whole image in given Firmware area, and checks its CRC. Nothing is written. For a delta image, the
+ * other Firmware area must contain the raw image the delta was created for. It must have been programmed before
+ * (state Current, Previous or Restored), and must not be a compressed or delta image itself.
+ *
+ * @param xflAdr Address of Firmware area containing image, fwHdr must contain its header
+ * @param baseAdr Address of other Firmware area
+ * @param pBaseInfo FIRMWARE_INFO of other Firmware area
+ *
+ * @return TRUE if image is valid
+ */
+BOOL fwImageVerify(DWORD xflAdr, DWORD baseAdr, FIRMWARE_INFO* pBaseInfo) {
+    DWORD crc;
+    DWORD n;
+    WORD len;
+
+    if ((fwHdr.format & ~(FIRMWARE_FORMAT_LZ | FIRMWARE_FORMAT_DELTA))
+            || (fwHdr.size > ((XFLASH_FIRMWARE_SIZE_IN_SECTORS*XFLASH_SECTOR_SIZE) - sizeof(FIRMWARE_IMAGE_HDR))))
+        return FALSE;
+
+    //Check other Firmware area contains raw image delta was created for
+    if (fwHdr.format & FIRMWARE_FORMAT_DELTA) {
+        if ((pBaseInfo->magicNumber.Val != FIRMWARE_INFO_MAGIC_NUMBER)
+                || ((pBaseInfo->fwState.LB != FIRMWARE_STATE_CURRENT)
+                    && (pBaseInfo->fwState.LB != FIRMWARE_STATE_PREVIOUS)
+                    && (pBaseInfo->fwState.LB != FIRMWARE_STATE_RESTORED)))
+            return FALSE;
+
+        spiFlashReadArray(baseAdr, (BYTE*)&crc, 4);
+        if (crc == FIRMWARE_IMAGE_MAGIC_NUMBER)
+            return FALSE;
+
+        crc = 0xfffffffful;
+        spiFlashBeginRead(baseAdr);
+        for (n = FW_IMAGE_SIZE; n != 0; n -= len) {
+            len = (n > sizeof(buf)) ? sizeof(buf) : (WORD)n;
+            spiFlashReadNext(buf, len);
+            crc = crc32Update(crc, buf, len);
+            USBDeviceTasks();
+        }
+        spiFlashEndRead();
+        if (~crc != fwHdr.crcBase)
+            return FALSE;
+    }
+
+    //Decode whole image
+    crc = 0xfffffffful;
+    fwImageBegin(xflAdr, baseAdr);
+    for (n = FW_IMAGE_SIZE; (n != 0) && (fwErr == FALSE); n -= len) {
+        len = (n > sizeof(buf)) ? sizeof(buf) : (WORD)n;
+        fwImageRead(buf, len);
+        crc = crc32Update(crc, buf, len);
+        USBDeviceTasks();
+    }
+
+    return ((fwErr == FALSE) && (~crc == fwHdr.crc)) ? TRUE : FALSE;
+}
+#endif  //#if defined(BOOT_USE_FWIMAGE)
+
+
 /**
  * This function checks if the External Flash contains new Firmware that has to be copied to flash.
  *
@@ -768,6 +1110,10 @@ BYTE FlashFirmwareUpgrade(void) {
     DWORD addressNewState1;
     DWORD addressNewState2;
     BYTE allOnes;
+    #if defined(BOOT_USE_FWIMAGE)
+    DWORD baseAdr;                      //external flash address of other firmware
+    BOOL bEncoded = FALSE;              //Firmware is compressed and/or a delta
+    #endif
 
     sysLedPattern = 0x0F0F;     //Even on/off flashing. Period = 400mS
 
@@ -851,6 +1197,23 @@ BYTE FlashFirmwareUpgrade(void) {
     //Do Checksum check of new firmware
     xflAdrChksum = xflAdr;
 
+    //Compressed or delta image. Decode it once to verify CRC, before erasing program memory. If it is not
+    //valid, mark it as Faulty so it is not tried again, and keep current firmware.
+    #if defined(BOOT_USE_FWIMAGE)
+    baseAdr = (updateFirmwareFrom == UPDATE_FIRMWARE_FROM_A) ? XFLASH_FIRMWAREB_ADR : XFLASH_FIRMWAREA_ADR;
+    spiFlashReadArray(xflAdr, ((BYTE*)&fwHdr), sizeof(fwHdr));
+    if (fwHdr.magicNumber == FIRMWARE_IMAGE_MAGIC_NUMBER) {
+        if (fwImageVerify(xflAdr, baseAdr, (updateFirmwareFrom == UPDATE_FIRMWARE_FROM_A) ? &firmwareBInfo : &firmwareAInfo) == FALSE) {
+            firmwareNewState1 = FIRMWARE_STATE_FAULTY;
+            spiFlashBeginWrite(((updateFirmwareFrom == UPDATE_FIRMWARE_FROM_A) ? XFLASH_FIRMWAREA_INFO_ADR : XFLASH_FIRMWAREB_INFO_ADR) + offsetof(FIRMWARE_INFO, fwState.LB));
+            spiFlashWriteArray(&firmwareNewState1, 1);
+            PORTBbits.RB6 = 0;  // Turn the LED off
+            return 0;   //Firmware NOT updated
+        }
+        bEncoded = TRUE;
+    }
+    #endif
+
     /////////////////////////////////////////////////
     //Erase whole program memory.
     for(ErasePageTracker = BEGIN_PAGE_TO_ERASE; ErasePageTracker <= MAX_PAGE_TO_ERASE_NO_CONFIGS; ErasePageTracker++)
@@ -862,7 +1225,13 @@ BYTE FlashFirmwareUpgrade(void) {
 
 
     /////////////////////////////////////////////////
-    //Program whole program memory.
+    //Program whole program memory. A raw firmware is read from external FLASH with a single streaming read.
+    #if defined(BOOT_USE_FWIMAGE)
+    if (bEncoded)
+        fwImageBegin(xflAdr, baseAdr);
+    else
+    #endif
+        spiFlashBeginRead(xflAdr);
     for (progmemWriteAdr.Val = PROGRAM_MEM_START; progmemWriteAdr.Val < PROGRAM_MEM_STOP_NO_CONFIGS; ) {
         USBDeviceTasks();       //Call USBDriverService() periodically to prevent falling off the bus if any SETUP packets should happen to arrive.
 
@@ -875,8 +1244,13 @@ BYTE FlashFirmwareUpgrade(void) {
         }
         */
 
-        //Read next row from external FLASH.
-        spiFlashReadArray(xflAdr, &buf[0], ((PROGRAM_MEM_WR_ROW_SIZE/2)*3));
+        //Read next row from external FLASH, decompress and/or apply delta if required
+        #if defined(BOOT_USE_FWIMAGE)
+        if (bEncoded)
+            fwImageRead(&buf[0], ((PROGRAM_MEM_WR_ROW_SIZE/2)*3));
+        else
+        #endif
+            spiFlashReadNext(&buf[0], ((PROGRAM_MEM_WR_ROW_SIZE/2)*3));
         xflAdr += ((PROGRAM_MEM_WR_ROW_SIZE/2)*3);
 
         //Copy bytes read from external FLASH to the progmemWriteBuf[] buffer. Used to program the program memory.
@@ -913,6 +1287,10 @@ BYTE FlashFirmwareUpgrade(void) {
             progmemWriteAdr.Val = progmemWriteAdr.Val + PROGRAM_MEM_WR_ROW_SIZE;
         }
     }
+    #if defined(BOOT_USE_FWIMAGE)
+    if (!bEncoded)
+    #endif
+        spiFlashEndRead();
 
 
     /////////////////////////////////////////////////
@@ -995,6 +1373,11 @@ void BootloaderTask(void) {
         // USB is Configured, and NOT suspended
         if( (USBDeviceState >= CONFIGURED_STATE) && (USBIsDeviceSuspended()==0) ) {
             BootApplication();
+
+            //MODTRONIX added next 3 lines
+            #if defined(BOOT_USE_BULK)
+            bulkTask();
+            #endif
         }
 
     }//end while
@@ -1337,6 +1720,169 @@ void BootApplication()
     }//End if/else
 }//End BootApplication()
 
+
+//MODTRONIX added next lines
+#if defined(BOOT_USE_BULK)
+/**
+ * Sends acknowledgment with current state of pipelined write to host. If the bulk IN endpoint is still
+ * busy, it is sent by a later call to bulkTask().
+ */
+void bulkSendAck(void) {
+    if (USBHandleBusy(bulkInHandle)) {
+        bulkAckPending = TRUE;
+        return;
+    }
+    bulkAckPending = FALSE;
+
+    bulkAck.command = BULK_CMD_ACK;
+    bulkAck.status = bulkStatus;
+    bulkAck.seq = bulkSeq;
+    bulkAck.written = bulkWritten;
+    bulkAck.crc = ~bulkCrc;
+    bulkInHandle = USBTxOnePacket(BULK_EP, (BYTE*)&bulkAck, sizeof(BULK_ACK));
+}
+
+/**
+ * Writes bulkPage[] to external FLASH, erasing the sector first if required. Must only be called when the
+ * FLASH is not busy. Does not wait for the FLASH to finish the erase or program.
+ *
+ * @return TRUE if page was written. FALSE if a sector erase was started instead, call again when the
+ *         FLASH is not busy anymore.
+ */
+BOOL bulkWritePage(void) {
+    if ((bulkFlags & BULK_FLAG_ERASE) && ((bulkAdr & SPI_FLASH_SECTOR_MASK) == 0) && (bulkErasing == FALSE)) {
+        spiFlashBeginEraseSector(bulkAdr);
+        bulkErasing = TRUE;
+        return FALSE;
+    }
+    bulkErasing = FALSE;
+
+    spiFlashWritePage(bulkPage, bulkPageLen);
+    bulkAdr += bulkPageLen;
+    bulkWritten += bulkPageLen;
+    bulkPageLen = 0;
+    bulkPageFull = FALSE;
+    return TRUE;
+}
+
+/**
+ * Adds received data at bulkRxPtr to bulkPage[], up to the end of the FLASH page. Sets bulkPageFull if
+ * the page is complete, or if it contains the last data of the write.
+ */
+void bulkPutPage(void) {
+    WORD n;
+
+    n = SPI_FLASH_PAGE_SIZE - ((bulkAdr + bulkPageLen) & SPI_FLASH_PAGE_MASK);
+    if (n > bulkRxLen) {
+        n = bulkRxLen;
+    }
+    bulkRxLen -= n;
+    while (n--) {
+        bulkPage[bulkPageLen++] = *bulkRxPtr++;
+    }
+
+    if ((((bulkAdr + bulkPageLen) & SPI_FLASH_PAGE_MASK) == 0)
+            || ((bulkLeft == 0) && (bulkRxLen == 0) && (bulkPageLen != 0))) {
+        bulkPageFull = TRUE;
+    }
+}
+
+/**
+ * Processes packets received on bulk interface. See BULK_WRITE_CMD for a description of the protocol.
+ */
+void bulkTask(void) {
+    BULK_WRITE_CMD* cmd;
+    BYTE* p;
+    WORD len;
+
+    if (bulkAckPending) {
+        bulkSendAck();
+    }
+
+    //Write full page when FLASH is not busy. If a sector has to be erased first, the page is written by
+    //a later call, when the erase has finished.
+    if (bulkPageFull) {
+        if (spiFlashIsBusy() || (bulkWritePage() == FALSE)) {
+            return;
+        }
+    }
+
+    //Add rest of current packet to page buffer
+    if (bulkRxLen != 0) {
+        bulkPutPage();
+        return;
+    }
+
+    //All data received and written, acknowledge when FLASH has finished programming the last page
+    if ((bulkStatus == BULK_STAT_BUSY) && (bulkLeft == 0)) {
+        if (spiFlashIsBusy()) {
+            return;
+        }
+        bulkStatus = BULK_STAT_DONE;
+        bulkSendAck();
+        return;
+    }
+
+    //Wait for next packet from host
+    if (USBHandleBusy(bulkOutHandle)) {
+        return;
+    }
+
+    p = &bulkBuf[bulkBufIdx][0];
+    len = USBHandleGetLength(bulkOutHandle);
+
+    //Arm OUT endpoint with other buffer, so next packet is received while this one is written to FLASH
+    bulkBufIdx ^= 1;
+    bulkOutHandle = USBRxOnePacket(BULK_EP, &bulkBuf[bulkBufIdx][0], BULK_EP_SIZE);
+
+    //No write in progress, this is a command packet
+    if (bulkLeft == 0) {
+        cmd = (BULK_WRITE_CMD*)p;
+        bulkStatus = BULK_STAT_ERROR;
+        bulkSeq = 0;
+        bulkWritten = 0;
+        bulkCrc = 0xfffffffful;
+        bulkPageLen = 0;
+        bulkPageFull = FALSE;
+        bulkErasing = FALSE;
+
+        //With BULK_FLAG_ERASE, address must be sector aligned. Else first sector would not be erased
+        if ((len >= sizeof(BULK_WRITE_CMD)) && (cmd->command == BULK_CMD_WRITE_XFLASH)
+                && (((cmd->flags & BULK_FLAG_ERASE) == 0) || ((cmd->address & SPI_FLASH_SECTOR_MASK) == 0))) {
+            bulkAdr = cmd->address;
+            bulkLeft = cmd->length;
+            bulkFlags = cmd->flags;
+            bulkWindow = (cmd->window == 0) ? BULK_WINDOW_DEFAULT : cmd->window;
+            bulkStatus = (bulkLeft == 0) ? BULK_STAT_DONE : BULK_STAT_BUSY;
+            spiFlashBeginWrite(bulkAdr);
+        }
+
+        bulkSendAck();
+        return;
+    }
+
+    //Data packet
+    if (len > bulkLeft) {
+        len = (WORD)bulkLeft;
+    }
+    bulkLeft -= len;
+    bulkSeq++;
+    bulkCrc = crc32Update(bulkCrc, p, len);
+
+    //Add to page buffer. Full pages, and rest of packet, are written by following calls. The buffer
+    //containing this packet is only armed again once bulkRxLen is 0.
+    bulkRxPtr = p;
+    bulkRxLen = len;
+    bulkPutPage();
+
+    //Deferred acknowledgment, only every bulkWindow packets. Last packet is acknowledged with
+    //BULK_STAT_DONE once it has been written.
+    if ((bulkLeft != 0) && ((bulkSeq % bulkWindow) == 0)) {
+        bulkSendAck();
+    }
+}
+#endif
+
 /**
  * Writes a row of Flash program memory. A row consists of 64 Instructions = 128 Words = 192 bytes (128 x 1.5).
  * Ensure we write to full row. Also ensure to set any bytes not used to 0xff. Must be edge-aligned, from the
@@ -1660,6 +2206,17 @@ void USBCBInitEP(void)
     USBEnableEndpoint(HID_EP,USB_IN_ENABLED|USB_OUT_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
     //Arm the OUT endpoint for the first packet
     USBOutHandle = HIDRxPacket(HID_EP,(BYTE*)&PacketFromPCBuffer,64);
+
+    //MODTRONIX added next lines
+    #if defined(BOOT_USE_BULK)
+    //Enable the bulk endpoint, and arm the OUT endpoint with the first buffer
+    USBEnableEndpoint(BULK_EP,USB_IN_ENABLED|USB_OUT_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
+    bulkBufIdx = 0;
+    bulkLeft = 0;
+    bulkAckPending = FALSE;
+    bulkInHandle = 0;
+    bulkOutHandle = USBRxOnePacket(BULK_EP, bulkBuf[0], BULK_EP_SIZE);
+    #endif
 }
 
 /********************************************************************
@@ -7,4 +7,15 @@
 //#include "p24fxxxx.h"
 //#include "HardwareProfile.h"
 
+//Uncomment to add a vendor class bulk interface to the bootloader. It is used for pipelined writes
+//to the external FLASH, which are much faster than the 64 byte HID request/response packets.
+//#define BOOT_USE_BULK
+
+//Support compressed and delta firmware images (FIRMWARE_IMAGE_HDR). Comment to remove the image decoder if
+//the bootloader does not fit in its FLASH area. Raw firmware images are always supported.
+#define BOOT_USE_FWIMAGE
+
+//Size of CRC lookup tables (nz_crc.h). The bootloader must fit in its FLASH area, so use 16 entry tables
+#define NZ_CRC_TABLE_SIZE   16
+
 #endif  //_PROJDEFS_H_
@@ -39,10 +39,20 @@
 #if defined(SPIFLASH_CS_TRIS)
 	void spiFlashInit(void);		
 	void spiFlashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen);
+	void spiFlashBeginRead(DWORD dwAddress);
+	void spiFlashReadNext(BYTE *vData, WORD wLen);
+	void spiFlashEndRead(void);
 	void spiFlashBeginWrite(DWORD dwAddr);
 	void spiFlashWrite(BYTE vData);
 	void spiFlashWriteArray(BYTE *vData, WORD wLen);
         void spiFlashEraseSector(DWORD dwAddr);
+        //MODTRONIX added next 6 lines
+        void spiFlashBeginEraseSector(DWORD dwAddr);
+        #if defined(BOOT_USE_BULK)
+        WORD spiFlashWritePage(BYTE* vData, WORD wLen);
+        void spiFlashWaitWhileBusy(void);
+        BOOL spiFlashIsBusy(void);
+        #endif
 #else
 	// If you get any of these linker errors, it means that you either have an 
 	// error in your HardwareProfile.h or TCPIPConfig.h definitions.  The code 
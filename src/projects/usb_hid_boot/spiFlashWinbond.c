@@ -76,6 +76,12 @@ static inline __attribute__((__always_inline__)) void WaitForDataByte( void )
     while ((SPIFLASH_SPISTATbits.SPITBF == 1) || (SPIFLASH_SPISTATbits.SPIRBF == 0));
 }
 
+//Streaming reads use the Enhanced Buffer mode of the SPI peripheral, so the SPI clock keeps running between
+//bytes. It is only enabled between spiFlashBeginRead() and spiFlashEndRead(), all other code waits for each byte.
+#define SPIFLASH_FIFO_DEPTH     8
+#define SpiFlashEnhBufOn()      {SPIFLASH_SPISTATbits.SPIEN = 0; SPIFLASH_SPICON2 |= 0x0001; SPIFLASH_SPISTATbits.SPIEN = 1;}
+#define SpiFlashEnhBufOff()     {SPIFLASH_SPISTATbits.SPIEN = 0; SPIFLASH_SPICON2 &= ~0x0001; SPIFLASH_SPISTATbits.SPIEN = 1;}
+
 // Internal pointer to address being written
 static DWORD dwWriteAddr;
 
@@ -198,6 +204,7 @@ void spiFlashInit(void) {
   Function:
     void spiFlashReadArray(DWORD dwAddress, BYTE *vData, WORD wLength)
 
+
   Description:
     Reads an array of bytes from the SPI Flash module.
 
@@ -215,44 +222,99 @@ void spiFlashInit(void) {
   ***************************************************************************/
 void spiFlashReadArray(DWORD dwAddress, BYTE *vData, WORD wLength)
 {
+    spiFlashBeginRead(dwAddress);
+    spiFlashReadNext(vData, wLength);
+    spiFlashEndRead();
+}
 
-    // Ignore operations when the destination is NULL or nothing to read
-    /* //Skip checks to reduce code size
-    if(vData == NULL || wLength == 0)
-        return;
-    */
+
+/*****************************************************************************
+  Function:
+    void spiFlashBeginRead(DWORD dwAddress)
+
+  Description:
+    Starts a streaming read. The chip select is left asserted, and following
+    calls to spiFlashReadNext() continue reading from sequential addresses.
+    Must be terminated with spiFlashEndRead().
+
+  Precondition:
+    spiFlashInit has been called, and the chip is not busy.
+
+  Parameters:
+    dwAddress - Address from which to start reading
+
+  Returns:
+    None
+  ***************************************************************************/
+void spiFlashBeginRead(DWORD dwAddress)
+{
+    BYTE i;
+
+    SpiFlashEnhBufOn();
 
     // Activate chip select
     SPIFLASH_CS_IO = 0;
-    
-    // Send READ opcode
-    SPIFLASH_SSPBUF = READ;
-    WaitForDataByte();
-    Dummy = SPIFLASH_SSPBUF;
 
-    // Send address
+    // Send READ opcode and address, all fit in the TX FIFO
+    SPIFLASH_SSPBUF = READ;
     SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[2];
-    WaitForDataByte();
-    Dummy = SPIFLASH_SSPBUF;
-
     SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[1];
-    WaitForDataByte();
-    Dummy = SPIFLASH_SSPBUF;
-
     SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[0];
-    WaitForDataByte();
-    Dummy = SPIFLASH_SSPBUF;
 
-    // Read data
-    while(wLength--)
-    {
-        SPIFLASH_SSPBUF = 0;
-        WaitForDataByte();
-        *vData++ = SPIFLASH_SSPBUF;
+    for (i = 0; i < 4; i++) {
+        while (SPIFLASH_SPISTATbits.SRXMPT);
+        Dummy = SPIFLASH_SSPBUF;
     }
+}
+
 
+/*****************************************************************************
+  Function:
+    void spiFlashReadNext(BYTE *vData, WORD wLength)
+
+  Description:
+    Reads the next array of bytes of a streaming read started with
+    spiFlashBeginRead().
+
+  Parameters:
+    vData - Where to store data that has been read
+    wLength - Length of data to read
+
+  Returns:
+    None
+  ***************************************************************************/
+void spiFlashReadNext(BYTE *vData, WORD wLength)
+{
+    WORD txLeft = wLength;
+
+    // Keep TX FIFO filled, but never have more bytes in flight than the RX FIFO can hold
+    while (wLength) {
+        while ((txLeft != 0) && ((wLength - txLeft) < SPIFLASH_FIFO_DEPTH) && (SPIFLASH_SPISTATbits.SPITBF == 0)) {
+            SPIFLASH_SSPBUF = 0;
+            txLeft--;
+        }
+
+        while (SPIFLASH_SPISTATbits.SRXMPT == 0) {
+            *vData++ = SPIFLASH_SSPBUF;
+            wLength--;
+        }
+    }
+}
+
+
+/*****************************************************************************
+  Function:
+    void spiFlashEndRead(void)
+
+  Description:
+    Ends a streaming read started with spiFlashBeginRead().
+  ***************************************************************************/
+void spiFlashEndRead(void)
+{
     // Deactivate chip select
     SPIFLASH_CS_IO = 1;
+
+    SpiFlashEnhBufOff();
 }
 
 /*****************************************************************************
@@ -575,6 +637,101 @@ void spiFlashWriteArray(BYTE* vData, WORD wLen) {
 }
 
 
+//MODTRONIX added next lines
+#if defined(BOOT_USE_BULK)
+/**
+ * Writes given data to the SPI Flash, up to the next page boundary. Waits for any
+ * previous write to finish, but does NOT wait for this write to finish. This allows
+ * the caller to receive the next data while the FLASH is programming the page.
+ * Precondition is that spiFlashBeginWrite() has been called.
+ *
+ * @param vData The array to write to the next memory location
+ * @param wLen Length of data to write
+ *
+ * @return Returns number of bytes written, is less than wLen if a page boundary
+ *         was reached.
+ */
+WORD spiFlashWritePage(BYTE* vData, WORD wLen) {
+    WORD written = 0;
+
+    // Wait for previous page write to finish
+    _WaitWhileBusy();
+
+    // Enable writing
+    _SendCmd(WREN);
+
+    // Activate the chip select
+    SPIFLASH_CS_IO = 0;
+
+    // Issue WRITE command with address
+    SPIFLASH_SSPBUF = WRITE;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*) & dwWriteAddr)[2];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*) & dwWriteAddr)[1];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*) & dwWriteAddr)[0];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    //Write the bytes, up to a page boundary
+    while (wLen) {
+        SPIFLASH_SSPBUF = *vData++;
+        WaitForDataByte();
+        Dummy = SPIFLASH_SSPBUF;
+        dwWriteAddr++;
+        written++;
+        wLen--;
+        if ((dwWriteAddr & SPI_FLASH_PAGE_MASK) == 0)
+            break;
+    }
+
+    // Deactivate chip select to start the write, don't wait for it to complete
+    SPIFLASH_CS_IO = 1;
+
+    return written;
+}
+
+/**
+ * Waits for any write or erase in progress to finish.
+ */
+void spiFlashWaitWhileBusy(void) {
+    _WaitWhileBusy();
+}
+
+/**
+ * Reads the status register once, and checks if a write or erase is in progress. Does not wait.
+ *
+ * @return Returns TRUE if the FLASH is busy
+ */
+BOOL spiFlashIsBusy(void) {
+    // Activate chip select
+    SPIFLASH_CS_IO = 0;
+
+    // Send Read Status Register instruction
+    SPIFLASH_SSPBUF = RDSR;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Read status register
+    SPIFLASH_SSPBUF = 0x00;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Deactivate chip select
+    SPIFLASH_CS_IO = 1;
+
+    return (Dummy & BUSY) ? TRUE : FALSE;
+}
+#endif
+
+
 /*****************************************************************************
   Function:
     void spiFlashEraseSector(DWORD dwAddr)
@@ -601,6 +758,36 @@ void spiFlashWriteArray(BYTE* vData, WORD wLen) {
     memory parts.
   ***************************************************************************/
 void spiFlashEraseSector(DWORD dwAddr)
+{
+    //MODTRONIX, was commands to start erase, moved to spiFlashBeginEraseSector()
+    spiFlashBeginEraseSector(dwAddr);
+
+    // Wait for erase to complete
+    _WaitWhileBusy();
+}
+
+
+/*****************************************************************************
+  Function:
+    void spiFlashBeginEraseSector(DWORD dwAddr)
+
+  Summary:
+    Starts erasing a sector.
+
+  Description:
+    This function starts erasing a sector in the Flash part, and returns
+    without waiting for the erase to complete. MODTRONIX added.
+
+  Precondition:
+    spiFlashInit has been called, and the Flash is not busy.
+
+  Parameters:
+    dwAddr - The address of the sector to be erased.
+
+  Returns:
+    None
+  ***************************************************************************/
+void spiFlashBeginEraseSector(DWORD dwAddr)
 {
     //Ensure write protection bits are not set
     SPIFlashClearWriteProtection();
@@ -630,9 +817,6 @@ void spiFlashEraseSector(DWORD dwAddr)
 
     // Deactivate chip select to perform the erase
     SPIFLASH_CS_IO = 1;
-
-    // Wait for erase to complete
-    _WaitWhileBusy();
 }
 
 
@@ -59,7 +59,12 @@
 								// that use EP0 IN or OUT for sending large amounts of
 								// application related data.
 									
+//MODTRONIX added next 5 lines
+#if defined(BOOT_USE_BULK)
+#define USB_MAX_NUM_INT     	2   // For tracking Alternate Setting
+#else
 #define USB_MAX_NUM_INT     	1   // For tracking Alternate Setting
+#endif
 
 //Device descriptor - if these two definitions are not defined then
 //  a ROM USB_DEVICE_DESCRIPTOR variable by the exact name of device_dsc
@@ -156,7 +161,12 @@
 #define USB_USE_HID
 
 /** ENDPOINTS ALLOCATION *******************************************/
+//MODTRONIX added next 5 lines
+#if defined(BOOT_USE_BULK)
+#define USB_MAX_EP_NUMBER	    2
+#else
 #define USB_MAX_EP_NUMBER	    1
+#endif
 
 /* HID */
 #define HID_INTF_ID             0x00
@@ -166,6 +176,12 @@
 #define HID_NUM_OF_DSC          1
 #define HID_RPT01_SIZE          29
 
+//MODTRONIX added next lines
+/* Vendor class bulk interface, used for pipelined writes to external FLASH */
+#define BULK_INTF_ID            0x01
+#define BULK_EP                 2
+#define BULK_EP_SIZE            64
+
 /** DEFINITIONS ****************************************************/
 
 #endif //USBCFG_H
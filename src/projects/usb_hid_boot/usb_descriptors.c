@@ -186,8 +186,14 @@ ROM BYTE configDescriptor1[]={
     /* Configuration Descriptor */
     0x09,//sizeof(USB_CFG_DSC),    // Size of this descriptor in bytes
     USB_DESCRIPTOR_CONFIGURATION,                // CONFIGURATION descriptor type
+    //MODTRONIX added next 7 lines
+    #if defined(BOOT_USE_BULK)
+    0x40,0x00,            // Total length of data for this cfg
+    2,                      // Number of interfaces in this cfg
+    #else
     0x29,0x00,            // Total length of data for this cfg
     1,                      // Number of interfaces in this cfg
+    #endif
     1,                      // Index value of this configuration
     0,                      // Configuration string index
     _DEFAULT | _SELF,       // Attributes, see usbd.h
@@ -230,6 +236,37 @@ ROM BYTE configDescriptor1[]={
 	_INTERRUPT,                       //Attributes
     0x40,0x00,                  //size
     0x01                        //Interval
+
+    //MODTRONIX added next lines
+    #if defined(BOOT_USE_BULK)
+    ,
+    /* Interface Descriptor - Vendor class bulk interface */
+    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
+    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
+    BULK_INTF_ID,           // Interface Number
+    0,                      // Alternate Setting Number
+    2,                      // Number of endpoints in this intf
+    0xFF,                   // Class code (Vendor specific)
+    0xFF,                   // Subclass code
+    0xFF,                   // Protocol code
+    0,                      // Interface string index
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    BULK_EP | _EP_OUT,          //EndpointAddress
+    _BULK,                      //Attributes
+    BULK_EP_SIZE,0x00,          //size
+    0x00,                       //Interval
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    BULK_EP | _EP_IN,           //EndpointAddress
+    _BULK,                      //Attributes
+    BULK_EP_SIZE,0x00,          //size
+    0x00                        //Interval
+    #endif
 };
 
 
@@ -319,6 +319,7 @@
 #define MAX_UDP_SOCKETS         (10u)
 #define UDP_USE_TX_CHECKSUM             // This slows UDP TX performance by nearly 50%, except when using the ENCX24J600,
                                         //which has a super fast DMA and incurs virtually no speed pentalty.
+#define UDP_TX_QUEUE_SIZE       (512u)  // Bytes of RAM for datagrams queued by UDPSendV() while MAC TX buffer is busy, 0 disables queue
 
 
 /* Berkeley API Sockets Configuration
@@ -372,6 +373,8 @@
     #define HTTP_USE_POST                       // Enable POST support
     #define HTTP_USE_COOKIES                    // Enable cookie support
     #define HTTP_USE_AUTHENTICATION             // Enable basic authentication support
+    #define HTTP_USE_DEFLATE                    // Compress dynamic responses (gzip) if client accepts it
+    #define HTTP_USE_SSE                        // Enable Server-Sent Events push channel, see HTTP_SSE_PATH
 
     //#define HTTP_NO_AUTH_WITHOUT_SSL          // Uncomment to require SSL before requesting a password
 
@@ -513,10 +513,9 @@ static HTTP_IO_RESULT HTTPPostConfig(void) {
         return HTTP_IO_NEED_DATA;
 
 
-    // Use current config in non-volatile memory as defaults
-    xeeReadArray(XEEMEM_CFG_STRUCT_START_ADR + offsetof(CFG_STRUCT, net),
-            newNetConfig,
-            sizeof (newNetConfig));
+    // Use current config in non-volatile memory as defaults. Read with cfgGetArray(), it returns
+    // latest values from RAM shadow copy if NZ_APP_CONFIG_LOG_ENABLED is defined.
+    cfgGetArray(offsetof(CFG_STRUCT, net), newNetConfig, sizeof (newNetConfig));
 
     // Start out assuming that DHCP is disabled.  This is necessary since the
     // browser doesn't submit this field if it is unchecked (meaning zero).
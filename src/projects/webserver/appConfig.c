@@ -1457,26 +1457,17 @@ CFG_STRUCT cfgStruct __attribute__ ((space(auto_psv))) = {
 };
 
 void appConfInit(void) {
-    WORD xeeAdr;
     WORD w;
-    BYTE *p;
 
     /////////////////////////////////////////////////
-    //Initialize AppConfig with contents of External EEPROM. At this stage, external EEPROM
-    //should have valid configuration.
+    //Initialize AppConfig with contents of CFG_STRUCT. At this stage, external EEPROM
+    //should have valid configuration. Use cfgGetArray(), so latest values are read from the
+    //RAM shadow copy when NZ_APP_CONFIG_LOG_ENABLED is defined.
 
-    //Initialize Network Settings
-    p = (BYTE*)&AppConfig.MyIPAddr;     //CFG_STRUCT.net starts from AppConfig.MyIPAppr
-    xeeAdr = XEEMEM_CFG_STRUCT_START_ADR + offsetof(CFG_STRUCT, net);
+    //Initialize Network Settings. CFG_STRUCT.net starts from AppConfig.MyIPAppr
     //Get number of bytes to read. AppConfig does NOT contain 'reserve' array
-    //w = sizeof(CFG_BLOCK_NET) -  sizeof(((CFG_BLOCK_NET*)0)->reserve);; //Number of bytes to write
     w = sizeof(((CFG_STRUCT*)0)->net) - sizeof(((CFG_STRUCT*)0)->net.reserve);
-    // TODO Use xeeReadArray() function??
-    xeeBeginRead(xeeAdr);
-    while (w-- != 0) {
-        *p++ = xeeRead();
-    }
-    xeeEndRead();
+    cfgGetArray(offsetof(CFG_STRUCT, net), (BYTE*)&AppConfig.MyIPAddr, (BYTE)w);
     FormatNetBIOSName(AppConfig.NetBIOSName);
     DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nNetbios Name = ");
     DEBUG_PUT_STR(DEBUG_LEVEL_INFO, (const char*)AppConfig.NetBIOSName);
@@ -1486,14 +1477,8 @@ void appConfInit(void) {
     //for details on what is done in working app
     #if defined(WF_CS_TRIS)
     {
-        p = (BYTE*)&AppConfig.MySSID;
-        xeeAdr = XEEMEM_CFG_STRUCT_START_ADR + offsetof(CFG_STRUCT, wifi);
-        w = sizeof(CFG_BLOCK_WIFI); //Number of bytes to write
-        xeeBeginRead(xeeAdr);
-        while (w-- != 0) {
-            *p++ = xeeRead();
-        }
-        xeeEndRead();
+        w = sizeof(CFG_BLOCK_WIFI); //Number of bytes to read
+        cfgGetArray(offsetof(CFG_STRUCT, wifi), (BYTE*)&AppConfig.MySSID, (BYTE)w);
     }
     #endif
 
@@ -1502,16 +1487,9 @@ void appConfInit(void) {
     //for details on what is done in working app
     #if defined(STACK_USE_SNMP_SERVER)
     {
-        p = (BYTE*)&AppConfig.readCommunity;
-        xeeAdr = XEEMEM_CFG_STRUCT_START_ADR + offsetof(CFG_STRUCT, snmp);
         //Get number of bytes to read. AppConfig does NOT contain 'reserve' array
-        w = sizeof(CFG_BLOCK_SNMP) -  sizeof(((CFG_BLOCK_SNMP*)0)->reserve); //Number of bytes to write
-        //w = sizeof(((CFG_STRUCT*)0)->snmp) - sizeof(((CFG_STRUCT*)0)->snmp.reserve);
-        xeeBeginRead(xeeAdr);
-        while (w-- != 0) {
-            *p++ = xeeRead();
-        }
-        xeeEndRead();
+        w = sizeof(CFG_BLOCK_SNMP) -  sizeof(((CFG_BLOCK_SNMP*)0)->reserve); //Number of bytes to read
+        cfgGetArray(offsetof(CFG_STRUCT, snmp), (BYTE*)&AppConfig.readCommunity, (BYTE)w);
     }
     #endif
 }
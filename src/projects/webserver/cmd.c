@@ -588,7 +588,7 @@ WORD cmdExecNameValueCmd(char * name, char * value, void* param1, WORD flags) {
                 //DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, w.Val);
 
                 //Write value to given port
-                portWriteBitadr(portGetLAT(w.Val), (value[0]=='1'));
+                portWrite(w.Val, (value[0]=='1'));
                 //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "-Out");
             }
         }
@@ -816,6 +816,178 @@ BYTE cmp3Bytes(BYTE* src, BYTE* bytes) {
 const BYTE BARR[] = {'5','6'};
 
 
+/**
+ * Writes the configuration of the given port to val. Is 'od' for Digital Output, 'oc' for
+ * Open Collector Output, 'iu' for Input with Pullup, 'iw' for Input with Pulldown and 'id'
+ * for Digital Input.
+ *
+ * @param portId The "Port ID" of the requested port
+ * @param val Buffer to write tag value to
+ * @return Number of bytes written to val
+ */
+static BYTE tagPortConfig(WORD portId, BYTE* val) {
+    PORT_DESC* pDesc;
+
+    //Port not available, report as normal Digital Input
+    if ((portId > PORT_ID_MAX) || !portDescIsValid(pDesc = portDescGet(portId))) {
+        val[0]='i';
+        val[1]='d';
+        return 2;
+    }
+
+    //Port is an output
+    if (portDescReadTRIS(pDesc)==0) {
+        val[0]='o';
+        //Port is normal Digital Output = 'od'
+        if (portDescReadODC(pDesc)==0) {
+            val[1]='d';
+        }
+        //Port is an Open Collector = 'oc'
+        else {
+            val[1]='c';
+        }
+    }
+    //Port is an input
+    else {
+        val[0]='i';
+        //Port is a Digital Input with Pullup resistor enabled = 'iu'
+        if (portDescReadCNPU(pDesc)!=0) {
+            val[1]='u';
+        }
+        //Port is a Digital Input with Pulldown resistor enabled = 'iw'
+        else if (portDescReadCNPD(pDesc)!=0) {
+            val[1]='w';
+        }
+        //Port is an normal Digital Input = 'id'
+        else {
+            val[1]='d';
+        }
+    }
+    return 2;
+}
+
+
+/**
+ * Writes the input value of the given port to val, '0' or '1'.
+ *
+ * @param portId The "Port ID" of the requested port
+ * @param val Buffer to write tag value to
+ * @return Number of bytes written to val
+ */
+static BYTE tagPortInput(WORD portId, BYTE* val) {
+    val[0] = (portRead(portId)==0) ? '0' : '1';
+    return 1;
+}
+
+
+/**
+ * Writes the output (latch) value of the given port to val, '0' or '1'.
+ *
+ * @param portId The "Port ID" of the requested port
+ * @param val Buffer to write tag value to
+ * @return Number of bytes written to val
+ */
+static BYTE tagPortOutput(WORD portId, BYTE* val) {
+    PORT_DESC* pDesc;
+
+    val[0] = '0';
+    if ((portId <= PORT_ID_MAX) && portDescIsValid(pDesc = portDescGet(portId)) && (portDescReadLAT(pDesc)!=0)) {
+        val[0] = '1';
+    }
+    return 1;
+}
+
+
+//Jump table for compiled tags, is indexed with CMD_TAG_HANDLER_XX constants
+static BYTE (* const compiledTagHandlers[CMD_TAG_HANDLER_COUNT])(WORD, BYTE*) = {
+    NULL,           //CMD_TAG_HANDLER_NONE
+    tagPortConfig,  //CMD_TAG_HANDLER_CONFIG
+    tagPortInput,   //CMD_TAG_HANDLER_INPUT
+    tagPortOutput   //CMD_TAG_HANDLER_OUTPUT
+};
+
+
+/**
+ * Compiles the given tag. If the tag can be compiled, the parsed tag is written to the
+ * given CMD_COMPILED_TAG structure, and can be executed with cmdGetCompiledTag().
+ *
+ * @param tag Pointer to string containing tag, can start with '#'
+ * @param compiled The compiled tag is written to this structure
+ * @return Returns TRUE if the tag was compiled, else FALSE
+ */
+BOOL cmdCompileTag(BYTE* tag, CMD_COMPILED_TAG* compiled) {
+    WORD portId;
+
+    compiled->handler = CMD_TAG_HANDLER_NONE;
+    compiled->param = 0;
+
+    if(tag[0]=='#') {
+        tag++;  //Increment past '#'
+    }
+
+    //Only port tags can currently be compiled
+    if (!isdigit(tag[1])) {
+        return FALSE;
+    }
+
+    switch(tag[0]) {
+        case TAG_CONFIG:
+            compiled->handler = CMD_TAG_HANDLER_CONFIG;
+            break;
+        case TAG_INPUT:
+            compiled->handler = CMD_TAG_HANDLER_INPUT;
+            break;
+        case TAG_OUTPUT:
+            compiled->handler = CMD_TAG_HANDLER_OUTPUT;
+            break;
+        default:
+            return FALSE;
+    }
+
+    //Get "Port ID"
+    portId = getPortIdForStr((const char*)&tag[1]);
+    if (portId == IOPORT_ID_NA) {
+        compiled->handler = CMD_TAG_HANDLER_NONE;
+        return FALSE;
+    }
+    compiled->id = portId;
+
+    return TRUE;
+}
+
+
+/**
+ * Get the requested compiled tag. Same as cmdGetTag(), but for a tag compiled with cmdCompileTag().
+ *
+ * @param compiled The compiled tag, as returned by cmdCompileTag()
+ * @param ref Reference, 0 if this is the first call for requesting this tag.
+ * @param dest The destination to write data to. If NULL, data is written to current HTTP
+ *      TCP socket, else dest is a Circular Buffer (CIRBUF*)
+ * @return Returns 0 if done, else a reference.
+ */
+WORD cmdGetCompiledTag(CMD_COMPILED_TAG* compiled, WORD ref, void* dest) {
+    BYTE valLen;
+    BYTE val[4];
+
+    if ((compiled->handler == CMD_TAG_HANDLER_NONE) || (compiled->handler >= CMD_TAG_HANDLER_COUNT)) {
+        return 0;   //Done
+    }
+
+    valLen = (*compiledTagHandlers[compiled->handler])(compiled->id, val);
+
+    if (dest == NULL) {
+        //Write requested data to current TCP socket
+        TCPPutArray(sktHTTP, val, valLen);
+    }
+    else {
+        //Write requested data to circular buffer
+        cbufPutArray((CIRBUF*)dest, val, valLen);
+    }
+
+    return 0;   //Done
+}
+
+
 /**
  * Get the requested tag. The command might not be executed if a higher user level is
  * required.
@@ -857,38 +1029,7 @@ WORD cmdGetTag(BYTE* tag, WORD ref, void* dest, BYTE user, void* param) {
             //Get "Port ID"
             w.Val = getPortIdForStr((const char*)&tag[1]);
             if (w.Val != IOPORT_ID_NA) {
-                //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nTAG i");
-                //DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, w.Val);
-
-                //Port is an output
-                if (portReadBitadr(portGetTRIS(w.Val))==0) {
-                    val[0]='o';
-                    //Port is normal Digital Output = 'od'
-                    if (portReadBitadr(portGetODC(w.Val))==0) {
-                        val[1]='d';
-                    }
-                    //Port is an Open Collector = 'oc'
-                    else {
-                        val[1]='c';
-                    }
-                }
-                //Port is an input
-                else {
-                    val[0]='i';
-                    //Port is a Digital Input with Pullup resistor enabled = 'iu'
-                    if (portReadBitadr(portGetCNPU(w.Val))==1) {
-                        val[1]='u';
-                    }
-                    //Port is a Digital Input with Pulldown resistor enabled = 'iw'
-                    else if (portReadBitadr(portGetCNPD(w.Val))==1) {
-                        val[1] = w.Val;
-                    }
-                    //Port is an normal Digital Input = 'id'
-                    else {
-                        val[1]='d';
-                    }
-                }
-                valLen = 2;
+                valLen = tagPortConfig(w.Val, val);
                 ref = 0;    //Done
             }
         }
@@ -1190,17 +1331,7 @@ WORD cmdGetTag(BYTE* tag, WORD ref, void* dest, BYTE user, void* param) {
             //Get "Port ID"
             w.Val = getPortIdForStr((const char*)&tag[1]);
             if (w.Val != IOPORT_ID_NA) {
-                //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nTAG i");
-                //DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, w.Val);
-
-                //Read requested port
-                if (portReadBitadr(portGetPIN(w.Val))==0) {
-                    val[0]='0';
-                }
-                else {
-                    val[0]='1';
-                }
-                valLen = 1;
+                valLen = tagPortInput(w.Val, val);
                 ref = 0;    //Done
             }
         }
@@ -1409,17 +1540,7 @@ WORD cmdGetTag(BYTE* tag, WORD ref, void* dest, BYTE user, void* param) {
             //Get "Port ID"
             w.Val = getPortIdForStr((const char*)&tag[1]);
             if (w.Val != IOPORT_ID_NA) {
-                //DEBUG_PUT_STR(DEBUG_LEVEL_INFO, "\nTAG o");
-                //DEBUG_PUT_WORD(DEBUG_LEVEL_INFO, w.Val);
-
-                //Read requested port
-                if (portReadBitadr(portGetLAT(w.Val))==0) {
-                    val[0]='0';
-                }
-                else {
-                    val[0]='1';
-                }
-                valLen = 1;
+                valLen = tagPortOutput(w.Val, val);
                 ref = 0;    //Done
             }
         }
@@ -155,6 +155,26 @@ and <a href="http://www.netcruzer.com/project-webserver-tags">www.netcruzer.com/
 #define TAG_USER_Z ('z')        // y "User Tag", only available if USER_TAG_ONLY_X = 0
 
 
+////////// Compiled Tags ////////////////////////
+//Handlers for compiled tags, is index into jump table in cmd.c
+#define CMD_TAG_HANDLER_NONE    0   // Tag could not be compiled, use cmdGetTag() with tag string
+#define CMD_TAG_HANDLER_CONFIG  1   // Config Tag for a port, ex. "c5"
+#define CMD_TAG_HANDLER_INPUT   2   // Input Tag for a port, ex. "i5"
+#define CMD_TAG_HANDLER_OUTPUT  3   // Output Tag for a port, ex. "o5"
+#define CMD_TAG_HANDLER_COUNT   4   // Number of handlers, including CMD_TAG_HANDLER_NONE
+
+/**
+ * A tag that has been parsed by cmdCompileTag(). It can be executed with cmdGetCompiledTag(),
+ * without having to parse the tag string again. Is stored in HTTP_CONN and the HTTP tag cache.
+ */
+typedef struct __attribute__((__packed__))
+{
+    BYTE    handler;    ///< Index of handler in jump table, is a CMD_TAG_HANDLER_XX constant
+    BYTE    param;      ///< Parameter for handler, currently not used
+    WORD    id;         ///< ID for handler, for example "Port ID" for port tags
+} CMD_COMPILED_TAG;
+
+
 ////////// Commands /////////////////////////////
 //k = Application config commands
 //g = General Command
@@ -298,6 +318,41 @@ WORD_VAL cmdParseCirbuf(CIRBUF* pBuf, BYTE size, CIRBUF* cbufReply, BYTE replyCm
 WORD cmdGetTag(BYTE* tag, WORD ref, void* dest, BYTE user, void* param);
 
 
+/**
+ * Compiles the given tag. If the tag can be compiled, the parsed tag is written to the
+ * given CMD_COMPILED_TAG structure, and can be executed with cmdGetCompiledTag(). This
+ * is faster than calling cmdGetTag(), seeing that the tag string does not have to be parsed
+ * again. Only tags that do not depend on the user level, and always complete in a single
+ * call can be compiled. Currently this is the Config, Input and Output tags for ports.
+ *
+ * @param tag Pointer to string containing tag, can start with '#'
+ *
+ * @param compiled The compiled tag is written to this structure. If the tag can not be
+ *      compiled, compiled->handler is set to CMD_TAG_HANDLER_NONE.
+ *
+ * @return Returns TRUE if the tag was compiled, else FALSE
+ */
+BOOL cmdCompileTag(BYTE* tag, CMD_COMPILED_TAG* compiled);
+
+
+/**
+ * Get the requested compiled tag. Same as cmdGetTag(), but for a tag compiled with cmdCompileTag().
+ *
+ * @param compiled The compiled tag, as returned by cmdCompileTag()
+ *
+ * @param ref Reference used by this function to determine if it is the first call, or
+ *      if it should continue from last return. If 0, this is the first call for requesting this tag.
+ *
+ * @param dest The destination to write data to.
+ *      If NULL, the requested data is written to current HTTP TCP socket
+ *      If NOT NULL, dest is a Circular Buffer (CIRBUF*)
+ *
+ * @return Returns 0 if done, else a reference. If a reference is returned, it must be passed
+ * back to this function on the next call.
+ */
+WORD cmdGetCompiledTag(CMD_COMPILED_TAG* compiled, WORD ref, void* dest);
+
+
 /**
  * Writes a single byte to the "User RAM". This function checks the given ptr is located
  * within valid the "User RAM", and returns 0 if all OK.
@@ -41,6 +41,7 @@
 #include "nz_xFlash.h"
 
 //#include "TCPIP Stack/ENCX24J600.h"
+#include "TCPIP Stack/TCPIP.h"
 #include "TCPIP Stack/Helpers.h"
 
 #include "doxygen/src_examples/examples.h"
@@ -282,6 +283,22 @@ void debugService(void) {
                 cbufPutString(CIRBUF_TX_DEBUG, "\nDone");
             }
         }
+        else if (firstChar=='m') {
+            #if defined(STACK_USE_MPFS2) && defined(MPFS_USE_SPI_FLASH) && (MPFS_CACHE_WAYS > 0)
+            //'mpfs cache' = Print hit and miss counters of MPFS SPI Flash read cache
+            if (cbufPacketStrcmp(CIRBUF_RX_DEBUG, "mpfs cache") == 0) {
+                DWORD hits, misses;
+
+                MPFSCacheGetStats(&hits, &misses);
+                debugPutString("\nMPFS Cache Hits=0x");
+                debugPutHexWord((WORD)(hits >> 16));
+                debugPutHexWord((WORD)hits);
+                debugPutString(" Misses=0x");
+                debugPutHexWord((WORD)(misses >> 16));
+                debugPutHexWord((WORD)misses);
+            }
+            #endif
+        }
         else if (firstChar=='t') {
             #if !defined(RELEASE_BUILD)
             //'t1'
@@ -183,6 +183,14 @@
 #define XEEPROM_BUFFER_SIZE      (32)
 
 
+// *********************************************************************
+// ------------ xFlash Configuration (from nz_xFlash.h) ----------------
+// *********************************************************************
+//Queue SPI Flash erases and page programs, and start them from xflashAsyncTask(). Web page (MPFS)
+//and firmware uploads then don't block while the Flash is busy. Comment to use blocking writes.
+#define XFLASH_USE_ASYNC
+
+
 // *********************************************************************
 // ------------ RTC Configuration (from nz_rtc.h) -------------
 // *********************************************************************
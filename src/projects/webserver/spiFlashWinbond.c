@@ -40,6 +40,11 @@
 
 #include "nz_xFlash.h"
 
+#if defined(XFLASH_USE_ASYNC)
+#include "nz_tick.h"
+#include <string.h>
+#endif
+
 //Add debugging to this file. The DEBUG_CONF_SPIFLASH macro sets debugging to desired level, and is configured in "Debug Configuration" section of projdefs.h file
 #if !defined(DEBUG_CONF_SPIFLASH)
     #define DEBUG_CONF_SPIFLASH     DEBUG_CONF_DEFAULT   //Default Debug Level, disabled if DEBUG_LEVEL_ALLOFF defined, else DEBUG_LEVEL_ERROR
@@ -106,6 +111,79 @@
     #error Determine SPI flag mechanism
 #endif
 
+//FAST_READ has a dummy byte after the address, and is only required above the maximum clock of the READ
+//opcode. The SPI bus is shared with the external EEPROM, and runs at Fcy/2 = 8MHz on the PIC24.
+#if !defined(XFLASH_USE_READ_FAST)
+    #if (SPIFLASH_MAX_SPI_FREQ > 25000000ul)
+        #define XFLASH_USE_READ_FAST    1
+    #else
+        #define XFLASH_USE_READ_FAST    0
+    #endif
+#endif
+#if (XFLASH_USE_READ_FAST == 1)
+    #define XFLASH_READ_OPCODE      READ_FAST
+    #define XFLASH_READ_HDR_SIZE    5       //Opcode, 3 address bytes and dummy byte
+#else
+    #define XFLASH_READ_OPCODE      READ
+    #define XFLASH_READ_HDR_SIZE    4       //Opcode and 3 address bytes
+#endif
+
+//Streaming reads use the Enhanced Buffer mode of the SPI peripheral. The TX and RX FIFOs keep the SPI
+//clock running between bytes. It is only enabled between xflashBeginRead() and xflashEndRead(), because
+//all other code using this SPI bus waits for each byte.
+#if defined(__C30__)
+    #if !defined(SPIFLASH_SPICON2) && defined(SPIMEM_SPICON2)
+        #define SPIFLASH_SPICON2    SPIMEM_SPICON2
+    #endif
+    #if defined(SPIFLASH_SPICON2)
+        #define SPIFLASH_HAS_ENHBUF
+        #define SPIFLASH_FIFO_DEPTH     8
+        #define SpiFlashRxFifoEmpty()   (SPIFLASH_SPISTATbits.SRXMPT)
+        #define SpiFlashTxFifoFull()    (SPIFLASH_SPISTATbits.SPITBF)
+        #define SpiFlashEnhBufOn()      {SPIFLASH_SPISTATbits.SPIEN = 0; SPIFLASH_SPICON2 |= 0x0001; SPIFLASH_SPISTATbits.SPIEN = 1;}
+        #define SpiFlashEnhBufOff()     {SPIFLASH_SPISTATbits.SPIEN = 0; SPIFLASH_SPICON2 &= ~0x0001; SPIFLASH_SPISTATbits.SPIEN = 1;}
+    #endif
+#elif defined(__PIC32MX__) && !defined(XFLASH_USE_DMA)
+    #define SPIFLASH_HAS_ENHBUF
+    #define SPIFLASH_FIFO_DEPTH     8       //FIFO is 16 deep in 8-bit mode, 8 is enough to keep clock running
+    #define SpiFlashRxFifoEmpty()   (SPIFLASH_SPISTATbits.SPIRBE)
+    #define SpiFlashTxFifoFull()    (SPIFLASH_SPISTATbits.SPITBF)
+    #define SpiFlashEnhBufOn()      {SPIFLASH_SPICON1bits.ON = 0; SPIFLASH_SPICON1bits.ENHBUF = 1; SPIFLASH_SPICON1bits.ON = 1;}
+    #define SpiFlashEnhBufOff()     {SPIFLASH_SPICON1bits.ON = 0; SPIFLASH_SPICON1bits.ENHBUF = 0; SPIFLASH_SPICON1bits.ON = 1;}
+#endif
+
+//PIC32 only. Reads of at least XFLASH_DMA_MIN bytes use two DMA channels, triggered by the SPI TX and RX
+//interrupts. The RX channel has a higher priority, so the RX buffer is never overrun.
+#if defined(XFLASH_USE_DMA)
+    #if !defined(__PIC32MX__)
+        #error "XFLASH_USE_DMA is only supported on the PIC32MX, PIC24FJ has no DMA!"
+    #endif
+    #if !defined(XFLASH_DMA_TX_CH)
+        #define XFLASH_DMA_TX_CH        6
+    #endif
+    #if !defined(XFLASH_DMA_RX_CH)
+        #define XFLASH_DMA_RX_CH        7
+    #endif
+    #if !defined(XFLASH_DMA_TX_IRQ)
+        #define XFLASH_DMA_TX_IRQ       _SPI2_TX_IRQ
+    #endif
+    #if !defined(XFLASH_DMA_RX_IRQ)
+        #define XFLASH_DMA_RX_IRQ       _SPI2_RX_IRQ
+    #endif
+    #if !defined(XFLASH_DMA_MIN)
+        #define XFLASH_DMA_MIN          16      //Smaller reads are faster without DMA setup
+    #endif
+    #define XFLASH_DMA_MAX_BLOCK        256     //Largest block all PIC32MX DMA controllers can do
+
+    //Get DMA register for given channel number, for example XFLASH_DCH(7, CON) is DCH7CON
+    #define XFLASH_DCH(ch, reg)         _XFLASH_DCH(ch, reg)
+    #define _XFLASH_DCH(ch, reg)        DCH##ch##reg
+    #define XFLASH_DCHCON_CHEN          0x00000080ul    //Channel enable
+    #define XFLASH_DCHECON_CFORCE       0x00000080ul    //Force a single cell transfer
+    #define XFLASH_DCHECON_SIRQEN       0x00000010ul    //Start cell transfer on CHSIRQ
+    #define XFLASH_DCHINT_CHBCIF        0x00000008ul    //Block transfer complete
+#endif
+
 typedef union __attribute__((aligned(2), packed)) {
     struct
     {
@@ -156,6 +234,34 @@ static void _WaitWhileBusy(void);
 //static void _GetStatus(void);
 static void SPIFlashClearWriteProtection(void);
 
+#if defined(XFLASH_USE_ASYNC)
+#define XFLASH_JOB_ERASE    0   //Erase 4K sector
+#define XFLASH_JOB_PROGRAM  1   //Program page buffer, never crosses a page boundary
+
+typedef struct XFLASH_JOB_
+{
+    DWORD   adr;    //Flash address
+    WORD    len;    //Number of bytes in page buffer, only for XFLASH_JOB_PROGRAM
+    BYTE    type;   //XFLASH_JOB_xxx
+    BYTE    page;   //Index of page buffer in asyncPages[], only for XFLASH_JOB_PROGRAM
+} XFLASH_JOB;
+
+static XFLASH_JOB asyncJobs[XFLASH_ASYNC_JOBS];     //Job queue, oldest job is asyncJobs[asyncJobHead]
+static BYTE asyncPages[XFLASH_ASYNC_PAGES][SPI_FLASH_PAGE_SIZE];   //Page buffers, freed in same order they are allocated
+static BYTE asyncJobHead;
+static BYTE asyncJobCount;
+static BYTE asyncPageHead;
+static BYTE asyncPageCount;
+static BOOL asyncBusy;          //Oldest job has been started, and Flash might still be busy with it
+static BOOL asyncFlush;         //Program last page, even if it is not full
+static WORD asyncTmrFlush;      //Program last page when this timer expires, even if it is not full
+static DWORD asyncWrAdr;        //Write cursor
+static DWORD asyncEraseNext;    //Next sector to erase ahead of write cursor
+static DWORD asyncEraseEnd;     //Sectors from this address on are not erased ahead of write cursor
+
+static void asyncWaitCurrent(void);
+#endif
+
 
 /**
  * Initializes SPI Flash module. This function is only called once during the
@@ -236,23 +342,64 @@ void xflashInit(void)
  */
 void xflashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen)
 {
-    volatile BYTE Dummy;
-
     // Ignore operations when the destination is NULL or nothing to read
     if(vData == NULL || wLen == 0)
         return;
 
-    #define CLOCK8MBIT_SPICON1 0x013b;    //SPI Clock = 8Mbit/sec, Primary prescaler 1:1, Secondary prescale 2:1
-    #define CLOCK4MBIT_SPICON1 0x0133;    //SPI Clock = 4Mbit/sec, Primary prescaler 1:1, Secondary prescale 4:1
-    #define CLOCK2MBIT_SPICON1 0x013a;    //SPI Clock = 2Mbit/sec, Primary prescaler 4:1, Secondary prescale 2:1
-    #define CLOCK1MBIT_SPICON1 0x0132;    //SPI Clock = 2Mbit/sec, Primary prescaler 4:1, Secondary prescale 4:1
+    xflashBeginRead(dwAddress);
+    xflashReadNext(vData, wLen);
+    xflashEndRead();
+}
+
+
+/**
+ * Starts a streaming read from the SPI Flash module. The chip select is left
+ * asserted, and following calls to xflashReadNext() continue reading from
+ * sequential addresses. Must be terminated with xflashEndRead().
+ *
+ * @preCondition xflashInit has been called, and the chip is not busy (should be
+ * handled elsewhere automatically.)
+ *
+ * @param dwAddress Address from which to start reading
+ */
+void xflashBeginRead(DWORD dwAddress)
+{
+    volatile BYTE Dummy;
+
+    #if defined(SPIFLASH_HAS_ENHBUF)
+    BYTE i;
+    #endif
+
+    #if defined(XFLASH_USE_ASYNC)
+    asyncWaitCurrent();
+    #endif
+
+    #if defined(SPIFLASH_HAS_ENHBUF)
+    SpiFlashEnhBufOn();
 
+    // Activate chip select
+    SPIFLASH_CS_IO = 0;
+
+    // Opcode, address and dummy byte all fit in the TX FIFO
+    SPIFLASH_SSPBUF = XFLASH_READ_OPCODE;
+    SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[2];
+    SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[1];
+    SPIFLASH_SSPBUF = ((BYTE*)&dwAddress)[0];
+    #if (XFLASH_USE_READ_FAST == 1)
+    SPIFLASH_SSPBUF = 0;
+    #endif
+
+    for (i = 0; i < XFLASH_READ_HDR_SIZE; i++) {
+        while (SpiFlashRxFifoEmpty());
+        Dummy = SPIFLASH_SSPBUF;
+    }
+    #else
     // Activate chip select
     SPIFLASH_CS_IO = 0;
     ClearSPIDoneFlag();
 
     // Send READ opcode
-    SPIFLASH_SSPBUF = READ;
+    SPIFLASH_SSPBUF = XFLASH_READ_OPCODE;
     WaitForDataByte();
     Dummy = SPIFLASH_SSPBUF;
 
@@ -269,6 +416,98 @@ void xflashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen)
     WaitForDataByte();
     Dummy = SPIFLASH_SSPBUF;
 
+    #if (XFLASH_USE_READ_FAST == 1)
+    SPIFLASH_SSPBUF = 0;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+    #endif
+    #endif
+}
+
+
+#if defined(XFLASH_USE_DMA)
+/**
+ * Reads given number of bytes with DMA. The data sent while reading is don't care, so the TX channel
+ * sends the destination buffer. It is always ahead of the RX channel writing to it.
+ *
+ * @param vData Where to store data that has been read
+ * @param wLen Length of data to read
+ */
+static void xflashReadDma(BYTE *vData, WORD wLen)
+{
+    WORD n;
+
+    DMACONSET = _DMACON_ON_MASK;    //Enable DMA controller
+
+    while (wLen) {
+        n = (wLen > XFLASH_DMA_MAX_BLOCK) ? XFLASH_DMA_MAX_BLOCK : wLen;
+
+        //RX channel, from SPI buffer to vData
+        XFLASH_DCH(XFLASH_DMA_RX_CH, CONCLR) = XFLASH_DCHCON_CHEN;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, INTCLR) = 0x000000fful;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, SSA) = KVA_TO_PA(&SPIFLASH_SSPBUF);
+        XFLASH_DCH(XFLASH_DMA_RX_CH, DSA) = KVA_TO_PA(vData);
+        XFLASH_DCH(XFLASH_DMA_RX_CH, SSIZ) = 1;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, DSIZ) = n;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, CSIZ) = 1;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, ECON) = (((DWORD)XFLASH_DMA_RX_IRQ) << 8) | XFLASH_DCHECON_SIRQEN;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, CON) = XFLASH_DCHCON_CHEN | 3;
+
+        //TX channel, from vData to SPI buffer. First byte is forced, following bytes when TX buffer is empty
+        XFLASH_DCH(XFLASH_DMA_TX_CH, CONCLR) = XFLASH_DCHCON_CHEN;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, INTCLR) = 0x000000fful;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, SSA) = KVA_TO_PA(vData);
+        XFLASH_DCH(XFLASH_DMA_TX_CH, DSA) = KVA_TO_PA(&SPIFLASH_SSPBUF);
+        XFLASH_DCH(XFLASH_DMA_TX_CH, SSIZ) = n;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, DSIZ) = 1;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, CSIZ) = 1;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, ECON) = (((DWORD)XFLASH_DMA_TX_IRQ) << 8) | XFLASH_DCHECON_SIRQEN;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, CON) = XFLASH_DCHCON_CHEN | 2;
+        XFLASH_DCH(XFLASH_DMA_TX_CH, ECONSET) = XFLASH_DCHECON_CFORCE;
+
+        //Wait for last byte to be received
+        while ((XFLASH_DCH(XFLASH_DMA_RX_CH, INT) & XFLASH_DCHINT_CHBCIF) == 0);
+
+        XFLASH_DCH(XFLASH_DMA_TX_CH, CONCLR) = XFLASH_DCHCON_CHEN;
+        XFLASH_DCH(XFLASH_DMA_RX_CH, CONCLR) = XFLASH_DCHCON_CHEN;
+        vData += n;
+        wLen -= n;
+    }
+}
+#endif
+
+
+/**
+ * Reads the next array of bytes of a streaming read started with xflashBeginRead().
+ *
+ * @param vData Where to store data that has been read
+ * @param wLen Length of data to read
+ */
+void xflashReadNext(BYTE *vData, WORD wLen)
+{
+    #if defined(SPIFLASH_HAS_ENHBUF)
+    WORD txLeft = wLen;
+
+    // Keep TX FIFO filled, but never have more bytes in flight than the RX FIFO can hold
+    while (wLen) {
+        while ((txLeft != 0) && ((wLen - txLeft) < SPIFLASH_FIFO_DEPTH) && !SpiFlashTxFifoFull()) {
+            SPIFLASH_SSPBUF = 0;
+            txLeft--;
+        }
+
+        while (!SpiFlashRxFifoEmpty()) {
+            *vData++ = SPIFLASH_SSPBUF;
+            wLen--;
+        }
+    }
+    #else
+    #if defined(XFLASH_USE_DMA)
+    if (wLen >= XFLASH_DMA_MIN) {
+        xflashReadDma(vData, wLen);
+        return;
+    }
+    #endif
+
     // Read data
     while(wLen--)
     {
@@ -276,9 +515,21 @@ void xflashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen)
         WaitForDataByte();
         *vData++ = SPIFLASH_SSPBUF;
     }
+    #endif
+}
 
+
+/**
+ * Ends a streaming read started with xflashBeginRead().
+ */
+void xflashEndRead(void)
+{
     // Deactivate chip select
     SPIFLASH_CS_IO = 1;
+
+    #if defined(SPIFLASH_HAS_ENHBUF)
+    SpiFlashEnhBufOff();
+    #endif
 }
 
 
@@ -306,6 +557,10 @@ void xflashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen)
  */
 void xflashBeginWrite(DWORD dwAddr)
 {
+    #if defined(XFLASH_USE_ASYNC)
+    xflashAsyncWaitIdle();
+    #endif
+
     dwWriteAddr = dwAddr;
 
     //Ensure write protection bits are not set
@@ -336,6 +591,10 @@ void xflashWrite(BYTE vData)
 {
     volatile BYTE Dummy;
 
+    #if defined(XFLASH_USE_ASYNC)
+    xflashAsyncWaitIdle();
+    #endif
+
     // If address is a boundary, erase a sector first
     if((dwWriteAddr & SPI_FLASH_SECTOR_MASK) == 0u)
         xflashEraseSector(dwWriteAddr);
@@ -408,6 +667,10 @@ void xflashWriteArray(BYTE* vData, WORD wLen, BOOL bEraseSector)
     if(wLen == 0u)
         return;
 
+    #if defined(XFLASH_USE_ASYNC)
+    xflashAsyncWaitIdle();
+    #endif
+
     //if (manufactID == MNFR_ID_WINBOND) {
 
         // Loop over all data to be written
@@ -590,6 +853,10 @@ void xflashEraseSector(DWORD dwAddr)
 {
     volatile BYTE Dummy;
 
+    #if defined(XFLASH_USE_ASYNC)
+    xflashAsyncWaitIdle();
+    #endif
+
     //Ensure write protection bits are not set
     SPIFlashClearWriteProtection();
 
@@ -801,5 +1068,295 @@ void SPIFlashClearWriteProtection() {
 }
 
 
+#if defined(XFLASH_USE_ASYNC)
+/**
+ * Returns the last job if it is a program job data can still be added to. This is the case if
+ * it has not been started yet, ends at the write cursor, and is not full.
+ */
+static XFLASH_JOB* asyncGetOpenJob(void)
+{
+    XFLASH_JOB* p;
+
+    if ((asyncJobCount == 0) || (asyncBusy && (asyncJobCount == 1)))
+        return NULL;
+
+    p = &asyncJobs[(asyncJobHead + asyncJobCount - 1) % XFLASH_ASYNC_JOBS];
+    if ((p->type != XFLASH_JOB_PROGRAM) || ((p->adr + p->len) != asyncWrAdr) || ((asyncWrAdr & SPI_FLASH_PAGE_MASK) == 0))
+        return NULL;
+
+    return p;
+}
+
+
+/**
+ * Reads the status register once, and returns TRUE if the Flash is busy.
+ */
+static BOOL asyncReadBusy(void)
+{
+    volatile BYTE Dummy;
+
+    // Activate chip select
+    SPIFLASH_CS_IO = 0;
+    ClearSPIDoneFlag();
+
+    // Send Read Status Register instruction, and read status
+    SPIFLASH_SSPBUF = RDSR;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = 0x00;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Deactivate chip select
+    SPIFLASH_CS_IO = 1;
+
+    return (Dummy & BUSY) ? TRUE : FALSE;
+}
+
+
+/**
+ * Removes the oldest job from the queue, it has been completed.
+ */
+static void asyncCompleteJob(void)
+{
+    if (asyncJobs[asyncJobHead].type == XFLASH_JOB_PROGRAM) {
+        asyncPageHead = (asyncPageHead + 1) % XFLASH_ASYNC_PAGES;
+        asyncPageCount--;
+    }
+    asyncJobHead = (asyncJobHead + 1) % XFLASH_ASYNC_JOBS;
+    asyncJobCount--;
+    asyncBusy = FALSE;
+}
+
+
+/**
+ * Starts the oldest job. The erase or program is started when the chip select is deactivated, and
+ * xflashAsyncTask() polls the status register until it is done.
+ */
+static void asyncStartJob(void)
+{
+    volatile BYTE Dummy;
+    XFLASH_JOB* p;
+    BYTE* ptr;
+    WORD i;
+
+    p = &asyncJobs[asyncJobHead];
+
+    //Ensure write protection bits are not set
+    SPIFlashClearWriteProtection();
+
+    // Enable writing
+    _SendCmd(WREN);
+
+    // Activate the chip select
+    SPIFLASH_CS_IO = 0;
+    ClearSPIDoneFlag();
+
+    // Issue ERASE or WRITE command with address
+    SPIFLASH_SSPBUF = (p->type == XFLASH_JOB_ERASE) ? ERASE_4K : WRITE;
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*)&p->adr)[2];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*)&p->adr)[1];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    SPIFLASH_SSPBUF = ((BYTE*)&p->adr)[0];
+    WaitForDataByte();
+    Dummy = SPIFLASH_SSPBUF;
+
+    // Write the page buffer
+    if (p->type == XFLASH_JOB_PROGRAM) {
+        ptr = asyncPages[p->page];
+        for (i = 0; i < p->len; i++) {
+            SPIFLASH_SSPBUF = *ptr++;
+            WaitForDataByte();
+            Dummy = SPIFLASH_SSPBUF;
+        }
+    }
+
+    // Deactivate chip select to start the erase or program
+    SPIFLASH_CS_IO = 1;
+    asyncBusy = TRUE;
+}
+
+
+/**
+ * Waits for the erase or program currently in progress to finish. Queued jobs are not started.
+ */
+static void asyncWaitCurrent(void)
+{
+    if (asyncBusy) {
+        _WaitWhileBusy();
+        asyncCompleteJob();
+    }
+}
+
+
+/**
+ * Sets the write cursor for following xflashAsyncWriteArray() calls, see nz_xFlash.h for details.
+ */
+void xflashAsyncBeginWrite(DWORD dwAddr, DWORD dwEraseEnd)
+{
+    asyncWrAdr = dwAddr;
+    asyncEraseNext = (dwAddr + SPI_FLASH_SECTOR_MASK) & ~((DWORD)SPI_FLASH_SECTOR_MASK);
+    asyncEraseEnd = dwEraseEnd;
+}
+
+
+/**
+ * Queues given data for writing at the current write cursor, see nz_xFlash.h for details.
+ */
+WORD xflashAsyncWriteArray(BYTE* vData, WORD wLen)
+{
+    XFLASH_JOB* p;
+    WORD n;
+    WORD done = 0;
+
+    while (done < wLen) {
+        //Erase current and next sector ahead of write cursor
+        while ((asyncEraseNext <= (asyncWrAdr + SPI_FLASH_SECTOR_SIZE)) && (asyncEraseNext < asyncEraseEnd)) {
+            if (xflashAsyncEraseSector(asyncEraseNext) == FALSE)
+                break;
+            asyncEraseNext += SPI_FLASH_SECTOR_SIZE;
+        }
+
+        //Sector at write cursor has to be queued for erasing before data is written to it
+        if ((asyncEraseNext <= asyncWrAdr) && (asyncEraseNext < asyncEraseEnd))
+            break;
+
+        //Add to last page buffer if possible, else start a new one
+        if ((p = asyncGetOpenJob()) == NULL) {
+            if ((asyncJobCount >= XFLASH_ASYNC_JOBS) || (asyncPageCount >= XFLASH_ASYNC_PAGES))
+                break;
+
+            p = &asyncJobs[(asyncJobHead + asyncJobCount++) % XFLASH_ASYNC_JOBS];
+            p->type = XFLASH_JOB_PROGRAM;
+            p->adr = asyncWrAdr;
+            p->len = 0;
+            p->page = (asyncPageHead + asyncPageCount++) % XFLASH_ASYNC_PAGES;
+        }
+
+        //Copy up to end of page
+        n = SPI_FLASH_PAGE_SIZE - (WORD)(asyncWrAdr & SPI_FLASH_PAGE_MASK);
+        if (n > (wLen - done))
+            n = wLen - done;
+        memcpy(&asyncPages[p->page][p->len], &vData[done], n);
+        p->len += n;
+        asyncWrAdr += n;
+        done += n;
+    }
+
+    if (done != 0) {
+        asyncFlush = FALSE;
+        tick16SetTmrMS(asyncTmrFlush, tick16ConvertFromMS(XFLASH_ASYNC_FLUSH_TIME));
+    }
+
+    return done;
+}
+
+
+/**
+ * Queues the erase of the sector containing given address, see nz_xFlash.h for details.
+ */
+BOOL xflashAsyncEraseSector(DWORD dwAddr)
+{
+    XFLASH_JOB* p;
+
+    if (asyncJobCount >= XFLASH_ASYNC_JOBS)
+        return FALSE;
+
+    p = &asyncJobs[(asyncJobHead + asyncJobCount++) % XFLASH_ASYNC_JOBS];
+    p->type = XFLASH_JOB_ERASE;
+    p->adr = dwAddr & ~((DWORD)SPI_FLASH_SECTOR_MASK);
+    return TRUE;
+}
+
+
+/**
+ * Gets the number of bytes xflashAsyncWriteArray() will currently accept, see nz_xFlash.h for details.
+ */
+WORD xflashAsyncGetFree(void)
+{
+    WORD n = 0;
+    BYTE jobs;
+    BYTE pages;
+
+    //Two jobs are reserved for erasing ahead of write cursor
+    jobs = XFLASH_ASYNC_JOBS - asyncJobCount;
+    jobs = (jobs > 2) ? (jobs - 2) : 0;
+    pages = XFLASH_ASYNC_PAGES - asyncPageCount;
+    if (pages > jobs)
+        pages = jobs;
+
+    //Space in last page buffer, or in first new one if write cursor is not on a page boundary
+    if ((asyncGetOpenJob() != NULL) || (pages != 0)) {
+        n = SPI_FLASH_PAGE_SIZE - (WORD)(asyncWrAdr & SPI_FLASH_PAGE_MASK);
+        if (asyncGetOpenJob() == NULL)
+            pages--;
+    }
+
+    return n + (pages * SPI_FLASH_PAGE_SIZE);
+}
+
+
+/**
+ * Causes a partially filled last page to be programmed without waiting for more data.
+ */
+void xflashAsyncFlush(void)
+{
+    asyncFlush = TRUE;
+}
+
+
+/**
+ * Checks if all queued erases and programs have completed.
+ */
+BOOL xflashAsyncIsIdle(void)
+{
+    return (asyncJobCount == 0) ? TRUE : FALSE;
+}
+
+
+/**
+ * Flushes the queue, and waits until all queued erases and programs have completed.
+ */
+void xflashAsyncWaitIdle(void)
+{
+    asyncFlush = TRUE;
+    while (asyncJobCount != 0) {
+        xflashAsyncTask();
+    }
+}
+
+
+/**
+ * Polls the Flash if busy, and starts the next queued job when it is done.
+ */
+void xflashAsyncTask(void)
+{
+    if (asyncBusy) {
+        if (asyncReadBusy())
+            return;
+        asyncCompleteJob();
+    }
+
+    if (asyncJobCount == 0)
+        return;
+
+    //Wait for more data if only job is a page that is not full yet
+    if ((asyncGetOpenJob() == &asyncJobs[asyncJobHead]) && (asyncFlush == FALSE) && (tick16TestTmr(asyncTmrFlush) == 0))
+        return;
+
+    asyncStartJob();
+}
+#endif  //#if defined(XFLASH_USE_ASYNC)
+
+
 #endif //#if defined(SPIFLASH_CS_TRIS)
 